@@ -84,7 +84,9 @@ mat3 get_tbn(in float bscale, in vec3 n) {
 	return get_tbn_default(bscale, n);
 }
 vec3 get_bump_map_normal() {
-	return normalize(texture(bump_map, tc).xyz * 2.0 - 1.0);
+	vec3 n = texture(bump_map, tc).xyz * 2.0 - 1.0;
+	if (n.z < -0.99) {n.z = sqrt(max(0.0, 1.0 - dot(n.xy, n.xy)));} // two channel (BC5) normal map
+	return normalize(n);
 }
 #endif // !BUMP_MAP_CUSTOM
 
@@ -9,6 +9,7 @@ vec3 get_bump_map_normal_dnm(in float bump_scale, in vec3 eye_pos) {
 	vec3 nmap2= texture(detail_normal_tex, detail_normal_tex_scale*tc/6.0).rgb;
 	nmap = mix(nmap, nmap2, clamp((length(eye_pos) - 0.8), 0.0, 1.0));
 #endif
+	if (nmap.b < 0.005) {nmap.b = 0.5 + 0.5*sqrt(max(0.0, 1.0 - dot(2.0*nmap.rg - 1.0, 2.0*nmap.rg - 1.0)));} // two channel (BC5) normal map
 	return normalize(mix(vec3(0,0,1), (2.0*nmap - 1.0), bump_scale));
 }
 vec3 get_bump_map_normal() {
@@ -75,7 +75,7 @@ bool store_cobj_accum_lighting_as_blocked(0), all_model3d_ref_update(0), begin_m
 bool enable_model3d_bump_maps(1), use_obj_file_bump_grayscale(1), invert_bump_maps(0), use_interior_cube_map_refl(0), enable_cube_map_bump_maps(1), no_store_model_textures_in_memory(0);
 bool enable_model3d_custom_mipmaps(1), flatten_tt_mesh_under_models(0), show_map_view_mandelbrot(0), smileys_chase_player(0), disable_fire_delay(0), disable_recoil(0);
 bool enable_dpart_shadows(0), enable_tt_model_reflect(1), enable_tt_model_indir(0), auto_calc_tt_model_zvals(0), use_model_lod_blocks(0), enable_translocator(0), enable_grass_fire(0);
-bool disable_model_textures(0), start_in_inf_terrain(0), allow_shader_invariants(1), config_unlimited_weapons(0);
+bool disable_model_textures(0), start_in_inf_terrain(0), allow_shader_invariants(1), config_unlimited_weapons(0), headless_mode(0);
 int xoff(0), yoff(0), xoff2(0), yoff2(0), rand_gen_index(0), mesh_rgen_index(0), camera_change(1), camera_in_air(0), auto_time_adv(0);
 int animate(1), animate2(1), draw_model(0), init_x(STARTING_INIT_X), fire_key(0), do_run(0), init_num_balls(-1), change_wmode_frame(0);
 int game_mode(0), map_mode(0), load_hmv(0), load_coll_objs(1), read_landscape(0), screen_reset(0), mesh_seed(0), rgen_seed(1);
@@ -93,7 +93,7 @@ int enable_fsource(0), run_forward(0), advanced(0), dynamic_mesh_scroll(0);
 int read_snow_file(0), write_snow_file(0), mesh_detail_tex(NOISE_TEX);
 int read_light_files[NUM_LIGHTING_TYPES] = {0}, write_light_files[NUM_LIGHTING_TYPES] = {0};
 unsigned num_snowflakes(0), create_voxel_landscape(0), hmap_filter_width(0), num_dynam_parts(100), snow_coverage_resolution(2), num_birds_per_tile(2), num_fish_per_tile(15);
-unsigned erosion_iters(0), erosion_iters_tt(0), video_framerate(60);
+unsigned erosion_iters(0), erosion_iters_tt(0), video_framerate(60), model_simplify_levels(0), headless_frames(0), hmap_tile_size(256);
 float NEAR_CLIP(DEF_NEAR_CLIP), FAR_CLIP(DEF_FAR_CLIP), system_max_orbit(1.0);
 float water_plane_z(0.0), base_gravity(1.0), crater_depth(1.0), crater_radius(1.0), disabled_mesh_z(FAR_CLIP), vegetation(1.0), atmosphere(1.0), biome_x_offset(0.0);
 float mesh_file_scale(1.0), mesh_file_tz(0.0), speed_mult(1.0), mesh_z_cutoff(-FAR_CLIP), relh_adj_tex(0.0), dodgeball_metalness(1.0), ray_step_size_mult(1.0);
@@ -103,10 +103,12 @@ float CAMERA_RADIUS(DEF_CAMERA_RADIUS), C_STEP_HEIGHT(0.6), waypoint_sz_thresh(1
 float ocean_wave_height(DEF_OCEAN_WAVE_HEIGHT), tree_density_thresh(0.55), model_auto_tc_scale(0.0), model_triplanar_tc_scale(0.0), shadow_map_pcf_offset(0.0);
 float custom_glaciate_exp(0.0), tree_type_rand_zone(0.0), jump_height(1.0), force_czmin(0.0), force_czmax(0.0), smap_thresh_scale(1.0), dlight_intensity_scale(1.0);
 float model_mat_lod_thresh(5.0), clouds_per_tile(0.5), def_atmosphere(1.0), def_vegetation(1.0), ocean_depth_opacity_mult(1.0), erode_amount(1.0), ambient_scale(1.0);
+float model_simplify_lod_scale(1.0);
 float light_int_scale[NUM_LIGHTING_TYPES] = {1.0, 1.0, 1.0, 1.0, 1.0}, first_ray_weight[NUM_LIGHTING_TYPES] = {1.0, 1.0, 1.0, 1.0, 1.0};
 double camera_zh(0.0);
 point mesh_origin(all_zeros), camera_pos(all_zeros), cube_map_center(all_zeros);
-string user_text, cobjs_out_fn, sphere_materials_fn, hmap_out_fn;
+string user_text, cobjs_out_fn, sphere_materials_fn, hmap_out_fn, cache_dir; // cache_dir: base dir for generated cache files; empty = per-user cache dir
+extern string texture_cache_dir;
 colorRGB ambient_lighting_scale(1,1,1), mesh_color_scale(1,1,1);
 colorRGBA bkg_color, flower_color(ALPHA0);
 set<unsigned char> keys, keyset;
@@ -124,15 +126,17 @@ char player_name[MAX_CHARS] = "Player";
 bool vert_opt_flags[3] = {0}; // {enable, full_opt, verbose}
 
 
-extern bool clear_landscape_vbo, use_dense_voxels, tree_4th_branches, model_calc_tan_vect, water_is_lava, use_grass_tess, def_tex_compress;
+extern bool clear_landscape_vbo, use_dense_voxels, compact_lightmap, tree_4th_branches, tree_gen_bench, model_calc_tan_vect, water_is_lava, use_grass_tess, def_tex_compress;
+extern bool mipmap_gamma_correct, mipmap_use_kaiser, mipmap_bench, cpu_tex_compress, bc5_normal_maps, tex_compress_bench, tex_load_bench, voxel_mc_bench, smoke_bench, fire_bench, water_bench, model_3ds_bench, movable_cobj_bench, use_gjk_narrow_phase, gjk_bench, grass_bench, smiley_parallel_ai, smiley_ai_bench, use_sw_occlusion, occlusion_bench, use_frame_arena, frame_arena_bench, model_simplify_bench, csg_bench;
 extern int camera_flight, DISABLE_WATER, DISABLE_SCENERY, camera_invincible, onscreen_display, mesh_freq_filter, show_waypoints;
 extern int tree_coll_level, GLACIATE, UNLIMITED_WEAPONS, destroy_thresh, MAX_RUN_DIST, mesh_gen_mode, mesh_gen_shape, map_drag_x, map_drag_y;
-extern unsigned NPTS, NRAYS, LOCAL_RAYS, GLOBAL_RAYS, DYNAMIC_RAYS, NUM_THREADS, MAX_RAY_BOUNCES, grass_density, max_unique_trees, shadow_map_sz;
-extern unsigned scene_smap_vbo_invalid, spheres_mode, max_cube_map_tex_sz, DL_GRID_BS;
-extern float fticks, team_damage, self_damage, player_damage, smiley_damage, smiley_speed, tree_deadness, tree_dead_prob, lm_dz_adj, nleaves_scale, flower_density, universe_ambient_scale;
+extern unsigned NPTS, NRAYS, LOCAL_RAYS, GLOBAL_RAYS, DYNAMIC_RAYS, NUM_THREADS, MAX_RAY_BOUNCES, grass_density, max_unique_trees, shadow_map_sz, waypoint_bench_agents, sw_occlusion_width, sw_max_occluders;
+extern unsigned scene_smap_vbo_invalid, spheres_mode, max_cube_map_tex_sz, DL_GRID_BS, smoke_substeps;
+extern int iticks;
+extern float fticks, tstep, TIMESTEP, team_damage, self_damage, player_damage, smiley_damage, smiley_speed, tree_deadness, tree_dead_prob, lm_dz_adj, nleaves_scale, flower_density, universe_ambient_scale;
 extern float mesh_scale, tree_scale, mesh_height_scale, smiley_acc, hmv_scale, last_temp, grass_length, grass_width, branch_radius_scale, tree_height_scale, planet_update_rate;
 extern float MESH_START_MAG, MESH_START_FREQ, MESH_MAG_MULT, MESH_FREQ_MULT, def_tex_aniso;
-extern double map_x, map_y;
+extern double map_x, map_y, tfticks, sim_ticks;
 extern point hmv_pos, camera_last_pos;
 extern colorRGBA sunlight_color;
 extern int coll_id[];
@@ -962,6 +966,9 @@ void keyboard_proc(unsigned char key, int x, int y) {
 	case 'u': // toggle timing profiler
 		toggle_timing_profiler();
 		break;
+	case 'O': // print current and peak memory usage by subsystem
+		print_mem_usage();
+		break;
 
 	case '=': // increase temp
 		temperature += TEMP_INCREMENT;
@@ -1607,6 +1614,7 @@ int load_config(string const &config_file) {
 	kwmb.add("texture_alpha_in_red_comp", texture_alpha_in_red_comp);
 	kwmb.add("use_model2d_tex_mipmaps", use_model2d_tex_mipmaps);
 	kwmb.add("use_dense_voxels", use_dense_voxels);
+	kwmb.add("compact_lightmap", compact_lightmap);
 	kwmb.add("use_voxel_cobjs", use_voxel_cobjs);
 	kwmb.add("mt_cobj_tree_build", mt_cobj_tree_build);
 	kwmb.add("global_lighting_update", global_lighting_update);
@@ -1622,6 +1630,7 @@ int load_config(string const &config_file) {
 	kwmb.add("model3d_winding_number_normal", model3d_wn_normal);
 	kwmb.add("snow_shadows", snow_shadows);
 	kwmb.add("tree_4th_branches", tree_4th_branches);
+	kwmb.add("tree_gen_bench", tree_gen_bench);
 	kwmb.add("skip_light_vis_test", skip_light_vis_test);
 	kwmb.add("model_calc_tan_vect", model_calc_tan_vect);
 	kwmb.add("invert_model_nmap_bscale", invert_model_nmap_bscale);
@@ -1656,6 +1665,30 @@ int load_config(string const &config_file) {
 	kwmb.add("flatten_tt_mesh_under_models", flatten_tt_mesh_under_models);
 	kwmb.add("show_map_view_mandelbrot", show_map_view_mandelbrot);
 	kwmb.add("def_texture_compress", def_tex_compress);
+	kwmb.add("mipmap_gamma_correct", mipmap_gamma_correct);
+	kwmb.add("mipmap_use_kaiser", mipmap_use_kaiser);
+	kwmb.add("mipmap_bench", mipmap_bench);
+	kwmb.add("voxel_mc_bench", voxel_mc_bench);
+	kwmb.add("smoke_bench", smoke_bench);
+	kwmb.add("fire_bench", fire_bench);
+	kwmb.add("water_bench", water_bench);
+	kwmb.add("model_3ds_bench", model_3ds_bench);
+	kwmb.add("model_simplify_bench", model_simplify_bench);
+	kwmb.add("movable_cobj_bench", movable_cobj_bench);
+	kwmb.add("use_gjk_narrow_phase", use_gjk_narrow_phase);
+	kwmb.add("gjk_bench", gjk_bench);
+	kwmb.add("grass_bench", grass_bench);
+	kwmb.add("smiley_parallel_ai", smiley_parallel_ai);
+	kwmb.add("smiley_ai_bench", smiley_ai_bench);
+	kwmb.add("use_sw_occlusion", use_sw_occlusion);
+	kwmb.add("occlusion_bench", occlusion_bench);
+	kwmb.add("use_frame_arena", use_frame_arena);
+	kwmb.add("frame_arena_bench", frame_arena_bench);
+	kwmb.add("cpu_tex_compress", cpu_tex_compress);
+	kwmb.add("bc5_normal_maps", bc5_normal_maps);
+	kwmb.add("tex_compress_bench", tex_compress_bench);
+	kwmb.add("tex_load_bench", tex_load_bench);
+	kwmb.add("csg_bench", csg_bench);
 	kwmb.add("smileys_chase_player", smileys_chase_player);
 	kwmb.add("disable_fire_delay", disable_fire_delay);
 	kwmb.add("disable_recoil", disable_recoil);
@@ -1703,10 +1736,15 @@ int load_config(string const &config_file) {
 	kw_to_val_map_t<unsigned> kwmu(error);
 	kwmu.add("grass_density", grass_density);
 	kwmu.add("max_unique_trees", max_unique_trees);
+	kwmu.add("waypoint_bench_agents", waypoint_bench_agents);
+	kwmu.add("headless_frames", headless_frames);
+	kwmu.add("sw_occlusion_width", sw_occlusion_width);
+	kwmu.add("sw_max_occluders", sw_max_occluders);
 	kwmu.add("shadow_map_sz", shadow_map_sz);
 	kwmu.add("max_ray_bounces", MAX_RAY_BOUNCES);
 	kwmu.add("num_test_snowflakes", num_snowflakes);
 	kwmu.add("hmap_filter_width", hmap_filter_width);
+	kwmu.add("hmap_tile_size", hmap_tile_size);
 	kwmu.add("erosion_iters", erosion_iters);
 	kwmu.add("erosion_iters_tt", erosion_iters_tt);
 	kwmu.add("num_dynam_parts", num_dynam_parts);
@@ -1716,6 +1754,8 @@ int load_config(string const &config_file) {
 	kwmu.add("snow_coverage_resolution", snow_coverage_resolution);
 	kwmu.add("dlight_grid_bitshift", DL_GRID_BS);
 	kwmu.add("video_framerate", video_framerate);
+	kwmu.add("model_simplify_levels", model_simplify_levels);
+	kwmu.add("smoke_substeps", smoke_substeps);
 
 	kw_to_val_map_t<float> kwmf(error);
 	kwmf.add("gravity", base_gravity);
@@ -1778,6 +1818,7 @@ int load_config(string const &config_file) {
 	kwmf.add("force_czmax", force_czmax);
 	kwmf.add("dlight_intensity_scale", dlight_intensity_scale);
 	kwmf.add("model_mat_lod_thresh", model_mat_lod_thresh);
+	kwmf.add("model_simplify_lod_scale", model_simplify_lod_scale);
 	kwmf.add("def_texture_aniso", def_tex_aniso);
 	kwmf.add("clouds_per_tile", clouds_per_tile);
 	kwmf.add("atmosphere", def_atmosphere);
@@ -1805,6 +1846,8 @@ int load_config(string const &config_file) {
 
 	kw_to_val_map_t<string> kwms(error);
 	kwms.add("cobjs_out_filename", cobjs_out_fn);
+	kwms.add("cache_dir", cache_dir);
+	kwms.add("texture_cache_dir", texture_cache_dir);
 
 	while (read_str(fp, strc)) { // slow but should be OK: these ones require special handling
 		string const str(strc);
@@ -2174,6 +2217,107 @@ void init_debug_callback() {
 }
 
 
+void init_ground_mode_state() {
+
+	reset_planet_defaults(); // set atmosphere and vegetation
+	init_objects();
+	alloc_matrices();
+	t_trees.resize(num_trees);
+	if (tree_gen_bench) {run_tree_gen_benchmark();}
+	init_models();
+	init_terrain_mesh();
+	init_lights();
+	gen_scene(1, (world_mode == WMODE_GROUND), 0, 0, 0);
+	gen_snow_coverage();
+	if (enable_grass_fire) {init_ground_fire();}
+	create_object_groups();
+	init_game_state();
+
+	if (game_mode) {
+		gamemode_rand_appear();
+		camera_mode = 1; // on the ground
+	}
+	get_landscape_texture_color(0, 0); // hack to force creation of the cached_ls_colors vector in the master thread (before build_lightmap())
+	build_lightmap(1);
+}
+
+
+// steps the ground mode simulation with a fixed timestep and no GL context, then prints per-subsystem times;
+// GL-only work (shaders, VBOs, shadow maps, smoke texture upload, voxel updates, and drawing) is skipped
+void run_headless_sim(unsigned num_frames) {
+
+	if (world_mode != WMODE_GROUND) {
+		cerr << "Error: headless_frames is only supported in ground mode" << endl;
+		exit(1);
+	}
+	headless_mode = 1;
+	cout << "Running headless simulation for " << num_frames << " frames" << endl;
+	load_textures();
+	init_ground_mode_state();
+	begin_motion = 1; // start objects moving without user input
+	if (occlusion_bench) {run_occlusion_benchmark();}
+	if (frame_arena_bench) {run_frame_arena_benchmark();}
+	frame_arena_next_frame(); // don't count allocations from scene init
+	cout << "After init ";
+	print_mem_usage();
+	frame_arena_stats_t arena_stats;
+	toggle_timing_profiler(); // enable
+	double const start_time(get_hr_time_ms());
+
+	for (unsigned f = 0; f < num_frames; ++f) {
+		uevent_advance_frame();
+		fticks    = 1.0; // fixed timestep
+		iticks    = 1;
+		tstep     = TIMESTEP*fticks;
+		tfticks  += fticks;
+		sim_ticks = tfticks;
+		hr_timer_t const frame_timer("Frame");
+		{
+			hr_timer_t timer("Time+Lighting");
+			auto_advance_time();
+			compute_brightness();
+		}
+		{
+			hr_timer_t timer("Platforms+Moving Cobjs");
+			process_platforms_falling_moving_and_light_triggers();
+		}
+		{
+			hr_timer_t timer("Process Groups");
+			process_groups();
+		}
+		{
+			hr_timer_t timer("Water");
+			update_water_no_draw();
+		}
+		{
+			hr_timer_t timer("Smoke+Fire");
+			distribute_smoke();
+			next_frame_ground_fire();
+			next_frame_tree_fires();
+		}
+		if (game_mode) {
+			hr_timer_t timer("Game");
+			update_blasts();
+			update_game_frame();
+		}
+		purge_coll_freed(0);
+		frame_arena_stats_t const fas(frame_arena_next_frame());
+		arena_stats.num_allocs      += fas.num_allocs;
+		arena_stats.num_heap_allocs += fas.num_heap_allocs;
+		arena_stats.bytes           += fas.bytes;
+		arena_stats.capacity         = max(arena_stats.capacity, fas.capacity);
+		arena_stats.num_live         = max(arena_stats.num_live, fas.num_live);
+	} // for f
+	double const total_time(get_hr_time_ms() - start_time);
+	cout << "Headless simulation: " << num_frames << " frames in " << total_time << "ms, " << total_time/max(num_frames, 1U) << " ms/frame" << endl;
+	unsigned const nf(max(num_frames, 1U));
+	cout << "Frame arena" << (use_frame_arena ? "" : " (disabled)") << ": " << arena_stats.num_allocs/nf << " allocs/frame, " << arena_stats.num_heap_allocs/nf << " heap allocs/frame, "
+		 << arena_stats.bytes/(1024*nf) << " KB/frame, " << arena_stats.capacity/1024 << " KB capacity, " << arena_stats.num_live << " max live at frame end" << endl;
+	timing_profiler_stats(); // average column is ms/frame for per-frame entries
+	print_mem_usage();
+}
+
+
 int main(int argc, char** argv) {
 
 	cout << "Starting 3DWorld" << endl;
@@ -2183,10 +2327,16 @@ int main(int argc, char** argv) {
 	else if (srand_param != 0) {rs = srand_param;}
 	add_uevent_srand(rs);
 	create_sin_table();
+	frame_arena_next_frame(); // create the per-thread frame arenas from the main thread
 	set_scene_constants();
 	load_texture_names(); // needs to be before config file load
 	load_top_level_config(defaults_file);
 	gen_gauss_rand_arr(); // after reading seed from config file
+
+	if (headless_frames > 0) {
+		run_headless_sim(headless_frames);
+		return 0;
+	}
 	cout << "Loading."; cout.flush();
 	
     // Initialize GLUT
@@ -2227,27 +2377,7 @@ int main(int argc, char** argv) {
 	setup_shaders();
 	//cout << "Extensions: " << get_all_gl_extensions() << endl;
 
-	if (!universe_only) { // universe mode should be able to do without these initializations
-		reset_planet_defaults(); // set atmosphere and vegetation
-		init_objects();
-		alloc_matrices();
-		t_trees.resize(num_trees);
-		init_models();
-		init_terrain_mesh();
-		init_lights();
-		gen_scene(1, (world_mode == WMODE_GROUND), 0, 0, 0);
-		gen_snow_coverage();
-		if (enable_grass_fire) {init_ground_fire();}
-		create_object_groups();
-		init_game_state();
-
-		if (game_mode) {
-			gamemode_rand_appear();
-			camera_mode = 1; // on the ground
-		}
-		get_landscape_texture_color(0, 0); // hack to force creation of the cached_ls_colors vector in the master thread (before build_lightmap())
-		build_lightmap(1);
-	}
+	if (!universe_only) {init_ground_mode_state();} // universe mode should be able to do without these initializations
 	glutMainLoop(); // Switch to main loop
 	quit_3dworld(); // never actually gets here
     return 0;
@@ -586,7 +586,7 @@ struct cube_t { // size = 24
 cube_t const all_zeros_cube(0,0,0,0,0,0);
 
 
-template<typename T> cube_t get_polygon_bbox(vector<T> const &p) {
+template<typename T, typename A> cube_t get_polygon_bbox(vector<T, A> const &p) {
 
 	if (p.empty()) return all_zeros_cube;
 	cube_t bbox(p.front().v, p.front().v);
@@ -1146,18 +1146,28 @@ template <typename T> void draw_verts(T const *const verts, unsigned count, int
 	unset_ptr_state(verts);
 }
 
-template <typename T> void draw_verts(vector<T> const &verts, int gl_type, unsigned start_ix=0) {
+template <typename T, typename A> void draw_verts(vector<T, A> const &verts, int gl_type, unsigned start_ix=0) {
 	if (!verts.empty()) {draw_verts(&verts.front(), verts.size(), gl_type, start_ix);}
 }
 
-template <typename T> void draw_and_clear_verts(vector<T> &verts, int gl_type) {
+template <typename T, typename A> void draw_and_clear_verts(vector<T, A> &verts, int gl_type) {
 	draw_verts(verts, gl_type);
 	verts.resize(0); // clear()?
 }
 
 void draw_quads_as_tris(unsigned num_quad_verts, unsigned start_quad_vert=0, unsigned num_instances=1);
 bool bind_quads_as_tris_ivbo(unsigned num_quad_verts);
-void convert_quad_ixs_to_tri_ixs(vector<unsigned> const &qixs, vector<unsigned> &tixs);
+
+template<typename A> void convert_quad_ixs_to_tri_ixs(vector<unsigned, A> const &qixs, vector<unsigned> &tixs) { // what about 16-bit indices?
+
+	tixs.resize(6*qixs.size()/4);
+
+	for (unsigned i = 0, j = 0; i < qixs.size(); i += 4) { // step a quad at a time
+		UNROLL_4X(tixs[j++] = qixs[i+i_];) // copy quad verts
+		tixs[j++] = qixs[i+0];
+		tixs[j++] = qixs[i+2];
+	}
+}
 
 template <typename T> void draw_quad_verts_as_tris(T const *const verts, unsigned count, unsigned start_ix=0, unsigned num_instances=1) {
 	assert(count > 0);
@@ -1166,11 +1176,11 @@ template <typename T> void draw_quad_verts_as_tris(T const *const verts, unsigne
 	unset_ptr_state(verts);
 }
 
-template <typename T> void draw_quad_verts_as_tris(vector<T> const &verts) {
+template <typename T, typename A> void draw_quad_verts_as_tris(vector<T, A> const &verts) {
 	if (!verts.empty()) {draw_quad_verts_as_tris(&verts.front(), verts.size());}
 }
 
-template <typename T> void draw_quad_verts_as_tris_and_clear(vector<T> &verts) {
+template <typename T, typename A> void draw_quad_verts_as_tris_and_clear(vector<T, A> &verts) {
 	draw_quad_verts_as_tris(verts); verts.clear();
 }
 
@@ -1292,6 +1302,7 @@ public:
 
 protected:
 	unsigned char *data, *orig_data, *colored_data, *mm_data;
+	size_t reg_cpu_mem; // client side memory registered with the memory tracker
 	unsigned tid;
 	colorRGBA color;
 	vector<unsigned> mm_offsets;
@@ -1299,16 +1310,17 @@ protected:
 	enum {DEFER_TYPE_NONE=0, DEFER_TYPE_DDS, NUM_DEFER_TYPE};
 
 	void maybe_swap_rb(unsigned char *ptr) const;
+	void update_cpu_mem_usage();
 
 public:
 	texture_t() : type(0), format(0), use_mipmaps(0), defer_load_type(DEFER_TYPE_NONE), wrap(0), mirror(0), invert_y(0), do_compress(0), has_binary_alpha(0),
 		is_16_bit_gray(0), no_avg_color_alpha_fill(0), invert_alpha(0), normal_map(0), width(0), height(0), ncolors(0), bump_tid(-1), alpha_tid(-1),
-		anisotropy(1.0), mipmap_alpha_weight(1.0), data(0), orig_data(0), colored_data(0), mm_data(0), tid(0), color(DEF_TEX_COLOR) {}
+		anisotropy(1.0), mipmap_alpha_weight(1.0), data(0), orig_data(0), colored_data(0), mm_data(0), reg_cpu_mem(0), tid(0), color(DEF_TEX_COLOR) {}
 
 	texture_t(char t, char f, int w, int h, int wrap_mir, int nc, char um, std::string const &n, bool inv=0, bool do_comp=1, float a=1.0, float maw=1.0, bool nm=0)
 		: type(t), format(f), use_mipmaps(um), defer_load_type(DEFER_TYPE_NONE), wrap(wrap_mir != 0), mirror(wrap_mir == 2), invert_y(inv), do_compress(do_comp),
 		has_binary_alpha(0), is_16_bit_gray(0), no_avg_color_alpha_fill(0), invert_alpha(0), normal_map(nm), width(w), height(h), ncolors(nc), bump_tid(-1),
-		alpha_tid(-1), anisotropy(a), mipmap_alpha_weight(maw), name(n), data(0), orig_data(0), colored_data(0), mm_data(0), tid(0), color(DEF_TEX_COLOR) {}
+		alpha_tid(-1), anisotropy(a), mipmap_alpha_weight(maw), name(n), data(0), orig_data(0), colored_data(0), mm_data(0), reg_cpu_mem(0), tid(0), color(DEF_TEX_COLOR) {}
 	bool is_inverted_y_type() const {return (defer_load_type == DEFER_TYPE_DDS);}
 	void init();
 	void do_gl_init(bool free_after_upload=0);
@@ -1320,6 +1332,9 @@ public:
 	void merge_in_alpha_channel(texture_t const &at);
 	void build_mipmaps();
 	void create_custom_mipmaps();
+	unsigned get_cpu_compress_format() const;
+	void get_compressed_data(unsigned fmt, vector<unsigned char> &cdata, vector<unsigned> &level_offsets);
+	bool upload_cpu_compressed();
 	unsigned char const *get_mipmap_data(unsigned level) const;
 	void set_to_color(colorRGBA const &c);
 	void maybe_assign_normal_map_tid(int nm_tid) {if (nm_tid >= 0 && bump_tid < 0) {bump_tid = nm_tid;}}
@@ -1336,6 +1351,7 @@ public:
 	void load_png(int index, bool allow_diff_width_height, bool allow_two_byte_grayscale);
 	void load_tiff(int index, bool allow_diff_width_height, bool allow_two_byte_grayscale);
 	void load_dds(int index);
+	bool can_decode_in_parallel() const;
 	void auto_insert_alpha_channel(int index);
 	void fill_transparent_with_avg_color();
 	void do_invert_y();
@@ -1371,6 +1387,7 @@ public:
 	colorRGBA get_avg_color() const {return color;}
 	unsigned char *get_data() {assert(data); return data;}
 	unsigned char const *get_data() const {assert(data); return data;}
+	size_t get_cpu_mem() const;
 	void write_pixel_16_bits(unsigned ix, float val);
 };
 
@@ -1604,9 +1621,16 @@ colorRGBA const BACKGROUND_NIGHT(BLACK);
 
 
 void register_timing_value(const char *str, int delta_time);
+void register_timing_value_ms(const char *str, double delta_time);
+double get_hr_time_ms();
 void toggle_timing_profiler();
 void timing_profiler_stats();
 
+enum {MEM_CAT_COBJS=0, MEM_CAT_LIGHTMAP, MEM_CAT_VOXELS, MEM_CAT_GRASS, MEM_CAT_TILES, MEM_CAT_BUILDINGS, MEM_CAT_MODELS, MEM_CAT_TEXTURES, MEM_CAT_UNIVERSE, MEM_CAT_FRAME_ARENA, NUM_MEM_CATS};
+void add_mem_usage(unsigned cat, size_t bytes);
+void sub_mem_usage(unsigned cat, size_t bytes);
+void print_mem_usage();
+
 // macros
 #define GET_TIME_MS()    glutGet(GLUT_ELAPSED_TIME)
 #define RESET_TIME       int const timer1(GET_TIME_MS());
@@ -1638,6 +1662,15 @@ public:
 	void end() {if (!name.empty()) {register_timing_value(name.c_str(), GET_DELTA_TIME); name.clear();}}
 };
 
+class hr_timer_t { // high resolution timer_t for sub-ms work
+	std::string name;
+	double start_time;
+public:
+	hr_timer_t(char const *const name_) : name(name_), start_time(get_hr_time_ms()) {}
+	~hr_timer_t() {end();}
+	void end() {if (!name.empty()) {register_timing_value_ms(name.c_str(), (get_hr_time_ms() - start_time)); name.clear();}}
+};
+
 
 // world modes
 enum {WMODE_GROUND=0, WMODE_UNIVERSE, WMODE_INF_TERRAIN, NUM_WMODE};
@@ -199,7 +199,8 @@ float def_tex_aniso(2.0);
 unsigned char *landscape0 = NULL;
 
 
-extern bool mesh_difuse_tex_comp, water_is_lava, invert_bump_maps;
+extern bool mesh_difuse_tex_comp, water_is_lava, invert_bump_maps, mipmap_gamma_correct, mipmap_use_kaiser, mipmap_bench;
+extern bool cpu_tex_compress, bc5_normal_maps, tex_compress_bench, tex_load_bench, headless_mode;
 extern unsigned smoke_tid, dl_tid, elem_tid, gb_tid, reflection_tid, depth_tid, empty_smap_tid, frame_buffer_RGB_tid;
 extern int world_mode, read_landscape, default_ground_tex, xoff2, yoff2, DISABLE_WATER;
 extern int scrolling, dx_scroll, dy_scroll, display_mode, iticks, universe_only, window_width, window_height;
@@ -264,14 +265,17 @@ void load_textures() {
 	cout << "loading textures"; cout.flush();
 	if (using_custom_landscape_texture()) {set_landscape_texture_from_file();} // must be done first
 	load_texture_names();
+	vector<unsigned char> is_large(textures.size(), 0);
 
+	for (unsigned i = 0; i < textures.size(); ++i) { // large images that support parallel decoding are loaded one at a time, each decoded with multiple threads
+		if (is_tex_disabled(i) || !textures[i].can_decode_in_parallel()) continue;
+		is_large[i] = 1;
+		textures[i].load(i);
+	}
 #pragma omp parallel for schedule(dynamic)
 	for (int i = 0; i < (int)textures.size(); ++i) {
 		//cout << "."; cout.flush();
-		if (!is_tex_disabled(i)) {textures[i].load(i, 0, 0, 1);} // ignore word alignment here, since resizing isn't thread safe
-	}
-	for (int i = 0; i < (int)textures.size(); ++i) {
-		if (!is_tex_disabled(i)) {textures[i].fix_word_alignment();}
+		if (!is_tex_disabled(i) && !is_large[i]) {textures[i].load(i);} // resizing for word alignment is done on the CPU and is thread safe
 	}
 	cout << " done" << endl;
 	textures[BULLET_D_TEX].merge_in_alpha_channel(textures[BULLET_A_TEX]);
@@ -298,7 +302,11 @@ void load_textures() {
 	}
 	textures[TREE_HEMI_TEX].set_color_alpha_to_one();
 	textures_inited = 1;
+	if (mipmap_bench) {run_mipmap_benchmark();}
+	if (tex_compress_bench) {run_texture_compress_benchmark();}
+	if (tex_load_bench) {run_texture_load_benchmark();}
 
+	if (headless_mode) return; // no GL context
 	glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &max_tius);
 	glGetIntegerv(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS, &max_ctius);
 	cout << "max TIUs: " << max_tius << ", max combined TIUs: " << max_ctius << endl;
@@ -419,6 +427,7 @@ void texture_t::alloc() {
 
 	free_data();
 	data = new unsigned char[num_bytes()];
+	update_cpu_mem_usage();
 
 	if (SHOW_TEXTURE_MEMORY) {
 		static unsigned tmem(0);
@@ -437,6 +446,24 @@ void texture_t::free_mm_data() {
 	delete [] mm_data;
 	mm_data = NULL;
 	mm_offsets.clear();
+	update_cpu_mem_usage(); // called last by free_client_mem()
+}
+
+size_t texture_t::get_cpu_mem() const { // client side copies: image data, recolored data, and CPU mipmaps
+
+	if (!is_allocated()) return 0;
+	size_t mem(num_bytes());
+	if (orig_data    != nullptr && orig_data    != data) {mem += num_bytes();}
+	if (colored_data != nullptr && colored_data != data) {mem += num_bytes();}
+	if (mm_data != nullptr && !mm_offsets.empty()) {mem += mm_offsets.back() + ncolors*bytes_per_channel();} // last level is 1x1
+	return mem;
+}
+
+void texture_t::update_cpu_mem_usage() { // register the change in client side memory since the last call
+
+	size_t const mem(get_cpu_mem());
+	if (mem > reg_cpu_mem) {add_mem_usage(MEM_CAT_TEXTURES, (mem - reg_cpu_mem));} else {sub_mem_usage(MEM_CAT_TEXTURES, (reg_cpu_mem - mem));}
+	reg_cpu_mem = mem;
 }
 
 void texture_t::free_client_mem() {
@@ -464,6 +491,14 @@ GLenum texture_t::calc_internal_format() const {
 	return get_internal_texture_format(ncolors, (COMPRESS_TEXTURES && do_compress && type != 2), 0); // linear_space=0
 }
 
+unsigned texture_t::get_cpu_compress_format() const { // BC format to compress on the CPU, or TEX_COMP_NONE to let the driver handle it
+
+	if (!cpu_tex_compress || !COMPRESS_TEXTURES || !do_compress || type == 2 || is_16_bit_gray) return TEX_COMP_NONE;
+	if (use_mipmaps == 3 || use_mipmaps == 4) return TEX_COMP_NONE; // custom mipmaps are uploaded per level
+	if (normal_map && bc5_normal_maps && ncolors >= 2) return TEX_COMP_BC5; // requires Z reconstruction in the shader
+	return ((ncolors == 3) ? TEX_COMP_BC1 : ((ncolors == 4) ? TEX_COMP_BC3 : TEX_COMP_NONE)); // same formats as get_internal_texture_format()
+}
+
 GLenum texture_t::calc_format() const {
 	return (is_16_bit_gray ? GL_RED : get_texture_format(ncolors));
 }
@@ -484,9 +519,12 @@ void texture_t::do_gl_init(bool free_after_upload) {
 	if (defer_load()) {deferred_load_and_bind();} // FIXME: mipmaps?
 	else {
 		assert(is_allocated() && width > 0 && height > 0);
-		glTexImage2D(GL_TEXTURE_2D, 0, calc_internal_format(), width, height, 0, calc_format(), get_data_format(), data);
-		if (use_mipmaps == 1 || use_mipmaps == 2) {gen_mipmaps();}
-		if (use_mipmaps == 3 || use_mipmaps == 4) {create_custom_mipmaps();}
+
+		if (!upload_cpu_compressed()) { // uncompressed, or compressed by the driver
+			glTexImage2D(GL_TEXTURE_2D, 0, calc_internal_format(), width, height, 0, calc_format(), get_data_format(), data);
+			if (use_mipmaps == 1 || use_mipmaps == 2) {gen_mipmaps();}
+			if (use_mipmaps == 3 || use_mipmaps == 4) {create_custom_mipmaps();}
+		}
 	}
 	assert(glIsTexture(tid));
 	if (free_after_upload) {free_client_mem();}
@@ -555,28 +593,22 @@ void texture_t::merge_in_alpha_channel(texture_t const &at) {
 }
 
 
-void texture_t::build_mipmaps() {
+image_scale_params_t get_tex_scale_params(texture_t const &t) {
+	bool const linear_space(mipmap_gamma_correct && t.ncolors >= 3 && !t.normal_map && !t.is_16_bit_gray);
+	return image_scale_params_t(linear_space, mipmap_use_kaiser, (t.ncolors == 4 && t.has_binary_alpha)); // preserve coverage for alpha tested textures
+}
+
+void texture_t::build_mipmaps() { // CPU side mipmaps; no GL calls
 
 	if (use_mipmaps != 2) return; // not enabled
-	assert(width == height);
 	if (!mm_offsets.empty()) {assert(mm_data); return;} // already built
 	assert(mm_data == NULL);
-	unsigned data_size(0);
-
-	for (unsigned tsz = width/2; tsz >= 1; tsz /= 2) {
-		mm_offsets.push_back(data_size);
-		data_size += ncolors*tsz*tsz;
-	}
+	assert(is_allocated());
+	unsigned const data_size(calc_mipmap_offsets(width, height, ncolors*bytes_per_channel(), mm_offsets));
+	if (data_size == 0) return; // 1x1 texture
 	mm_data = new unsigned char[data_size];
-	GLenum const format(calc_format());
-
-	for (unsigned level = 0; level < mm_offsets.size(); ++level) {
-		unsigned const tsz(width >> level);
-		assert(tsz > 1);
-		int const ret(gluScaleImage(format, tsz,   tsz,   get_data_format(), get_mipmap_data(level),
-			                                tsz/2, tsz/2, get_data_format(), (mm_data + mm_offsets[level])));
-		if (ret) cout << "GLU error during mipmap image scale: " << gluErrorString(ret) << "." << endl;
-	}
+	gen_mipmaps(data, width, height, ncolors, is_16_bit_gray, get_tex_scale_params(*this), mm_data, mm_offsets);
+	update_cpu_mem_usage();
 }
 
 
@@ -611,6 +643,7 @@ void texture_t::set_to_color(colorRGBA const &c) {
 	if (orig_data    == NULL) orig_data    = data; // make a copy
 	data = colored_data;
 	assert(data != NULL);
+	update_cpu_mem_usage();
 
 	for (unsigned i = 0; i < size; ++i) {
 		unsigned const pos(i*ncolors);
@@ -778,23 +811,24 @@ void texture_t::add_alpha_channel() {
 	}
 	free_data();
 	data = new_data;
+	update_cpu_mem_usage();
 }
 
 
-void texture_t::resize(int new_w, int new_h) { // Note: not thread safe
+void texture_t::resize(int new_w, int new_h) { // Note: thread safe if the texture isn't bound
 
 	if (new_w == width && new_h == height) return; // already correct size
 	assert(is_allocated());
 	assert(width > 0 && height > 0 && new_w > 0 && new_h > 0);
-	unsigned char *new_data(new unsigned char[new_w*new_h*ncolors]);
-	glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // required to handle calls from from fix_word_alignment()
-	int const ret(gluScaleImage(calc_format(), width, height, get_data_format(), data, new_w, new_h, get_data_format(), new_data));
-	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
-	if (ret) {cout << "GLU error during image scale: " << gluErrorString(ret) << "." << endl;}
+	unsigned char *new_data(new unsigned char[new_w*new_h*ncolors*bytes_per_channel()]);
+	image_scale_params_t const params(get_tex_scale_params(*this));
+	if (is_16_bit_gray) {scale_image((unsigned short const *)data, width, height, (unsigned short *)new_data, new_w, new_h, ncolors, params);}
+	else {scale_image(data, width, height, new_data, new_w, new_h, ncolors, params);}
 	free_data(); // only if size increases?
 	data   = new_data;
 	width  = new_w;
 	height = new_h;
+	update_cpu_mem_usage();
 }
 
 
@@ -817,6 +851,7 @@ bool texture_t::try_compact_to_lum() {
 	for (unsigned i = 0; i < npixels; ++i) {new_data[i] = data[3*i];}
 	free_data();
 	data = new_data;
+	update_cpu_mem_usage();
 	return 1;
 }
 
@@ -861,6 +896,7 @@ void texture_t::make_normal_map() {
 	}
 	free_data();
 	data = new_data;
+	update_cpu_mem_usage();
 }
 
 
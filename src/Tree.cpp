@@ -12,6 +12,7 @@
 #include "sinf.h"
 #include "cobj_bsp_tree.h"
 #include "draw_utils.h"
+#include <omp.h>
 
 float const BURN_RADIUS      = 0.2;
 float const BURN_DAMAGE      = 80.0;
@@ -44,13 +45,8 @@ tree_type tree_types[NUM_TREE_TYPES] = { // not const - config file can override
 	tree_type(BARK6_TEX, PAPAYA_TEX,   1.0, 1.0, 1.0, 1.00, 2.0, 2.0, 0.5, 0.1,  0.0, colorRGBA(0.7, 0.6,  0.5,  1.0), WHITE)
 };
 
-vector<tree_cylin >   tree_builder_t::cylin_cache;
-vector<tree_branch>   tree_builder_t::branch_cache;
-vector<tree_branch *> tree_builder_t::branch_ptr_cache;
-
-
 // tree_mode: 0 = no trees, 1 = large only, 2 = small only, 3 = both large and small
-bool has_any_billboard_coll(0), next_has_any_billboard_coll(0), tree_4th_branches(0);
+bool has_any_billboard_coll(0), next_has_any_billboard_coll(0), tree_4th_branches(0), tree_gen_bench(0);
 unsigned max_unique_trees(0);
 int tree_mode(1), tree_coll_level(2);
 float leaf_color_coherence(0.5), tree_color_coherence(0.2), tree_deadness(-1.0), tree_dead_prob(0.0), nleaves_scale(1.0), branch_radius_scale(1.0), tree_height_scale(1.0);
@@ -1458,10 +1454,6 @@ void tree::gen_tree(point const &pos, int size, int ttype, int calc_z, bool add_
 	}
 	else {
 		type = ((ttype < 0) ? rgen.rand() : ttype) % NUM_TREE_TYPES; // maybe should be an error if > NUM_TREE_TYPES
-		bool const create_bush(allow_bushes && rgen.rand_probability(tree_types[type].bush_prob));
-		if (create_bush) {type = (type + 1) % NUM_TREE_TYPES;} // mix up the tree types so that bushes stand out from trees
-		tree_type const &treetype(tree_types[type]);
-		UNROLL_3X(tree_color[i_] = 1.0 + treetype.branch_color_var*color_var[i_];)
 		float tree_depth(get_default_tree_depth());
 	
 		if (calc_z) {
@@ -1469,8 +1461,9 @@ void tree::gen_tree(point const &pos, int size, int ttype, int calc_z, bool add_
 			if (user_placed) {tree_depth = tree_center.z - get_tree_z_bottom(tree_center.z, tree_center);} // more accurate
 		}
 		cube_t const cc(clip_cube - tree_center);
-		td.gen_tree_data(type, size, tree_depth, ((height_scale == 1.0) ? treetype.height_scale : height_scale), ((br_scale_mult == 1.0) ? treetype.branch_radius : br_scale_mult),
-			nl_scale, ((height_scale == 1.0) ? treetype.branch_break_off : 1.0), has_4th_branches, (use_clip_cube ? &cc : NULL), create_bush, rgen); // create the tree here
+		// create the tree here
+		type = td.gen_tree_data_of_type(type, size, tree_depth, height_scale, br_scale_mult, nl_scale, has_4th_branches, (use_clip_cube ? &cc : NULL), allow_bushes, rgen);
+		UNROLL_3X(tree_color[i_] = 1.0 + tree_types[type].branch_color_var*color_var[i_];)
 	}
 	assert(type < NUM_TREE_TYPES);
 	unsigned const nleaves(td.get_leaves().size());
@@ -1480,6 +1473,18 @@ void tree::gen_tree(point const &pos, int size, int ttype, int calc_z, bool add_
 }
 
 
+int tree_data_t::gen_tree_data_of_type(int type, int size, float tree_depth, float height_scale, float br_scale_mult, float nl_scale,
+	bool has_4th_branches_, cube_t const *clip_cube, bool allow_bushes, rand_gen_t &rgen)
+{
+	bool const create_bush(allow_bushes && rgen.rand_probability(tree_types[type].bush_prob));
+	if (create_bush) {type = (type + 1) % NUM_TREE_TYPES;} // mix up the tree types so that bushes stand out from trees
+	::tree_type const &treetype(tree_types[type]); // not the tree_type member
+	gen_tree_data(type, size, tree_depth, ((height_scale == 1.0) ? treetype.height_scale : height_scale), ((br_scale_mult == 1.0) ? treetype.branch_radius : br_scale_mult),
+		nl_scale, ((height_scale == 1.0) ? treetype.branch_break_off : 1.0), has_4th_branches_, clip_cube, create_bush, rgen);
+	return type; // may have been changed to create a bush
+}
+
+
 void tree_data_t::gen_tree_data(int tree_type_, int size, float tree_depth, float height_scale, float br_scale_mult,
 	float nl_scale, float bbo_scale, bool has_4th_branches_, cube_t const *clip_cube, bool create_bush, rand_gen_t &rgen)
 {
@@ -2139,6 +2144,7 @@ void tree_cont_t::gen_trees_tt_within_radius(int x1, int y1, int x2, int y2, poi
 				int ttype(t->type);
 				if (ttype >= 0) {ttype %= NUM_TREE_TYPES;} // make sure it maps to a valid tree type if specified
 				add_new_tree(rgen, ttype);
+				// Note: shared tree data not yet created is generated serially here using this tree's size and no bushes
 				back().gen_tree(pos, int(t->size), ttype, 1, 1, 0, rgen, 1.0, 1.0, 1.0, tree_4th_branches, 0); // Note: can't be user placed + instanced; no bushes
 			} // for t
 		} // for b
@@ -2148,6 +2154,7 @@ void tree_cont_t::gen_trees_tt_within_radius(int x1, int y1, int x2, int y2, poi
 	unsigned const smod(3.321*XY_MULT_SIZE+1), tree_prob(max(1U, XY_MULT_SIZE/mod_num_trees));
 	unsigned const skip_val(max(1, int(1.0/tree_scale))); // similar to deterministic gen in scenery.cpp
 	shared_tree_data.ensure_init();
+	shared_tree_data.gen_all_tree_data(0, 1.0, 1.0, 1.0, tree_4th_branches, 1); // must use the same parameters as the gen_tree() call below
 	mesh_xy_grid_cache_t density_gen[NUM_TREE_TYPES+1];
 
 	if (NONUNIFORM_TREE_DEN) { // i==0 is the coverage density map, i>0 are the per-tree type coverage maps
@@ -2294,6 +2301,8 @@ void tree_data_manager_t::ensure_init() {
 
 	if (max_unique_trees > 0 && empty()) {
 		resize(max_unique_trees);
+		last_tree_scale = tree_scale;
+		last_rgi        = rand_gen_index;
 	}
 	else if (tree_scale != last_tree_scale || rand_gen_index != last_rgi) {
 		for (iterator i = begin(); i != end(); ++i) {i->clear_data();}
@@ -2302,6 +2311,83 @@ void tree_data_manager_t::ensure_init() {
 	}
 }
 
+// generates all shared tree data that hasn't already been created by a tree::gen_tree() call, in parallel, using the same per-tree parameters as gen_tree();
+// each tree is seeded by its index, so results are independent of thread count and order
+void tree_data_manager_t::gen_all_tree_data(int size, float height_scale, float br_scale_mult, float nl_scale, bool has_4th_branches, bool allow_bushes) {
+
+	vector<unsigned> to_gen;
+
+	for (unsigned i = 0; i < this->size(); ++i) {
+		if (!operator[](i).is_created()) {to_gen.push_back(i);}
+	}
+	if (to_gen.empty()) return;
+	RESET_TIME;
+	unsigned const num_per_type(max(1U, (unsigned)this->size()/NUM_TREE_TYPES));
+	float const tree_depth(get_default_tree_depth());
+
+#pragma omp parallel for schedule(dynamic,1)
+	for (int n = 0; n < (int)to_gen.size(); ++n) {
+		unsigned const i(to_gen[n]);
+		rand_gen_t rgen;
+		rgen.set_state(i+1, rand_gen_index+1);
+		rgen.rand_mix();
+		// tree_cont_t::add_new_tree() binds trees of a requested type to this range of IDs; the final type is read back from the tree data
+		int const type(min(i/num_per_type, unsigned(NUM_TREE_TYPES-1)));
+		// Note: shared trees are never user placed, so there's no clip cube
+		operator[](i).gen_tree_data_of_type(type, size, tree_depth, height_scale, br_scale_mult, nl_scale, has_4th_branches, NULL, allow_bushes, rgen);
+	}
+	PRINT_TIME("Gen Shared Tree Data");
+}
+
+bool same_cylins(vector<draw_cylin> const &a, vector<draw_cylin> const &b) {
+
+	if (a.size() != b.size()) return 0;
+
+	for (unsigned i = 0; i < a.size(); ++i) {
+		if (a[i].p1 != b[i].p1 || a[i].p2 != b[i].p2 || a[i].r1 != b[i].r1 || a[i].r2 != b[i].r2 || a[i].level != b[i].level || a[i].branch_id != b[i].branch_id) return 0;
+	}
+	return 1;
+}
+
+bool same_leaves(vector<tree_leaf> const &a, vector<tree_leaf> const &b) {
+
+	if (a.size() != b.size()) return 0;
+
+	for (unsigned i = 0; i < a.size(); ++i) {
+		if (a[i].lcolor != b[i].lcolor || a[i].lred != b[i].lred || a[i].lgreen != b[i].lgreen || a[i].norm != b[i].norm) return 0;
+		for (unsigned p = 0; p < 4; ++p) {if (a[i].pts[p] != b[i].pts[p]) return 0;}
+	}
+	return 1;
+}
+
+// enabled with the "tree_gen_bench" config option and run once at load time; generates shared tree data sets with one thread and with all threads
+// and checks that every cylinder and leaf matches
+void run_tree_gen_benchmark() {
+
+	unsigned const num_trees(max(max_unique_trees, 100U)), num_threads(omp_get_max_threads());
+	tree_data_manager_t tdm[2];
+	double time[2] = {0.0, 0.0};
+
+	for (unsigned n = 0; n < 2; ++n) {
+		tdm[n].resize(num_trees);
+		omp_set_num_threads(n ? num_threads : 1);
+		double const start_time(omp_get_wtime());
+		tdm[n].gen_all_tree_data(0, 1.0, 1.0, 1.0, tree_4th_branches, 1);
+		time[n] = omp_get_wtime() - start_time;
+	}
+	omp_set_num_threads(num_threads);
+	unsigned num_mismatch(0);
+
+	for (unsigned i = 0; i < num_trees; ++i) { // output must be independent of thread count
+		tree_data_t const &a(tdm[0][i]), &b(tdm[1][i]);
+		if (a.get_tree_type() != b.get_tree_type() || a.sphere_radius != b.sphere_radius || a.sphere_center_zoff != b.sphere_center_zoff ||
+			!same_cylins(a.get_all_cylins(), b.get_all_cylins()) || !same_leaves(a.get_leaves(), b.get_leaves())) {++num_mismatch;}
+	}
+	cout << "Tree gen benchmark: " << num_trees << " trees in " << 1000.0*time[0] << " ms with 1 thread, " << 1000.0*time[1] << " ms with "
+		 << num_threads << " threads (" << ((time[1] > 0.0) ? time[0]/time[1] : 0.0) << "x), " << num_mismatch << " mismatches" << endl;
+	assert(num_mismatch == 0);
+}
+
 void tree_data_manager_t::clear_context() {
 	for (iterator i = begin(); i != end(); ++i) {i->clear_context();}
 }
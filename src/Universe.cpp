@@ -842,7 +842,7 @@ void ucell::draw_systems(ushader_group &usg, s_object const &clobj, unsigned pas
 			set_universe_ambient_color(galaxy.color);
 			uasteroid_field::begin_render(usg.asteroid_shader, 0, 1);
 
-			for (vector<uasteroid_field>::iterator i = galaxy.asteroid_fields.begin(); i != galaxy.asteroid_fields.end(); ++i) {
+			for (auto i = galaxy.asteroid_fields.begin(); i != galaxy.asteroid_fields.end(); ++i) {
 				i->apply_physics(pos, camera);
 				i->draw(pos, camera, usg.asteroid_shader, 0);
 			}
@@ -1148,7 +1148,7 @@ void ucell::gen_cell(int const ii[3]) {
 	radius = 0.5*CELL_SIZE;
 	set_rand2_state(gen_rand_seed1(pos), gen_rand_seed2(pos));
 	get_rseeds();
-	galaxies.reset(new vector<ugalaxy>);
+	galaxies.reset(new uobj_vect_t<ugalaxy>);
 	galaxies->resize(rand_uniform_uint2(MIN_GALAXIES_PER_CELL, MAX_GALAXIES_PER_CELL));
 
 	for (unsigned l = 0; l < galaxies->size(); ++l) { // gen galaxies
@@ -1347,7 +1347,7 @@ void ugalaxy::process(ucell const &cell) {
 	unsigned const num_af(rand_uniform_uint2(MIN_AST_FIELD_PER_GALAXY, MAX_AST_FIELD_PER_GALAXY));
 	asteroid_fields.resize(num_af);
 
-	for (vector<uasteroid_field>::iterator i = asteroid_fields.begin(); i != asteroid_fields.end(); ++i) {
+	for (auto i = asteroid_fields.begin(); i != asteroid_fields.end(); ++i) {
 		i->init(gen_valid_system_pos(), radius*rand_uniform2(0.005, 0.01));
 	}
 	//PRINT_TIME("Gen Asteroid Fields");
@@ -1369,7 +1369,7 @@ bool ugalaxy::gen_system_loc(vector<point> const &placed) {
 		}
 		for (unsigned c = 0; c < clusters.size() && !bad_pos; ++c) {
 			if (dist_less_than(pos2, clusters[c].center, clusters[c].bounds)) { // close to a cluster
-				vector<point> const &cs(clusters[c].systems);
+				auto const &cs(clusters[c].systems);
 
 				for (unsigned s = 0; s < cs.size() && !bad_pos; ++s) {
 					bad_pos = dist_less_than(pos2, cs[s], SYSTEM_MIN_SPACING);
@@ -1453,7 +1453,7 @@ colorRGBA const &ussystem::get_galaxy_color() {
 void ussystem::calc_color() { // delayed until the color is actually needed
 
 	assert(galaxy);
-	vector<ussystem> const &sols(galaxy->sols);
+	auto const &sols(galaxy->sols);
 	assert(!sols.empty());
 	galaxy_color = BLACK;
 	float const max_dist(5.0*SYSTEM_MIN_SPACING), max_dist_sq(max_dist*max_dist);
@@ -1900,7 +1900,7 @@ point_d urev_body::do_update(point_d const &p0, bool update_rev, bool update_rot
 
 
 template<typename T>
-bool urev_body::create_orbit(vector<T> const &objs, int i, point const &pos0, vector3d const &raxis, float radius0,
+bool urev_body::create_orbit(uobj_vect_t<T> const &objs, int i, point const &pos0, vector3d const &raxis, float radius0,
 							 float max_size, float min_size, float rspacing, float ispacing, float minspacing, float min_gap, vector3d const &oscale)
 {
 	radius = (min(0.4f*radius0, max_size) - min_size)*((float)rand2d()) + min_size;
@@ -2248,7 +2248,7 @@ void ucell::free_uobj() {
 	gen = 0;
 
 	if (galaxies != nullptr) {
-		for (vector<ugalaxy>::iterator i = galaxies->begin(); i != galaxies->end(); ++i) {i->free_uobj();}
+		for (auto i = galaxies->begin(); i != galaxies->end(); ++i) {i->free_uobj();}
 		galaxies.reset();
 	}
 }
@@ -2801,7 +2801,7 @@ int universe_t::get_closest_object(s_object &result, point pos, int max_level, b
 			min_gdist     = distg;
 		}
 		if (include_asteroids) { // check for asteroid field collisions
-			for (vector<uasteroid_field>::const_iterator i = galaxy.asteroid_fields.begin(); i != galaxy.asteroid_fields.end(); ++i) {
+			for (auto i = galaxy.asteroid_fields.begin(); i != galaxy.asteroid_fields.end(); ++i) {
 				if (!dist_less_than(pos, i->pos, expand*i->radius+r_add)) continue;
 
 				// asteroid positions are dynamic, so spatial subdivision is difficult - we just do a slow linear iteration here
@@ -3025,7 +3025,7 @@ bool universe_t::get_trajectory_collisions(line_query_state &lqs, s_object &resu
 		if (cell->galaxies == nullptr) return 0; // galaxies not yet allocated
 		cell_status   = 0;
 		result.galaxy = result.cluster = result.system = result.planet = result.moon = -1;
-		vector<ugalaxy> &galaxies(*cell->galaxies);
+		auto &galaxies(*cell->galaxies);
 		assert(galaxies.size() <= MAX_GALAXIES_PER_CELL); // just a consistency check
 
 		for (unsigned i = 0; i < galaxies.size(); ++i) { // search for galaxies
@@ -3045,7 +3045,7 @@ bool universe_t::get_trajectory_collisions(line_query_state &lqs, s_object &resu
 			if (!galaxy.gen) continue; // not yet generated
 
 			if (include_asteroids) { // asteroid fields
-				for (vector<uasteroid_field>::const_iterator i = galaxy.asteroid_fields.begin(); i != galaxy.asteroid_fields.end(); ++i) {
+				for (auto i = galaxy.asteroid_fields.begin(); i != galaxy.asteroid_fields.end(); ++i) {
 					if (!dist_less_than(curr, i->pos, (i->radius + dist))) continue;
 
 					if (line_intersect_sphere(curr, dir, i->pos, (i->radius+line_radius), rdist, ldist, t)) {
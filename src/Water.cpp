@@ -53,6 +53,14 @@ float const w_spec[2][2] = {{0.9, 80.0}, {0.5, 60.0}};
 enum {SPILL_NONE, SPILL_OUTSIDE, SPILL_INSIDE};
 
 
+struct spill_draw_t {
+	int i, j, si, sj, index, vol_over;
+	float blood_mix, mud_mix, zval; // zval is the zval of the target pool at the time of the spill
+	spill_draw_t(int i_, int j_, int si_, int sj_, int index_, int vol_over_, float bm, float mm, float z)
+		: i(i_), j(j_), si(si_), sj(sj_), index(index_), vol_over(vol_over_), blood_mix(bm), mud_mix(mm), zval(z) {}
+};
+
+
 struct water_spring { // size = 40;
 
 	int enabled;
@@ -93,6 +101,18 @@ vector<valley> valleys;
 vector<water_spring> water_springs;
 vector<water_section> wsections;
 spillover spill;
+vector<vector<unsigned> > valley_bcells, valley_nbors; // boundary cells and adjacent valleys of each valley
+bool valley_bcells_dirty(1), water_bench(0);
+unsigned num_valley_spill_checks(0);
+
+struct valley_spill_state_t { // result of the last spillover check of a valley
+	float zval;
+	short spill_index;
+	valley::spill_func sf;
+	valley_spill_state_t() : zval(0.0), spill_index(-1) {}
+};
+vector<valley_spill_state_t> valley_spill_state;
+vector<unsigned char> valley_spill_dirty; // valleys that must be rechecked for spillover
 
 extern bool using_lightmap, has_snow, fast_water_reflect, enable_clip_plane_z, begin_motion;
 extern int display_mode, frame_counter, game_mode, TIMESCALE2, I_TIMESCALE2, world_mode, rand_gen_index, animate, animate2, blood_spilled;
@@ -108,14 +128,19 @@ extern water_params_t water_params;
 
 void calc_water_normals();
 void compute_ripples();
+void update_valleys_and_spillover(frame_vector<spill_draw_t> *spills);
 void update_valleys_and_draw_spillover();
 void update_water_volumes();
-void draw_spillover(vector<vert_norm_color> &verts, int i, int j, int si, int sj, int index, int vol_over, float blood_mix, float mud_mix);
+void draw_spillover(frame_vector<vert_norm_color> &verts, int i, int j, int si, int sj, int index, int vol_over, float blood_mix, float mud_mix, float zval);
+void calc_rest_positions(vector<int> &dest, vector<unsigned char> &found);
+void run_water_benchmark();
 int  calc_rest_pos(vector<int> &path_x, vector<int> &path_y, vector<char> &rp_set, int &x, int &y);
 void calc_water_flow();
 void init_water_springs(int nws);
 void process_water_springs();
 void add_waves();
+float get_pond_cell_area_frac(int i, int j, float zval);
+void update_water_ripples(bool is_ice);
 void update_accumulation(int xpos, int ypos);
 void shift_water_springs(vector3d const &vd);
 
@@ -518,17 +543,7 @@ void draw_water(bool no_update, bool draw_fast) {
 		if (DEBUG_WATER_TIME) {PRINT_TIME("4 Water Valleys Update");}
 		assert(fticks != 0.0);
 
-		if (animate2) { // call the function that computes the ripple effect
-			unsigned num_steps(1);
-
-			if (!(start_ripple || first_water_run) || is_ice || (!start_ripple && first_water_run)) {}
-			else {
-				assert(I_TIMESCALE2 > 0);
-				num_steps = max(1U, min(MAX_RIPPLE_STEPS, unsigned(min(3.0f, fticks)*min(MAX_I_TIMESCALE, I_TIMESCALE2))));
-			}
-			for (unsigned i = 0; i < num_steps; ++i) {compute_ripples();}
-			calc_water_normals();
-		}
+		if (animate2) {update_water_ripples(is_ice);}
 		if (DEBUG_WATER_TIME) {PRINT_TIME("5 Water Ripple Update");}
 	}
 	unsigned nin(0);
@@ -553,19 +568,7 @@ void draw_water(bool no_update, bool draw_fast) {
 					if (!is_ice && UPDATE_UW_LANDSCAPE && !no_update && wzval > zval && (rgen.rand()&63) == 0) {
 						add_hole_in_landscape_texture(j, i, 1.2*fticks*(0.02 + wzmax - z_min));
 					}
-					float delta_area(1.0);
-
-					if (point_interior_to_mesh(j, i)) { // more accurate but less efficient
-						delta_area = 0.0;
-
-						for (int y = -1; y <= 1; ++y) {
-							for (int x = -1; x <= 1; ++x) {
-								if (zval >= mesh_height[i+y][j+x]) {delta_area += 1.0;}
-							}
-						}
-						delta_area /= 9.0;
-					}
-					valleys[wsi].area += SQUARE_S_AREA*delta_area; // if !no_update?
+					valleys[wsi].area += SQUARE_S_AREA*get_pond_cell_area_frac(i, j, zval); // if !no_update?
 					
 					if (wzmax >= z_min && i < MESH_Y_SIZE-1 && j < MESH_X_SIZE-1) {
 						xin[nin] = j; yin[nin] = i; ++nin;
@@ -642,6 +645,59 @@ void draw_water(bool no_update, bool draw_fast) {
 }
 
 
+float get_pond_cell_area_frac(int i, int j, float zval) {
+
+	if (!point_interior_to_mesh(j, i)) return 1.0;
+	float delta_area(0.0); // more accurate but less efficient
+
+	for (int y = -1; y <= 1; ++y) {
+		for (int x = -1; x <= 1; ++x) {
+			if (zval >= mesh_height[i+y][j+x]) {delta_area += 1.0;}
+		}
+	}
+	return delta_area/9.0;
+}
+
+
+void update_water_ripples(bool is_ice) { // call the function that computes the ripple effect
+
+	unsigned num_steps(1);
+
+	if (!(start_ripple || first_water_run) || is_ice || (!start_ripple && first_water_run)) {}
+	else {
+		assert(I_TIMESCALE2 > 0);
+		num_steps = max(1U, min(MAX_RIPPLE_STEPS, unsigned(min(3.0f, fticks)*min(MAX_I_TIMESCALE, I_TIMESCALE2))));
+	}
+	for (unsigned i = 0; i < num_steps; ++i) {compute_ripples();}
+	calc_water_normals();
+}
+
+
+// the update parts of draw_water() without any drawing, for headless mode
+void update_water_no_draw() {
+
+	process_water_springs();
+	add_waves();
+	if (DISABLE_WATER) return;
+	bool const is_ice(temperature <= W_FREEZE_POINT);
+	update_valleys_and_spillover(NULL);
+	if (animate2) {update_water_ripples(is_ice);}
+
+	for (int i = 0; i < MESH_Y_SIZE; ++i) { // accumulate pond surface areas, which is normally done while drawing interior water
+		for (int j = 0; j < MESH_X_SIZE; ++j) {
+			if (!is_ice && has_snow_accum) {update_accumulation(j, i);}
+			if (wminside[i][j] != 1) continue;
+			int const wsi(watershed_matrix[i][j].wsi);
+			assert(size_t(wsi) < valleys.size());
+			float const zval(valleys[wsi].zval), wzmax(max(zval, water_matrix[i][j]));
+			if (wzmax >= z_min_matrix[i][j] - G_W_STOP_DEPTH) {valleys[wsi].area += SQUARE_S_AREA*get_pond_cell_area_frac(i, j, zval);}
+		}
+	}
+	update_water_volumes();
+	first_water_run = 0;
+}
+
+
 void calc_water_normals() {
 
 	if (DISABLE_WATER) return;
@@ -1003,7 +1059,55 @@ void sync_water_height(int wsi, int skip_ix, float zval, float z_over, vector<un
 }
 
 
-void update_valleys_and_draw_spillover() {
+// cells of each valley that have a 4-neighbor outside of the valley, in row-major order; only these cells can spill
+void update_valley_boundary_cells() {
+
+	if (!valley_bcells_dirty && valley_bcells.size() == valleys.size()) return; // up-to-date
+	valley_bcells.clear();
+	valley_bcells.resize(valleys.size());
+	valley_nbors.clear();
+	valley_nbors.resize(valleys.size());
+	valley_spill_state.clear();
+	valley_spill_state.resize(valleys.size());
+	valley_spill_dirty.clear();
+	valley_spill_dirty.resize(valleys.size(), 1); // recheck everything
+	int const dirs[4][2] = {{0,1}, {0,-1}, {1,0}, {-1,0}};
+
+	for (int i = 1; i < MESH_Y_SIZE-1; ++i) {
+		for (int j = 1; j < MESH_X_SIZE-1; ++j) {
+			if (wminside[i][j] != 1) continue;
+			int const wsi(watershed_matrix[i][j].wsi);
+			assert(size_t(wsi) < valleys.size());
+
+			for (unsigned k = 0; k < 4; ++k) {
+				int const ii(i+dirs[k][0]), jj(j+dirs[k][1]);
+				if (wminside[ii][jj] == 1 && watershed_matrix[ii][jj].wsi == wsi) continue; // same valley
+				if (valley_bcells[wsi].empty() || valley_bcells[wsi].back() != unsigned(i*MESH_X_SIZE + j)) {valley_bcells[wsi].push_back(i*MESH_X_SIZE + j);}
+				if (wminside[ii][jj] == 1) {valley_nbors[wsi].push_back(watershed_matrix[ii][jj].wsi);}
+			}
+		}
+	}
+	for (auto i = valley_nbors.begin(); i != valley_nbors.end(); ++i) {
+		sort(i->begin(), i->end());
+		i->erase(unique(i->begin(), i->end()), i->end());
+	}
+	valley_bcells_dirty = 0;
+}
+
+void mark_valley_spill_dirty(int x, int y) { // called when the mesh height of (x, y) changes
+	int const dirs[5][2] = {{0,0}, {0,1}, {0,-1}, {1,0}, {-1,0}};
+
+	for (unsigned k = 0; k < 5; ++k) { // valleys that contain or border this cell
+		int const xx(x+dirs[k][0]), yy(y+dirs[k][1]);
+		if (point_outside_mesh(xx, yy) || wminside[yy][xx] != 1) continue;
+		int const wsi(watershed_matrix[yy][xx].wsi);
+		if (size_t(wsi) < valley_spill_dirty.size()) {valley_spill_dirty[wsi] = 1;}
+	}
+}
+
+
+// if spills is non-NULL, spillover draw calls are added to it
+void update_valleys_and_spillover(frame_vector<spill_draw_t> *spills) {
 
 	for (unsigned i = 0; i < valleys.size(); ++i) {
 		valley &v(valleys[i]);
@@ -1075,22 +1179,46 @@ void update_valleys_and_draw_spillover() {
 		v.depth       = v.zval - mesh_height[v.y][v.x];
 	} // for i
 
-	// check for spillover offscreen or into another pool
+	// check for spillover offscreen or into another pool; only boundary cells can spill, and each valley only updates its own spill state
 	int const ijd[4][4] = {{0,1,0,1}, {0,-1,0,0}, {1,0,1,0}, {-1,0,0,0}};
+	update_valley_boundary_cells();
+	// the result only depends on the water height of the valley and its neighbors, the mesh, and the spill graph;
+	// valleys that spilled into a neighbor last time depend on the spill graph and are always rechecked
+	vector<unsigned char> zval_changed(valleys.size());
+	for (unsigned i = 0; i < valleys.size(); ++i) {zval_changed[i] = (valleys[i].zval != valley_spill_state[i].zval);}
 
-	for (int i = 1; i < MESH_Y_SIZE-1; ++i) {
-		for (int j = 1; j < MESH_X_SIZE-1; ++j) {
-			if (wminside[i][j] != 1) continue;
-			int const wsi(watershed_matrix[i][j].wsi);
-			float const zval(valleys[wsi].zval);
-			if (zval < z_min_matrix[i][j]) continue;
+	for (unsigned i = 0; i < valleys.size(); ++i) {
+		if (valley_spill_dirty[i]) continue;
+		if (zval_changed[i] || valley_spill_state[i].spill_index >= 0) {valley_spill_dirty[i] = 1; continue;}
+		for (auto n = valley_nbors[i].begin(); n != valley_nbors[i].end(); ++n) {if (zval_changed[*n]) {valley_spill_dirty[i] = 1; break;}}
+	}
+	#pragma omp parallel for schedule(dynamic,16)
+	for (int wsi = 0; wsi < (int)valleys.size(); ++wsi) {
+		valley_spill_state_t &state(valley_spill_state[wsi]);
+
+		if (!valley_spill_dirty[wsi]) { // reuse the last result
+			valleys[wsi].sf          = state.sf;
+			valleys[wsi].spill_index = state.spill_index;
+			continue;
+		}
+		float const zval(valleys[wsi].zval);
+
+		for (auto c = valley_bcells[wsi].begin(); c != valley_bcells[wsi].end(); ++c) {
+			int const i(*c/MESH_X_SIZE), j(*c%MESH_X_SIZE);
+			if (wminside[i][j] != 1 || zval < z_min_matrix[i][j]) continue;
 
 			for (unsigned k = 0; k < 4; ++k) {
 				check_spillover(i+ijd[k][0], j+ijd[k][1], i+ijd[k][2], j+ijd[k][3], i, j, zval, wsi);
 			}
 		}
+		state.zval        = zval;
+		state.sf          = valleys[wsi].sf;
+		state.spill_index = valleys[wsi].spill_index;
+	}
+	for (unsigned i = 0; i < valleys.size(); ++i) {
+		num_valley_spill_checks += valley_spill_dirty[i];
+		valley_spill_dirty[i] = 0;
 	}
-	vector<vert_norm_color> verts;
 
 	for (unsigned i = 0; i < valleys.size(); ++i) { // update spill graph and other data
 		valley &v(valleys[i]); // pool that may be spilling (source)
@@ -1117,7 +1245,7 @@ void update_valleys_and_draw_spillover() {
 			v.has_spilled = 1;
 			float const zval(max((v.zval - sf.z_over), v.min_zval)); // zval at spill point (local minima)
 			sync_water_height(i, sf.index, zval, sf.z_over, cc);
-			draw_spillover(verts, sf.i, sf.j, sf.si, sf.sj, sf.index, int(vol_over), v.blood_mix, v.mud_mix);
+			if (spills) {spills->push_back(spill_draw_t(sf.i, sf.j, sf.si, sf.sj, sf.index, int(vol_over), v.blood_mix, v.mud_mix, ((sf.index < 0) ? zmin : valleys[sf.index].zval)));}
 			v.zval = zval;
 		}
 		else if (v.spill_index >= 0) {
@@ -1131,6 +1259,18 @@ void update_valleys_and_draw_spillover() {
 }
 
 
+void update_valleys_and_draw_spillover() {
+
+	frame_vector<spill_draw_t> spills;
+	update_valleys_and_spillover(&spills);
+	frame_vector<vert_norm_color> verts;
+
+	for (auto s = spills.begin(); s != spills.end(); ++s) {
+		draw_spillover(verts, s->i, s->j, s->si, s->sj, s->index, s->vol_over, s->blood_mix, s->mud_mix, s->zval);
+	}
+}
+
+
 void update_water_volumes() {
 
 	for (unsigned i = 0; i < valleys.size(); ++i) {
@@ -1158,10 +1298,78 @@ void update_water_volumes() {
 }
 
 
+// checks the parallel rest position calculation against calc_rest_pos(), then runs water springs on the current mesh
+// for a number of frames without drawing and restores the previous water state
+void run_water_benchmark() {
+
+	unsigned const NUM_FRAMES = 1000, NUM_SPRINGS = 100;
+	float const SPRING_RATE = 0.2; // water volume per spring per frame
+	int const t0(GET_TIME_MS());
+	vector<char> rp_set(XY_MULT_SIZE, 0);
+	vector<int> path_x(XY_SUM_SIZE), path_y(XY_SUM_SIZE), ref_dest(XY_MULT_SIZE, 0), dest;
+	vector<unsigned char> ref_found(XY_MULT_SIZE, 0), found;
+
+	for (int i = 0; i < MESH_Y_SIZE; ++i) { // Note: sets watershed_matrix x/y to the same values as calc_watershed()
+		for (int j = 0; j < MESH_X_SIZE; ++j) {
+			if (!point_interior_to_mesh(j, i)) continue;
+			int x(j), y(i);
+			ref_found[i*MESH_X_SIZE + j] = (unsigned char)calc_rest_pos(path_x, path_y, rp_set, x, y);
+			ref_dest [i*MESH_X_SIZE + j] = y*MESH_X_SIZE + x;
+		}
+	}
+	int const t1(GET_TIME_MS());
+	calc_rest_positions(dest, found);
+	int const t2(GET_TIME_MS());
+	unsigned num_diff(0);
+
+	for (int i = 0; i < MESH_Y_SIZE; ++i) {
+		for (int j = 0; j < MESH_X_SIZE; ++j) {
+			int const ix(i*MESH_X_SIZE + j);
+			if (point_interior_to_mesh(j, i) && (dest[ix] != ref_dest[ix] || (found[ix] == 1) != (ref_found[ix] != 0))) {++num_diff;}
+		}
+	}
+	cout << "Water benchmark: " << MESH_X_SIZE << "x" << MESH_Y_SIZE << " mesh, " << valleys.size() << " pools, rest positions serial " << (t1 - t0)
+		 << "ms, parallel " << (t2 - t1) << "ms, mismatches: " << num_diff << endl;
+	if (valleys.empty()) return;
+	vector<unsigned> spring_wsi;
+	rand_gen_t rgen;
+
+	for (unsigned n = 0; n < 100*NUM_SPRINGS && spring_wsi.size() < NUM_SPRINGS; ++n) {
+		int const x(rgen.rand()%MESH_X_SIZE), y(rgen.rand()%MESH_Y_SIZE);
+		if (wminside[y][x] == 1) {spring_wsi.push_back(watershed_matrix[y][x].wsi);}
+	}
+	vector<valley> const saved_valleys(valleys);
+	spillover const saved_spill(spill);
+	float const saved_max_water_height(max_water_height);
+	unsigned num_spills(0);
+	frame_vector<spill_draw_t> spills;
+	num_valley_spill_checks = 0;
+	int const t3(GET_TIME_MS());
+
+	for (unsigned n = 0; n < NUM_FRAMES; ++n) {
+		for (auto i = spring_wsi.begin(); i != spring_wsi.end(); ++i) {valleys[*i].fvol += SPRING_RATE;}
+		update_valleys_and_spillover(&spills);
+		update_water_volumes();
+		num_spills += spills.size();
+		spills.clear();
+	}
+	int const t4(GET_TIME_MS());
+	unsigned num_bcells(0);
+	for (auto i = valley_bcells.begin(); i != valley_bcells.end(); ++i) {num_bcells += i->size();}
+	cout << "Water benchmark: " << spring_wsi.size() << " springs, " << NUM_FRAMES << " frames in " << (t4 - t3) << "ms (" << float(t4 - t3)/NUM_FRAMES
+		 << "ms/frame), " << num_spills << " spills, " << num_bcells << " pool boundary cells of " << total_watershed << ", "
+		 << float(num_valley_spill_checks)/NUM_FRAMES << " of " << valleys.size() << " pools checked per frame" << endl;
+	valleys = saved_valleys;
+	spill   = saved_spill;
+	max_water_height = saved_max_water_height;
+	valley_bcells_dirty = 1; // reset cached spill state
+}
+
+
 // *** END VALLEYS/SPILLOVER ***
 
 
-int draw_spill_section(vector<vert_norm_color> &verts, int x1, int y1, int x2, int y2, float z1, float z2, float width, int volume, int index, float blood_mix, float mud_mix) {
+int draw_spill_section(frame_vector<vert_norm_color> &verts, int x1, int y1, int x2, int y2, float z1, float z2, float width, int volume, int index, float blood_mix, float mud_mix) {
 
 	assert(abs(x2 - x1) <= 1 && abs(y2 - y1) <= 1);
 	float const flow_height(FLOW_HEIGHT0*Z_SCENE_SIZE);
@@ -1232,7 +1440,7 @@ int draw_spill_section(vector<vert_norm_color> &verts, int x1, int y1, int x2, i
 }
 
 
-void draw_spillover(vector<vert_norm_color> &verts, int i, int j, int si, int sj, int index, int vol_over, float blood_mix, float mud_mix) {
+void draw_spillover(frame_vector<vert_norm_color> &verts, int i, int j, int si, int sj, int index, int vol_over, float blood_mix, float mud_mix, float zval) {
 
 	if (vol_over <= 0) return;
 	assert(!point_outside_mesh(j, i));
@@ -1241,7 +1449,6 @@ void draw_spillover(vector<vert_norm_color> &verts, int i, int j, int si, int sj
 	int x1(j), x2(j), y1(i), y2(i);
 	bool last_iteration(0);
 	float z1(mesh_height[i][j]);
-	float const zval(nov ? zmin : valleys[index].zval);
 	float const width(min(0.012, 0.1*(DX_VAL + DY_VAL)*(sqrt((float)vol_over) + 1.0)));
 	float const v_splash(min(10.0f, (float)vol_over));
 	int const xs(nov ? -1 : valleys[index].x), ys(nov ? -1 : valleys[index].y);
@@ -1331,24 +1538,26 @@ void calc_watershed() {
 	else { // no water
 		def_water_level = zmin;
 	}
-	for (int i = 0; i < MESH_Y_SIZE; ++i) {
-		for (int j = 0; j < MESH_X_SIZE; ++j) {
-			watershed_matrix[i][j].x = watershed_matrix[i][j].y = 0;
-		}
-	}
 	max_water_height = def_water_level;
 	min_water_height = def_water_level;
-	vector<char> rp_set(XY_MULT_SIZE, 0);
-	vector<int> path_x(XY_SUM_SIZE), path_y(XY_SUM_SIZE);
+	vector<int> dest;
+	vector<unsigned char> found;
+	calc_rest_positions(dest, found);
 
+	#pragma omp parallel for schedule(static,16)
 	for (int i = 0; i < MESH_Y_SIZE; ++i) {
 		for (int j = 0; j < MESH_X_SIZE; ++j) {
+			int const ix(i*MESH_X_SIZE + j);
+			bool const interior(point_interior_to_mesh(j, i));
+			int const x(interior ? dest[ix]%MESH_X_SIZE : j), y(interior ? dest[ix]/MESH_X_SIZE : i);
+			watershed_matrix[i][j].x = (interior ? x : 0);
+			watershed_matrix[i][j].y = (interior ? y : 0);
+
 			if (!get_water_enabled(j, i)) { // disabled
 				wminside[i][j] = 0;
 				continue;
 			}
-			int x(j), y(i);
-			int const crp(point_interior_to_mesh(j, i) ? calc_rest_pos(path_x, path_y, rp_set, x, y) : 0);
+			int const crp(interior ? (found[ix] == 1) : 0);
 			wminside[i][j] = ((mode == 1 && mesh_height[y][x] < water_plane_z) ? 2 : crp);
 		}
 	}
@@ -1357,6 +1566,7 @@ void calc_watershed() {
 	matrix_clear_2d(ripples);
 	first_water_run = 1;
 
+	#pragma omp parallel for schedule(static,16)
 	for (int i = 0; i < MESH_Y_SIZE; ++i) {
 		for (int j = 0; j < MESH_X_SIZE; ++j) {
 			if (wminside[i][j] == 1) { // dynamic water
@@ -1396,6 +1606,47 @@ void calc_watershed() {
 			}
 		} // for j
 	} // for i
+	if (water_bench) {run_water_benchmark();}
+}
+
+
+// computes the position reached by following w_motion_matrix from every interior cell with parallel pointer jumping; gives the same result as
+// calc_rest_pos(): dest is the final cell index, and found is 1 if the path ended at a local minimum or 2 if it left the mesh interior
+void calc_rest_positions(vector<int> &dest, vector<unsigned char> &found) {
+
+	unsigned const MAX_ROUNDS = 64; // enough for paths of 2^64 cells
+	dest .resize(XY_MULT_SIZE);
+	found.resize(XY_MULT_SIZE);
+	vector<int> next_dest(XY_MULT_SIZE);
+	vector<unsigned char> next_found(XY_MULT_SIZE);
+
+	#pragma omp parallel for schedule(static,16)
+	for (int y = 0; y < MESH_Y_SIZE; ++y) {
+		for (int x = 0; x < MESH_X_SIZE; ++x) {
+			int const ix(y*MESH_X_SIZE + x), x2(w_motion_matrix[y][x].x), y2(w_motion_matrix[y][x].y), ix2(y2*MESH_X_SIZE + x2);
+			if (!point_interior_to_mesh(x, y)) {dest[ix] = ix; found[ix] = 2;} // never pointed to; not used
+			else if (ix2 == ix) {dest[ix] = ix;  found[ix] = 1;} // local minimum
+			else if (!point_interior_to_mesh(x2, y2)) {dest[ix] = ix2; found[ix] = 2;} // leaves the interior
+			else {dest[ix] = ix2; found[ix] = 0;} // pending: dest is the next cell on the path
+		}
+	}
+	for (unsigned n = 0; n < MAX_ROUNDS; ++n) {
+		bool any_pending(0);
+
+		#pragma omp parallel for schedule(static,4096) reduction(|:any_pending)
+		for (int ix = 0; ix < XY_MULT_SIZE; ++ix) {
+			if (found[ix]) {next_dest[ix] = dest[ix]; next_found[ix] = found[ix]; continue;} // done
+			int const ix2(dest[ix]);
+			next_dest [ix] = dest [ix2]; // jump to the cell ix2 points to, or to its final position if done
+			next_found[ix] = found[ix2];
+			any_pending   |= (found[ix2] == 0);
+		}
+		dest .swap(next_dest);
+		found.swap(next_found);
+		if (!any_pending) return;
+	}
+	cout << "Error: Water flow path cycle in calc_rest_positions()." << endl;
+	for (auto i = found.begin(); i != found.end(); ++i) {if (*i == 0) {*i = 2;}} // treat cycles as not found
 }
 
 
@@ -1459,6 +1710,7 @@ void calc_water_flow() {
 	}
 	valleys.clear();
 	spill.clear();
+	valley_bcells_dirty = 1;
 
 	for (int i = 0; i < MESH_Y_SIZE; ++i) {
 		for (int j = 0; j < MESH_X_SIZE; ++j) {
@@ -1628,6 +1880,7 @@ void make_outside_water(int x, int y) {
 	if (wminside[y][x] == 2) return; // already outside water
 	wminside[y][x] = 2; // make outside water (anything else we need to update? what if all of a valley disappears?)
 	watershed_matrix[y][x].wsi = -1; // invalid
+	valley_bcells_dirty = 1;
 	water_matrix[y][x] = water_plane_z; // may be unnecessary
 }
 
@@ -1636,6 +1889,7 @@ void update_water_zval(int x, int y, float old_mh) {
 
 	assert(!point_outside_mesh(x, y));
 	if (!get_water_enabled(x, y)) return; // ???
+	mark_valley_spill_dirty(x, y);
 
 	if (mesh_height[y][x] < water_plane_z) { // check if this pos is under the mesh
 		make_outside_water(x, y); // previously above the mesh
@@ -22,9 +22,11 @@ unsigned const PMAP_SIZE          = (2*N_SPHERE_DIV)/3;
 float const UNREACHABLE_TIME      = 0.75; // in seconds
 
 
+bool smiley_parallel_ai(1), smiley_ai_bench(0);
 float smiley_speed(1.0), smiley_acc(0);
 vector<point> app_spots;
 vector<od_data> oddatav; // used as a temporary
+vector<unsigned char> smiley_darkness; // per-frame is_in_darkness() results for {smileys, camera}
 
 
 extern bool has_wpt_goal, use_waypoint_app_spots, enable_init_shields, smileys_chase_player, enable_translocator;
@@ -300,8 +302,9 @@ void add_target(vector<od_data> &oddatav, pos_dir_up const &pdu, point const &po
 }
 
 
-int player_state::find_nearest_enemy(point const &pos, pos_dir_up const &pdu, point const &avoid_dir,
-	int smiley_id, point &target, int &target_visible, float &min_dist) const
+// Note: thread safe if odv is not shared
+int player_state::find_nearest_enemy(point const &pos, pos_dir_up const &pdu, point const &avoid_dir, int smiley_id,
+	point &target, int &target_visible, float &min_dist, vector<od_data> &odv, vector<unsigned char> const *in_darkness) const
 {
 	assert(smiley_id < num_smileys);
 	int min_i(NO_SOURCE);
@@ -319,36 +322,51 @@ int player_state::find_nearest_enemy(point const &pos, pos_dir_up const &pdu, po
 			dwobject const &obj(obj_groups[cid].get_obj(i));
 			if (obj.disabled() || i == smiley_id || same_team(smiley_id, i))      continue;
 			if (last_hitter != i && sstates[i].powerup == PU_INVISIBILITY)        continue; // invisible
-			if (last_hitter != i && is_in_darkness(obj.pos, radius, obj.coll_id)) continue; // too dark to be visible
-			add_target(oddatav, pdu, obj.pos, radius, i, last_hitter, killer);
+			if (last_hitter != i && (in_darkness ? (*in_darkness)[i] : is_in_darkness(obj.pos, radius, obj.coll_id))) continue; // too dark to be visible
+			add_target(odv, pdu, obj.pos, radius, i, last_hitter, killer);
 		}
 	}
 	if (camera_mode != 0 && !spectate && !same_team(smiley_id, CAMERA_ID) && (sstates[CAMERA_ID].powerup != PU_INVISIBILITY || last_hitter == CAMERA_ID)) {
-		if (!is_in_darkness(camera, radius, camera_coll_id)) {
-			add_target(oddatav, pdu, camera, radius, CAMERA_ID, last_hitter, killer); // camera IN_DARKNESS?
+		if (!(in_darkness ? (*in_darkness)[num_smileys] : is_in_darkness(camera, radius, camera_coll_id))) {
+			add_target(odv, pdu, camera, radius, CAMERA_ID, last_hitter, killer); // camera IN_DARKNESS?
 		}
 	}
-	sort(oddatav.begin(), oddatav.end());
+	sort(odv.begin(), odv.end());
 
-	for (unsigned i = 0; i < oddatav.size(); ++i) { // find closest visible target
-		point const pos2(get_sstate_pos(oddatav[i].id));
+	for (unsigned i = 0; i < odv.size(); ++i) { // find closest visible target
+		point const pos2(get_sstate_pos(odv[i].id));
 		if (avoid_dir != zero_vector && dot_product_ptv(pos2, pos, avoid_dir) > 0.0) continue; // need to avoid this direction
-		float const dist(oddatav[i].dist);
+		float const dist(odv[i].dist);
 
 		if (sphere_in_view(pdu, pos2, radius, 5)) {
 			min_dist = sqrt(dist);
-			min_i    = oddatav[i].id;
+			min_i    = odv[i].id;
 			assert(min_i >= CAMERA_ID);
 			target         = pos2;
 			target_visible = 1;
 			break;
 		}
 	}
-	oddatav.clear();
+	odv.clear();
 	return min_i;
 }
 
 
+// uses the results of the sense phase if still valid, otherwise runs the visibility queries now
+int player_state::get_nearest_enemy(point const &pos, pos_dir_up const &pdu, point const &avoid_dir, int smiley_id,
+	point &target, int &target_visible, float &min_dist, bool use_sensed) const
+{
+	if (!use_sensed) return find_nearest_enemy(pos, pdu, avoid_dir, smiley_id, target, target_visible, min_dist, oddatav);
+	min_dist = sensed.enemy_dist;
+
+	if (sensed.enemy_visible) {
+		target         = sensed.enemy_pos;
+		target_visible = 1;
+	}
+	return sensed.enemy;
+}
+
+
 int find_nearest_enemy_translocator(int smiley_id, pos_dir_up const &pdu) { // unused
 
 	obj_group &objg(obj_groups[coll_id[XLOCATOR]]);
@@ -404,6 +422,52 @@ void player_state::mark_waypoint_reached(int curw, int smiley_id) {
 }
 
 
+// mode: 0: none, 1: user wpt, 2: placed item wpt, 3: goal wpt, 4: wpt index, 5: closest wpt, 6: closest visible wpt, 7: goal pos (new wpt)
+wpt_goal player_state::get_wpt_goal(int smiley_id, int last_target_visible, int last_target_type) const {
+
+	wpt_goal goal;
+
+	if (smileys_chase_player) {
+		goal = wpt_goal(6, 0, get_camera_pos()-point(0.0, 0.0, camera_zh)); // closest wpt visible to camera
+	}
+	else {
+		goal = wpt_goal((has_wpt_goal ? 3 : 2), 0, all_zeros); // mode, wpt, goal_pos
+	}
+	if (last_target_visible && last_target_type != 3 && goal.mode <= 2) { // have a previous enemy/item target and no real goal
+		goal.mode = 6; // closest visible waypoint
+		goal.pos  = target_pos; // should still be valid
+	}
+	if (goal.mode <= 2) { // add waypoint to a team member engaging an enemy
+		for (int i = 0; i < num_smileys; ++i) { // what about camera/player (CAMERA_ID)?
+			if (i == smiley_id || !same_team(i, smiley_id)) continue;
+			player_state const &ss(sstates[i]);
+			if (!ss.target_visible || ss.target_type != 1 || ss.target == NO_SOURCE) continue;
+			goal.mode = 6;
+			goal.pos  = ss.target_pos;
+		}
+	}
+	return goal;
+}
+
+
+// next waypoint on the path from curw to goal, using the result of the batched query from the sense phase if it was for the same start and goal
+int player_state::find_next_path_wpt(int curw, wpt_goal const &goal, int smiley_id) {
+
+	bool const use_sensed(sensed.path_start == curw && sensed.path_goal == goal);
+	int const next_wpt(use_sensed ? sensed.path_next_wpt : -1);
+	sensed.path_start = -1; // only use once
+	if (use_sensed) return next_wpt;
+	set<unsigned> wps_used; // penalize waypoints on other smiley paths to reduce clustering of smileys
+#if 0
+	for (unsigned i = 0; i < (unsigned)num_smileys; ++i) {
+		if (sstates != nullptr && i != smiley_id && sstates[i].last_waypoint >= 0) {wps_used.insert(sstates[i].last_waypoint);}
+	}
+#endif
+	// FIXME: skip path waypoints that are in unreachable[1]?
+	return find_optimal_next_waypoint(curw, goal, wps_used); // can return -1
+}
+
+
 // health, shields, powerup, weapon, ammo, pack, waypoint
 int player_state::find_nearest_obj(point const &pos, pos_dir_up const &pdu, point const &avoid_dir, int smiley_id,
 	point &target_pt, float &min_dist, vector<type_wt_t> types, int last_target_visible, int last_target_type)
@@ -422,28 +486,8 @@ int player_state::find_nearest_obj(point const &pos, pos_dir_up const &pdu, poin
 		if (type == WAYPOINT) { // process waypoints
 			int curw(last_waypoint);
 			int ignore_w(-1);
-			wpt_goal goal;
+			wpt_goal const goal(get_wpt_goal(smiley_id, last_target_visible, last_target_type));
 
-			// mode: 0: none, 1: user wpt, 2: placed item wpt, 3: goal wpt, 4: wpt index, 5: closest wpt, 6: closest visible wpt, 7: goal pos (new wpt)
-			if (smileys_chase_player) {
-				goal = wpt_goal(6, 0, get_camera_pos()-point(0.0, 0.0, camera_zh)); // closest wpt visible to camera
-			}
-			else {
-				goal = wpt_goal((has_wpt_goal ? 3 : 2), 0, all_zeros); // mode, wpt, goal_pos
-			}
-			if (last_target_visible && last_target_type != 3 && goal.mode <= 2) { // have a previous enemy/item target and no real goal
-				goal.mode = 6; // closest visible waypoint
-				goal.pos  = target_pos; // should still be valid
-			}
-			if (goal.mode <= 2) { // add waypoint to a team member engaging an enemy
-				for (int i = 0; i < num_smileys; ++i) { // what about camera/player (CAMERA_ID)?
-					if (i == smiley_id || !same_team(i, smiley_id)) continue;
-					player_state const &ss(sstates[i]);
-					if (!ss.target_visible || ss.target_type != 1 || ss.target == NO_SOURCE) continue;
-					goal.mode = 6;
-					goal.pos  = ss.target_pos;
-				}
-			}
 			if (curw >= 0) { // currently targeting a waypoint
 				assert((unsigned)curw < waypoints.size());
 
@@ -452,14 +496,7 @@ int player_state::find_nearest_obj(point const &pos, pos_dir_up const &pdu, poin
 					waypt_adj_vect const &next(waypoints[curw].next_wpts);
 
 					if (!next.empty()) { // choose next waypoint from graph
-						set<unsigned> wps_used; // penalize waypoints on other smiley paths to reduce clustering of smileys
-#if 0
-						for (unsigned i = 0; i < (unsigned)num_smileys; ++i) {
-							if (sstates != nullptr && i != smiley_id && sstates[i].last_waypoint >= 0) {wps_used.insert(sstates[i].last_waypoint);}
-						}
-#endif
-						// FIXME: skip path waypoints that are in unreachable[1]?
-						curw = next_path_wpt = find_optimal_next_waypoint(curw, goal, wps_used); // can return -1
+						curw = next_path_wpt = find_next_path_wpt(curw, goal, smiley_id); // can return -1
 
 						for (unsigned i = 0; i < next.size(); ++i) {
 							check_cand_waypoint(pos, avoid_dir, smiley_id, oddatav, next[i], curw, dmult, pdu, 1, 0.0);
@@ -703,11 +740,13 @@ void player_state::smiley_select_target(dwobject &obj, int smiley_id) {
 	float const health_eq(min(4.0f*health, (health + shields)));
 	bool const almost_dead(health_eq < 20.0);
 	pos_dir_up const pdu(get_smiley_pdu(obj.pos, obj.orientation));
-	vector3d const avoid_dir(get_avoid_dir(obj.pos, smiley_id, pdu));
+	bool const use_sensed(sensed.matches(obj.pos, obj.orientation)); // not moved (teleported, respawned, etc.) since the sense phase
+	vector3d const avoid_dir(use_sensed ? sensed.avoid_dir : get_avoid_dir(obj.pos, smiley_id, pdu));
+	sensed.valid = 0; // only use once
 
 	if (game_mode == 2 && !UNLIMITED_WEAPONS) { // want the ball
 		if (p_ammo[W_BALL] > 0) { // already have a ball
-			min_ie = find_nearest_enemy(obj.pos, pdu, avoid_dir, smiley_id, target_pos, target_visible, diste);
+			min_ie = get_nearest_enemy(obj.pos, pdu, avoid_dir, smiley_id, target_pos, target_visible, diste, use_sensed);
 		}
 		if (!target_visible) { // don't have a ball or no enemy in sight
 			types.push_back(type_wt_t(BALL, 1.0));
@@ -723,7 +762,7 @@ void player_state::smiley_select_target(dwobject &obj, int smiley_id) {
 		types.push_back(type_wt_t(WA_PACK, 1.0));
 		types.push_back(type_wt_t(SHIELD,  (almost_dead ? 10 : 1.2)*(1.0 - shields/MAX_SHIELDS))); // always below max since it ticks down over time
 		if (health < MAX_HEALTH) {types.push_back(type_wt_t(HEALTH, (almost_dead ? 15 : 1.5)*(1.0 - health/MAX_HEALTH)));}
-		if (game_mode) {min_ie = find_nearest_enemy(obj.pos, pdu, avoid_dir, smiley_id, targete, target_visible, diste);}
+		if (game_mode) {min_ie = get_nearest_enemy(obj.pos, pdu, avoid_dir, smiley_id, targete, target_visible, diste, use_sensed);}
 		min_ih = find_nearest_obj(obj.pos, pdu, avoid_dir, smiley_id, targeth, disth, types, last_target_visible, last_target_type);
 
 		if (!target_visible) { // can't find an enemy, choose health/pickup
@@ -789,6 +828,108 @@ void player_state::smiley_select_target(dwobject &obj, int smiley_id) {
 }
 
 
+// read-only visibility queries against the current world state; safe to run in parallel across smileys
+void player_state::smiley_sense(dwobject const &obj, int smiley_id) {
+
+	sensed = smiley_sense_t();
+	if (obj.disabled() || obj.health < 0.0 || obj.time < 1) return; // dead or not yet initialized
+	pos_dir_up const pdu(get_smiley_pdu(obj.pos, obj.orientation));
+	sensed.pos       = obj.pos;
+	sensed.orient    = obj.orientation;
+	sensed.avoid_dir = get_avoid_dir(obj.pos, smiley_id, pdu);
+
+	if (game_mode) {
+		vector<od_data> odv;
+		sensed.enemy = find_nearest_enemy(obj.pos, pdu, sensed.avoid_dir, smiley_id, sensed.enemy_pos, sensed.enemy_visible, sensed.enemy_dist, odv, &smiley_darkness);
+	}
+	sensed.valid = 1;
+}
+
+
+// run the path queries of smileys that have reached their current waypoint as one batch; the goal is predicted from the current state,
+// and find_next_path_wpt() falls back to a single query if the goal changed because other smileys were updated first
+void smiley_batch_path_queries() {
+
+	if (waypoints.empty()) return;
+	float const sradius(object_types[SMILEY].radius);
+	vector<wpt_path_query_t> queries;
+	vector<int> query_smileys;
+
+	for (int i = 0; i < num_smileys; ++i) {
+		smiley_sense_t &sensed(sstates[i].sensed);
+		int const curw(sstates[i].last_waypoint);
+		if (!sensed.valid || curw < 0) continue;
+		assert((unsigned)curw < waypoints.size());
+		if (!dist_less_than(waypoints[curw].pos, sensed.pos, sradius) || waypoints[curw].next_wpts.empty()) continue; // not choosing the next path waypoint
+		sensed.path_goal = sstates[i].get_wpt_goal(i, sstates[i].target_visible, sstates[i].target_type);
+		if (!sensed.path_goal.is_reachable()) continue; // single query returns -1 without a search
+		queries.push_back(wpt_path_query_t(curw, sensed.path_goal));
+		query_smileys.push_back(i);
+	}
+	find_optimal_next_waypoints(queries); // Note: modifies the query goals
+
+	for (unsigned i = 0; i < queries.size(); ++i) {
+		smiley_sense_t &sensed(sstates[query_smileys[i]].sensed);
+		sensed.path_start    = queries[i].start;
+		sensed.path_next_wpt = queries[i].next_wpt;
+	}
+}
+
+
+// sense phase: evaluate the per-frame target visibility queries of all smileys as one batch before any smiley moves;
+// the decide/act phase (smiley_select_target(), smiley_motion(), smiley_action()) then runs serially in advance_smiley()
+void smiley_sense_all(bool parallel) {
+
+	if (num_smileys == 0 || sstates == nullptr) return;
+	obj_group const &objg(obj_groups[coll_id[SMILEY]]);
+	if (!objg.enabled) return;
+	assert((int)objg.max_objects() == num_smileys);
+	float const radius(object_types[SMILEY].radius);
+	point camera(get_camera_pos());
+	camera.z += 0.5*camera_zh;
+	smiley_darkness.resize(num_smileys+1);
+
+	// darkness doesn't depend on the viewer, so test each potential target once rather than once per viewer/target pair
+#pragma omp parallel for schedule(dynamic,1) if (parallel)
+	for (int i = 0; i <= num_smileys; ++i) {
+		if (i == num_smileys) {smiley_darkness[i] = (camera_mode != 0 && is_in_darkness(camera, radius, camera_coll_id)); continue;}
+		dwobject const &obj(objg.get_obj(i));
+		smiley_darkness[i] = (!obj.disabled() && is_in_darkness(obj.pos, radius, obj.coll_id));
+	}
+#pragma omp parallel for schedule(dynamic,1) if (parallel)
+	for (int i = 0; i < num_smileys; ++i) {sstates[i].smiley_sense(objg.get_obj(i), i);}
+	if (parallel) {smiley_batch_path_queries();}
+}
+
+void run_smiley_ai_benchmark() {
+
+	vector<smiley_sense_t> serial(num_smileys);
+	int const start_time(GET_TIME_MS());
+	smiley_sense_all(0);
+	int const serial_time(GET_TIME_MS() - start_time);
+	for (int i = 0; i < num_smileys; ++i) {serial[i] = sstates[i].sensed;}
+	smiley_sense_all(1);
+	int const parallel_time(GET_TIME_MS() - start_time - serial_time);
+	unsigned num_valid(0), num_visible(0), num_mismatch(0);
+
+	for (int i = 0; i < num_smileys; ++i) {
+		smiley_sense_t const &a(serial[i]), &b(sstates[i].sensed);
+		num_valid    += a.valid;
+		num_visible  += (a.enemy_visible != 0);
+		num_mismatch += (a.valid != b.valid || a.enemy != b.enemy || a.enemy_visible != b.enemy_visible || a.avoid_dir != b.avoid_dir);
+	}
+	cout << "Smiley AI benchmark: " << num_smileys << " smileys, " << num_valid << " active, " << num_visible << " with visible enemies, sense phase serial "
+		 << serial_time << "ms, parallel " << parallel_time << "ms, mismatches " << num_mismatch << endl;
+	assert(num_mismatch == 0); // the parallel sense phase must match the serial one
+}
+
+void smiley_sense_targets() {
+
+	if (smiley_ai_bench && num_smileys > 0) {run_smiley_ai_benchmark(); smiley_ai_bench = 0;} // run once
+	else {smiley_sense_all(smiley_parallel_ai);}
+}
+
+
 bool is_targeting_smiley(int targeter, int targetee, point const &targetee_pos) {
 
 	assert(targeter >= CAMERA_ID && targeter < num_smileys);
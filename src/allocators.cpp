@@ -0,0 +1,205 @@
+// 3D World - Per-Frame Linear Arena Allocator
+// by 3DWorld contributors
+// 10/18/26
+
+#include "3DWorld.h"
+#include "allocators.h"
+#include <omp.h>
+#include <thread>
+
+std::size_t const ARENA_ALIGN = 16; // also the header size, which keeps user pointers aligned
+std::size_t const MIN_ARENA_BLOCK_SZ = (1 << 20); // 1MB
+int const HEAP_ARENA_ID = -1;
+
+bool use_frame_arena(1), frame_arena_bench(0);
+thread_local int tls_arena_id(HEAP_ARENA_ID); // only bound on the main thread and the OpenMP worker threads of its team
+
+
+struct arena_alloc_hdr_t {
+	int arena_id; // index of the owning arena, or HEAP_ARENA_ID
+	unsigned pad;
+	std::size_t sz; // rounded size, including the header
+};
+static_assert(sizeof(arena_alloc_hdr_t) <= ARENA_ALIGN, "arena header is too large");
+
+
+class frame_arena_t {
+
+	struct block_t {
+		char *data;
+		std::size_t sz;
+		block_t(std::size_t sz_) : data(static_cast<char *>(malloc(sz_))), sz(sz_) {assert(data != nullptr); add_mem_usage(MEM_CAT_FRAME_ARENA, sz);}
+	};
+	vector<block_t> blocks; // allocations come from the last block
+	std::size_t pos; // offset into the last block
+	frame_arena_stats_t stats;
+
+	void free_blocks() {
+		for (auto i = blocks.begin(); i != blocks.end(); ++i) {free(i->data); sub_mem_usage(MEM_CAT_FRAME_ARENA, i->sz);}
+		blocks.clear();
+	}
+public:
+	frame_arena_t() : pos(0) {}
+	~frame_arena_t() {free_blocks();}
+
+	void *alloc(std::size_t sz) { // sz includes the header
+		if (blocks.empty() || pos + sz > blocks.back().sz) { // start a new block; the previous ones are merged on the next reset
+			blocks.push_back(block_t(max(max(sz, MIN_ARENA_BLOCK_SZ), (blocks.empty() ? 0 : 2*blocks.back().sz))));
+			stats.capacity += blocks.back().sz;
+			pos = 0;
+		}
+		char *const ptr(blocks.back().data + pos);
+		pos += sz;
+		stats.bytes += sz;
+		++stats.num_allocs;
+		++stats.num_live;
+		return ptr;
+	}
+	void dealloc(char *ptr, std::size_t sz) {
+		assert(stats.num_live > 0 && !blocks.empty());
+		--stats.num_live;
+		if (stats.num_live == 0) {pos = 0;} // everything was freed, restart the current block
+		else if (ptr + sz == blocks.back().data + pos) {pos -= sz;} // last allocation, such as the old buffer of a growing vector
+	}
+	frame_arena_stats_t next_frame() {
+		frame_arena_stats_t const ret(stats);
+
+		if (stats.num_live == 0 && blocks.size() > 1) { // merge blocks so that the next frame fits in one
+			std::size_t const tot_sz(stats.capacity);
+			free_blocks();
+			blocks.push_back(block_t(tot_sz));
+			pos = 0;
+		}
+		// if any containers are still live, keep their memory and continue from the current position
+		stats.num_allocs = 0;
+		stats.bytes      = 0;
+		return ret;
+	}
+};
+
+
+class frame_arena_set_t {
+
+	vector<frame_arena_t> arenas; // one per thread
+	std::thread::id main_thread_id;
+	bool team_bound;
+
+	// binds the main thread to arena 0 and the worker threads of its OpenMP team to the other arenas; the runtime reuses these threads for later parallel regions
+	// started by the main thread, while other threads (ray tracing, etc.) and the workers of teams they start are never bound and use the heap
+	void bind_main_team() {
+		assert(omp_get_level() == 0 && std::this_thread::get_id() == main_thread_id);
+#pragma omp parallel num_threads((int)arenas.size())
+		{tls_arena_id = omp_get_thread_num();}
+		assert(tls_arena_id == 0);
+		team_bound = 1;
+	}
+public:
+	unsigned num_heap_allocs;
+
+	frame_arena_set_t() : arenas(max(omp_get_max_threads(), omp_get_num_procs())), main_thread_id(std::this_thread::get_id()), team_bound(0), num_heap_allocs(0) {}
+
+	static int get_arena_id() {
+		if (!use_frame_arena || tls_arena_id == HEAP_ARENA_ID) return HEAP_ARENA_ID; // not a thread of the main team
+		int const level(omp_get_level());
+		if (level == 0) {return ((tls_arena_id == 0) ? 0 : HEAP_ARENA_ID);} // main thread outside of a parallel region
+		if (level > 1) return HEAP_ARENA_ID; // nested parallel region
+		return ((omp_get_thread_num() == tls_arena_id) ? tls_arena_id : HEAP_ARENA_ID); // bound thread used at a different position, maybe in another team
+	}
+	frame_arena_t &get_arena(int id) {assert(id >= 0 && id < (int)arenas.size()); return arenas[id];}
+
+	frame_arena_stats_t next_frame() {
+		assert(!omp_in_parallel() && std::this_thread::get_id() == main_thread_id);
+		if (!team_bound) {bind_main_team();} // first frame; everything before this used the heap
+		frame_arena_stats_t stats;
+		stats.num_heap_allocs = num_heap_allocs;
+		num_heap_allocs = 0;
+
+		for (auto i = arenas.begin(); i != arenas.end(); ++i) {
+			frame_arena_stats_t const s(i->next_frame());
+			stats.num_allocs += s.num_allocs;
+			stats.num_live   += s.num_live;
+			stats.bytes      += s.bytes;
+			stats.capacity   += s.capacity;
+		}
+		return stats;
+	}
+};
+
+frame_arena_set_t &get_frame_arenas() {
+	static frame_arena_set_t frame_arenas; // created on first use, which is from the main thread
+	return frame_arenas;
+}
+
+
+void *frame_arena_alloc(std::size_t sz) {
+
+	std::size_t const tot_sz(((sz + ARENA_ALIGN - 1)/ARENA_ALIGN + 1)*ARENA_ALIGN); // round up and add the header
+	frame_arena_set_t &fas(get_frame_arenas());
+	int const arena_id(fas.get_arena_id());
+	arena_alloc_hdr_t *hdr(nullptr);
+
+	if (arena_id == HEAP_ARENA_ID) {
+		hdr = static_cast<arena_alloc_hdr_t *>(malloc(tot_sz));
+		if (hdr == nullptr) throw std::bad_alloc();
+#pragma omp atomic
+		++fas.num_heap_allocs;
+	}
+	else {hdr = static_cast<arena_alloc_hdr_t *>(fas.get_arena(arena_id).alloc(tot_sz));}
+	hdr->arena_id = arena_id;
+	hdr->sz       = tot_sz;
+	return reinterpret_cast<char *>(hdr) + ARENA_ALIGN;
+}
+
+void frame_arena_free(void *ptr, std::size_t sz) {
+
+	if (ptr == nullptr) return;
+	arena_alloc_hdr_t *const hdr(reinterpret_cast<arena_alloc_hdr_t *>(static_cast<char *>(ptr) - ARENA_ALIGN));
+	if (hdr->arena_id == HEAP_ARENA_ID) {free(hdr); return;}
+	frame_arena_set_t &fas(get_frame_arenas());
+	assert(hdr->arena_id == tls_arena_id); // must be freed by the allocating thread, which owns the arena
+	fas.get_arena(hdr->arena_id).dealloc(reinterpret_cast<char *>(hdr), hdr->sz);
+}
+
+frame_arena_stats_t frame_arena_next_frame() {return get_frame_arenas().next_frame();}
+
+
+// builds and destroys small sets and vectors in a parallel loop, similar to the movable cobj push code, with the default and frame allocators
+void run_frame_arena_benchmark() {
+
+	unsigned const NUM_ITERS = 200000, SET_SZ = 16, VECT_SZ = 64;
+	bool const prev_use_frame_arena(use_frame_arena);
+	double times[2] = {0.0};
+	unsigned checksum[2] = {0};
+
+	for (unsigned pass = 0; pass < 2; ++pass) { // {std::allocator, frame_allocator_t}
+		use_frame_arena = 1;
+		frame_arena_next_frame();
+		double const start_time(get_hr_time_ms());
+		unsigned sum(0);
+
+#pragma omp parallel for schedule(static,256) reduction(+:sum)
+		for (int i = 0; i < (int)NUM_ITERS; ++i) {
+			if (pass == 0) {
+				set<unsigned> seen;
+				vector<unsigned> cobjs;
+				for (unsigned n = 0; n < SET_SZ;  ++n) {seen.insert((i*7919U + n*104729U) & 1023);}
+				for (unsigned n = 0; n < VECT_SZ; ++n) {cobjs.push_back(i + n);}
+				sum += seen.size() + cobjs.back();
+			}
+			else {
+				frame_set<unsigned> seen;
+				frame_vector<unsigned> cobjs;
+				for (unsigned n = 0; n < SET_SZ;  ++n) {seen.insert((i*7919U + n*104729U) & 1023);}
+				for (unsigned n = 0; n < VECT_SZ; ++n) {cobjs.push_back(i + n);}
+				sum += seen.size() + cobjs.back();
+			}
+		}
+		times[pass]    = get_hr_time_ms() - start_time;
+		checksum[pass] = sum;
+	}
+	frame_arena_stats_t const stats(frame_arena_next_frame());
+	use_frame_arena = prev_use_frame_arena;
+	assert(checksum[0] == checksum[1]);
+	cout << "Frame arena benchmark: " << NUM_ITERS << " iterations, std::allocator " << times[0] << "ms, frame arena " << times[1] << "ms ("
+		 << stats.num_allocs << " arena allocs, " << stats.num_heap_allocs << " heap allocs)" << endl;
+}
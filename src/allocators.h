@@ -29,5 +29,59 @@ public:
 	}
 };
 
+
+// per-frame linear (bump) arena for transient containers, with one arena per thread of the main thread's OpenMP team (other threads use the heap);
+// arena memory is reclaimed by frame_arena_next_frame(), so containers must not outlive the frame or the allocating thread
+void *frame_arena_alloc(std::size_t sz);
+void frame_arena_free(void *ptr, std::size_t sz);
+
+struct frame_arena_stats_t {
+	unsigned num_allocs, num_heap_allocs, num_live; // num_live = containers still allocated at the end of the frame
+	std::size_t bytes, capacity;
+	frame_arena_stats_t() : num_allocs(0), num_heap_allocs(0), num_live(0), bytes(0), capacity(0) {}
+};
+frame_arena_stats_t frame_arena_next_frame(); // returns stats for the frame that just ended
+void run_frame_arena_benchmark();
+
+template <typename T>
+class frame_allocator_t {
+public:
+	typedef T value_type;
+	template <typename O> struct rebind {typedef frame_allocator_t<O> other;};
+	frame_allocator_t() {}
+	template <typename O> frame_allocator_t(frame_allocator_t<O> const &) {}
+	T* allocate(std::size_t n) {return static_cast<T *>(frame_arena_alloc(n*sizeof(T)));}
+	void deallocate(T* ptr, std::size_t n) {frame_arena_free(ptr, n*sizeof(T));}
+	template <typename O> bool operator==(frame_allocator_t<O> const &) const {return 1;} // all instances share the same arenas
+	template <typename O> bool operator!=(frame_allocator_t<O> const &) const {return 0;}
+};
+
+template <typename T> using frame_vector = vector<T, frame_allocator_t<T>>;
+template <typename T> using frame_set    = std::set<T, std::less<T>, frame_allocator_t<T>>;
+
+
+// heap allocator that registers its bytes with memory category CAT (MEM_CAT_*) for the current/peak memory usage report
+template <typename T, unsigned CAT>
+class mem_track_allocator_t {
+public:
+	typedef T value_type;
+	template <typename O> struct rebind {typedef mem_track_allocator_t<O, CAT> other;};
+	mem_track_allocator_t() {}
+	template <typename O> mem_track_allocator_t(mem_track_allocator_t<O, CAT> const &) {}
+	T* allocate(std::size_t n) {
+		T *const ptr(std::allocator<T>().allocate(n));
+		add_mem_usage(CAT, n*sizeof(T));
+		return ptr;
+	}
+	void deallocate(T* ptr, std::size_t n) {
+		std::allocator<T>().deallocate(ptr, n);
+		sub_mem_usage(CAT, n*sizeof(T));
+	}
+	template <typename O> bool operator==(mem_track_allocator_t<O, CAT> const &) const {return 1;} // stateless
+	template <typename O> bool operator!=(mem_track_allocator_t<O, CAT> const &) const {return 0;}
+};
+
+template <typename T, unsigned CAT> using tracked_vector = vector<T, mem_track_allocator_t<T, CAT>>;
+
 #endif // _ALLOCATORS_H_
 
@@ -1191,9 +1191,9 @@ void uasteroid_belt_system::calc_colliders() {
 	colliders.clear();
 	if (!animate2 || !system) return;
 
-	for (vector<uplanet>::const_iterator p = system->planets.begin(); p != system->planets.end(); ++p) {
+	for (auto p = system->planets.begin(); p != system->planets.end(); ++p) {
 		add_potential_collider(p->pos, p->radius);
-		for (vector<umoon>::const_iterator m = p->moons.begin(); m != p->moons.end(); ++m) {add_potential_collider(m->pos, m->radius);}
+		for (auto m = p->moons.begin(); m != p->moons.end(); ++m) {add_potential_collider(m->pos, m->radius);}
 	}
 	for (auto i = all_ships.begin(); i != all_ships.end(); ++i) {
 		if (i->radius > 0.004) {add_potential_collider(i->pos, i->radius);} // large ships
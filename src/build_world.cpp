@@ -48,7 +48,7 @@ vector<obj_draw_group> obj_draw_groups;
 vector<sphere_t> cur_frame_explosions;
 cube_light_src_vect sky_cube_lights, global_cube_lights;
 
-extern bool clear_landscape_vbo, use_voxel_cobjs, tree_4th_branches, lm_alloc, reflect_dodgeballs, begin_motion, disable_fire_delay;
+extern bool headless_mode, clear_landscape_vbo, use_voxel_cobjs, tree_4th_branches, lm_alloc, reflect_dodgeballs, begin_motion, disable_fire_delay;
 extern int camera_view, camera_mode, camera_reset, animate2, recreated, temp_change, preproc_cube_cobjs, precip_mode;
 extern int is_cloudy, num_smileys, load_coll_objs, world_mode, start_ripple, has_snow_accum, has_accumulation, scrolling, num_items, camera_coll_id;
 extern int num_dodgeballs, display_mode, game_mode, num_trees, tree_mode, has_scenery2, UNLIMITED_WEAPONS, ground_effects_level;
@@ -336,6 +336,7 @@ void process_groups() {
 		obj_type const &otype(object_types[objg.type]);
 		bool const precip((flags & PRECIPITATION) != 0);
 		int const type(objg.get_ptype());
+		hr_timer_t const smiley_timer((headless_mode && type == SMILEY) ? "  Smileys" : ""); // per-subsystem headless timing
 
 		if (!objg.temperature_ok()) {
 			if (temp_change) {
@@ -387,6 +388,7 @@ void process_groups() {
 		if (reflective) {cp.metalness = dodgeball_metalness; cp.tscale = 0.0; cp.color = WHITE; cp.spec_color = WHITE; cp.shine = 100.0;} // reflective metal sphere
 		size_t const iter_count((large_radius || type == MAT_SPHERE || app_rate > 0) ? max_objs : objg.end_id); // optimization to use end_id when valid
 		bool defer_remove_cobj(0);
+		if (type == SMILEY) {smiley_sense_targets();} // parallel sense phase for all smileys before any of them move
 
 		for (size_t jj = 0; jj < iter_count; ++jj) {
 			unsigned const j(unsigned((type == SMILEY) ? (jj + scounter)%max_objs : jj)); // handle smiley permutation
@@ -809,7 +811,7 @@ void coll_obj_group::clear_ids() {
 
 void coll_obj_group::clear() { // unused, but may be useful
 	has_lt_atten = has_voxel_cobjs = 0;
-	vector<coll_obj>::clear();
+	tracked_vector<coll_obj, MEM_CAT_COBJS>::clear();
 	clear_ids();
 }
 
@@ -29,6 +29,7 @@ float const CITY_LIGHT_FALLOFF      = 0.2;
 float const STREETLIGHT_ON_RAND     = 0.05;
 float const HEADLIGHT_ON_RAND       = 0.1;
 float const TRACKS_WIDTH            = 0.5; // relative to road width
+size_t const MAX_SITE_SAT_CELLS     = (1<<24); // max heightmap size for city site summed-area tables (20 bytes per cell)
 vector3d const CAR_SIZE(0.30, 0.13, 0.08); // {length, width, height} in units of road width
 unsigned  const CONN_CITY_IX((1<<16)-1); // uint16_t max
 
@@ -105,11 +106,13 @@ struct city_params_t {
 	float tree_spacing;
 	// detail objects
 	unsigned max_benches_per_plot;
+	// debugging
+	unsigned bench_num_cities;
 
 	city_params_t() : num_cities(0), num_samples(100), num_conn_tries(50), city_size_min(0), city_size_max(0), city_border(0), road_border(0),
 		slope_width(0), num_rr_tracks(0), road_width(0.0), road_spacing(0.0), conn_road_seg_len(1000.0), max_road_slope(1.0), num_cars(0), car_speed(0.0),
 		enable_car_path_finding(0), min_park_spaces(12), min_park_rows(1), min_park_density(0.0), max_park_density(1.0), car_shadows(0), max_lights(1024),
-		max_shadow_maps(0), max_trees_per_plot(0), tree_spacing(1.0), max_benches_per_plot(0) {}
+		max_shadow_maps(0), max_trees_per_plot(0), tree_spacing(1.0), max_benches_per_plot(0), bench_num_cities(0) {}
 	bool enabled() const {return (num_cities > 0 && city_size_min > 0);}
 	bool roads_enabled() const {return (road_width > 0.0 && road_spacing > 0.0);}
 	float get_road_ar() const {return nearbyint(road_spacing/road_width);} // round to nearest texture multiple
@@ -212,6 +215,10 @@ struct city_params_t {
 		else if (str == "max_benches_per_plot") {
 			if (!read_uint(fp, max_benches_per_plot)) {return read_error(str);}
 		}
+		// debugging
+		else if (str == "bench_num_cities") {
+			if (!read_uint(fp, bench_num_cities)) {return read_error(str);}
+		}
 		else {
 			cout << "Unrecognized city keyword in input file: " << str << endl;
 			return 0;
@@ -1321,6 +1328,83 @@ public:
 }; // heightmap_query_t
 
 
+class hmap_sat_t { // summed-area tables over the heightmap, for O(1) region height queries when choosing city locations
+
+	unsigned xsize, ysize; // heightmap size; tables are (xsize+1)x(ysize+1) with a zero first row and column
+	vector<double> hsum, hsum_sq; // double to avoid cancellation when computing the variance
+	vector<unsigned> uw_count; // number of underwater points
+
+	size_t get_ix(unsigned x, unsigned y) const {return (size_t(y)*(xsize+1) + x);}
+
+	template<typename T> T get_sum(vector<T> const &v, unsigned x1, unsigned y1, unsigned x2, unsigned y2) const {
+		return (v[get_ix(x2, y2)] - v[get_ix(x1, y2)] - v[get_ix(x2, y1)] + v[get_ix(x1, y1)]);
+	}
+public:
+	hmap_sat_t() : xsize(0), ysize(0) {}
+	bool empty() const {return hsum.empty();}
+	static size_t get_num_cells(unsigned xsize, unsigned ysize) {return size_t(xsize+1)*(ysize+1);}
+
+	void clear() {
+		vector<double>().swap(hsum); vector<double>().swap(hsum_sq); vector<unsigned>().swap(uw_count); // free the memory
+	}
+	void build(float const *const heightmap, unsigned xsize_, unsigned ysize_, float water_z) {
+		assert(heightmap != nullptr);
+		xsize = xsize_; ysize = ysize_;
+		size_t const num(get_num_cells(xsize, ysize));
+		hsum.resize(num); hsum_sq.resize(num); uw_count.resize(num);
+
+#pragma omp parallel for schedule(static,64)
+		for (int y = 0; y <= (int)ysize; ++y) { // first pass: prefix sums along rows
+			size_t const row(get_ix(0, y));
+			double sum(0.0), sum_sq(0.0);
+			unsigned count(0);
+			hsum[row] = hsum_sq[row] = 0.0;
+			uw_count[row] = 0;
+
+			for (unsigned x = 0; x < xsize; ++x) {
+				if (y > 0) {
+					float const h(heightmap[(y-1)*xsize + x]);
+					sum    += h;
+					sum_sq += double(h)*h;
+					count  += (h < water_z);
+				}
+				hsum[row+x+1] = sum; hsum_sq[row+x+1] = sum_sq; uw_count[row+x+1] = count;
+			}
+		} // for y
+		unsigned const block_sz(64), num_blocks((xsize + block_sz)/block_sz); // xsize+1 columns
+
+#pragma omp parallel for schedule(static,1)
+		for (int b = 0; b < (int)num_blocks; ++b) { // second pass: accumulate rows along columns, in blocks of columns for better cache usage
+			unsigned const x1(b*block_sz), x2(min(x1+block_sz, xsize+1));
+
+			for (unsigned y = 1; y <= ysize; ++y) {
+				size_t const row(get_ix(0, y)), prev(get_ix(0, y-1));
+
+				for (unsigned x = x1; x < x2; ++x) {
+					hsum[row+x] += hsum[prev+x]; hsum_sq[row+x] += hsum_sq[prev+x]; uw_count[row+x] += uw_count[prev+x];
+				}
+			}
+		} // for b
+	}
+	// returns the sum of squared height differences from the average height of region [x1,x2)x[y1,y2), or -1 if any point is underwater
+	double get_height_diff_cost(unsigned x1, unsigned y1, unsigned x2, unsigned y2, bool border_only) const {
+		assert(!empty());
+		assert(x1 < x2 && y1 < y2 && x2 <= xsize && y2 <= ysize);
+		double sum(get_sum(hsum, x1, y1, x2, y2)), sum_sq(get_sum(hsum_sq, x1, y1, x2, y2));
+		unsigned num_uw(get_sum(uw_count, x1, y1, x2, y2)), num((x2 - x1)*(y2 - y1));
+
+		if (border_only && x2 > x1+2 && y2 > y1+2) { // subtract the interior
+			sum    -= get_sum(hsum,     x1+1, y1+1, x2-1, y2-1);
+			sum_sq -= get_sum(hsum_sq,  x1+1, y1+1, x2-1, y2-1);
+			num_uw -= get_sum(uw_count, x1+1, y1+1, x2-1, y2-1);
+			num    -= (x2 - x1 - 2)*(y2 - y1 - 2);
+		}
+		if (num_uw > 0) return -1.0;
+		return max(0.0, (sum_sq - sum*sum/num)); // sum of (h - avg)^2
+	}
+}; // hmap_sat_t
+
+
 class city_plot_gen_t : public heightmap_query_t {
 
 protected:
@@ -1329,6 +1413,13 @@ protected:
 	vector<rect_t> used;
 	vector<cube_t> plots; // same size as used
 	cube_t bcube;
+	hmap_sat_t sat;
+
+	struct site_cand_t {
+		unsigned x1, y1, x2, y2;
+		float diff; // -1 if invalid
+		rand_gen_t rgen_after; // rgen state after generating this candidate
+	};
 
 	bool overlaps_used(unsigned x1, unsigned y1, unsigned x2, unsigned y2) const {
 		rect_t const cur(x1, y1, x2, y2);
@@ -1378,7 +1469,7 @@ public:
 		if (rand_gen_index != last_rgi) {rgen.set_state(rand_gen_index, 12345); last_rgi = rand_gen_index;} // only when rand_gen_index changes
 	}
 	bool find_best_city_location(unsigned wmin, unsigned hmin, unsigned wmax, unsigned hmax, unsigned border, unsigned slope_width, unsigned num_samples,
-		unsigned &cx1, unsigned &cy1, unsigned &cx2, unsigned &cy2)
+		unsigned &cx1, unsigned &cy1, unsigned &cx2, unsigned &cy2, bool allow_sat=1)
 	{
 		assert(num_samples > 0);
 		assert((wmax + 2*border) < xsize && (hmax + 2*border) < ysize); // otherwise the city can't fit in the map
@@ -1386,17 +1477,41 @@ public:
 		unsigned xend(xsize - wmax - 2*border + 1), yend(ysize - hmax - 2*border + 1); // max rect LLC, inclusive
 		unsigned num_cands(0);
 		float best_diff(0.0);
-
-		for (unsigned n = 0; n < num_iters; ++n) { // find min RMS height change across N samples
-			unsigned const x1(border + (rgen.rand()%xend)), y1(border + (rgen.rand()%yend));
-			unsigned const x2(x1 + ((wmin == wmax) ? wmin : rgen.rand_int(wmin, wmax)));
-			unsigned const y2(y1 + ((hmin == hmax) ? hmin : rgen.rand_int(hmin, hmax)));
-			if (overlaps_used (x1-slope_width, y1-slope_width, x2+slope_width, y2+slope_width)) continue; // skip if plot expanded by slope_width overlaps an existing city
-			if (any_underwater(x1, y1, x2, y2, CHECK_HEIGHT_BORDER_ONLY))   continue; // skip
-			float const diff(get_rms_height_diff(x1, y1, x2, y2));
-			if (num_cands == 0 || diff < best_diff) {cx1 = x1; cy1 = y1; cx2 = x2; cy2 = y2; best_diff = diff;}
-			if (++num_cands == num_samples) break; // done
+		// use summed-area tables if building them is cheaper than scanning every candidate (the heightmap may have changed, so they're rebuilt for every city)
+		unsigned const wavg((wmin + wmax)/2), havg((hmin + hmax)/2);
+		size_t const cells_per_cand(CHECK_HEIGHT_BORDER_ONLY ? 2*(wavg + havg) : wavg*havg), num_sat_cells(hmap_sat_t::get_num_cells(xsize, ysize));
+		bool const use_sat(allow_sat && num_sat_cells <= MAX_SITE_SAT_CELLS && num_sat_cells < 3*num_samples*cells_per_cand); // 3 passes per candidate
+		if (use_sat) {sat.build(heightmap, xsize, ysize, water_plane_z);}
+		vector<site_cand_t> cands;
+
+		for (unsigned n = 0; n < num_iters && num_cands < num_samples;) { // find min RMS height change across N samples
+			// generate a batch of candidates serially so that the random number sequence is the same as evaluating them one at a time
+			unsigned const batch_sz(min((num_iters - n), max(2*(num_samples - num_cands), 64U)));
+			cands.resize(batch_sz);
+
+			for (auto c = cands.begin(); c != cands.end(); ++c) {
+				c->x1 = border + (rgen.rand()%xend); c->y1 = border + (rgen.rand()%yend);
+				c->x2 = c->x1 + ((wmin == wmax) ? wmin : rgen.rand_int(wmin, wmax));
+				c->y2 = c->y1 + ((hmin == hmax) ? hmin : rgen.rand_int(hmin, hmax));
+				c->rgen_after = rgen;
+			}
+#pragma omp parallel for schedule(dynamic,1)
+			for (int i = 0; i < (int)cands.size(); ++i) { // evaluate candidates in parallel
+				site_cand_t &c(cands[i]);
+				c.diff = -1.0; // invalid
+				if (overlaps_used(c.x1-slope_width, c.y1-slope_width, c.x2+slope_width, c.y2+slope_width)) continue; // skip if plot expanded by slope_width overlaps an existing city
+				if (use_sat) {c.diff = sat.get_height_diff_cost(c.x1, c.y1, c.x2, c.y2, CHECK_HEIGHT_BORDER_ONLY); continue;} // -1 if underwater
+				if (any_underwater(c.x1, c.y1, c.x2, c.y2, CHECK_HEIGHT_BORDER_ONLY)) continue; // skip
+				c.diff = get_rms_height_diff(c.x1, c.y1, c.x2, c.y2);
+			}
+			for (auto c = cands.begin(); c != cands.end(); ++c) { // serial reduction in candidate order
+				++n;
+				if (c->diff < 0.0) continue; // invalid
+				if (num_cands == 0 || c->diff < best_diff) {cx1 = c->x1; cy1 = c->y1; cx2 = c->x2; cy2 = c->y2; best_diff = c->diff;}
+				if (++num_cands == num_samples) {rgen = c->rgen_after; break;} // done; rewind rgen to where it would have stopped
+			}
 		} // for n
+		if (use_sat) {sat.clear();} // free the memory
 		if (num_cands == 0) return 0;
 		//cout << "City cands: " << num_cands << ", diff: " << best_diff << ", loc: " << (cx1+cx2)/2 << "," << (cy1+cy2)/2 << endl;
 		return 1; // success
@@ -2020,6 +2135,7 @@ class city_road_gen_t {
 		bool empty() const {return roads.empty();}
 		bool has_tunnels() const {return !tunnels.empty();}
 		void set_cluster(unsigned id) {cluster_id = id;}
+		void set_city_id(unsigned id) {city_id = id;}
 		void register_connected_city(unsigned id) {connected_to.insert(id);}
 		set<unsigned> const &get_connected() const {return connected_to;}
 		bool is_connected_to(unsigned id) const {return (connected_to.find(id) != connected_to.end());}
@@ -2994,12 +3110,25 @@ public:
 		bcube.expand_by_xy(city_params.get_car_size().x); // expand by car length to fully include cars that are partially inside connector road intersections
 		return bcube;
 	}
-	void gen_roads(cube_t const &region, float road_width, float road_spacing) {
-		//timer_t timer("Gen Roads"); // ~0.5ms
-		road_networks.push_back(road_network_t(region, road_networks.size()));
-		if (!road_networks.back().gen_road_grid(road_width, road_spacing)) {road_networks.pop_back(); return;}
-		//cout << "Roads: " << road_networks.back().num_roads() << endl;
-		road_networks.back().add_streetlights();
+	void gen_roads(vector<cube_t> const &regions, float road_width, float road_spacing) {
+		//timer_t timer("Gen Roads"); // ~0.5ms per city
+		vector<road_network_t> rns;
+		vector<unsigned char> valid(regions.size(), 0);
+		rns.reserve(regions.size());
+		for (auto r = regions.begin(); r != regions.end(); ++r) {rns.push_back(road_network_t(*r, CONN_CITY_IX));} // city_id is assigned below
+
+#pragma omp parallel for schedule(dynamic,1)
+		for (int i = 0; i < (int)rns.size(); ++i) { // cities are independent, so generate their road grids in parallel
+			if (!rns[i].gen_road_grid(road_width, road_spacing)) continue;
+			rns[i].add_streetlights();
+			valid[i] = 1;
+		}
+		for (unsigned i = 0; i < rns.size(); ++i) { // add in order, skipping cities without roads
+			if (!valid[i]) continue;
+			rns[i].set_city_id(road_networks.size());
+			road_networks.push_back(std::move(rns[i]));
+			//cout << "Roads: " << road_networks.back().num_roads() << endl;
+		}
 	}
 	bool connect_two_cities(unsigned city1, unsigned city2, vector<cube_t> &blockers, heightmap_query_t &hq, float road_width) {
 		assert(city1 < road_networks.size() && city2 < road_networks.size());
@@ -3819,7 +3948,59 @@ struct city_smap_manager_t {
 	}
 };
 
-class city_gen_t : public city_plot_gen_t {
+class city_site_gen_t : public city_plot_gen_t {
+public:
+	// choose locations and flatten the mesh serially, since each city affects the placement of the next one
+	void choose_city_locations(city_params_t const &params, vector<cube_t> &regions, bool allow_sat=1, unsigned *find_time=nullptr, unsigned *flatten_time=nullptr) {
+		for (unsigned n = 0; n < params.num_cities; ++n) {
+			unsigned x1(0), y1(0), x2(0), y2(0);
+			int const start_time(GET_TIME_MS());
+			bool const found(find_best_city_location(params.city_size_min, params.city_size_min, params.city_size_max, params.city_size_max,
+				params.city_border, params.slope_width, params.num_samples, x1, y1, x2, y2, allow_sat));
+			int const find_end_time(GET_TIME_MS());
+			if (find_time) {*find_time += (find_end_time - start_time);}
+			if (!found) continue;
+			float const elevation(flatten_region(x1, y1, x2, y2, params.slope_width));
+			regions.push_back(add_plot(x1, y1, x2, y2, elevation));
+			if (flatten_time) {*flatten_time += (GET_TIME_MS() - find_end_time);}
+		} // for n
+	}
+}; // city_site_gen_t
+
+
+// generates cities on a copy of the heightmap and prints the time taken by each phase; doesn't modify the scene
+void run_city_gen_benchmark(float const *const heightmap, unsigned xsize, unsigned ysize, unsigned num_cities) {
+	city_params_t params(city_params);
+	params.num_cities = num_cities;
+	unsigned const ncells(xsize*ysize);
+	vector<float> hmap_scan(heightmap, heightmap+ncells), hmap_sat(hmap_scan);
+	city_site_gen_t site_gen_scan, site_gen_sat; // same initial random seed
+	site_gen_scan.init(&hmap_scan.front(), xsize, ysize);
+	site_gen_sat .init(&hmap_sat .front(), xsize, ysize);
+	vector<cube_t> regions_scan, regions;
+	unsigned find_time_scan(0), flatten_time_scan(0), find_time(0), flatten_time(0);
+	site_gen_scan.choose_city_locations(params, regions_scan, 0, &find_time_scan, &flatten_time_scan); // direct scans
+	site_gen_sat .choose_city_locations(params, regions,      1, &find_time,      &flatten_time     ); // summed-area tables, if enabled for this size
+	bool const same_sites(regions == regions_scan);
+	city_road_gen_t road_gen;
+	int const roads_start_time(GET_TIME_MS());
+	if (params.roads_enabled()) {road_gen.gen_roads(regions, params.road_width, params.road_spacing);}
+	int const conn_start_time(GET_TIME_MS());
+	road_gen.connect_all_cities(&hmap_sat.front(), xsize, ysize, params.road_width, params.road_spacing);
+	int const blocks_start_time(GET_TIME_MS());
+	road_gen.gen_tile_blocks();
+	int const end_time(GET_TIME_MS());
+	cout << "City gen benchmark: " << regions.size() << " of " << num_cities << " cities placed on " << xsize << "x" << ysize << " heightmap" << endl;
+	cout << "  site search: " << find_time << "ms (direct scan: " << find_time_scan << "ms, same sites: " << same_sites << ")" << endl;
+	cout << "  flatten:     " << flatten_time << "ms" << endl;
+	cout << "  road grids:  " << (conn_start_time - roads_start_time) << "ms" << endl;
+	cout << "  connect:     " << (blocks_start_time - conn_start_time) << "ms" << endl;
+	cout << "  tile blocks: " << (end_time - blocks_start_time) << "ms" << endl;
+	assert(same_sites); // summed-area tables must choose the same sites as the direct scan
+}
+
+
+class city_gen_t : public city_site_gen_t {
 
 	city_road_gen_t road_gen;
 	car_manager_t car_manager;
@@ -3830,23 +4011,18 @@ class city_gen_t : public city_plot_gen_t {
 public:
 	city_gen_t() : car_manager(road_gen), lights_bcube(all_zeros), light_radius_scale(1.0) {}
 
-	bool gen_city(city_params_t const &params, cube_t &cities_bcube) {
-		unsigned x1(0), y1(0), x2(0), y2(0);
-		if (!find_best_city_location(params.city_size_min, params.city_size_min, params.city_size_max, params.city_size_max,
-			params.city_border, params.slope_width, params.num_samples, x1, y1, x2, y2)) return 0;
-		float const elevation(flatten_region(x1, y1, x2, y2, params.slope_width));
-		cube_t const pos_range(add_plot(x1, y1, x2, y2, elevation));
-		if (cities_bcube.is_all_zeros()) {cities_bcube = pos_range;} else {cities_bcube.union_with_cube(pos_range);}
-		if (params.roads_enabled()) {road_gen.gen_roads(pos_range, params.road_width, params.road_spacing);}
-		return 1;
-	}
 	void gen_cities(city_params_t const &params) {
 		if (params.num_cities == 0) return;
 		cube_t cities_bcube(all_zeros);
+		vector<cube_t> regions;
 		{ // open a scope
 			timer_t t("Choose City Location");
-			for (unsigned n = 0; n < params.num_cities; ++n) {gen_city(params, cities_bcube);}
+			choose_city_locations(params, regions);
+		}
+		for (auto r = regions.begin(); r != regions.end(); ++r) {
+			if (cities_bcube.is_all_zeros()) {cities_bcube = *r;} else {cities_bcube.union_with_cube(*r);}
 		}
+		if (params.roads_enabled()) {road_gen.gen_roads(regions, params.road_width, params.road_spacing);}
 		bool const is_const_zval(cities_bcube.z1() == cities_bcube.z2());
 		if (!cities_bcube.is_all_zeros()) {set_buildings_pos_range(cities_bcube, is_const_zval);}
 		road_gen.connect_all_cities(heightmap, xsize, ysize, params.road_width, params.road_spacing);
@@ -3938,6 +4114,7 @@ float get_road_max_len() {return city_params.road_spacing;}
 
 void gen_cities(float *heightmap, unsigned xsize, unsigned ysize) {
 	if (!have_cities()) return; // nothing to do
+	if (city_params.bench_num_cities > 0) {run_city_gen_benchmark(heightmap, xsize, ysize, city_params.bench_num_cities);}
 	city_gen.init(heightmap, xsize, ysize); // only need to call once for any given heightmap
 	city_gen.gen_cities(city_params);
 }
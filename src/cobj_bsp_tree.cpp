@@ -498,8 +498,8 @@ bool cobj_bvh_tree::check_point_contained(point const &p, int &cindex) const {
 }
 
 
-void cobj_bvh_tree::get_intersecting_cobjs(cube_t const &cube, vector<unsigned> &cobjs,
-	int ignore_cobj, float toler, bool check_ccounter, int id_for_cobj_int) const
+template<typename V> void cobj_bvh_tree::get_intersecting_cobjs(cube_t const &cube, V &cobjs,
+	int ignore_cobj, float toler, bool check_ccounter, int id_for_cobj_int, vector<unsigned> const *group_ids, unsigned group_id) const
 {
 	unsigned const num_nodes((unsigned)nodes.size());
 
@@ -514,6 +514,7 @@ void cobj_bvh_tree::get_intersecting_cobjs(cube_t const &cube, vector<unsigned>
 		}
 		for (unsigned i = n.start; i < n.end; ++i) { // check leaves
 			if ((int)cixs[i] == ignore_cobj) continue;
+			if (group_ids && (*group_ids)[cixs[i]] != group_id) continue; // not in this group (don't read the cobj, which may be modified by another thread)
 			coll_obj const &c(get_cobj(i));
 			if (check_ccounter && c.counter == cobj_counter) continue;
 			if (!cube.intersects(c, toler) || !obj_ok(c))    continue;
@@ -523,6 +524,10 @@ void cobj_bvh_tree::get_intersecting_cobjs(cube_t const &cube, vector<unsigned>
 		++nix;
 	}
 }
+template void cobj_bvh_tree::get_intersecting_cobjs(cube_t const &cube, vector<unsigned> &cobjs,
+	int ignore_cobj, float toler, bool check_ccounter, int id_for_cobj_int, vector<unsigned> const *group_ids, unsigned group_id) const;
+template void cobj_bvh_tree::get_intersecting_cobjs(cube_t const &cube, frame_vector<unsigned> &cobjs,
+	int ignore_cobj, float toler, bool check_ccounter, int id_for_cobj_int, vector<unsigned> const *group_ids, unsigned group_id) const;
 
 
 bool cobj_bvh_tree::is_cobj_contained(point const &viewer, point const *const pts, unsigned npts, int ignore_cobj, int &cobj) const {
@@ -755,6 +760,12 @@ cobj_bvh_tree &get_tree(bool dynamic) {
 	return (dynamic ? cobj_tree_dynamic : cobj_tree_static);
 }
 
+void cobj_bvh_tree::get_undrawn_cobj_ids(vector<unsigned> &ids) const {
+	for (auto i = cixs.begin(); i != cixs.end(); ++i) {
+		if (!(*cobjs)[*i].cp.draw) {ids.push_back(*i);}
+	}
+}
+
 void build_static_moving_cobj_tree() {
 
 	cobj_tree_static_moving.clear();
@@ -818,6 +829,12 @@ void get_intersecting_cobjs_tree(cube_t const &cube, vector<unsigned> &cobjs, in
 	get_tree(dynamic).get_intersecting_cobjs(cube, cobjs, ignore_cobj, toler, check_ccounter, id_for_cobj_int);
 	if (!dynamic) {cobj_tree_static_moving.get_intersecting_cobjs(cube, cobjs, ignore_cobj, toler, check_ccounter, id_for_cobj_int);}
 }
+void get_intersecting_cobjs_tree(cube_t const &cube, frame_vector<unsigned> &cobjs, int ignore_cobj, float toler,
+	bool dynamic, bool check_ccounter, int id_for_cobj_int)
+{
+	get_tree(dynamic).get_intersecting_cobjs(cube, cobjs, ignore_cobj, toler, check_ccounter, id_for_cobj_int);
+	if (!dynamic) {cobj_tree_static_moving.get_intersecting_cobjs(cube, cobjs, ignore_cobj, toler, check_ccounter, id_for_cobj_int);}
+}
 
 // used in cobj_contained_ref() for grass occlusion
 bool cobj_contained_tree(point const &viewer, point const *const pts, unsigned npts, int ignore_cobj, int &cobj) {
@@ -850,4 +867,8 @@ bool have_occluders() {
 	return !cobj_tree_occlude.is_empty();
 }
 
+void get_undrawn_occluder_ids(vector<unsigned> &ids) { // model3d collision cobjs aren't in coll_objects.drawn_ids
+	cobj_tree_occlude.get_undrawn_cobj_ids(ids);
+}
+
 
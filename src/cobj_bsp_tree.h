@@ -108,7 +108,7 @@ public:
 class cobj_bvh_tree : public cobj_tree_base {
 
 	coll_obj_group const *cobjs;
-	vector<unsigned> cixs;
+	tracked_vector<unsigned, MEM_CAT_COBJS> cixs;
 	bool is_static, is_dynamic, occluders_only, cubes_only, inc_voxel_cobjs;
 
 	struct per_thread_data {
@@ -141,14 +141,16 @@ public:
 		: cobjs(cobjs_), is_static(s), is_dynamic(d), occluders_only(o), cubes_only(c), inc_voxel_cobjs(v) {assert(cobjs);}
 
 	unsigned get_num_objs() const {return cixs.size();}
+	void get_undrawn_cobj_ids(vector<unsigned> &ids) const;
 	void clear();
-	void add_cobj_ids(vector<unsigned> const &cids) {assert(cixs.empty() && !cids.empty()); cixs = cids;}
+	void add_cobj_ids(vector<unsigned> const &cids) {assert(cixs.empty() && !cids.empty()); cixs.assign(cids.begin(), cids.end());}
 	void add_cobjs(bool verbose);
 	void build_tree_from_cixs(bool do_mt_build);
 	bool check_coll_line(point const &p1, point const &p2, point &cpos, vector3d &cnorm, int &cindex, int ignore_cobj,
 		bool exact, int test_alpha, bool skip_non_drawn, bool skip_init_colls, bool skip_movable) const;
 	bool check_point_contained(point const &p, int &cindex) const;
-	void get_intersecting_cobjs(cube_t const &cube, vector<unsigned> &cobjs, int ignore_cobj, float toler, bool check_ccounter, int id_for_cobj_int) const;
+	template<typename V> void get_intersecting_cobjs(cube_t const &cube, V &cobjs, int ignore_cobj, float toler, bool check_ccounter, int id_for_cobj_int,
+		vector<unsigned> const *group_ids=NULL, unsigned group_id=0) const;
 	bool is_cobj_contained(point const &viewer, point const *const pts, unsigned npts, int ignore_cobj, int &cobj) const;
 	void get_coll_line_cobjs(point const &pos1, point const &pos2, int ignore_cobj, vector<int> *cobjs, cobj_query_callback *cqc, bool do_expand) const;
 	void get_coll_sphere_cobjs(point const &center, float radius, int ignore_cobj, vert_coll_detector &vcd) const;
@@ -0,0 +1,714 @@
+// 3D World - GJK/EPA Narrow Phase for Convex Collision Objects
+// by 3DWorld contributors
+// 10/18/26
+
+#include "3DWorld.h"
+#include "collision_detect.h"
+#include <random>
+
+unsigned const GJK_MAX_ITERS = 64;
+unsigned const EPA_MAX_ITERS = 64;
+unsigned const EPA_MAX_VERTS = EPA_MAX_ITERS + 4;
+unsigned const EPA_MAX_FACES = 2*EPA_MAX_VERTS;
+float    const GJK_CONTACT_EPS = 1.0E-5; // separation distance counted as contact, relative to cobj size
+float    const REF_CONTACT_EPS = 1.0E-4; // benchmark reference results closer than this to contact (relative to cobj size) are too close to call
+unsigned const REF_MAX_ITERS   = 100000; // max alternating projection iterations for the benchmark reference
+
+bool use_gjk_narrow_phase(1), gjk_bench(0);
+
+
+// support mapping for a convex cobj: returns the point on the cobj farthest in a given direction
+class convex_support_t {
+
+	int type;
+	unsigned npts;
+	point_d pts[2*N_COLL_POLY_PTS]; // cube {min, max}, cylinder/capsule ends, sphere center, or polygon verts
+	double r[2];
+	vector3d_d axis; // cylinder axis, unit length
+
+public:
+	convex_support_t() : type(COLL_NULL), npts(0), axis(zero_vector) {r[0] = r[1] = 0.0;}
+
+	bool init(coll_obj const &c) {
+		type = c.type;
+		npts = 0;
+
+		switch (type) {
+		case COLL_CUBE:
+			pts[npts++] = point_d(c.d[0][0], c.d[1][0], c.d[2][0]);
+			pts[npts++] = point_d(c.d[0][1], c.d[1][1], c.d[2][1]);
+			return 1;
+		case COLL_SPHERE:
+			pts[npts++] = c.points[0];
+			r[0] = c.radius;
+			return 1;
+		case COLL_CYLINDER:
+		case COLL_CYLINDER_ROT:
+		case COLL_CAPSULE:
+			pts[npts++] = c.points[0];
+			pts[npts++] = c.points[1];
+			r[0] = c.radius; r[1] = c.radius2;
+			axis = pts[1] - pts[0];
+			if (type != COLL_CAPSULE && axis.mag_sq() == 0.0) return 0; // degenerate cylinder
+			if (axis.mag_sq() > 0.0) {axis.normalize();}
+			return 1;
+		case COLL_POLYGON:
+			if (c.npoints < 3 || c.npoints > N_COLL_POLY_PTS) return 0;
+
+			if (c.thickness > MIN_POLY_THICK) { // extruded polygon
+				point ext_pts[2][4];
+				gen_poly_planes(c.points, c.npoints, c.norm, c.thickness, ext_pts);
+				for (unsigned j = 0; j < 2; ++j) {for (int i = 0; i < c.npoints; ++i) {pts[npts++] = ext_pts[j][i];}}
+			}
+			else { // zero thickness
+				for (int i = 0; i < c.npoints; ++i) {pts[npts++] = c.points[i];}
+			}
+			return 1;
+		} // end switch
+		return 0; // torus is not convex
+	}
+	point_d get_center() const {
+		point_d center(all_zeros);
+		for (unsigned i = 0; i < npts; ++i) {center += pts[i];}
+		return center/double(npts);
+	}
+	point_d get_support(vector3d_d const &dir) const {
+		switch (type) {
+		case COLL_CUBE: return point_d(pts[dir.x > 0.0].x, pts[dir.y > 0.0].y, pts[dir.z > 0.0].z);
+		case COLL_SPHERE: {
+			double const mag(dir.mag());
+			return ((mag > 0.0) ? (pts[0] + (r[0]/mag)*dir) : pts[0]);
+		}
+		case COLL_CYLINDER:
+		case COLL_CYLINDER_ROT: { // farthest point on either end disk
+			vector3d_d const perp(dir - axis*dot_product(dir, axis));
+			double const perp_mag(perp.mag());
+			point_d best;
+			double best_dp(0.0);
+
+			for (unsigned i = 0; i < 2; ++i) {
+				point_d const p((perp_mag > 0.0) ? (pts[i] + (r[i]/perp_mag)*perp) : pts[i]);
+				double const dp(dot_product(p, dir));
+				if (i == 0 || dp > best_dp) {best = p; best_dp = dp;}
+			}
+			return best;
+		}
+		case COLL_CAPSULE: { // farthest point on either end sphere
+			double const mag(dir.mag());
+			point_d best;
+			double best_dp(0.0);
+
+			for (unsigned i = 0; i < 2; ++i) {
+				point_d const p((mag > 0.0) ? (pts[i] + (r[i]/mag)*dir) : pts[i]);
+				double const dp(dot_product(p, dir));
+				if (i == 0 || dp > best_dp) {best = p; best_dp = dp;}
+			}
+			return best;
+		}
+		case COLL_POLYGON: {
+			unsigned best(0);
+			double best_dp(dot_product(pts[0], dir));
+
+			for (unsigned i = 1; i < npts; ++i) {
+				double const dp(dot_product(pts[i], dir));
+				if (dp > best_dp) {best = i; best_dp = dp;}
+			}
+			return pts[best];
+		}
+		default: assert(0);
+		} // end switch
+		return all_zeros; // never gets here
+	}
+};
+
+// support point of the Minkowski difference A - B
+point_d get_support_diff(convex_support_t const &A, convex_support_t const &B, vector3d_d const &dir) {
+	return (A.get_support(dir) - B.get_support(-dir));
+}
+
+
+struct gjk_simplex_t {
+
+	unsigned n;
+	point_d w[4];
+
+	gjk_simplex_t() : n(0) {}
+	void keep(unsigned mask) { // keep the verts selected by mask, in order
+		unsigned num(0);
+		for (unsigned i = 0; i < n; ++i) {if (mask & (1<<i)) {w[num++] = w[i];}}
+		n = num;
+	}
+};
+
+// closest point to the origin on segment ab; returns the mask of verts used
+unsigned closest_pt_on_segment(point_d const &a, point_d const &b, vector3d_d &v) {
+
+	vector3d_d const ab(b - a);
+	double const len_sq(ab.mag_sq());
+	double const t((len_sq > 0.0) ? -dot_product(a, ab)/len_sq : 0.0);
+	if (t <= 0.0) {v = a; return 1;}
+	if (t >= 1.0) {v = b; return 2;}
+	v = a + t*ab;
+	return 3;
+}
+
+// closest point to the origin on triangle abc (Voronoi region test); returns the mask of verts used
+unsigned closest_pt_on_triangle(point_d const &a, point_d const &b, point_d const &c, vector3d_d &v) {
+
+	vector3d_d const ab(b - a), ac(c - a);
+	double const d1(-dot_product(ab, a)), d2(-dot_product(ac, a));
+	if (d1 <= 0.0 && d2 <= 0.0) {v = a; return 1;}
+	double const d3(-dot_product(ab, b)), d4(-dot_product(ac, b));
+	if (d3 >= 0.0 && d4 <= d3) {v = b; return 2;}
+	double const vc(d1*d4 - d3*d2);
+	if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0) {v = a + (d1/(d1 - d3))*ab; return 3;}
+	double const d5(-dot_product(ab, c)), d6(-dot_product(ac, c));
+	if (d6 >= 0.0 && d5 <= d6) {v = c; return 4;}
+	double const vb(d5*d2 - d1*d6);
+	if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0) {v = a + (d2/(d2 - d6))*ac; return 5;}
+	double const va(d3*d6 - d5*d4);
+	if (va <= 0.0 && (d4 - d3) >= 0.0 && (d5 - d6) >= 0.0) {v = b + ((d4 - d3)/((d4 - d3) + (d5 - d6)))*(c - b); return 6;}
+	double const denom(va + vb + vc);
+	if (denom == 0.0) {return closest_pt_on_segment(a, b, v);} // degenerate triangle
+	v = a + (vb/denom)*ab + (vc/denom)*ac;
+	return 7;
+}
+
+// replaces the simplex with the smallest sub-simplex containing the point closest to the origin and returns that point;
+// returns zero_vector with n=4 if the origin is inside the tetrahedron
+vector3d_d reduce_simplex(gjk_simplex_t &s) {
+
+	vector3d_d v(s.w[0]);
+
+	switch (s.n) {
+	case 1: break;
+	case 2: s.keep(closest_pt_on_segment (s.w[0], s.w[1], v)); break;
+	case 3: s.keep(closest_pt_on_triangle(s.w[0], s.w[1], s.w[2], v)); break;
+	case 4: {
+		unsigned const faces[4][4] = {{0,1,2,3}, {0,3,1,2}, {0,2,3,1}, {1,3,2,0}}; // three face verts + opposite vert
+		double best_dist_sq(0.0);
+		unsigned best_mask(0);
+		bool inside(1);
+
+		for (unsigned f = 0; f < 4; ++f) {
+			point_d const &a(s.w[faces[f][0]]), &b(s.w[faces[f][1]]), &c(s.w[faces[f][2]]), &d(s.w[faces[f][3]]);
+			vector3d_d const n(cross_product((b - a), (c - a)));
+			double const side_o(-dot_product(n, a)), side_d(dot_product(n, (d - a)));
+			if (side_o*side_d > 0.0 && side_d != 0.0) continue; // origin is on the same side as the opposite vert
+			inside = 0;
+			vector3d_d fv;
+			unsigned const tmask(closest_pt_on_triangle(a, b, c, fv));
+			double const dist_sq(fv.mag_sq());
+			if (best_mask != 0 && dist_sq >= best_dist_sq) continue;
+			best_dist_sq = dist_sq;
+			best_mask    = 0;
+			v = fv;
+			for (unsigned i = 0; i < 3; ++i) {if (tmask & (1<<i)) {best_mask |= (1<<faces[f][i]);}}
+		}
+		if (inside) return zero_vector;
+		s.keep(best_mask);
+		break;
+	}
+	default: assert(0);
+	} // end switch
+	return v;
+}
+
+// returns the distance between A and B, or 0.0 if they intersect, in which case s contains a simplex enclosing or touching the origin;
+// stops early and returns a lower bound once the distance is known to be larger than max_dist
+double gjk_distance(convex_support_t const &A, convex_support_t const &B, gjk_simplex_t &s, double max_dist) {
+
+	vector3d_d v(A.get_center() - B.get_center());
+	if (v.mag_sq() == 0.0) {v = plus_x;}
+	s.n = 0;
+	s.w[s.n++] = get_support_diff(A, B, -v);
+	v = s.w[0];
+	double max_w_sq(v.mag_sq());
+
+	for (unsigned iter = 0; iter < GJK_MAX_ITERS; ++iter) {
+		double const v_sq(v.mag_sq());
+		if (v_sq <= 1.0E-20*max_w_sq) return 0.0; // origin is on the simplex (contact)
+		point_d const w(get_support_diff(A, B, -v));
+		double const vw(dot_product(v, w));
+		if (vw > 0.0 && vw*vw > max_dist*max_dist*v_sq) return vw/sqrt(v_sq); // separating axis found, lower bound is larger than max_dist
+		if (v_sq - vw <= 1.0E-6*v_sq) break; // no more progress; v is the closest point (to float precision)
+		bool dup(0);
+		for (unsigned i = 0; i < s.n && !dup; ++i) {dup = (s.w[i] == w);}
+		if (dup) break; // numerical precision limit
+		gjk_simplex_t const prev_s(s);
+		s.w[s.n++] = w;
+		max_w_sq = max(max_w_sq, w.mag_sq());
+		vector3d_d const new_v(reduce_simplex(s));
+		if (s.n == 4) return 0.0; // origin is inside the tetrahedron
+		if (new_v.mag_sq() >= v_sq) {s = prev_s; break;} // no progress due to a nearly degenerate simplex
+		v = new_v;
+	}
+	return v.mag();
+}
+
+
+struct epa_face_t {
+	unsigned v[3];
+	vector3d_d n;
+	double dist;
+};
+
+bool init_epa_face(epa_face_t &f, point_d const *verts, unsigned a, unsigned b, unsigned c) {
+
+	f.v[0] = a; f.v[1] = b; f.v[2] = c;
+	f.n = cross_product((verts[b] - verts[a]), (verts[c] - verts[a]));
+	double const mag(f.n.mag());
+	if (mag < 1.0E-18) return 0; // degenerate
+	f.n   /= mag;
+	f.dist = dot_product(f.n, verts[a]);
+	return 1;
+}
+
+// expands a GJK simplex containing the origin to a tetrahedron; returns 0 if the Minkowski difference is flat
+bool make_tetrahedron(convex_support_t const &A, convex_support_t const &B, gjk_simplex_t &s) {
+
+	vector3d_d const axes[3] = {plus_x, plus_y, plus_z};
+
+	while (s.n < 4) {
+		vector3d_d dirs[6];
+		unsigned ndirs(0);
+
+		if (s.n == 1) {for (unsigned d = 0; d < 3; ++d) {dirs[ndirs++] = axes[d]; dirs[ndirs++] = -axes[d];}}
+		else if (s.n == 2) {
+			vector3d_d const ab(s.w[1] - s.w[0]);
+			for (unsigned d = 0; d < 3; ++d) {dirs[ndirs] = cross_product(ab, axes[d]); dirs[ndirs+1] = -dirs[ndirs]; ndirs += 2;}
+		}
+		else {
+			dirs[ndirs++] = cross_product((s.w[1] - s.w[0]), (s.w[2] - s.w[0]));
+			dirs[ndirs++] = -dirs[0];
+		}
+		bool added(0);
+
+		for (unsigned i = 0; i < ndirs && !added; ++i) {
+			if (dirs[i].mag_sq() == 0.0) continue;
+			point_d const w(get_support_diff(A, B, dirs[i]));
+			double const scale(max(w.mag_sq(), s.w[0].mag_sq()));
+			bool new_dim(0);
+
+			if      (s.n == 1) {new_dim = (p2p_dist_sq(w, s.w[0]) > 1.0E-20*scale);}
+			else if (s.n == 2) {new_dim = (cross_product((s.w[1] - s.w[0]), (w - s.w[0])).mag_sq() > 1.0E-20*scale*scale);}
+			else {new_dim = (fabs(dot_product(cross_product((s.w[1] - s.w[0]), (s.w[2] - s.w[0])), (w - s.w[0]))) > 1.0E-15*scale*sqrt(scale));}
+			if (new_dim) {s.w[s.n++] = w; added = 1;}
+		}
+		if (!added) return 0; // flat
+	}
+	return 1;
+}
+
+// returns the penetration depth of intersecting A and B using the expanding polytope algorithm, or -1.0 if the Minkowski difference is flat
+double epa_penetration_depth(convex_support_t const &A, convex_support_t const &B, gjk_simplex_t &s, vector3d_d *pen_dir=nullptr) {
+
+	if (!make_tetrahedron(A, B, s)) return -1.0;
+	point_d verts[EPA_MAX_VERTS];
+	epa_face_t faces[EPA_MAX_FACES];
+	unsigned edges[3*EPA_MAX_FACES][2];
+	unsigned nverts(0), nfaces(0);
+	for (unsigned i = 0; i < 4; ++i) {verts[nverts++] = s.w[i];}
+	point_d const center(0.25*(verts[0] + verts[1] + verts[2] + verts[3]));
+	unsigned const tet_faces[4][3] = {{0,1,2}, {0,3,1}, {0,2,3}, {1,3,2}};
+
+	for (unsigned f = 0; f < 4; ++f) {
+		epa_face_t &face(faces[nfaces]);
+		if (!init_epa_face(face, verts, tet_faces[f][0], tet_faces[f][1], tet_faces[f][2])) return -1.0;
+		if (dot_product(face.n, (verts[face.v[0]] - center)) < 0.0) {swap(face.v[1], face.v[2]); face.n = -face.n; face.dist = -face.dist;} // make outward facing
+		++nfaces;
+	}
+	epa_face_t best(faces[0]);
+
+	for (unsigned iter = 0; iter < EPA_MAX_ITERS; ++iter) {
+		unsigned closest(0);
+		for (unsigned f = 1; f < nfaces; ++f) {if (faces[f].dist < faces[closest].dist) {closest = f;}}
+		best = faces[closest];
+		point_d const w(get_support_diff(A, B, best.n));
+		double const w_dist(dot_product(w, best.n));
+		if (w_dist - best.dist <= 1.0E-6*max(1.0, fabs(w_dist)) || nverts == EPA_MAX_VERTS) break; // converged
+		unsigned const wix(nverts++), prev_nfaces(nfaces);
+		verts[wix] = w;
+		unsigned nedges(0);
+
+		for (unsigned f = 0; f < nfaces; ++f) { // remove faces visible from w, and find the horizon edges
+			if (dot_product(faces[f].n, (w - verts[faces[f].v[0]])) <= 0.0) continue; // not visible
+
+			for (unsigned e = 0; e < 3; ++e) {
+				unsigned const e0(faces[f].v[e]), e1(faces[f].v[(e+1)%3]);
+				bool shared(0);
+
+				for (unsigned i = 0; i < nedges; ++i) { // shared edge between two removed faces is not on the horizon
+					if (edges[i][0] == e1 && edges[i][1] == e0) {edges[i][0] = edges[nedges-1][0]; edges[i][1] = edges[nedges-1][1]; --nedges; shared = 1; break;}
+				}
+				if (!shared) {edges[nedges][0] = e0; edges[nedges][1] = e1; ++nedges;}
+			}
+			faces[f] = faces[--nfaces];
+			--f;
+		}
+		if (nfaces == prev_nfaces || nfaces + nedges > EPA_MAX_FACES) break; // no visible faces (numerical error) or out of space
+
+		for (unsigned i = 0; i < nedges; ++i) {
+			if (init_epa_face(faces[nfaces], verts, edges[i][0], edges[i][1], wix)) {++nfaces;}
+		}
+		if (nfaces == 0) break; // all degenerate
+	} // for iter
+	if (pen_dir) {*pen_dir = best.n;}
+	return max(0.0, best.dist);
+}
+
+
+// signed distance between two convex cobjs: positive is separation distance, negative is penetration depth; max_dist is as in gjk_distance();
+// returns 0 if either cobj isn't convex or if the penetration depth can't be computed
+bool get_cobj_signed_dist(coll_obj const &c1, coll_obj const &c2, double &dist, double max_dist, bool need_depth) {
+
+	convex_support_t A, B;
+	if (!A.init(c1) || !B.init(c2)) return 0;
+	gjk_simplex_t s;
+	dist = gjk_distance(A, B, s, max_dist);
+	if (dist > 0.0 || !need_depth) return 1;
+	double const depth(epa_penetration_depth(A, B, s));
+	if (depth < 0.0) return 0; // flat Minkowski difference (two thin polygons)
+	dist = -depth;
+	return 1;
+}
+
+// same return values and tolerance semantics as coll_obj::intersects_cobj(), except -1 means not supported (non-convex or degenerate);
+// toler > 0 requires a penetration depth of more than toler, toler < 0 counts separations of less than -toler
+int gjk_cobj_intersect(coll_obj const &c1, coll_obj const &c2, float toler) {
+
+	double dist(0.0);
+	// GJK rarely converges to exactly zero for touching cobjs, so separations within a small epsilon count as contact
+	float const contact_eps(GJK_CONTACT_EPS*max(c1.max_len(), c2.max_len()));
+	if (!get_cobj_signed_dist(c1, c2, dist, max(contact_eps, -toler), (toler > 0.0))) return -1;
+	if (toler == 0.0) {return (dist <= contact_eps);} // contact counts as intersection, same as the pairwise tests
+	return (dist < -toler);
+}
+
+
+// closest point on segment ab to p
+point_d closest_pt_on_seg(point_d const &a, point_d const &b, point_d const &p) {
+	vector3d_d const ab(b - a);
+	double const len_sq(ab.mag_sq());
+	return ((len_sq > 0.0) ? (a + ab*max(0.0, min(1.0, dot_product((p - a), ab)/len_sq))) : a);
+}
+
+// closest point on the planar convex polygon with CCW verts around n to p
+point_d closest_pt_on_convex_poly(point_d const *verts, unsigned npts, vector3d_d const &n, point_d const &p) {
+
+	point_d const pp(p - n*dot_product(n, (p - verts[0]))); // project into the plane
+	bool inside(1);
+
+	for (unsigned i = 0; i < npts && inside; ++i) {
+		inside = (dot_product(cross_product((verts[(i+1)%npts] - verts[i]), (pp - verts[i])), n) >= 0.0);
+	}
+	if (inside) return pp;
+	point_d best;
+	double best_dsq(0.0);
+
+	for (unsigned i = 0; i < npts; ++i) {
+		point_d const cp(closest_pt_on_seg(verts[i], verts[(i+1)%npts], pp));
+		double const dsq((cp - pp).mag_sq());
+		if (i == 0 || dsq < best_dsq) {best = cp; best_dsq = dsq;}
+	}
+	return best;
+}
+
+// a convex cobj, optionally eroded by a distance, that supports exact closest point projection; used as the benchmark reference,
+// which is independent of the pairwise tests and of the support functions used by GJK; capsules must have equal radii
+class ref_convex_shape_t {
+
+	int type; // COLL_CUBE, COLL_SPHERE, COLL_CAPSULE, COLL_CYLINDER (any truncated cone), or COLL_POLYGON
+	unsigned npts; // polygon verts
+	point_d pts[2*N_COLL_POLY_PTS]; // cube {min, max}, sphere center, capsule/cone ends, or polygon verts: {top face, bottom face}
+	double r[2], half_thick;
+	vector3d_d norm;
+
+public:
+	// returns 0 if the eroded shape is empty; zero thickness polygons are only eroded within their plane
+	bool init(coll_obj const &c, double erode) {
+		type = c.type;
+		npts = 0;
+		half_thick = 0.0;
+
+		switch (type) {
+		case COLL_CUBE:
+			for (unsigned i = 0; i < 2; ++i) {pts[i] = point_d(c.d[0][i], c.d[1][i], c.d[2][i]) + ((i ? -erode : erode)*vector3d_d(1.0, 1.0, 1.0));}
+			UNROLL_3X(if (pts[0][i_] > pts[1][i_]) return 0;)
+			return 1;
+		case COLL_SPHERE:
+		case COLL_CAPSULE:
+			pts[0] = c.points[0];
+			pts[1] = ((type == COLL_CAPSULE) ? c.points[1] : c.points[0]);
+			assert(type != COLL_CAPSULE || c.radius == c.radius2);
+			r[0] = r[1] = c.radius - erode;
+			return (r[0] >= 0.0);
+		case COLL_CYLINDER:
+		case COLL_CYLINDER_ROT: { // shrink the ends by erode, and move the sides in by erode perpendicular to the (sloped) sides
+			type = COLL_CYLINDER;
+			vector3d_d const axis(point_d(c.points[1]) - point_d(c.points[0]));
+			double const len(axis.mag()), slope((c.radius2 - c.radius)/len), side_erode(erode*sqrt(1.0 + slope*slope));
+			if (len <= 2.0*erode) return 0;
+
+			for (unsigned i = 0; i < 2; ++i) {
+				double const t(i ? (len - erode) : erode);
+				pts[i] = point_d(c.points[0]) + axis*(t/len);
+				r[i]   = c.radius + slope*t - side_erode;
+				if (r[i] < 0.0) return 0;
+			}
+			return 1;
+		}
+		case COLL_POLYGON: {
+			norm = c.norm;
+			unsigned const n(c.npoints);
+			double const thick((c.thickness > MIN_POLY_THICK) ? (c.thickness - 2.0*erode) : 0.0);
+			if (c.thickness > MIN_POLY_THICK && thick <= 0.0) return 0;
+			npts       = n;
+			half_thick = 0.5*thick;
+
+			for (unsigned i = 0; i < n; ++i) { // move each edge in by erode
+				point_d const &prev(c.points[(i+n-1)%n]), &cur(c.points[i]), &next(c.points[(i+1)%n]);
+				vector3d_d const n0(cross_product(norm, (cur - prev)).get_norm()), n1(cross_product(norm, (next - cur)).get_norm()); // inward edge normals for CCW verts
+				point_d const vert(cur + (n0 + n1)*(erode/(1.0 + dot_product(n0, n1))));
+
+				for (unsigned j = 0; j < 2; ++j) {pts[j*n + i] = vert + norm*(j ? -half_thick : half_thick);}
+			}
+			for (unsigned i = 0; i < n; ++i) { // check that the eroded polygon didn't flip
+				if (dot_product(cross_product((pts[(i+1)%n] - pts[i]), (pts[(i+2)%n] - pts[(i+1)%n])), norm) <= 0.0) return 0;
+			}
+			return 1;
+		}
+		default: assert(0);
+		} // end switch
+		return 0;
+	}
+	point_d project(point_d const &p) const {
+		switch (type) {
+		case COLL_CUBE: {
+			point_d ret(p);
+			UNROLL_3X(ret[i_] = max(pts[0][i_], min(pts[1][i_], p[i_]));)
+			return ret;
+		}
+		case COLL_SPHERE:
+		case COLL_CAPSULE: {
+			point_d const center(closest_pt_on_seg(pts[0], pts[1], p));
+			double const dist((p - center).mag());
+			return ((dist <= r[0]) ? p : (center + (p - center)*(r[0]/dist)));
+		}
+		case COLL_CYLINDER: { // project in the 2D (axial, radial) half plane containing p onto the trapezoid {(0,0), (len,0), (len,r1), (0,r0)}
+			vector3d_d axis(pts[1] - pts[0]);
+			double const len(axis.mag());
+			axis /= len;
+			double const t(dot_product((p - pts[0]), axis));
+			vector3d_d rdir((p - pts[0]) - axis*t);
+			double const rho(rdir.mag());
+			if (rho > 0.0) {rdir /= rho;}
+			double const rmax(r[0] + (r[1] - r[0])*t/len);
+			if (t >= 0.0 && t <= len && rho <= rmax) return p; // inside
+			point_d const corners[4] = {point_d(0.0, 0.0, 0.0), point_d(len, 0.0, 0.0), point_d(len, r[1], 0.0), point_d(0.0, r[0], 0.0)}, p2(t, rho, 0.0);
+			point_d best;
+			double best_dsq(0.0);
+
+			for (unsigned i = 0; i < 4; ++i) {
+				point_d const cp(closest_pt_on_seg(corners[i], corners[(i+1)&3], p2));
+				double const dsq((cp - p2).mag_sq());
+				if (i == 0 || dsq < best_dsq) {best = cp; best_dsq = dsq;}
+			}
+			return (pts[0] + axis*best.x + rdir*best.y);
+		}
+		case COLL_POLYGON: {
+			unsigned const n(npts);
+			if (half_thick == 0.0) {return closest_pt_on_convex_poly(pts, n, norm, p);} // zero thickness
+			double const pdist(dot_product(norm, (p - (pts[0] - norm*half_thick)))); // signed distance from the center plane
+			bool inside(fabs(pdist) <= half_thick);
+			
+			for (unsigned i = 0; i < n && inside; ++i) {
+				inside = (dot_product(cross_product((pts[(i+1)%n] - pts[i]), (p - pts[i])), norm) >= 0.0);
+			}
+			if (inside) return p;
+			point_d best(closest_pt_on_convex_poly(pts, n, norm, p)); // top face
+			double best_dsq((best - p).mag_sq());
+			point_d face[4];
+
+			for (unsigned f = 0; f <= n; ++f) { // bottom face, then sides
+				point_d cp;
+
+				if (f == n) { // bottom face: reverse the verts so that they're CCW around -norm
+					for (unsigned i = 0; i < n; ++i) {face[i] = pts[2*n - 1 - i];}
+					cp = closest_pt_on_convex_poly(face, n, -norm, p);
+				}
+				else {
+					unsigned const fn((f+1)%n);
+					face[0] = pts[f]; face[1] = pts[n+f]; face[2] = pts[n+fn]; face[3] = pts[fn];
+					cp = closest_pt_on_convex_poly(face, 4, cross_product((face[1] - face[0]), (face[2] - face[1])).get_norm(), p);
+				}
+				double const dsq((cp - p).mag_sq());
+				if (dsq < best_dsq) {best = cp; best_dsq = dsq;}
+			}
+			return best;
+		}
+		default: assert(0);
+		} // end switch
+		return p; // never gets here
+	}
+};
+
+// distance between a and b using alternating projections, which converge to the closest pair of points, or -1.0 if they didn't converge
+double get_ref_shape_dist(ref_convex_shape_t const &a, ref_convex_shape_t const &b, point_d const &start, double scale) {
+
+	point_d pb(start);
+	double prev_dist(0.0);
+
+	for (unsigned iter = 0; iter < REF_MAX_ITERS; ++iter) {
+		point_d const pa(a.project(pb));
+		pb = b.project(pa);
+		double const dist((pa - pb).mag());
+		if (dist <= 1.0E-9*scale) return 0.0; // intersecting
+		if (iter > 0 && prev_dist - dist <= 1.0E-12*scale) return dist; // converged
+		prev_dist = dist;
+	}
+	return -1.0;
+}
+
+// returns 1 if a and b intersect by more than REF_CONTACT_EPS, 0 if they're separated by more than REF_CONTACT_EPS, and -1 if too close to call
+int get_ref_cobj_intersect(coll_obj const &a, coll_obj const &b) {
+
+	double const scale(max(a.max_len(), b.max_len())), eps(REF_CONTACT_EPS*scale);
+	point_d const start(a.get_cube_center());
+	ref_convex_shape_t sa, sb;
+	// intersect if the shapes eroded by eps intersect
+	if (sa.init(a, eps) && sb.init(b, eps) && get_ref_shape_dist(sa, sb, start, scale) == 0.0) return 1;
+	bool const valid(sa.init(a, 0.0) && sb.init(b, 0.0));
+	assert(valid);
+	if (get_ref_shape_dist(sa, sb, start, scale) > eps) return 0; // separated
+	return -1;
+}
+
+
+// random cobjs of every convex type, placed so that their bcubes usually overlap
+coll_obj gen_test_cobj(int type, std::mt19937 &rgen) {
+
+	std::uniform_real_distribution<float> U(-1.0, 1.0);
+	auto rand_pt([&]() {return point(0.5*U(rgen), 0.5*U(rgen), 0.5*U(rgen));});
+	auto rand_r ([&]() {return 0.05f + 0.2f*fabs(U(rgen));});
+	coll_obj c;
+	c.type   = type;
+	c.status = COLL_STATIC;
+	c.fixed  = 1;
+
+	switch (type) {
+	case COLL_CUBE: {
+		point const p(rand_pt());
+		c.set_from_point(p);
+		c.expand_by(vector3d(rand_r(), rand_r(), rand_r()));
+		break;
+	}
+	case COLL_SPHERE:
+		c.points[0] = rand_pt();
+		c.radius    = rand_r();
+		break;
+	case COLL_CYLINDER: // vertical
+		c.points[0] = c.points[1] = rand_pt();
+		c.points[1].z += 2.0*rand_r();
+		c.radius = c.radius2 = rand_r();
+		break;
+	case COLL_CYLINDER_ROT: // cone
+	case COLL_CAPSULE:
+		c.points[0] = rand_pt();
+		c.points[1] = rand_pt();
+		c.radius    = rand_r();
+		c.radius2   = ((type == COLL_CAPSULE) ? c.radius : rand_r());
+		break;
+	case COLL_POLYGON: { // planar convex triangle or quad, maybe extruded
+		point const center(rand_pt());
+		vector3d n(U(rgen), U(rgen), U(rgen));
+		if (n == zero_vector) {n = plus_z;}
+		n.normalize();
+		vector3d const d1(cross_product(n, ((fabs(n.x) < 0.9) ? plus_x : plus_y)).get_norm()), d2(cross_product(n, d1));
+		c.npoints = ((U(rgen) > 0.0) ? 4 : 3);
+		float const size(2.0*rand_r()), a0(PI*U(rgen));
+
+		for (int i = 0; i < c.npoints; ++i) { // CCW around n
+			float const a(a0 + TWO_PI*i/c.npoints);
+			c.points[i] = center + size*(cos(a)*d1 + sin(a)*d2);
+		}
+		c.norm      = n;
+		c.thickness = ((U(rgen) > 0.0) ? rand_r() : 0.0);
+		break;
+	}
+	default: assert(0);
+	} // end switch
+	c.calc_bcube();
+	return c;
+}
+
+// randomized differential test of gjk_cobj_intersect() and the pairwise tests in intersects_cobj() against a slow reference, and a pairs/sec benchmark of both;
+// many of the pairwise tests that return definite results are approximate (they use bounding cylinders, SAT with a subset of axes, or edge tests),
+// so they disagree with the reference for up to 10% of pairs with a cone or capsule and for some sphere vs. polygon pairs; GJK must agree with
+// all reference results that aren't too close to contact to call; enabled with the "gjk_bench" config option
+void run_gjk_benchmark() {
+
+	unsigned const NUM_PAIRS = 100000;
+	int const types[6] = {COLL_CUBE, COLL_CYLINDER, COLL_SPHERE, COLL_CYLINDER_ROT, COLL_POLYGON, COLL_CAPSULE};
+	char const *const names[6] = {"cube", "cylinder", "sphere", "cone", "polygon", "capsule"};
+	std::mt19937 rgen(123);
+	vector<coll_obj> cobjs[2];
+	vector<unsigned> type_ixs[2];
+
+	for (unsigned i = 0; i < NUM_PAIRS; ++i) {
+		for (unsigned j = 0; j < 2; ++j) {
+			type_ixs[j].push_back(rgen()%6);
+			cobjs[j].push_back(gen_test_cobj(types[type_ixs[j].back()], rgen));
+		}
+	}
+	unsigned num_gjk_agree[6][6] = {}, num_pair_agree[6][6] = {}, num_pair_definite[6][6] = {}, num_ref[6][6] = {};
+	unsigned num_maybe(0), num_int(0), num_bcube(0), num_unsupported(0), num_near(0);
+	vector<int> gjk_ret(NUM_PAIRS, 0), pair_ret(NUM_PAIRS, 0);
+	int times[2] = {0, 0};
+
+	for (unsigned pass = 0; pass < 2; ++pass) { // {GJK, pairwise}
+		int const start_time(GET_TIME_MS());
+
+		for (unsigned i = 0; i < NUM_PAIRS; ++i) {
+			coll_obj const &a(cobjs[0][i]), &b(cobjs[1][i]);
+			if (!a.intersects(b)) continue; // bcube test
+			if (pass == 0) {gjk_ret[i] = gjk_cobj_intersect(a, b, 0.0);} else {pair_ret[i] = a.intersects_cobj(b, 0.0, 0);}
+		}
+		times[pass] = GET_TIME_MS() - start_time;
+	}
+	for (unsigned i = 0; i < NUM_PAIRS; ++i) {
+		coll_obj const &a(cobjs[0][i]), &b(cobjs[1][i]);
+		if (!a.intersects(b)) continue;
+		++num_bcube;
+		num_int += (gjk_ret[i] == 1);
+		num_unsupported += (gjk_ret[i] < 0);
+		num_maybe += (pair_ret[i] == 2);
+		int const ref_ret(get_ref_cobj_intersect(a, b));
+		if (ref_ret < 0) {++num_near; continue;} // too close to call
+		unsigned const ta(min(type_ixs[0][i], type_ixs[1][i])), tb(max(type_ixs[0][i], type_ixs[1][i]));
+		++num_ref[ta][tb];
+		num_gjk_agree[ta][tb] += (gjk_ret[i] == ref_ret);
+		if (pair_ret[i] == 2) continue; // pairwise test is inexact
+		++num_pair_definite[ta][tb];
+		num_pair_agree[ta][tb] += (pair_ret[i] == ref_ret);
+	}
+	cout << "GJK benchmark: " << num_bcube << " of " << NUM_PAIRS << " pairs with overlapping bcubes, " << num_int << " intersecting; GJK "
+		 << times[0] << "ms (" << 1000.0*num_bcube/max(times[0], 1) << " pairs/s), pairwise " << times[1] << "ms (" << 1000.0*num_bcube/max(times[1], 1)
+		 << " pairs/s), " << num_maybe << " pairwise results inexact, " << num_unsupported << " GJK unsupported, " << num_near << " too close to contact to check" << endl;
+	unsigned tot_ref(0), tot_gjk_agree(0), tot_pair_definite(0), tot_pair_agree(0);
+
+	for (unsigned i = 0; i < 6; ++i) {
+		for (unsigned j = i; j < 6; ++j) {
+			if (num_ref[i][j] == 0) continue;
+			cout << "  " << names[i] << " vs. " << names[j] << ": GJK agrees with " << num_gjk_agree[i][j] << " of " << num_ref[i][j] << " reference results, pairwise "
+				 << num_pair_agree[i][j] << " of " << num_pair_definite[i][j] << endl;
+			tot_ref           += num_ref[i][j];
+			tot_gjk_agree     += num_gjk_agree[i][j];
+			tot_pair_definite += num_pair_definite[i][j];
+			tot_pair_agree    += num_pair_agree[i][j];
+		}
+	}
+	cout << "GJK agrees with " << tot_gjk_agree << " of " << tot_ref << " reference results; definite pairwise results agree with " << tot_pair_agree << " of " << tot_pair_definite << endl;
+	assert(num_unsupported == 0); // all generated cobjs are convex and nondegenerate
+	assert(tot_gjk_agree == tot_ref);
+}
@@ -5,6 +5,7 @@
 #include "3DWorld.h"
 #include "mesh.h"
 #include "physics_objects.h"
+#include <omp.h>
 
 
 bool const CACHE_COBJ_LITES   = 0;
@@ -13,7 +14,7 @@ unsigned const QLP_CACHE_SIZE = 10000;
 
 int cobj_counter(0);
 
-extern bool group_back_face_cull, begin_motion;
+extern bool group_back_face_cull, begin_motion, use_sw_occlusion;
 extern int display_mode;
 extern float zmin, zbottom, water_plane_z;
 extern coll_obj_group coll_objects;
@@ -304,6 +305,7 @@ bool cobj_contained_ref(point const &pos1, const point *pts, unsigned npts, int
 
 bool cobj_contained(point const &pos1, const point *pts, unsigned npts, int cobj) {
 	static int last_cobj(-1);
+	if (omp_in_parallel()) {int thread_last_cobj(-1); return cobj_contained_ref(pos1, pts, npts, cobj, thread_last_cobj);} // don't share the cache across threads
 	return cobj_contained_ref(pos1, pts, npts, cobj, last_cobj);
 }
 
@@ -437,7 +439,8 @@ bool is_occluded(vector<int> const &occluders, point const *const pts, int npts,
 void get_occluders() {
 
 	RESET_TIME;
-	if (!(display_mode & 0x08) || !have_occluders()) return;
+	update_sw_occlusion_raster(camera_pdu); // replaces the ray cast occluders below when enabled
+	if (use_sw_occlusion || !(display_mode & 0x08) || !have_occluders()) return;
 	static unsigned startval(0), stopped_count(0);
 	static bool first_run(1);
 	unsigned const skipval(first_run ? 0 : 8); // spread update across many frames
@@ -101,7 +101,7 @@ void decal_obj::check_cobj() {
 	else {
 		int const xpos(get_xpos(ipos.x)), ypos(get_ypos(ipos.y));
 		if (point_outside_mesh(xpos, ypos)) {status = 0; return;}
-		vector<int> const &cvals(v_collision_matrix[ypos][xpos].cvals);
+		auto const &cvals(v_collision_matrix[ypos][xpos].cvals);
 		cid = -1;
 
 		for (unsigned i = 0; i < cvals.size(); ++i) {
@@ -740,7 +740,7 @@ int remove_coll_object(int index, bool reset_draw) {
 
 	for (int i = y1; i <= y2; ++i) {
 		for (int j = x1; j <= x2; ++j) {
-			vector<int> &cvals(v_collision_matrix[i][j].cvals);
+			auto &cvals(v_collision_matrix[i][j].cvals);
 			unsigned const num_cvals(cvals.size());
 			
 			for (unsigned k = 0; k < num_cvals; ++k) {
@@ -782,8 +782,8 @@ void purge_coll_freed(bool force) {
 			if (!changed) continue;
 			vcm.zmin = mesh_height[i][j];
 			vcm.zmax = zmin;
-			vector<int>::const_iterator in(vcm.cvals.begin());
-			vector<int>::iterator o(vcm.cvals.begin());
+			auto in(vcm.cvals.cbegin());
+			auto o(vcm.cvals.begin());
 
 			for (; in != vcm.cvals.end(); ++in) {
 				coll_obj &cobj(coll_objects[*in]);
@@ -1123,7 +1123,7 @@ bool decal_contained_in_union_cube_face(coll_obj const &cobj, point const &pos,
 	// check for decal contained in union of surfaces of nearby cubes (to handle split cube)
 	bool const dir(norm[dim] > 0.0);
 	int const ds((dim+1)%3), dt((dim+2)%3);
-	vector<unsigned> cobjs;
+	frame_vector<unsigned> cobjs;
 	cube_t bcube;
 	bcube.set_from_sphere(pos, radius); // should really be disk in direction dir
 	get_intersecting_cobjs_tree(bcube, cobjs, -1, 0.0, 0, 0); // duplicates should be okay
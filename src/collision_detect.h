@@ -169,7 +169,7 @@ public:
 	int  add_coll_cobj();
 	void re_add_coll_cobj(int index, int remove_old=1);
 	bool subtract_from_cobj(coll_obj_group &new_cobjs, csg_cube const &cube, bool include_polys);
-	int  intersects_cobj(coll_obj const &c, float toler=0.0) const;
+	int  intersects_cobj(coll_obj const &c, float toler=0.0, bool allow_gjk=1) const;
 	void get_side_polygons(vector<tquad_t> &sides, int top_bot_only=0) const;
 	void get_contact_points(coll_obj const &c, vector<point> &contact_pts, bool vert_only=0, float toler=0.0) const;
 	int  is_anchored() const;
@@ -307,7 +307,7 @@ struct cobj_groups_t : public deque<cobj_group_t> { // use deque rather than vec
 };
 
 
-class coll_obj_group : public vector<coll_obj> {
+class coll_obj_group : public tracked_vector<coll_obj, MEM_CAT_COBJS> {
 
 public:
 	bool has_lt_atten, has_voxel_cobjs;
@@ -432,7 +432,7 @@ void copy_tquad_to_cobj(coll_tquad const &tquad, coll_obj &cobj);
 struct coll_cell { // size = 52
 
 	float zmin, zmax;
-	vector<int> cvals;
+	tracked_vector<int, MEM_CAT_COBJS> cvals;
 
 	void clear(bool clear_vectors);
 
@@ -16,6 +16,11 @@ bool const ONLY_SUB_PREV_NEG  = 1;
 bool const CHECK_ADJACENCY    = 0; // doesn't seem to make any significant difference
 int  const REMOVE_T_JUNCTIONS = 1; // fewer hole pixels and better ambient transitions but more cobjs and render time
 float const REL_DMAX          = 0.2;
+unsigned const CSG_PARALLEL_MIN_COBJS = 1000; // use the serial versions of cube preprocessing for fewer cobjs than this
+
+bool csg_bench(0); // compare parallel cube preprocessing results and times against the serial versions (slow)
+
+extern int verbose_mode;
 
 
 bool sphere_t::contains_point(point const &p) const {return dist_less_than(pos, p, radius);}
@@ -827,111 +832,275 @@ void coll_obj_group::check_cubes() {
 }
 
 
-// Note: also sorts by alpha so that transparency works correctly
-void coll_obj_group::merge_cubes() { // only merge compatible cubes
+unsigned get_cube_cobjs_checksum(coll_obj_group const &cobjs) { // used to compare serial vs. parallel cube preprocessing
 
-	if (!MERGE_COBJS) return;
-	RESET_TIME;
-	float const tolerance(-X_SCENE_SIZE*1.0E-6); // tiny negative tolerance to include adjacencies
-	unsigned const ncobjs((unsigned)size());
+	uint32_t hash(0);
+
+	for (coll_obj_group::const_iterator i = cobjs.begin(); i != cobjs.end(); ++i) {
+		if (i->type != COLL_CUBE) continue;
+		uint32_t const vals[4] = {(uint32_t)i->id, (uint32_t)i->status, (uint32_t)i->cp.surfs, (uint32_t)i->destroy};
+		hash = 31*hash + jenkins_one_at_a_time_hash((uint8_t const *)i->d, sizeof(i->d));
+		hash = 31*hash + jenkins_one_at_a_time_hash(vals, 4);
+	}
+	return hash;
+}
+
+void verify_parallel_csg_result(coll_obj_group const &cobjs, coll_obj_group const &serial_cobjs, char const *const name, int serial_ms, int par_ms) {
+
+	unsigned const cs_par(get_cube_cobjs_checksum(cobjs)), cs_ser(get_cube_cobjs_checksum(serial_cobjs));
+	cout << name << " checksum: parallel " << cs_par << ", serial " << cs_ser << "; time: parallel " << par_ms << "ms, serial " << serial_ms << "ms" << endl;
+	assert(cobjs.size() == serial_cobjs.size() && cs_par == cs_ser);
+}
+
+
+// merge cubes in cids into each other in order; if group_ids is non-NULL, only cubes with a group ID of group_id are considered
+unsigned merge_cube_group(coll_obj_group &cobjs, vector<unsigned> const &cids, cobj_bvh_tree const &cube_tree,
+	float tolerance, vector<unsigned> const *group_ids, unsigned group_id)
+{
 	unsigned merged(0);
-	cobj_bvh_tree cube_tree(this, 0, 0, 0, 1, 0); // cubes only
-	cube_tree.add_cobjs(0);
-	vector<unsigned> cids;
+	vector<unsigned> cands;
 
-	for (unsigned i = 0; i < ncobjs; ++i) { // choose merge candidates
-		if ((*this)[i].type != COLL_CUBE) continue;
-		csg_cube cube((*this)[i]);
+	for (unsigned n = 0; n < cids.size(); ++n) { // choose merge candidates
+		unsigned const i(cids[n]);
+		if (cobjs[i].type != COLL_CUBE) continue;
+		csg_cube cube(cobjs[i]);
 		if (cube.is_zero_area()) continue;
-		cids.resize(0);
-		cube_tree.get_intersecting_cobjs(cube, cids, i, tolerance, 0, -1);
+		cands.resize(0);
+		cube_tree.get_intersecting_cobjs(cube, cands, i, tolerance, 0, -1, group_ids, group_id);
 		unsigned mi(0);
 
-		for (vector<unsigned>::const_iterator it = cids.begin(); it != cids.end(); ++it) {
+		for (vector<unsigned>::const_iterator it = cands.begin(); it != cands.end(); ++it) {
 			unsigned const j(*it);
-			assert(j < ncobjs && j != i);
-			assert((*this)[j].type == COLL_CUBE);
-			if (!(*this)[i].equal_params((*this)[j])) continue; // not compatible
-			csg_cube cube2((*this)[j]);
+			assert(j < cobjs.size() && j != i);
+			assert(cobjs[j].type == COLL_CUBE);
+			if (!cobjs[i].equal_params(cobjs[j])) continue; // not compatible
+			csg_cube cube2(cobjs[j]);
 
 			if (cube.cube_merge(cube2)) {
-				(*this)[j].type = COLL_INVALID; // remove old coll obj
+				cobjs[j].type = COLL_INVALID; // remove old coll obj
 				++mi;
 			}
 		}
 		if (mi > 0) { // cube has changed
-			cube.write_to_cobj((*this)[i]);
+			cube.write_to_cobj(cobjs[i]);
 			merged += mi;
-			--i; // force this cube to be processed again
+			--n; // force this cube to be processed again
 		}
 	}
-	if (merged > 0) remove_invalid_cobjs();
-	cout << ncobjs << " => " << size() << endl;
-	PRINT_TIME("Cube Merge");
+	return merged;
 }
 
 
-void coll_obj_group::remove_overlapping_cubes(int min_split_destroy_thresh) { // objects specified later are the ones that are split/removed
+// Splits cubes into groups of transitively touching compatible cubes. A merged cube is the union of its parts, so it can only
+// touch cubes that one of its parts touched; this means merges never cross group boundaries and groups can be merged independently.
+unsigned get_cube_merge_groups(coll_obj_group const &cobjs, cobj_bvh_tree const &cube_tree, float tolerance, vector<unsigned> &group_ids, vector<vector<unsigned> > &groups) {
 
-	if (!UNOVERLAP_COBJS || empty()) return;
+	unsigned const ncobjs((unsigned)cobjs.size());
+	vector<vector<unsigned> > adj(ncobjs);
+
+#pragma omp parallel for schedule(dynamic,64)
+	for (int i = 0; i < (int)ncobjs; ++i) {
+		if (cobjs[i].type != COLL_CUBE) continue;
+		vector<unsigned> &cands(adj[i]);
+		cube_tree.get_intersecting_cobjs(cobjs[i], cands, i, tolerance, 0, -1);
+		vector<unsigned>::iterator end(cands.begin());
+
+		for (vector<unsigned>::const_iterator j = cands.begin(); j != cands.end(); ++j) {
+			if ((int)*j > i && cobjs[i].equal_params(cobjs[*j])) {*(end++) = *j;} // only need one direction
+		}
+		cands.erase(end, cands.end());
+	}
+	vector<unsigned> parent(ncobjs); // union-find
+
+	for (unsigned i = 0; i < ncobjs; ++i) {parent[i] = i;}
+	auto find_root([&parent](unsigned i) {while (parent[i] != i) {parent[i] = parent[parent[i]]; i = parent[i];} return i;});
+
+	for (unsigned i = 0; i < ncobjs; ++i) {
+		for (vector<unsigned>::const_iterator j = adj[i].begin(); j != adj[i].end(); ++j) {
+			unsigned const ri(find_root(i)), rj(find_root(*j));
+			if (ri != rj) {parent[max(ri, rj)] = min(ri, rj);}
+		}
+	}
+	group_ids.resize(ncobjs);
+	vector<unsigned> root_to_group(ncobjs, ncobjs);
+	groups.clear();
+
+	for (unsigned i = 0; i < ncobjs; ++i) { // groups are in order of their first cube, and cubes within groups are in increasing order
+		unsigned &gid(root_to_group[find_root(i)]);
+		if (gid == ncobjs) {gid = (unsigned)groups.size(); groups.push_back(vector<unsigned>());}
+		group_ids[i] = gid;
+		groups[gid].push_back(i);
+	}
+	return (unsigned)groups.size();
+}
+
+
+void merge_cubes_int(coll_obj_group &cobjs, bool allow_parallel) {
+
+	float const tolerance(-X_SCENE_SIZE*1.0E-6); // tiny negative tolerance to include adjacencies
+	unsigned const ncobjs((unsigned)cobjs.size());
+	unsigned merged(0);
+	cobj_bvh_tree cube_tree(&cobjs, 0, 0, 0, 1, 0); // cubes only
+	cube_tree.add_cobjs(0);
+
+	if (!allow_parallel || ncobjs < CSG_PARALLEL_MIN_COBJS) { // serial version: one group containing all cobjs
+		vector<unsigned> cids(ncobjs);
+		for (unsigned i = 0; i < ncobjs; ++i) {cids[i] = i;}
+		merged = merge_cube_group(cobjs, cids, cube_tree, tolerance, NULL, 0);
+	}
+	else {
+		vector<unsigned> group_ids;
+		vector<vector<unsigned> > groups;
+		unsigned const num_groups(get_cube_merge_groups(cobjs, cube_tree, tolerance, group_ids, groups));
+		if (verbose_mode) {cout << "cube merge groups: " << num_groups << endl;}
+
+#pragma omp parallel for schedule(dynamic,1) reduction(+:merged)
+		for (int g = 0; g < (int)num_groups; ++g) {
+			if (groups[g].size() > 1) {merged += merge_cube_group(cobjs, groups[g], cube_tree, tolerance, &group_ids, g);} // singletons can't be merged
+		}
+	}
+	if (merged > 0) {cobjs.remove_invalid_cobjs();}
+}
+
+
+// Note: also sorts by alpha so that transparency works correctly
+void coll_obj_group::merge_cubes() { // only merge compatible cubes
+
+	if (!MERGE_COBJS) return;
 	RESET_TIME;
 	unsigned const ncobjs((unsigned)size());
+	coll_obj_group serial_cobjs;
+	int const t0(GET_TIME_MS());
+	if (csg_bench) {serial_cobjs.assign(begin(), end()); merge_cubes_int(serial_cobjs, 0);}
+	int const t1(GET_TIME_MS());
+	merge_cubes_int(*this, 1);
+	if (csg_bench) {verify_parallel_csg_result(*this, serial_cobjs, "Cube Merge", (t1 - t0), (GET_TIME_MS() - t1));}
+	cout << ncobjs << " => " << size() << endl;
+	PRINT_TIME("Cube Merge");
+}
+
+
+// subtracts all overlapping cubes with a lower or equal id and the same sign from cobjs[i], skipping cubes marked as removed;
+// returns 1 and fills cur_cobjs with the remaining pieces if anything was removed;
+// if defer_pos is non-NULL and another cube with the same id is processed earlier in serial order, returns 2 because it may have been removed
+int subtract_overlapping_cubes(coll_obj_group const &cobjs, unsigned i, cobj_bvh_tree const &cube_tree, float tolerance, vector<unsigned char> const &is_removed,
+	vector<int> const *defer_pos, vector<unsigned> &cids, coll_obj_group &cur_cobjs, coll_obj_group &next_cobjs)
+{
+	csg_cube const cube(cobjs[i]); // remove all other cobjs from cobjs[i] with lower id
+	if (cube.is_zero_area()) return 0;
+	bool const neg(cobjs[i].status == COLL_NEGATIVE);
+	cids.resize(0);
+	cube_tree.get_intersecting_cobjs(cube, cids, i, tolerance, 0, -1);
+	if (cids.empty()) return 0;
+
+	if (defer_pos) {
+		for (vector<unsigned>::const_iterator it = cids.begin(); it != cids.end(); ++it) {
+			if (cobjs[*it].id == cobjs[i].id && (*defer_pos)[*it] > (*defer_pos)[i]) return 2;
+		}
+	}
+	cur_cobjs.resize(0);
+	cur_cobjs.push_back(cobjs[i]); // start with the current cobj
+	bool was_removed(0);
+
+	for (vector<unsigned>::const_iterator it = cids.begin(); it != cids.end(); ++it) {
+		unsigned const j(*it);
+		assert(j < cobjs.size());
+		assert(cobjs[j].type == COLL_CUBE && j != i);
+		if (is_removed[j])                            continue; // already removed by a cube processed earlier
+		if (cobjs[i].id < cobjs[j].id)                continue; // enforce ordering
+		if (neg ^ (cobjs[j].status == COLL_NEGATIVE)) continue; // sign must be the same
+		csg_cube sub_cube(cobjs[j]);
+
+		for (coll_obj_group::const_iterator c = cur_cobjs.begin(); c != cur_cobjs.end(); ++c) {
+			if (sub_cube.subtract_from_cube(next_cobjs, *c)) {
+				was_removed = 1;
+			}
+			else { // didn't overlap
+				next_cobjs.push_back(*c);
+			}
+		}
+		cur_cobjs.clear();
+		cur_cobjs.swap(next_cobjs);
+	} // for it
+	if (!was_removed) {assert(cur_cobjs.size() == 1);} // the original cobjs[i]
+	return was_removed;
+}
+
+
+// Each cube is only split by cubes with lower ids that haven't been processed yet, which still have their original shapes, so cubes can be processed
+// in parallel. The exception is cubes with equal ids, which can be removed before they're processed; these are deferred to a serial pass.
+void remove_overlapping_cubes_int(coll_obj_group &cobjs, int min_split_destroy_thresh, bool allow_parallel) {
+
+	unsigned const ncobjs((unsigned)cobjs.size());
 	vector<pair<unsigned, unsigned> > proc_order;
 		
 	for (unsigned i = 0; i < ncobjs; ++i) {
-		if ((*this)[i].type == COLL_CUBE && (*this)[i].destroy >= min_split_destroy_thresh) {
-			proc_order.push_back(make_pair((*this)[i].id, i));
+		if (cobjs[i].type == COLL_CUBE && cobjs[i].destroy >= min_split_destroy_thresh) {
+			proc_order.push_back(make_pair(cobjs[i].id, i));
 		}
 	}
 	if (proc_order.empty()) return; // nothing to do
-	sort(proc_order.begin(), proc_order.end());
+	sort(proc_order.begin(), proc_order.end()); // processed in reverse order
 	float const tolerance(X_SCENE_SIZE*1.0E-6); // tiny tolerance to prevent adjacencies
-	cobj_bvh_tree cube_tree(this, 0, 0, 0, 1, 0); // cubes only
+	cobj_bvh_tree cube_tree(&cobjs, 0, 0, 0, 1, 0); // cubes only
 	cube_tree.add_cobjs(0);
+	unsigned const nproc((unsigned)proc_order.size());
+	bool const parallel(allow_parallel && nproc >= CSG_PARALLEL_MIN_COBJS);
+	vector<vector<coll_obj> > results(nproc); // remaining pieces of each removed cube
+	vector<unsigned char> status(nproc, 0), is_removed(ncobjs, 0); // status: 0=unchanged, 1=removed, 2=deferred
 	bool overlaps(0);
-	coll_obj_group cur_cobjs, next_cobjs;
-	vector<unsigned> cids;
 
-	for (vector<pair<unsigned, unsigned> >::const_reverse_iterator it = proc_order.rbegin(); it != proc_order.rend(); ++it) {
-		unsigned const i(it->second);
-		csg_cube const cube((*this)[i]); // remove all other cobjs from cobjs[i] with lower id
-		if (cube.is_zero_area()) continue;
-		bool const neg((*this)[i].status == COLL_NEGATIVE);
-		cids.resize(0);
-		cube_tree.get_intersecting_cobjs(cube, cids, i, tolerance, 0, -1);
-		if (cids.empty()) continue;
-		cur_cobjs.resize(0);
-		cur_cobjs.push_back((*this)[i]); // start with the current cobj
-		bool was_removed(0);
+	if (parallel) {
+		vector<int> proc_pos(ncobjs, -1);
+		for (unsigned n = 0; n < nproc; ++n) {proc_pos[proc_order[n].second] = n;}
 
-		for (vector<unsigned>::const_iterator it = cids.begin(); it != cids.end(); ++it) {
-			unsigned const j(*it);
-			assert(j < size());
-			assert((*this)[j].type == COLL_CUBE && j != i);
-			if ((*this)[i].id < (*this)[j].id)              continue; // enforce ordering
-			if (neg ^ ((*this)[j].status == COLL_NEGATIVE)) continue; // sign must be the same
-			csg_cube sub_cube((*this)[j]);
-
-			for (coll_obj_group::const_iterator c = cur_cobjs.begin(); c != cur_cobjs.end(); ++c) {
-				if (sub_cube.subtract_from_cube(next_cobjs, *c)) {
-					was_removed = overlaps = 1;
-				}
-				else { // didn't overlap
-					next_cobjs.push_back(*c);
-				}
+#pragma omp parallel
+		{
+			coll_obj_group cur_cobjs, next_cobjs;
+			vector<unsigned> cids;
+
+#pragma omp for schedule(dynamic,16)
+			for (int n = 0; n < (int)nproc; ++n) {
+				status[n] = subtract_overlapping_cubes(cobjs, proc_order[n].second, cube_tree, tolerance, is_removed, &proc_pos, cids, cur_cobjs, next_cobjs);
+				if (status[n] == 1) {results[n].assign(cur_cobjs.begin(), cur_cobjs.end());}
 			}
-			cur_cobjs.clear();
-			cur_cobjs.swap(next_cobjs);
-		} // for it
-		if (was_removed) {
-			copy(cur_cobjs.begin(), cur_cobjs.end(), back_inserter(*this));
-			(*this)[i].type = COLL_INVALID; // remove old coll obj
 		}
-		else {
-			assert(cur_cobjs.size() == 1); // the original cobjs[i]
+	}
+	coll_obj_group cur_cobjs, next_cobjs;
+	vector<unsigned> cids;
+	unsigned num_deferred(0);
+
+	for (int n = (int)nproc-1; n >= 0; --n) { // serial pass in processing order
+		if (!parallel || status[n] == 2) {
+			num_deferred += parallel;
+			status[n] = subtract_overlapping_cubes(cobjs, proc_order[n].second, cube_tree, tolerance, is_removed, NULL, cids, cur_cobjs, next_cobjs);
+			if (status[n] == 1) {results[n].assign(cur_cobjs.begin(), cur_cobjs.end());}
 		}
-	} // for i
-	if (overlaps) remove_invalid_cobjs();
+		if (status[n] == 1) {is_removed[proc_order[n].second] = 1;}
+	}
+	if (parallel && verbose_mode) {cout << "deferred overlapping cubes: " << num_deferred << " of " << nproc << endl;}
+
+	for (int n = (int)nproc-1; n >= 0; --n) { // add pieces in processing order
+		if (status[n] != 1) continue;
+		copy(results[n].begin(), results[n].end(), back_inserter(cobjs));
+		cobjs[proc_order[n].second].type = COLL_INVALID; // remove old coll obj
+		overlaps = 1;
+	}
+	if (overlaps) {cobjs.remove_invalid_cobjs();}
+}
+
+
+void coll_obj_group::remove_overlapping_cubes(int min_split_destroy_thresh) { // objects specified later are the ones that are split/removed
+
+	if (!UNOVERLAP_COBJS || empty()) return;
+	RESET_TIME;
+	unsigned const ncobjs((unsigned)size());
+	coll_obj_group serial_cobjs;
+	int const t0(GET_TIME_MS());
+	if (csg_bench) {serial_cobjs.assign(begin(), end()); remove_overlapping_cubes_int(serial_cobjs, min_split_destroy_thresh, 0);}
+	int const t1(GET_TIME_MS());
+	remove_overlapping_cubes_int(*this, min_split_destroy_thresh, 1);
+	if (csg_bench) {verify_parallel_csg_result(*this, serial_cobjs, "Cube Overlap Removal", (t1 - t0), (GET_TIME_MS() - t1));}
 	cout << ncobjs << " => " << size() << endl;
 	PRINT_TIME("Cube Overlap Removal");
 }
@@ -48,9 +48,9 @@ void destroy_coll_objs(point const &pos, float damage, int shooter, int damage_t
 
 	if (!point_outside_mesh(xpos, ypos)) {
 		// check for waypoints that can be added near this cube (at the center only)
-		vector<int> const &cvals(v_collision_matrix[ypos][xpos].cvals);
+		auto const &cvals(v_collision_matrix[ypos][xpos].cvals);
 
-		for (vector<int>::const_iterator i = cvals.begin(); i != cvals.end(); ++i) {
+		for (auto i = cvals.begin(); i != cvals.end(); ++i) {
 			if (*i >= 0 && coll_objects.get_cobj(*i).waypt_id < 0) {coll_objects.get_cobj(*i).add_connect_waypoint();} // slow
 		}
 	}
@@ -503,11 +503,11 @@ int coll_obj::is_anchored() const {
 void fire_damage_cobjs(int xpos, int ypos) {
 
 	if (point_outside_mesh(xpos, ypos)) return;
-	vector<int> const &cvals(v_collision_matrix[ypos][xpos].cvals);
+	auto const &cvals(v_collision_matrix[ypos][xpos].cvals);
 	if (cvals.empty()) return;
 	point const pos(get_xval(xpos), get_yval(ypos), mesh_height[ypos][xpos]);
 
-	for (vector<int>::const_iterator i = cvals.begin(); i != cvals.end(); ++i) {
+	for (auto i = cvals.begin(); i != cvals.end(); ++i) {
 		if (*i < 0) continue;
 		coll_obj &cobj(coll_objects.get_cobj(*i));
 		if (cobj.destroy < EXPLODEABLE) continue;
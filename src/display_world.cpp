@@ -727,6 +727,7 @@ void display(void) {
 	RESET_TIME;
 	static int init(0), frame_index(0), time_index(0), global_time(0), tticks(0);
 	static point old_spos(0.0, 0.0, 0.0);
+	frame_arena_next_frame(); // reclaim transient container memory from the previous frame
 	proc_kbd_events();
 
 	if (!init) { // the first frame
@@ -534,7 +534,7 @@ void draw_group(obj_group &objg, shader_t &s, lt_atten_manager_t &lt_atten_manag
 		vector<wap_obj> wap_vis_objs[2];
 		bool const gm_smiley(game_mode && type == SMILEY);
 		float const radius_ext(gm_smiley ? 2.0*radius : radius); // double smiley radius to account for weapons
-		vector<unsigned> smiley_weapons_to_draw;
+		frame_vector<unsigned> smiley_weapons_to_draw;
 
 		for (unsigned j = 0; j < objg.end_id; ++j) {
 			dwobject const &obj(objg.get_obj(j));
@@ -591,16 +591,16 @@ void draw_group(obj_group &objg, shader_t &s, lt_atten_manager_t &lt_atten_manag
 		if (!wap_vis_objs[0].empty() || !wap_vis_objs[1].empty()) {end_sphere_draw();}
 
 		if (!smiley_weapons_to_draw.empty()) {
-			for (vector<unsigned>::const_iterator i = smiley_weapons_to_draw.begin(); i != smiley_weapons_to_draw.end(); ++i) {
+			for (auto i = smiley_weapons_to_draw.begin(); i != smiley_weapons_to_draw.end(); ++i) {
 				draw_weapon_in_hand(*i, s); // Note: view culling doesn't use correct bounding sphere for all weapons
 			}
 		}
 	} // large objects
 	else { // small objects
 		colorRGBA const &base_color(otype.color);
-		vector<tid_color_to_ix_t> tri_fragments, sphere_fragments;
+		frame_vector<tid_color_to_ix_t> tri_fragments, sphere_fragments;
 		vector<vert_norm_color> shrapnel_verts;
-		vector<pair<float, unsigned> > particles_to_draw;
+		frame_vector<pair<float, unsigned> > particles_to_draw;
 		int selected_particle(-1);
 		if (type == PARTICLE && (rand()&3) == 0) {selected_particle = rand()%objg.end_id;}
 
@@ -674,7 +674,7 @@ void draw_group(obj_group &objg, shader_t &s, lt_atten_manager_t &lt_atten_manag
 		vector<vert_norm_tc_color> fragment_vntc;
 		int last_tid(-1), emission_loc(-1);
 
-		for (vector<tid_color_to_ix_t>::const_iterator i = tri_fragments.begin(); i != tri_fragments.end(); ++i) { // Note: needs 2-sided lighting
+		for (auto i = tri_fragments.begin(); i != tri_fragments.end(); ++i) { // Note: needs 2-sided lighting
 			dwobject const &obj(objg.get_obj(i->ix));
 			bool const is_emissive(obj.direction > 0); // hot object, add color
 			
@@ -704,7 +704,7 @@ void draw_group(obj_group &objg, shader_t &s, lt_atten_manager_t &lt_atten_manag
 		draw_and_clear_tris(fragment_vnc, fragment_vntc); // draw any remaining triangles
 		sort(sphere_fragments.begin(), sphere_fragments.end()); // sort by tid
 
-		for (vector<tid_color_to_ix_t>::const_iterator i = sphere_fragments.begin(); i != sphere_fragments.end(); ++i) {
+		for (auto i = sphere_fragments.begin(); i != sphere_fragments.end(); ++i) {
 			dwobject &obj(objg.get_obj(i->ix));
 			select_texture(i->tid);
 			draw_sized_point(obj, obj.get_true_radius(), cd_scale, i->c, get_textured_color(tid, i->c), (i->tid >= 0), s, 2);
@@ -915,18 +915,6 @@ void draw_quads_as_tris(unsigned num_quad_verts, unsigned start_quad_vert, unsig
 bool bind_quads_as_tris_ivbo(unsigned num_quad_verts) {return quad_ix_buffer.bind_quads_as_tris_ivbo(num_quad_verts);}
 
 
-void convert_quad_ixs_to_tri_ixs(vector<unsigned> const &qixs, vector<unsigned> &tixs) { // what about 16-bit indices?
-
-	tixs.resize(6*qixs.size()/4);
-
-	for (unsigned i = 0, j = 0; i < qixs.size(); i += 4) { // step a quad at a time
-		UNROLL_4X(tixs[j++] = qixs[i+i_];) // copy quad verts
-		tixs[j++] = qixs[i+0];
-		tixs[j++] = qixs[i+2];
-	}
-}
-
-
 void lt_atten_manager_t::enable() {
 	const char *lt_atten_uniform_strs[5] = {"light_atten", "refract_ix", "cube_bb", "sphere_center", "sphere_radius"};
 
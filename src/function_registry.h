@@ -6,6 +6,7 @@
 #define _FUNCTION_REGISTRY_H_
 
 #include "3DWorld.h"
+#include "allocators.h"
 
 struct xform_matrix;
 
@@ -371,6 +372,7 @@ void auto_advance_time();
 
 // function prototypes - ai
 void advance_smiley(dwobject &obj, int smiley_id);
+void smiley_sense_targets();
 void shift_player_state(vector3d const &vd, int smiley_id);
 void player_clip_to_scene(point &pos);
 
@@ -420,6 +422,17 @@ bool sphere_sphere_int(point const &sc1, point const &sc2, float sr1, float sr2,
 void register_moving_cobj(unsigned index);
 void proc_moving_cobjs();
 
+// function prototypes - cobj_gjk
+bool get_cobj_signed_dist(coll_obj const &c1, coll_obj const &c2, double &dist, double max_dist, bool need_depth);
+int gjk_cobj_intersect(coll_obj const &c1, coll_obj const &c2, float toler);
+void run_gjk_benchmark();
+
+// function prototypes - occlusion_raster
+void update_sw_occlusion_raster(pos_dir_up const &pdu);
+bool sw_occlusion_valid_for(point const &viewer);
+bool sw_cube_occluded(cube_t const &cube);
+void run_occlusion_benchmark();
+
 // function prototypes - objects
 void pre_rt_bvh_build_hook();
 void post_rt_bvh_build_hook();
@@ -438,8 +451,11 @@ void get_coll_line_cobjs_tree(point const &pos1, point const &pos2, int ignore_c
 void get_coll_sphere_cobjs_tree(point const &center, float radius, int cobj, vert_coll_detector &vcd, bool dynamic);
 bool check_point_contained_tree(point const &p, int &cindex, bool dynamic);
 bool have_occluders();
+void get_undrawn_occluder_ids(vector<unsigned> &ids);
 void get_intersecting_cobjs_tree(cube_t const &cube, vector<unsigned> &cobjs, int ignore_cobj, float toler,
 	bool dynamic, bool check_ccounter, int id_for_cobj_int=-1);
+void get_intersecting_cobjs_tree(cube_t const &cube, frame_vector<unsigned> &cobjs, int ignore_cobj, float toler,
+	bool dynamic, bool check_ccounter, int id_for_cobj_int=-1);
 bool check_coll_line(point const &pos1, point const &pos2, int &cindex, int c_obj, int skip_dynamic, int test_alpha,
 	bool include_voxels=1, bool skip_init_colls=0, bool skip_movable=0);
 bool check_coll_line_exact(point pos1, point pos2, point &cpos, vector3d &coll_norm, int &cindex, float splash_val=0.0, int ignore_cobj=-1,
@@ -553,6 +569,7 @@ void select_water_ice_texture(shader_t &shader, colorRGBA &color);
 void set_tt_water_specular(shader_t &shader);
 colorRGBA get_tt_water_color();
 void draw_water(bool no_update=0, bool draw_fast=0);
+void update_water_no_draw();
 void add_splash(point const &pos, int xpos, int ypos, float energy, float radius, bool add_sound, vector3d const &vadd=zero_vector, bool add_droplets=1);
 bool add_water_section(float x1, float y1, float x2, float y2, float zval, float wvol);
 void float_downstream(point &pos, float radius);
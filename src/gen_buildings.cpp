@@ -371,9 +371,9 @@ struct building_t : public building_geom_t {
 	unsigned mat_ix;
 	colorRGBA side_color, roof_color, detail_color;
 	cube_t bcube;
-	vector<cube_t> parts;
-	vector<cube_t> details; // cubes on the roof - antennas, AC units, etc.
-	vector<tquad_t> roof_tquads;
+	tracked_vector<cube_t, MEM_CAT_BUILDINGS> parts;
+	tracked_vector<cube_t, MEM_CAT_BUILDINGS> details; // cubes on the roof - antennas, AC units, etc.
+	tracked_vector<tquad_t, MEM_CAT_BUILDINGS> roof_tquads;
 	mutable unsigned cur_draw_ix;
 
 	building_t(unsigned mat_ix_=0) : mat_ix(mat_ix_), side_color(WHITE), roof_color(WHITE), detail_color(BLACK), cur_draw_ix(0) {bcube.set_to_zeros();}
@@ -447,12 +447,14 @@ building_window_gen_t building_window_gen;
 
 class building_draw_t {
 
+	typedef tracked_vector<vert_norm_comp_tc_color, MEM_CAT_BUILDINGS> vert_vect_t;
+
 	struct draw_block_t {
 		bool use_vbos;
 		unsigned num_qv, num_tv;
 		vbo_wrap_t qvbo, tvbo;
 		tid_nm_pair_t tex;
-		vector<vert_norm_comp_tc_color> quad_verts, tri_verts;
+		vert_vect_t quad_verts, tri_verts;
 
 		draw_block_t() : use_vbos(0), num_qv(0), num_tv(0) {}
 
@@ -509,7 +511,7 @@ class building_draw_t {
 	};
 	vector<draw_block_t> to_draw, pend_draw; // one per texture, assumes tids are dense
 
-	vector<vert_norm_comp_tc_color> &get_verts(tid_nm_pair_t const &tex, bool quads_or_tris=0) { // default is quads
+	vert_vect_t &get_verts(tid_nm_pair_t const &tex, bool quads_or_tris=0) { // default is quads
 		unsigned const ix((tex.tid >= 0) ? (tex.tid+1) : 0);
 		if (ix >= to_draw.size()) {to_draw.resize(ix+1);}
 		draw_block_t &block(to_draw[ix]);
@@ -1387,7 +1389,7 @@ class building_creator_t {
 	vector3d range_sz, range_sz_inv, max_extent;
 	cube_t range, buildings_bcube;
 	rand_gen_t rgen;
-	vector<building_t> buildings;
+	tracked_vector<building_t, MEM_CAT_BUILDINGS> buildings;
 
 	struct grid_elem_t {
 		vector<unsigned> ixs;
@@ -1440,6 +1442,7 @@ public:
 	bool empty() const {return buildings.empty();}
 	void clear() {buildings.clear(); grid.clear();}
 	vector3d const &get_max_extent() const {return max_extent;}
+
 	building_t const &get_building(unsigned ix) const {assert(ix < buildings.size()); return buildings[ix];}
 
 	void gen(building_params_t const &params) {
@@ -78,16 +78,21 @@ void setup_3d_texture(unsigned &tid, int filter, int wrap) {
 	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, wrap);
 }
 
-unsigned create_3d_texture(unsigned xsz, unsigned ysz, unsigned zsz, unsigned ncomp, vector<unsigned char> const &data, int filter, int wrap, bool compress) {
+unsigned create_3d_texture(unsigned xsz, unsigned ysz, unsigned zsz, unsigned ncomp, unsigned char const *const data, int filter, int wrap, bool compress) {
 
-	assert(data.size() == ncomp*xsz*ysz*zsz);
+	assert(data != nullptr);
 	unsigned tid(0);
 	setup_3d_texture(tid, filter, wrap);
-	glTexImage3D(GL_TEXTURE_3D, 0, get_internal_texture_format(ncomp, compress), xsz, ysz, zsz, 0, get_texture_format(ncomp), GL_UNSIGNED_BYTE, &data.front());
+	glTexImage3D(GL_TEXTURE_3D, 0, get_internal_texture_format(ncomp, compress), xsz, ysz, zsz, 0, get_texture_format(ncomp), GL_UNSIGNED_BYTE, data);
 	//gen_mipmaps(3);
 	return tid;
 }
 
+unsigned create_3d_texture(unsigned xsz, unsigned ysz, unsigned zsz, unsigned ncomp, vector<unsigned char> const &data, int filter, int wrap, bool compress) {
+	assert(data.size() == ncomp*xsz*ysz*zsz);
+	return create_3d_texture(xsz, ysz, zsz, ncomp, &data.front(), filter, wrap, compress);
+}
+
 void update_3d_texture(unsigned tid, unsigned xoff, unsigned yoff, unsigned zoff, unsigned xsz, unsigned ysz, unsigned zsz,
 					   unsigned ncomp, unsigned char const *const data)
 {
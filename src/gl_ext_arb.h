@@ -35,6 +35,7 @@ void bind_texture_tu(unsigned tid, unsigned tu_id, bool is_cube_map=0);
 // 3D texture prototypes
 void bind_3d_texture(unsigned tid);
 void setup_3d_texture(unsigned &tid, int filter, int wrap);
+unsigned create_3d_texture(unsigned xsz, unsigned ysz, unsigned zsz, unsigned ncomp, unsigned char const *const data, int filter, int wrap, bool compress=0);
 unsigned create_3d_texture(unsigned xsz, unsigned ysz, unsigned zsz, unsigned ncomp, vector<unsigned char> const &data, int filter, int wrap, bool compress=0);
 void update_3d_texture(unsigned tid, unsigned xoff, unsigned yoff, unsigned zoff, unsigned xsz, unsigned ysz, unsigned zsz,
 					   unsigned ncomp, unsigned char const *const data);
@@ -70,20 +71,20 @@ inline void check_bind_vao(unsigned vao) {assert(vao); bind_vao(vao);}
 
 // templated vbo management utility functions/classes
 
-template<typename T> void upload_to_vbo(unsigned &vbo, vector<T> const &data, bool is_index=0, bool end_with_bind0=0, int dynamic_level=0) {
+template<typename T, typename A> void upload_to_vbo(unsigned &vbo, vector<T, A> const &data, bool is_index=0, bool end_with_bind0=0, int dynamic_level=0) {
 	check_bind_vbo(vbo, is_index);
 	upload_vbo_data(&data.front(), data.size()*sizeof(T), is_index, dynamic_level);
 	if (end_with_bind0) {bind_vbo(0, is_index);}
 }
 
-template<typename T> bool create_vbo_and_upload(unsigned &vbo, vector<T> const &data, bool is_index=0, bool end_with_bind0=0, int dynamic_level=0) {
+template<typename T, typename A> bool create_vbo_and_upload(unsigned &vbo, vector<T, A> const &data, bool is_index=0, bool end_with_bind0=0, int dynamic_level=0) {
 	if (vbo) return 0; // already uploaded
 	vbo = create_vbo();
 	upload_to_vbo(vbo, data, is_index, end_with_bind0, dynamic_level);
 	return 1;
 }
 
-template<typename T> void create_bind_vbo_and_upload(unsigned &vbo, vector<T> const &data, bool is_index=0, int dynamic_level=0) {
+template<typename T, typename A> void create_bind_vbo_and_upload(unsigned &vbo, vector<T, A> const &data, bool is_index=0, int dynamic_level=0) {
 	if (!create_vbo_and_upload(vbo, data, is_index, 0, dynamic_level)) {bind_vbo(vbo, is_index);}
 }
 
@@ -102,8 +103,8 @@ struct vbo_wrap_t { // Note: not for use with index vbo
 	bool vbo_valid() const {return (vbo > 0);}
 	void clear() {delete_and_zero_vbo(vbo);}
 	void clear_vbo() {clear();} // alias for clear()
-	template<typename vert_type_t>
-	void create_and_upload(vector<vert_type_t> const &data, int dynamic_level=0, bool end_with_bind0=0) {
+	template<typename vert_type_t, typename A>
+	void create_and_upload(vector<vert_type_t, A> const &data, int dynamic_level=0, bool end_with_bind0=0) {
 		if (!vbo) {create_vbo_and_upload(vbo, data, 0, end_with_bind0, dynamic_level);}
 	}
 	void pre_render() const {check_bind_vbo(vbo);}
@@ -118,8 +119,8 @@ struct indexed_vbo_manager_t : public vbo_wrap_t {
 	indexed_vbo_manager_t() : ivbo(0), gpu_mem(0) {}
 	void reset_vbos_to_zero() {vbo = ivbo = gpu_mem = 0;}
 
-	template<typename vert_type_t, typename index_type_t>
-	void create_and_upload(vector<vert_type_t> const &data, vector<index_type_t> const &idata, int dynamic_level=0, bool end_with_bind0=0) {
+	template<typename vert_type_t, typename index_type_t, typename VA, typename IA>
+	void create_and_upload(vector<vert_type_t, VA> const &data, vector<index_type_t, IA> const &idata, int dynamic_level=0, bool end_with_bind0=0) {
 		vbo_wrap_t::create_and_upload(data, dynamic_level, end_with_bind0);
 		if (!vbo ) {gpu_mem += data.size() *sizeof(vert_type_t );}
 		if (!ivbo) {create_vbo_and_upload(ivbo, idata, 1, end_with_bind0, dynamic_level); gpu_mem += idata.size()*sizeof(index_type_t);}
@@ -159,8 +160,8 @@ struct vao_wrap_t {
 
 struct vao_manager_t : public vbo_wrap_t, public vao_wrap_t {
 
-	template<typename vert_type_t>
-	void create_and_upload(vector<vert_type_t> const &data, int dynamic_level=0, bool setup_pointers=0) {
+	template<typename vert_type_t, typename A>
+	void create_and_upload(vector<vert_type_t, A> const &data, int dynamic_level=0, bool setup_pointers=0) {
 		if (vao) {assert(vbo); return;} // already set
 		ensure_vao_bound();
 		vbo_wrap_t::create_and_upload(data, dynamic_level);
@@ -177,8 +178,8 @@ struct indexed_vao_manager_t : public indexed_vbo_manager_t, public vao_wrap_t {
 	void reset_vbos_to_zero() {indexed_vbo_manager_t::reset_vbos_to_zero(); vao = 0;} // virtual?
 	void clear_vbos() {indexed_vbo_manager_t::clear_vbos(); vao_wrap_t::clear();}
 
-	template<typename vert_type_t, typename index_type_t>
-	void create_and_upload(vector<vert_type_t> const &data, vector<index_type_t> const &idata, int dynamic_level=0, bool setup_pointers=0) {
+	template<typename vert_type_t, typename index_type_t, typename VA, typename IA>
+	void create_and_upload(vector<vert_type_t, VA> const &data, vector<index_type_t, IA> const &idata, int dynamic_level=0, bool setup_pointers=0) {
 		if (vao) return; // already set
 		ensure_vao_bound();
 		indexed_vbo_manager_t::create_and_upload(data, idata, dynamic_level);
@@ -202,8 +203,8 @@ template<unsigned N> struct indexed_vao_multi_manager_t : public indexed_vbo_man
 		assert(ix < N);
 		vaos[ix].ensure_vao_bound();
 	}
-	template<typename vert_type_t, typename index_type_t>
-	void create_and_upload(unsigned ix, vector<vert_type_t> const &data, vector<index_type_t> const &idata, int dynamic_level=0, bool setup_pointers=0) {
+	template<typename vert_type_t, typename index_type_t, typename VA, typename IA>
+	void create_and_upload(unsigned ix, vector<vert_type_t, VA> const &data, vector<index_type_t, IA> const &idata, int dynamic_level=0, bool setup_pointers=0) {
 		assert(ix < N);
 		if (vaos[ix]) return; // already set
 		ensure_vao_bound(ix);
@@ -12,7 +12,7 @@
 #include "draw_utils.h"
 
 
-bool grass_enabled(1), use_grass_tess(0);
+bool grass_enabled(1), use_grass_tess(0), grass_bench(0);
 unsigned grass_density(0);
 float grass_length(0.02), grass_width(0.002), flower_density(0.0);
 
@@ -50,13 +50,40 @@ void detail_scenery_t::setup_shaders_post(shader_t &s) { // used for grass and f
 
 // *** grass ***
 
-void grass_manager_t::grass_t::merge(grass_t const &g) {
+void grass_manager_t::grass_qframe_t::set(float xy_min_, float xy_max, float z_min_, float z_max) {
 
-	p   = (p + g.p)*0.5; // average locations
-	float const dmag1(dir.mag()), dmag2(g.dir.mag());
-	dir = (dir/dmag1 + g.dir/dmag2).get_norm() * (0.5*(dmag1 + dmag2)); // average directions and lengths independently
-	n   = (n + g.n).get_norm(); // average normals
-	w  += g.w; // add widths to preserve surface area
+	assert(xy_min_ < xy_max && z_min_ <= z_max);
+	xy_min  = xy_min_;
+	xy_step = (xy_max - xy_min)/65535.0;
+	z_min   = z_min_;
+	z_step  = max((z_max - z_min)/65535.0, 1.0E-6);
+}
+
+void grass_manager_t::set_grass_pos(grass_t &g, point const &pos, point const &origin) const {
+
+	for (unsigned d = 0; d < 2; ++d) {g.p[d] = (unsigned short)max(0, min(65535, round_fp((pos[d] - origin[d] - qframe.xy_min)/qframe.xy_step)));}
+	g.p[2] = quantize_z(pos.z);
+}
+
+void grass_manager_t::set_grass_dir(grass_t &g, vector3d const &dir) const {
+
+	float const length(dir.mag());
+	if (length == 0.0) {g.len = 0; return;} // removed
+	encode_oct_norm(dir/length, g.dir);
+	g.len = (unsigned char)max(1, min(255, round_fp(255.0*length/(GRASS_MAX_LEN_SCALE*grass_length)))); // nonzero length is never rounded to removed
+}
+
+void grass_manager_t::set_grass_width(grass_t &g, float w) const {
+	g.w = (unsigned char)max(0, min(255, round_fp(GRASS_WIDTH_LOG_SCALE*(log2(w/grass_width) + GRASS_WIDTH_LOG_OFFSET))));
+}
+
+void grass_manager_t::merge_grass(grass_t &g1, grass_t const &g2, point const &origin) const {
+
+	set_grass_pos(g1, (get_grass_pos(g1, origin) + get_grass_pos(g2, origin))*0.5, origin); // average locations
+	encode_oct_norm((decode_oct_norm(g1.dir) + decode_oct_norm(g2.dir)).get_norm(), g1.dir); // average directions and lengths independently
+	g1.len = (unsigned char)((unsigned(g1.len) + unsigned(g2.len) + 1)/2);
+	encode_oct_norm((decode_oct_norm(g1.n) + decode_oct_norm(g2.n)).get_norm(), g1.n); // average normals
+	set_grass_width(g1, (get_grass_width(g1) + get_grass_width(g2))); // add widths to preserve surface area
 	//UNROLL_3X(c[i_] = (unsigned char)(unsigned(c[i_]) + unsigned(g.c[i_]))/2;) // don't average colors because they're used for the density filtering hash
 }
 
@@ -77,7 +104,7 @@ vector3d grass_manager_t::interpolate_mesh_normal(point const &pos) const { // N
 		 + vertex_normals[y0+1][x0+1]*(xpi*ypi);
 }
 
-void grass_manager_t::add_grass_blade_int(point const &pos, float cscale, bool on_mesh, vector<grass_t> &grass_, rand_gen_pregen_t &rgen_) const {
+void grass_manager_t::add_grass_blade_int(point const &pos, point const &origin, float cscale, bool on_mesh, grass_vect_t &grass_, rand_gen_pregen_t &rgen_) const {
 
 	vector3d const base_dir(on_mesh ? 0.5*(plus_z + interpolate_mesh_normal(pos)) : plus_z); // average mesh normal and +z for grass on mesh
 	vector3d const dir((base_dir + rgen_.signed_rand_vector(0.3)).get_norm());
@@ -96,7 +123,14 @@ void grass_manager_t::add_grass_blade_int(point const &pos, float cscale, bool o
 	}
 	float const length(grass_length*rgen_.rand_uniform(0.7, 1.3));
 	float const width( grass_width *rgen_.rand_uniform(0.7, 1.3));
-	grass_.push_back(grass_t(pos, dir*length, norm, color, width, on_mesh));
+	grass_t g;
+	set_grass_pos  (g, pos, origin);
+	set_grass_dir  (g, dir*length);
+	set_grass_width(g, width);
+	encode_oct_norm(norm, g.n);
+	UNROLL_3X(g.c[i_] = color[i_];)
+	g.on_mesh = on_mesh;
+	grass_.push_back(g);
 }
 
 void grass_manager_t::create_new_vbo() {
@@ -106,25 +140,23 @@ void grass_manager_t::create_new_vbo() {
 	data_valid = 0;
 }
 
-void grass_manager_t::add_to_vbo_data(grass_t const &g, vector<grass_data_t> &data, unsigned &ix, vector3d const &norm) const {
+void grass_manager_t::add_to_vbo_data(grass_t const &g, point const &origin, vector<grass_data_t> &data, unsigned &ix, vector3d const &norm) const {
 
-	point p2(g.p + g.dir); p2.z += 0.05*grass_length;
-	vector3d const binorm(cross_product(g.dir, g.n));
-	vector3d const delta(binorm*(0.5*g.w/binorm.mag()));
+	point const p(get_grass_pos(g, origin));
+	vector3d const dir(get_grass_dir(g));
+	point p2(p + dir); p2.z += 0.05*grass_length;
+	vector3d const binorm(cross_product(dir, decode_oct_norm(g.n)));
+	float const bmag(binorm.mag());
+	vector3d const delta((bmag > 0.0) ? binorm*(0.5*get_grass_width(g)/bmag) : zero_vector); // removed grass has zero area
 	norm_comp const nc(norm);
 	assert(ix+2 < data.size());
-	data[ix++].assign(g.p-delta, nc.n, g.c);
-	data[ix++].assign(g.p+delta, nc.n, g.c);
-	data[ix++].assign(p2,        nc.n, g.c);
+	data[ix++].assign(p-delta, nc.n, g.c);
+	data[ix++].assign(p+delta, nc.n, g.c);
+	data[ix++].assign(p2,      nc.n, g.c);
 }
 
 void grass_manager_t::scale_grass(float lscale, float wscale) {
-
-	for (auto i = grass.begin(); i != grass.end(); ++i) {
-		i->dir *= lscale;
-		i->w   *= wscale;
-	}
-	clear_vbo();
+	clear_vbo(); // nothing else to do, since lengths and widths are stored relative to grass_length and grass_width, which have already been updated
 }
 
 void grass_manager_t::begin_draw() const {
@@ -148,7 +180,7 @@ void grass_tile_manager_t::gen_block(unsigned bix) {
 			float const xval(x*DX_VAL), yval(y*DY_VAL);
 
 			for (unsigned n = 0; n < grass_density; ++n) {
-				add_grass_blade(point((xval + rscale_x*rgen.rand()), (yval + rscale_y*rgen.rand()), 0.0), TT_GRASS_COLOR_SCALE, 0); // no mesh normal
+				add_grass_blade(point((xval + rscale_x*rgen.rand()), (yval + rscale_y*rgen.rand()), 0.0), all_zeros, TT_GRASS_COLOR_SCALE, 0); // no mesh normal
 			}
 		}
 	}
@@ -176,8 +208,10 @@ void grass_tile_manager_t::gen_lod_block(unsigned bix, unsigned lod) {
 		unsigned merge_ix(i); // start at ourself (invalid)
 		unsigned const end_val(min(i+search_dist, end_ix));
 
+		point const pos(get_grass_pos(grass[i], all_zeros));
+
 		for (unsigned cur = i+1; cur < end_val; ++cur) {
-			float const dist_sq(p2p_dist_sq(grass[i].p, grass[cur].p));
+			float const dist_sq(p2p_dist_sq(pos, get_grass_pos(grass[cur], all_zeros)));
 					
 			if (dist_sq < dmin_sq) {
 				dmin_sq  = dist_sq;
@@ -187,7 +221,7 @@ void grass_tile_manager_t::gen_lod_block(unsigned bix, unsigned lod) {
 		if (merge_ix > i) {
 			assert(merge_ix < grass.size());
 			assert(merge_ix-start_ix < used.size());
-			grass.back().merge(grass[merge_ix]);
+			merge_grass(grass.back(), grass[merge_ix], all_zeros);
 			used[merge_ix-start_ix] = 1;
 		}
 	} // for i
@@ -212,7 +246,7 @@ void grass_tile_manager_t::upload_data() {
 	for (unsigned i = 0, ix = 0; i < size(); ++i) {
 		vector3d const &norm(plus_z); // use grass normal? 2-sided lighting? generate normals in vertex shader?
 		//vector3d const &norm(grass[i].n);
-		add_to_vbo_data(grass[i], data, ix, norm);
+		add_to_vbo_data(grass[i], all_zeros, data, ix, norm);
 	}
 	upload_to_vbo(vbo, data, 0, 1);
 	data_valid = 1;
@@ -225,6 +259,8 @@ void grass_tile_manager_t::gen_grass() {
 	RESET_TIME;
 	assert(NUM_GRASS_LODS > 0);
 	assert((MESH_X_SIZE % GRASS_BLOCK_SZ) == 0 && (MESH_Y_SIZE % GRASS_BLOCK_SZ) == 0);
+	float const cell_sz(max(DX_VAL, DY_VAL));
+	qframe.set(-cell_sz, (GRASS_BLOCK_SZ+1)*cell_sz, 0.0, 0.0); // blocks are at the origin with z=0
 
 	for (unsigned lod = 0; lod < NUM_GRASS_LODS; ++lod) {
 		vbo_offsets[lod].resize(NUM_RND_GRASS_BLOCKS+1);
@@ -269,6 +305,8 @@ class grass_manager_dynamic_t : public grass_manager_t {
 	int last_light;
 	point last_lpos;
 
+	static point get_cell_origin(int x, int y) {return point(get_xval(x), get_yval(y), 0.0);}
+
 	bool hcm_chk(int x, int y) const {
 		return (!point_outside_mesh(x, y) && (mesh_height[y][x] + SMALL_NUMBER < h_collision_matrix[y][x]));
 	}
@@ -300,6 +338,8 @@ public:
 		unsigned const om_stride(MESH_X_SIZE+1);
 		vector<unsigned char> occ_map;
 		unsigned const SAMPLES_PER_TILE(min(grass_density, 16U));
+		float const cell_sz(max(DX_VAL, DY_VAL)), gen_zmin(min(zmin, zbottom)), gen_zmax(max(max(zmax, ztop), czmax) + grass_length), gen_dz(gen_zmax - gen_zmin);
+		qframe.set(-cell_sz, 2.0*cell_sz, (gen_zmin - 0.5*gen_dz), (gen_zmax + 0.5*gen_dz)); // blades may be outside their cell; allow for mesh height changes
 
 		if (grass_tex_enabled) {
 			occ_map.resize(om_stride*(MESH_Y_SIZE+1), 0);
@@ -324,7 +364,7 @@ public:
 			//PRINT_TIME("Grass Occlusion");
 		}
 		vector<vector<unsigned>> mesh_to_grass_local(MESH_Y_SIZE); // one per Y row
-		vector<vector<grass_t>> grass_local(MESH_Y_SIZE); // one per Y row
+		vector<grass_vect_t> grass_local(MESH_Y_SIZE); // one per Y row
 		float const rscale_x(DX_VAL/2147483562.0), rscale_y(DY_VAL/2147483562.0);
 
 		#pragma omp parallel for schedule(dynamic,1)
@@ -332,13 +372,14 @@ public:
 			// create thread private copies of these three variables
 			vector<unsigned> &mesh_to_grass(mesh_to_grass_local[y]);
 			mesh_to_grass.resize(MESH_X_SIZE);
-			vector<grass_t> &grass_(grass_local[y]);
+			grass_vect_t &grass_(grass_local[y]);
 			rand_gen_pregen_t rgen_(rgen); // deep copy
 			rgen_.set_state(845631, 667239*y); // unique state for each y row
 
 			for (int x = 0; x < MESH_X_SIZE; ++x) {
 				mesh_to_grass[x] = (unsigned)grass_.size();
 				float const xval(get_xval(x)), yval(get_yval(y));
+				point const origin(get_cell_origin(x, y));
 
 				//if (create_voxel_landscape) {
 				if (coll_objects.has_voxel_cobjs) {
@@ -365,7 +406,7 @@ public:
 							point const pos((1 - sqrt_r1)*cobj.points[0] + (sqrt_r1*(1 - r2))*cobj.points[ptix] + (sqrt_r1*r2)*cobj.points[2]);
 							if (!test_cube.contains_pt(pos))     continue; // bbox test
 							if (ao_lighting_too_low(pos, rgen_)) continue; // too dark
-							add_grass_blade_int(pos, 0.8, 0, grass_, rgen_); // use cobj.norm instead of mesh normal?
+							add_grass_blade_int(pos, origin, 0.8, 0, grass_, rgen_); // use cobj.norm instead of mesh normal?
 							++num_voxel_blades;
 							has_voxel_grass = 1;
 						}
@@ -418,7 +459,7 @@ public:
 						if (point_inside_voxel_terrain(pos)) continue; // inside voxel volume
 						if (ao_lighting_too_low(pos, rgen_)) continue; // too dark
 					}
-					add_grass_blade_int(pos, 0.8, 1, grass_, rgen_);
+					add_grass_blade_int(pos, origin, 0.8, 1, grass_, rgen_);
 				} // for n
 			} // for x
 		} // for y
@@ -445,12 +486,15 @@ public:
 		vertex_data_buffer.resize(min(num_verts, block_size));
 		bind_vbo(vbo);
 		if (alloc_data) {upload_vbo_data(NULL, 3*grass.size()*vntc_sz);} // initial upload (setup, no data)
+		unsigned cix(get_cell_containing(start));
 		
 		for (unsigned i = start, ix = 0; i < end; ++i) {
+			while (mesh_to_grass_map[cix+1] <= i) {++cix;} // advance to the cell containing this blade
+			point const origin(get_cell_origin(cix%MESH_X_SIZE, cix/MESH_X_SIZE));
 			//vector3d norm(grass[i].n); // use grass normal? 2-sided lighting?
 			//vector3d norm(surface_normals[get_ypos(p1.y)][get_xpos(p1.x)]);
-			vector3d const norm(grass[i].on_mesh ? interpolate_mesh_normal(grass[i].p) : plus_z); // use +z normal for voxels
-			add_to_vbo_data(grass[i], vertex_data_buffer, ix, norm);
+			vector3d const norm(grass[i].on_mesh ? interpolate_mesh_normal(get_grass_pos(grass[i], origin)) : plus_z); // use +z normal for voxels
+			add_to_vbo_data(grass[i], origin, vertex_data_buffer, ix, norm);
 
 			if (ix == block_size || i+1 == end) { // filled block or last entry
 				upload_vbo_sub_data(&vertex_data_buffer.front(), offset*vntc_sz, ix*vntc_sz); // upload part or all of the data
@@ -480,6 +524,11 @@ public:
 		return radius;
 	}
 
+	unsigned get_cell_containing(unsigned grass_ix) const { // returns the mesh index of the cell containing this grass blade
+		assert(grass_ix < grass.size());
+		return unsigned(std::upper_bound(mesh_to_grass_map.begin(), mesh_to_grass_map.end(), grass_ix) - mesh_to_grass_map.begin()) - 1;
+	}
+
 	unsigned get_start_and_end(int x, int y, unsigned &start, unsigned &end) const {
 		unsigned const ix(y*MESH_X_SIZE + x);
 		assert(ix+1 < mesh_to_grass_map.size());
@@ -500,11 +549,13 @@ public:
 				unsigned start, end;
 				get_start_and_end(x, y, start, end);
 				if (start == end) continue; // no grass at this location
+				point const origin(get_cell_origin(x, y));
 
 				for (unsigned i = start; i < end; ++i) {
-					if (p2p_dist_xy_sq(pos, grass[i].p) > rad_sq) continue; // too far away
-					if (grass[i].dir == zero_vector) continue; // removed
-					pos.z = max(pos.z, (grass[i].p.z + grass[i].dir.z + radius));
+					if (grass[i].is_removed()) continue; // removed
+					point const gpos(get_grass_pos(grass[i], origin));
+					if (p2p_dist_xy_sq(pos, gpos) > rad_sq) continue; // too far away
+					pos.z = max(pos.z, (gpos.z + get_grass_dir(grass[i]).z + radius));
 					return 1; // early terminate at first grass blade
 				}
 			}
@@ -529,14 +580,16 @@ public:
 		unsigned start, end;
 		unsigned const ix(get_start_and_end(x, y, start, end));
 		unsigned min_up(end+1), max_up(start);
+		point const origin(get_cell_origin(x, y));
 
 		for (unsigned i = start; i < end; ++i) { // will do nothing if there's no grass here
 			grass_t &g(grass[i]);
-			if (!g.on_mesh || g.dir == zero_vector) continue; // not on mesh, or already "removed"
-			float const mh(interpolate_mesh_zval(g.p.x, g.p.y, 0.0, 0, 1));
+			if (!g.on_mesh || g.is_removed()) continue; // not on mesh, or already "removed"
+			point const gpos(get_grass_pos(g, origin));
+			unsigned short const qz(quantize_z(interpolate_mesh_zval(gpos.x, gpos.y, 0.0, 0, 1)));
 
-			if (fabs(g.p.z - mh) > 0.01*grass_width) { // is there any way we can check the ground texture to see if we sill have grass texture here?
-				g.p.z  = mh;
+			if (g.p[2] != qz) { // is there any way we can check the ground texture to see if we sill have grass texture here?
+				g.p[2] = qz;
 				min_up = min(min_up, i);
 				max_up = max(max_up, i);
 			}
@@ -565,34 +618,37 @@ public:
 				unsigned start, end;
 				unsigned const ix(get_start_and_end(x, y, start, end));
 				unsigned min_up(end+1), max_up(start);
+				point const origin(get_cell_origin(x, y));
 
 				for (unsigned i = start; i < end; ++i) { // will do nothing if there's no grass here
 					grass_t &g(grass[i]);
-					float const dsq(p2p_dist_xy_sq(pos, g.p));
+					if (g.is_removed()) continue; // already "removed" (uncommon case)
+					point const gpos(get_grass_pos(g, origin));
+					float const dsq(p2p_dist_xy_sq(pos, gpos));
 					if (dsq > rad_sq) continue; // too far away
-					if (g.dir == zero_vector) continue; // already "removed" (uncommon case)
 					bool const underwater(maybe_underwater && g.on_mesh);
 					bool updated(0);
 
 					if (cut) {
-						float const length(g.dir.mag());
+						float const length(get_grass_length(g));
 
 						if (length > 0.25*grass_length) {
-							g.dir  *= sqrt(dsq)*rad_inv;
+							set_grass_dir(g, get_grass_dir(g)*(sqrt(dsq)*rad_inv));
 							updated = 1;
 						}
 					}
 					if (crush) {
 						vector3d const &sn(surface_normals[y][x]);
-						float const length(g.dir.mag());
+						vector3d const dir(get_grass_dir(g));
+						float const length(get_grass_length(g));
 
-						if (fabs(dot_product(g.dir, sn)) > 0.1*length) { // update if not flat against the mesh
-							float const om_reld(1.0 - sqrt(dsq)*rad_inv), dx(g.p.x - pos.x), dy(g.p.y - pos.y), atten_val(1.0 - om_reld*om_reld);
+						if (fabs(dot_product(dir, sn)) > 0.1*length) { // update if not flat against the mesh
+							float const om_reld(1.0 - sqrt(dsq)*rad_inv), dx(gpos.x - pos.x), dy(gpos.y - pos.y), atten_val(1.0 - om_reld*om_reld);
 							vector3d const new_dir(vector3d(dx, dy, -(sn.x*dx + sn.y*dy)/sn.z).get_norm()); // point away from crushing point
 
-							if (dot_product(g.dir, new_dir) < 0.95*length) { // update if not already aligned
-								g.dir   = (g.dir*(atten_val/length) + new_dir*(1.0 - atten_val)).get_norm()*length;
-								g.n     = (g.n*atten_val + sn*(1.0 - atten_val)).get_norm();
+							if (dot_product(dir, new_dir) < 0.95*length) { // update if not already aligned
+								set_grass_dir(g, (dir*(atten_val/length) + new_dir*(1.0 - atten_val)).get_norm()*length);
+								encode_oct_norm((decode_oct_norm(g.n)*atten_val + sn*(1.0 - atten_val)).get_norm(), g.n);
 								updated = 1;
 							}
 						}
@@ -610,14 +666,14 @@ public:
 						UNROLL_3X(updated |= (g.c[i_] > 0);)
 						if (updated) {UNROLL_3X(g.c[i_] = (unsigned char)(atten_val*g.c[i_]);)}
 					}
-					if (check_uw && underwater && (g.p.z + g.dir.mag()) <= water_matrix[y][x]) {
+					if (check_uw && underwater && (gpos.z + get_grass_length(g)) <= water_matrix[y][x]) {
 						unsigned char uwc[3] = {120,  100, 50};
 						UNROLL_3X(updated |= (g.c[i_] != uwc[i_]);)
 						if (updated) {UNROLL_3X(g.c[i_] = (unsigned char)(0.9*g.c[i_] + 0.1*uwc[i_]);)}
 					}
 					if (remove) {
 						// Note: if we're removing, it doesn't make sense to do any other operations since they won't have any effect
-						g.dir   = zero_vector; // make zero length (can't actually remove it)
+						g.len   = 0; // make zero length (can't actually remove it)
 						updated = 1;
 					}
 					if (updated) {
@@ -639,6 +695,120 @@ public:
 		cout << "mem used: " << grass.size()*sizeof(grass_t) << ", vmem used: " << 3*grass.size()*sizeof(grass_data_t) << endl;
 	}
 
+	struct grass_f32_t { // unquantized blade format, used as the benchmark baseline; size = 44
+		point p;
+		vector3d dir, n;
+		unsigned char c[3];
+		unsigned char on_mesh;
+		float w;
+	};
+
+	void crush_or_cut_grass_f32(vector<grass_f32_t> &fgrass, point const &pos, float radius, bool crush, bool cut) const { // same as modify_grass() crush/cut
+		int x1, y1, x2, y2;
+		float const rad(get_xy_bounds(pos, radius, x1, y1, x2, y2));
+		if (rad == 0.0) return;
+		float const rad_sq(rad*rad), rad_inv(1.0/rad);
+
+		for (int y = y1; y <= y2; ++y) {
+			for (int x = x1; x <= x2; ++x) {
+				if (point_outside_mesh(x, y)) continue;
+				point const mpos(get_mesh_xyz_pos(x, y));
+				cube_t const bcube(mpos.x, mpos.x+DX_VAL, mpos.y, mpos.y+DY_VAL, 0.0, 0.0);
+				if (p2p_dist_xy_sq(pos, bcube.closest_pt(pos)) > rad_sq) continue;
+				unsigned start, end;
+				get_start_and_end(x, y, start, end);
+
+				for (unsigned i = start; i < end; ++i) {
+					grass_f32_t &g(fgrass[i]);
+					float const dsq(p2p_dist_xy_sq(pos, g.p));
+					if (dsq > rad_sq || g.dir == zero_vector) continue;
+					float const length(g.dir.mag());
+
+					if (cut && length > 0.25*grass_length) {g.dir *= sqrt(dsq)*rad_inv;}
+
+					if (crush) {
+						vector3d const &sn(surface_normals[y][x]);
+
+						if (fabs(dot_product(g.dir, sn)) > 0.1*length) {
+							float const om_reld(1.0 - sqrt(dsq)*rad_inv), dx(g.p.x - pos.x), dy(g.p.y - pos.y), atten_val(1.0 - om_reld*om_reld);
+							vector3d const new_dir(vector3d(dx, dy, -(sn.x*dx + sn.y*dy)/sn.z).get_norm());
+
+							if (dot_product(g.dir, new_dir) < 0.95*length) {
+								g.dir = (g.dir*(atten_val/length) + new_dir*(1.0 - atten_val)).get_norm()*length;
+								g.n   = (g.n*atten_val + sn*(1.0 - atten_val)).get_norm();
+							}
+						}
+					}
+				} // for i
+			} // for x
+		} // for y
+	}
+
+	void run_update_benchmark() const { // times blade updates and vertex data generation on a copy of the grass, vs. unquantized blades
+		if (empty()) return;
+		unsigned const NUM_UPDATES = 1000;
+		float const radius(2.0*max(DX_VAL, DY_VAL));
+		vector<grass_f32_t> fgrass(size());
+
+		for (int y = 0; y < MESH_Y_SIZE; ++y) { // decode into the baseline format
+			for (int x = 0; x < MESH_X_SIZE; ++x) {
+				unsigned start, end;
+				get_start_and_end(x, y, start, end);
+				point const origin(get_cell_origin(x, y));
+
+				for (unsigned i = start; i < end; ++i) {
+					grass_t const &g(grass[i]);
+					grass_f32_t &f(fgrass[i]);
+					f.p   = get_grass_pos(g, origin);
+					f.dir = get_grass_dir(g);
+					f.n   = decode_oct_norm(g.n);
+					UNROLL_3X(f.c[i_] = g.c[i_];)
+					f.on_mesh = g.on_mesh;
+					f.w   = get_grass_width(g);
+				}
+			}
+		}
+		rand_gen_t frgen;
+		int const f32_start_time(GET_TIME_MS());
+
+		for (unsigned n = 0; n < NUM_UPDATES; ++n) { // same update sequence as below
+			point pos(frgen.rand_uniform(-X_SCENE_SIZE, X_SCENE_SIZE), frgen.rand_uniform(-Y_SCENE_SIZE, Y_SCENE_SIZE), 0.0);
+			pos.z = interpolate_mesh_zval(pos.x, pos.y, 0.0, 0, 1);
+			crush_or_cut_grass_f32(fgrass, pos, radius, (n & 1), !(n & 1));
+		}
+		int const f32_update_time(GET_TIME_MS() - f32_start_time);
+		grass_manager_dynamic_t gm(*this);
+		gm.vbo = 0; // don't touch our VBO
+		rand_gen_t brgen;
+		int const start_time(GET_TIME_MS());
+
+		for (unsigned n = 0; n < NUM_UPDATES; ++n) { // alternate between crushing and cutting
+			point pos(brgen.rand_uniform(-X_SCENE_SIZE, X_SCENE_SIZE), brgen.rand_uniform(-Y_SCENE_SIZE, Y_SCENE_SIZE), 0.0);
+			pos.z = interpolate_mesh_zval(pos.x, pos.y, 0.0, 0, 1);
+			gm.modify_grass(pos, radius, (n & 1), 0, !(n & 1), 0, 0, 0, BLACK);
+		}
+		int const update_time(GET_TIME_MS() - start_time);
+		vector<grass_data_t> data(3*size());
+		unsigned ix(0);
+
+		for (int y = 0; y < MESH_Y_SIZE; ++y) {
+			for (int x = 0; x < MESH_X_SIZE; ++x) {
+				unsigned start, end;
+				get_start_and_end(x, y, start, end);
+				point const origin(get_cell_origin(x, y));
+
+				for (unsigned i = start; i < end; ++i) {
+					add_to_vbo_data(grass[i], origin, data, ix, (grass[i].on_mesh ? interpolate_mesh_normal(get_grass_pos(grass[i], origin)) : plus_z));
+				}
+			}
+		}
+		assert(ix == data.size());
+		cout << "Grass benchmark: " << size() << " blades, " << NUM_UPDATES << " crush/cut updates" << endl;
+		cout << "  float:     " << sizeof(grass_f32_t) << " bytes/blade, mem " << size()*sizeof(grass_f32_t) << ", updates " << f32_update_time << "ms" << endl;
+		cout << "  quantized: " << sizeof(grass_t) << " bytes/blade, mem " << size()*sizeof(grass_t) << ", updates " << update_time << "ms, vertex data "
+			 << (GET_TIME_MS() - start_time - update_time) << "ms" << endl;
+	}
+
 	void check_for_updates() {
 		bool const vbo_invalid(vbo == 0);
 		if (vbo_invalid) {create_new_vbo();}
@@ -879,7 +1049,7 @@ void flower_manager_t::scale_flowers(float lscale, float wscale) {
 }
 
 
-void flower_tile_manager_t::gen_flowers(vector<unsigned char> const &weight_data, unsigned wd_stride, int x1, int y1) {
+void flower_tile_manager_t::gen_flowers(tracked_vector<unsigned char, MEM_CAT_TILES> const &weight_data, unsigned wd_stride, int x1, int y1) {
 
 	if (skip_generate()) return;
 	//RESET_TIME;
@@ -901,7 +1071,7 @@ void flower_tile_manager_t::gen_flowers(vector<unsigned char> const &weight_data
 	//PRINT_TIME("Gen Flowers TT");
 }
 
-void flower_tile_manager_t::update_subrange(vector<unsigned char> const &weight_data, unsigned wd_stride, int x1, int y1, int xl, int yl, int xh, int yh) {
+void flower_tile_manager_t::update_subrange(tracked_vector<unsigned char, MEM_CAT_TILES> const &weight_data, unsigned wd_stride, int x1, int y1, int xl, int yl, int xh, int yh) {
 	
 	if (!generated || xh <= xl || yh <= yl) return; // only update if already generated and nonempty range
 
@@ -1067,6 +1237,7 @@ void gen_grass() { // and flowers
 	flower_manager.clear();
 	if (no_grass() || world_mode != WMODE_GROUND) return;
 	grass_manager.gen_grass();
+	if (grass_bench) {grass_manager.run_update_benchmark();}
 	flower_manager.gen_flowers();
 	cout << "grass: " << grass_manager.size() << " out of " << XY_MULT_SIZE*grass_density;
 	if (!flower_manager.empty()) {cout << ", flowers: " << flower_manager.size();}
@@ -7,12 +7,48 @@
 
 #include "3DWorld.h"
 #include "gl_ext_arb.h"
+#include "function_registry.h"
 
 
 unsigned const NUM_GRASS_LODS       = 6;
 unsigned const NUM_RND_GRASS_BLOCKS = 16;
 unsigned const GRASS_BLOCK_SZ       = 4;
 float const TT_GRASS_COLOR_SCALE    = 0.5;
+float const GRASS_MAX_LEN_SCALE     = 1.5;  // max blade length in units of grass_length
+float const GRASS_WIDTH_LOG_SCALE   = 32.0; // width quantization steps per factor of 2
+float const GRASS_WIDTH_LOG_OFFSET  = 2.0;  // min width is grass_width/2^offset
+
+extern float grass_length, grass_width;
+
+
+// octahedral encoding of unit vectors into two signed bytes
+inline void encode_oct_norm(vector3d const &v, signed char oct[2]) {
+
+	float const l1(fabs(v.x) + fabs(v.y) + fabs(v.z));
+	if (l1 == 0.0) {oct[0] = oct[1] = 0; return;} // encode as +z
+	float x(v.x/l1), y(v.y/l1);
+
+	if (v.z < 0.0) { // fold the lower hemisphere over the diagonals
+		float const x0(x);
+		x = (1.0 - fabs(y ))*SIGN(x0);
+		y = (1.0 - fabs(x0))*SIGN(y );
+	}
+	oct[0] = (signed char)round_fp(127.0*max(-1.0f, min(1.0f, x)));
+	oct[1] = (signed char)round_fp(127.0*max(-1.0f, min(1.0f, y)));
+}
+
+inline vector3d decode_oct_norm(signed char const oct[2]) {
+
+	float x(oct[0]/127.0), y(oct[1]/127.0);
+	float const z(1.0 - fabs(x) - fabs(y));
+
+	if (z < 0.0) {
+		float const x0(x);
+		x = (1.0 - fabs(y ))*SIGN(x0);
+		y = (1.0 - fabs(x0))*SIGN(y );
+	}
+	return vector3d(x, y, z).get_norm();
+}
 
 
 struct detail_scenery_t : public vbo_wrap_t {
@@ -24,26 +60,43 @@ struct detail_scenery_t : public vbo_wrap_t {
 class grass_manager_t : public detail_scenery_t {
 
 protected:
-	struct grass_t { // size = 44
-		point p;
-		vector3d dir, n;
+	struct grass_t { // size = 16
+		unsigned short p[3]; // x/y relative to the cell or block origin, z relative to the manager's z range (see grass_qframe_t)
+		signed char dir[2], n[2]; // octahedral encoded unit vectors
 		unsigned char c[3];
-		unsigned char on_mesh : 1;
-		float w;
+		unsigned char len; // in units of GRASS_MAX_LEN_SCALE*grass_length/255; 0 = removed
+		unsigned char w; // log2 encoded, in units of grass_width
+		unsigned char on_mesh;
+
+		bool is_removed() const {return (len == 0);}
+	};
 
-		grass_t() {} // optimization
-		grass_t(point const &p_, vector3d const &dir_, vector3d const &n_, unsigned char const *const c_, float w_, bool on_mesh_)
-			: p(p_), dir(dir_), n(n_), on_mesh(on_mesh_), w(w_) {c[0] = c_[0]; c[1] = c_[1]; c[2] = c_[2];}
-		void merge(grass_t const &g);
+	struct grass_qframe_t { // position quantization
+		float xy_min, xy_step, z_min, z_step;
+		grass_qframe_t() : xy_min(0.0), xy_step(1.0), z_min(0.0), z_step(1.0) {}
+		void set(float xy_min_, float xy_max, float z_min_, float z_max);
 	};
 
-	vector<grass_t> grass;
+	typedef tracked_vector<grass_t, MEM_CAT_GRASS> grass_vect_t;
+	grass_vect_t grass;
+	grass_qframe_t qframe;
 	bool data_valid;
 	rand_gen_pregen_t rgen;
 	typedef vert_norm_comp_color grass_data_t;
 
 	vector3d interpolate_mesh_normal(point const &pos) const;
-	void add_grass_blade_int(point const &pos, float cscale, bool on_mesh, vector<grass_t> &grass_, rand_gen_pregen_t &rgen_) const;
+	void add_grass_blade_int(point const &pos, point const &origin, float cscale, bool on_mesh, grass_vect_t &grass_, rand_gen_pregen_t &rgen_) const;
+	unsigned short quantize_z(float z) const {return (unsigned short)max(0, min(65535, round_fp((z - qframe.z_min)/qframe.z_step)));}
+	void set_grass_pos(grass_t &g, point const &pos, point const &origin) const;
+	void set_grass_dir(grass_t &g, vector3d const &dir) const; // dir length is the blade length
+	void set_grass_width(grass_t &g, float w) const;
+	point get_grass_pos(grass_t const &g, point const &origin) const {
+		return point((origin.x + qframe.xy_min + g.p[0]*qframe.xy_step), (origin.y + qframe.xy_min + g.p[1]*qframe.xy_step), (qframe.z_min + g.p[2]*qframe.z_step));
+	}
+	float get_grass_length(grass_t const &g) const {return g.len*(GRASS_MAX_LEN_SCALE*grass_length/255.0);}
+	vector3d get_grass_dir(grass_t const &g) const {return (g.is_removed() ? zero_vector : decode_oct_norm(g.dir)*get_grass_length(g));}
+	float get_grass_width(grass_t const &g) const {return grass_width*exp2(g.w/GRASS_WIDTH_LOG_SCALE - GRASS_WIDTH_LOG_OFFSET);}
+	void merge_grass(grass_t &g1, grass_t const &g2, point const &origin) const;
 
 public:
 	grass_manager_t() : data_valid(0) {}
@@ -52,9 +105,9 @@ public:
 	size_t size() const {return grass.size ();} // 2 points per grass blade
 	bool empty()  const {return grass.empty();}
 	void clear();
-	void add_grass_blade(point const &pos, float cscale, bool on_mesh) {add_grass_blade_int(pos, cscale, on_mesh, grass, rgen);}
+	void add_grass_blade(point const &pos, point const &origin, float cscale, bool on_mesh) {add_grass_blade_int(pos, origin, cscale, on_mesh, grass, rgen);}
 	void create_new_vbo();
-	void add_to_vbo_data(grass_t const &g, vector<grass_data_t> &data, unsigned &ix, vector3d const &norm) const;
+	void add_to_vbo_data(grass_t const &g, point const &origin, vector<grass_data_t> &data, unsigned &ix, vector3d const &norm) const;
 	void scale_grass(float lscale, float wscale);
 	void begin_draw() const;
 	void end_draw() const;
@@ -95,7 +148,7 @@ protected:
 		flower_t(point const &p, vector3d const &n, float r, float h, colorRGBA const &c) : pos(p), normal(n), radius(r), height(h), color(c) {}
 	};
 
-	vector<flower_t> flowers;
+	tracked_vector<flower_t, MEM_CAT_GRASS> flowers;
 	rand_gen_t rgen;
 	bool generated;
 
@@ -119,8 +172,8 @@ public:
 
 class flower_tile_manager_t : public flower_manager_t {
 public:
-	void gen_flowers(vector<unsigned char> const &weight_data, unsigned wd_stride, int x1, int y1);
-	void update_subrange(vector<unsigned char> const &weight_data, unsigned wd_stride, int x1, int y1, int xl, int yl, int xh, int yh);
+	void gen_flowers(tracked_vector<unsigned char, MEM_CAT_TILES> const &weight_data, unsigned wd_stride, int x1, int y1);
+	void update_subrange(tracked_vector<unsigned char, MEM_CAT_TILES> const &weight_data, unsigned wd_stride, int x1, int y1, int xl, int yl, int xh, int yh);
 	void clear_within(point const &pos, float radius, bool is_square);
 };
 
@@ -7,13 +7,23 @@
 #include "inlines.h"
 #include "file_utils.h"
 #include "sinf.h"
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 using namespace std;
 
 
 unsigned const TEX_EDGE_MODE = 2; // 0 = clamp, 1 = cliff/underwater, 2 = mirror
+unsigned const HMAP_TILES_VERSION = 1; // increment when the file format or height postprocessing changes
+char const HMAP_TILES_MAGIC[4]    = {'3', 'H', 'M', 'T'};
 
-extern unsigned hmap_filter_width, erosion_iters_tt;
+extern unsigned hmap_filter_width, erosion_iters_tt, hmap_tile_size;
 extern int display_mode;
 extern float mesh_scale, dxdy;
 extern string hmap_out_fn;
@@ -143,6 +153,208 @@ void heightmap_t::postprocess_height() {
 }
 
 
+bool tiled_hmap_t::header_t::is_compatible(header_t const &h) const {
+	return (memcmp(magic, h.magic, sizeof(magic)) == 0 && version == h.version && tile_sz == h.tile_sz && invert_y == h.invert_y &&
+		erosion_iters == h.erosion_iters && filter_width == h.filter_width && src_size == h.src_size && src_mtime == h.src_mtime);
+}
+
+tiled_hmap_t::tiled_hmap_t() : tiles_x(0), tiles_y(0), tile_shift(0), tile_mask(0), tile_pixels(0), num_overlay_tiles(0),
+	map_base(nullptr), map_size(0), ranges(nullptr), tile_data(nullptr)
+{
+#ifdef _WIN32
+	file_handle = map_handle = nullptr;
+#else
+	fd = -1;
+#endif
+}
+
+size_t tiled_hmap_t::get_data_offset(unsigned num_tiles) { // page aligned
+	size_t const page_size(4096);
+	return (((sizeof(header_t) + num_tiles*sizeof(tile_range_t) + page_size - 1)/page_size)*page_size);
+}
+
+unsigned short get_hmap_val_16(heightmap_t const &hmap, unsigned x, unsigned y) { // 8-bit values are filtered and converted to 16 bits
+	if (hmap.ncolors == 2) {return hmap.get_pixel_value(x, y);}
+	return min(65535, round_fp(256.0*hmap.get_heightmap_value(x, y)));
+}
+
+bool tiled_hmap_t::write_file(string const &fn, heightmap_t const &hmap, header_t const &hdr_in) {
+
+	timer_t timer("Heightmap Tiles Write");
+	assert(hmap.is_allocated());
+	header_t const &h(hdr_in);
+	assert(h.width == (unsigned)hmap.width && h.height == (unsigned)hmap.height && h.tile_sz > 0);
+	unsigned const tsz(h.tile_sz), ntx((h.width + tsz - 1)/tsz), nty((h.height + tsz - 1)/tsz), tpixels(tsz*tsz);
+	string const tmp_fn(fn + ".tmp");
+	FILE *fp(fopen(tmp_fn.c_str(), "wb"));
+
+	if (fp == nullptr) {
+		cerr << "Error opening heightmap tiles file " << tmp_fn << " for write" << endl;
+		return 0;
+	}
+	vector<tile_range_t> tile_ranges(ntx*nty);
+	vector<unsigned short> row_data(size_t(ntx)*tpixels); // one row of tiles
+	bool success(fwrite(&h, sizeof(header_t), 1, fp) == 1 && fseek(fp, (long)get_data_offset(tile_ranges.size()), SEEK_SET) == 0);
+
+	for (unsigned ty = 0; ty < nty && success; ++ty) {
+#pragma omp parallel for schedule(dynamic,1)
+		for (int tx = 0; tx < (int)ntx; ++tx) {
+			unsigned short *const tile(&row_data[size_t(tx)*tpixels]);
+			tile_range_t &range(tile_ranges[ty*ntx + tx]);
+			range.vmin = 65535;
+			range.vmax = 0;
+
+			for (unsigned y = 0; y < tsz; ++y) {
+				unsigned const py(min(ty*tsz + y, h.height-1)); // replicate edge values into partial tiles
+
+				for (unsigned x = 0; x < tsz; ++x) {
+					unsigned short const val(get_hmap_val_16(hmap, min(tx*tsz + x, h.width-1), py));
+					tile[y*tsz + x] = val;
+					range.vmin = min(range.vmin, val);
+					range.vmax = max(range.vmax, val);
+				}
+			}
+		} // for tx
+		success = (fwrite(&row_data.front(), sizeof(unsigned short), row_data.size(), fp) == row_data.size());
+	} // for ty
+	success &= (fseek(fp, sizeof(header_t), SEEK_SET) == 0 && fwrite(&tile_ranges.front(), sizeof(tile_range_t), tile_ranges.size(), fp) == tile_ranges.size());
+	success &= (fclose(fp) == 0);
+	remove(fn.c_str()); // required on windows, where rename() fails if the target exists
+
+	if (!success || rename(tmp_fn.c_str(), fn.c_str()) != 0) { // write to a temp file so that partial files are never read
+		cerr << "Error writing heightmap tiles file " << fn << endl;
+		remove(tmp_fn.c_str());
+		return 0;
+	}
+	return 1;
+}
+
+bool tiled_hmap_t::map_file(string const &fn) {
+
+	void *base(nullptr);
+#ifdef _WIN32
+	HANDLE const fh(CreateFileA(fn.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL));
+	if (fh == INVALID_HANDLE_VALUE) return 0;
+	file_handle = fh;
+	LARGE_INTEGER fsize;
+	if (!GetFileSizeEx(fh, &fsize) || fsize.QuadPart == 0) {unmap_file(); return 0;}
+	map_size    = (size_t)fsize.QuadPart;
+	map_handle  = CreateFileMappingA(fh, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (map_handle) {base = MapViewOfFile(map_handle, FILE_MAP_READ, 0, 0, 0);}
+#else
+	fd = ::open(fn.c_str(), O_RDONLY);
+	if (fd < 0) return 0;
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {unmap_file(); return 0;}
+	map_size = (size_t)st.st_size;
+	base     = mmap(nullptr, map_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (base == MAP_FAILED) {base = nullptr;} else {madvise(base, map_size, MADV_RANDOM);} // tiles are paged in on demand
+#endif
+	map_base = (unsigned char const *)base;
+	if (map_base == nullptr) {unmap_file(); return 0;}
+	return 1;
+}
+
+void tiled_hmap_t::unmap_file() {
+#ifdef _WIN32
+	if (map_base   ) {UnmapViewOfFile(map_base);}
+	if (map_handle ) {CloseHandle(map_handle);}
+	if (file_handle) {CloseHandle(file_handle);}
+	file_handle = map_handle = nullptr;
+#else
+	if (map_base) {munmap((void *)map_base, map_size);}
+	if (fd >= 0 ) {::close(fd);}
+	fd = -1;
+#endif
+	map_base = nullptr;
+	map_size = 0;
+}
+
+bool tiled_hmap_t::open_file(string const &fn, header_t const &exp_hdr) { // returns 0 if missing or out of date
+
+	close_file();
+	if (!map_file(fn)) return 0;
+	if (map_size >= sizeof(header_t)) {memcpy(&hdr, map_base, sizeof(header_t));}
+	bool valid(map_size >= sizeof(header_t) && hdr.is_compatible(exp_hdr) && hdr.width > 0 && hdr.height > 0 && hdr.tile_sz > 0 && (hdr.tile_sz & (hdr.tile_sz-1)) == 0);
+
+	if (valid) {
+		tile_shift  = 0;
+		while ((1U << tile_shift) < hdr.tile_sz) {++tile_shift;}
+		tile_mask   = hdr.tile_sz - 1;
+		tile_pixels = hdr.tile_sz*hdr.tile_sz;
+		tiles_x     = (hdr.width  + tile_mask) >> tile_shift;
+		tiles_y     = (hdr.height + tile_mask) >> tile_shift;
+		size_t const data_offset(get_data_offset(get_num_tiles()));
+		valid = (map_size >= data_offset + size_t(get_num_tiles())*tile_pixels*sizeof(unsigned short));
+
+		if (valid) {
+			ranges    = (tile_range_t const *)(map_base + sizeof(header_t));
+			tile_data = (unsigned short const *)(map_base + data_offset);
+			overlay.reset(new std::atomic<unsigned short *>[get_num_tiles()]);
+			for (unsigned i = 0; i < get_num_tiles(); ++i) {overlay[i] = nullptr;}
+			add_mem_usage(MEM_CAT_TILES, get_cpu_mem());
+		}
+	}
+	if (!valid) {close_file();}
+	return valid;
+}
+
+void tiled_hmap_t::close_file() {
+
+	if (overlay) {
+		sub_mem_usage(MEM_CAT_TILES, get_cpu_mem()); // overlay pointers and tiles
+		for (unsigned i = 0; i < get_num_tiles(); ++i) {delete [] overlay[i].load();}
+		overlay.reset();
+	}
+	unmap_file();
+	hdr = header_t();
+	tiles_x = tiles_y = tile_shift = tile_mask = tile_pixels = num_overlay_tiles = 0;
+	ranges    = nullptr;
+	tile_data = nullptr;
+}
+
+void tiled_hmap_t::get_height_range(unsigned short &vmin, unsigned short &vmax) const {
+
+	assert(is_open());
+	vmin = 65535;
+	vmax = 0;
+
+	for (unsigned i = 0; i < get_num_tiles(); ++i) { // Note: doesn't include modifications
+		vmin = min(vmin, ranges[i].vmin);
+		vmax = max(vmax, ranges[i].vmax);
+	}
+}
+
+unsigned short *tiled_hmap_t::get_overlay_tile(unsigned tix) { // copy on first write
+
+	assert(tix < get_num_tiles());
+	unsigned short *tile(overlay[tix].load(std::memory_order_acquire));
+	if (tile) return tile;
+
+#pragma omp critical(hmap_overlay_alloc)
+	{
+		tile = overlay[tix].load(std::memory_order_relaxed);
+
+		if (tile == nullptr) { // not created by another thread
+			tile = new unsigned short[tile_pixels];
+			memcpy(tile, get_mapped_tile(tix), tile_pixels*sizeof(unsigned short));
+			overlay[tix].store(tile, std::memory_order_release);
+			++num_overlay_tiles;
+			add_mem_usage(MEM_CAT_TILES, tile_pixels*sizeof(unsigned short));
+		}
+	}
+	return tile;
+}
+
+void tiled_hmap_t::modify(unsigned x, unsigned y, int val, bool val_is_delta) {
+
+	assert(x < hdr.width && y < hdr.height);
+	unsigned short &v(get_overlay_tile(get_tile_ix(x, y))[get_tile_off(x, y)]);
+	if (val_is_delta) {val += v;}
+	v = max(0, min(65535, val)); // clamp
+}
+
+
 void tex_mod_map_manager_t::add_mod(tex_mod_vect_t const &mod) { // vector (could use a template function)
 	for (tex_mod_vect_t::const_iterator i = mod.begin(); i != mod.end(); ++i) {add_mod(*i);}
 }
@@ -269,16 +481,66 @@ bool terrain_hmap_manager_t::clamp_no_scale(int &x, int &y, bool allow_wrap) con
 	return 1;
 }
 
+string append_texture_dir(string const &filename);
+
+bool terrain_hmap_manager_t::open_tiles(char const *const fn, bool invert_y) {
+
+	if (hmap_tile_size == 0 || have_cities()) return 0; // disabled, or cities are placed using the full heightmap image
+	struct stat st;
+	string src_fn(append_texture_dir(fn)); // first try texture directory
+	if (stat(src_fn.c_str(), &st) != 0) {src_fn = fn;} // not found, try current directory
+	if (stat(src_fn.c_str(), &st) != 0) return 0; // not found
+	unsigned tile_sz(1);
+	while (tile_sz < hmap_tile_size) {tile_sz <<= 1;} // round up to a power of 2
+	tiled_hmap_t::header_t hdr;
+	memcpy(hdr.magic, HMAP_TILES_MAGIC, sizeof(hdr.magic));
+	hdr.version       = HMAP_TILES_VERSION;
+	hdr.tile_sz       = tile_sz;
+	hdr.invert_y      = invert_y;
+	hdr.erosion_iters = erosion_iters_tt;
+	hdr.filter_width  = hmap_filter_width;
+	hdr.src_size      = st.st_size;
+	hdr.src_mtime     = st.st_mtime;
+	string const tiles_fn(src_fn + ".tiles");
+
+	if (!tiles.open_file(tiles_fn, hdr)) { // missing or out of date; create from the full image
+		hmap.load(-1, 0, 1, 1);
+		hmap.postprocess_height(); // apply erosion, etc. before writing, since these need the full image
+		hdr.width       = hmap.width;
+		hdr.height      = hmap.height;
+		hdr.src_ncolors = hmap.ncolors;
+		if (!tiled_hmap_t::write_file(tiles_fn, hmap, hdr) || !tiles.open_file(tiles_fn, hdr)) return 0; // keep the image in memory
+		hmap.free_data();
+	}
+	tiled_hmap_t::header_t const &th(tiles.get_header());
+	hmap.width  = th.width; // keep the size and format of the source image for clamping and delta scaling
+	hmap.height = th.height;
+	hmap.ncolors        = th.src_ncolors;
+	hmap.is_16_bit_gray = (th.src_ncolors == 2);
+	val_shift = ((th.src_ncolors == 2) ? 0 : 8);
+	unsigned short vmin(0), vmax(0);
+	tiles.get_height_range(vmin, vmax);
+	cout << "Heightmap tiles: " << tiles_fn << ", " << th.width << "x" << th.height << ", " << tiles.get_num_tiles() << " tiles of "
+		 << th.tile_sz << "x" << th.tile_sz << ", height range " << vmin/256.0 << " to " << vmax/256.0 << endl;
+	return 1;
+}
+
 void terrain_hmap_manager_t::load(char const *const fn, bool invert_y) {
 
 	assert(fn != NULL);
 	cout << "Loading terrain heightmap file " << fn << endl;
 	RESET_TIME;
-	assert(!hmap.is_allocated()); // can only call once
+	assert(!enabled()); // can only call once
 	hmap = heightmap_t(0, 7, 0, 0, fn, invert_y);
-	hmap.load(-1, 0, 1, 1);
-	PRINT_TIME("Heightmap Load");
-	hmap.postprocess_height(); // apply erosion, etc. directly after loading, before applying mod brushes
+
+	if (open_tiles(fn, invert_y)) {
+		PRINT_TIME("Heightmap Tiles Load");
+	}
+	else if (!hmap.is_allocated()) { // tiles failed or disabled
+		hmap.load(-1, 0, 1, 1);
+		PRINT_TIME("Heightmap Load");
+		hmap.postprocess_height(); // apply erosion, etc. directly after loading, before applying mod brushes
+	}
 	if (!hmap_out_fn.empty()) {write_png(hmap_out_fn);}
 }
 
@@ -290,13 +552,25 @@ bool terrain_hmap_manager_t::maybe_load(char const *const fn, bool invert_y) {
 }
 
 void terrain_hmap_manager_t::write_png(std::string const &fn) const {
+
 	timer_t timer("Heightmap PNG Write");
-	hmap.write_to_png(fn);
+	if (!tiles.is_open()) {hmap.write_to_png(fn); return;}
+	heightmap_t img(0, 7, hmap.width, hmap.height, fn, 0); // assemble a temporary 16-bit image from the tiles
+	img.ncolors        = 2;
+	img.is_16_bit_gray = 1;
+	img.alloc();
+
+#pragma omp parallel for schedule(static,64)
+	for (int y = 0; y < img.height; ++y) {
+		for (int x = 0; x < img.width; ++x) {img.modify_heightmap_value(x, y, tiles.get(x, y), 0);}
+	}
+	img.write_to_png(fn);
+	img.free_client_mem();
 }
 
 tex_mod_map_manager_t::hmap_val_t terrain_hmap_manager_t::get_clamped_pixel_value(int x, int y, bool allow_wrap) const {
 	if (!clamp_xy(x, y, allow_wrap)) return 0; // not sure what to do in this case - can we ever get here?
-	return hmap.get_pixel_value(x, y);
+	return get_pixel_value(x, y);
 }
 
 float terrain_hmap_manager_t::get_clamped_height(int x, int y) const { // translate so that (0,0) is in the center of the heightmap texture
@@ -327,7 +601,8 @@ vector3d terrain_hmap_manager_t::get_norm(int x, int y) const {
 void terrain_hmap_manager_t::modify_height(mod_elem_t const &elem, bool is_delta) {
 
 	assert((unsigned)max(hmap.width, hmap.height) <= max_tex_ix());
-	hmap.modify_heightmap_value(elem.x, elem.y, elem.delta, is_delta);
+	if (tiles.is_open()) {tiles.modify(elem.x, elem.y, elem.delta*(1 << val_shift), is_delta);} // scale from source image units to 16 bits
+	else {hmap.modify_heightmap_value(elem.x, elem.y, elem.delta, is_delta);}
 }
 
 tex_mod_map_manager_t::hmap_val_t terrain_hmap_manager_t::scale_delta(float delta) const {
@@ -346,7 +621,7 @@ bool terrain_hmap_manager_t::read_and_apply_mod(string const &fn) {
 void terrain_hmap_manager_t::apply_cur_mod_map() {
 	for (tex_mod_map_t::const_iterator i = mod_map.begin(); i != mod_map.end(); ++i) { // apply the mod to the current texture
 		assert(i->first.x < hmap.width && i->first.y < hmap.height); // ensure the mod values fit within the texture
-		hmap.modify_heightmap_value(i->first.x, i->first.y, i->second.val, 1); // no clamping
+		modify_height(mod_elem_t(*i), 1); // no clamping
 	}
 }
 
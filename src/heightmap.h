@@ -6,6 +6,8 @@
 #define _HEIGHTMAP_H_
 
 #include "3DWorld.h"
+#include <atomic>
+#include <cstring>
 
 
 float const HMAP_DETAIL_SCALE = 16.0;
@@ -33,6 +35,65 @@ public:
 };
 
 
+class tiled_hmap_t { // preprocessed 16-bit heightmap split into square tiles, memory mapped from disk, with sparse overlay tiles for modifications
+
+public:
+	struct header_t {
+		char magic[4];
+		unsigned version, width, height, tile_sz, invert_y, erosion_iters, filter_width, src_ncolors, reserved;
+		unsigned long long src_size, src_mtime; // for detecting changes to the source image
+		header_t() {memset(this, 0, sizeof(header_t));}
+		bool is_compatible(header_t const &h) const; // everything other than the values read from the source image
+	};
+	struct tile_range_t {
+		unsigned short vmin, vmax;
+	};
+
+private:
+	header_t hdr;
+	unsigned tiles_x, tiles_y, tile_shift, tile_mask, tile_pixels, num_overlay_tiles;
+	unsigned char const *map_base;
+	size_t map_size;
+	tile_range_t const *ranges;
+	unsigned short const *tile_data;
+	std::unique_ptr<std::atomic<unsigned short *>[]> overlay; // one per tile, null if unmodified
+#ifdef _WIN32
+	void *file_handle, *map_handle;
+#else
+	int fd;
+#endif
+
+	unsigned get_tile_ix (unsigned x, unsigned y) const {return ((y >> tile_shift)*tiles_x + (x >> tile_shift));}
+	unsigned get_tile_off(unsigned x, unsigned y) const {return (((y & tile_mask) << tile_shift) + (x & tile_mask));}
+	unsigned short const *get_mapped_tile(unsigned tix) const {return (tile_data + size_t(tix)*tile_pixels);}
+	unsigned short *get_overlay_tile(unsigned tix);
+	bool map_file(std::string const &fn);
+	void unmap_file();
+
+public:
+	tiled_hmap_t();
+	~tiled_hmap_t() {close_file();}
+	static size_t get_data_offset(unsigned num_tiles);
+	static bool write_file(std::string const &fn, heightmap_t const &hmap, header_t const &hdr_in);
+	bool open_file(std::string const &fn, header_t const &exp_hdr);
+	void close_file();
+	bool is_open() const {return (tile_data != nullptr);}
+	header_t const &get_header() const {return hdr;}
+	unsigned get_num_tiles() const {return tiles_x*tiles_y;}
+	unsigned get_num_overlay_tiles() const {return num_overlay_tiles;}
+	size_t get_cpu_mem() const {return (is_open() ? (get_num_tiles()*sizeof(overlay[0]) + size_t(num_overlay_tiles)*tile_pixels*sizeof(unsigned short)) : 0);}
+	void get_height_range(unsigned short &vmin, unsigned short &vmax) const;
+
+	unsigned short get(unsigned x, unsigned y) const {
+		assert(x < hdr.width && y < hdr.height);
+		unsigned const tix(get_tile_ix(x, y));
+		unsigned short const *const tile(overlay[tix].load(std::memory_order_acquire));
+		return (tile ? tile : get_mapped_tile(tix))[get_tile_off(x, y)];
+	}
+	void modify(unsigned x, unsigned y, int val, bool val_is_delta);
+};
+
+
 class tex_mod_map_manager_t {
 
 public:
@@ -108,16 +169,23 @@ public:
 
 class terrain_hmap_manager_t : public tex_mod_map_manager_t {
 
-	heightmap_t hmap;
+	heightmap_t hmap; // image data, or only size/format if tiles are used
+	tiled_hmap_t tiles;
+	unsigned val_shift; // from source image pixel values to 16-bit tile values
+
+	bool open_tiles(char const *const fn, bool invert_y);
+	unsigned get_pixel_value(int x, int y) const {return (tiles.is_open() ? (tiles.get(x, y) >> val_shift) : hmap.get_pixel_value(x, y));}
+	float get_heightmap_value(int x, int y) const {return (tiles.is_open() ? tiles.get(x, y)/256.0f : hmap.get_heightmap_value(x, y));}
 
 public:
+	terrain_hmap_manager_t() : val_shift(0) {}
 	void load(char const *const fn, bool invert_y=0);
 	bool maybe_load(char const *const fn, bool invert_y=0);
 	void write_png(std::string const &fn) const;
 	bool clamp_xy(int &x, int &y, float fract_x=0.0, float fract_y=0.0, bool allow_wrap=1) const;
 	bool clamp_no_scale(int &x, int &y, bool allow_wrap=1) const;
 	hmap_val_t get_clamped_pixel_value(int x, int y, bool allow_wrap=1) const;
-	float get_raw_height(int x, int y) const {return scale_mh_texture_val(hmap.get_heightmap_value(x, y));}
+	float get_raw_height(int x, int y) const {return scale_mh_texture_val(get_heightmap_value(x, y));}
 	float get_clamped_height(int x, int y) const;
 	float interpolate_height(float x, float y) const;
 	vector3d get_norm(int x, int y) const;
@@ -133,8 +201,8 @@ public:
 	bool read_and_apply_mod(std::string const &fn);
 	void apply_cur_mod_map();
 	void apply_cur_brushes();
-	bool enabled() const {return hmap.is_allocated();}
-	~terrain_hmap_manager_t() {hmap.free_data();}
+	bool enabled() const {return (hmap.is_allocated() || tiles.is_open());}
+	~terrain_hmap_manager_t() {hmap.free_data(); tiles.close_file();}
 };
 
 
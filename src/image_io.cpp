@@ -3,10 +3,20 @@
 // 10/14/13
 #include "targa.h"
 #include "textures_3dw.h"
+#include <omp.h>
+#include <cstring>
+#include <sys/stat.h>
 
 using std::string;
 using std::cerr;
 
+unsigned const LARGE_IMAGE_FILE_SIZE  = (1 << 22); // 4MB; larger images are decoded with multiple threads
+unsigned const MIN_PARALLEL_DECODE_PX = (1 << 20); // 1 MPixel
+
+bool tex_load_bench(0);
+
+extern texture_t def_textures[];
+
 #ifdef ENABLE_JPEG
 #define INT32 prev_INT32 // fix conflicting typedef used in freeglut
 #include "jpeglib.h"
@@ -34,6 +44,29 @@ std::string const texture_dir("textures");
 
 string append_texture_dir(string const &filename) {return (texture_dir + "/" + filename);}
 
+string get_texture_file_path(string const &filename) { // first try texture directory, then current directory
+	string const path(append_texture_dir(filename));
+	struct stat st;
+	return ((stat(path.c_str(), &st) == 0) ? path : filename);
+}
+
+bool is_large_image_file(string const &filename) {
+	struct stat st;
+	return (stat(get_texture_file_path(filename).c_str(), &st) == 0 && st.st_size >= LARGE_IMAGE_FILE_SIZE);
+}
+
+// image rows are stored bottom to top unless invert_y is set; loaders that write rows directly to their final position use this
+inline unsigned get_dest_row(unsigned row, unsigned height, bool invert_y) {return (invert_y ? row : (height - row - 1));}
+inline bool loader_handles_invert_y(int format) {return (format == 4 || format == 5 || format == 6 || format == 8);}
+
+void copy_row_add_alpha(unsigned char const *src, unsigned char *dest, unsigned width) { // RGB => RGBA
+
+	for (unsigned x = 0; x < width; ++x) {
+		UNROLL_3X(dest[4*x+i_] = src[3*x+i_];)
+		dest[4*x+3] = 255; // alpha of 255
+	}
+}
+
 
 FILE *open_texture_file(string const &filename) {
 
@@ -128,7 +161,7 @@ void texture_t::load(int index, bool allow_diff_width_height, bool allow_two_byt
 		// defer this check until we actually need to access the data, in case we want to actually do the load on the fly later
 		//assert(is_allocated());
 		assert(is_loaded());
-		if (invert_y && format != 10) {do_invert_y();} // upside down (not DDS)
+		if (invert_y && format != 10 && !loader_handles_invert_y(format)) {do_invert_y();} // upside down (not DDS or formats that invert while decoding)
 		if (want_alpha_channel && ncolors < 4) {add_alpha_channel();}
 		else if (want_luminance && ncolors == 3) {try_compact_to_lum();}
 		//if (want_alpha_channel) {fill_transparent_with_avg_color();}
@@ -385,9 +418,12 @@ void texture_t::load_targa(int index, bool allow_diff_width_height) {
 	//if (!tga_is_top_to_bottom(&img)) tga_flip_vert(&img);
 	//if (tga_is_right_to_left(&img)) tga_flip_horiz(&img);
 
+#pragma omp parallel for schedule(static,64) if (num_pixels() >= MIN_PARALLEL_DECODE_PX)
 	for (int y = 0; y < height; ++y) {
+		int const src_y(get_dest_row(y, height, invert_y)); // flip vert
+
 		for (int x = 0; x < width; ++x) {
-			unsigned char const *const pixel(tga_find_pixel(&img, x, height-y-1)); // flip vert
+			unsigned char const *const pixel(tga_find_pixel(&img, x, src_y));
 			assert(pixel);
 			unsigned char *d(data + ncolors*(x + y*width));
 			tga_result const ret2(tga_unpack_pixel(pixel, img.pixel_depth, (ncolors>2 ? d+2 : 0), (ncolors>1 ? d+1 : 0), d, (ncolors>3 ? d+3 : 0)));
@@ -398,22 +434,108 @@ void texture_t::load_targa(int index, bool allow_diff_width_height) {
 }
 
 
+#ifdef ENABLE_JPEG
+// entropy coded segments of a single scan sequential JPEG with restart markers at MCU row boundaries, which can be decoded independently
+struct jpeg_restart_layout_t {
+	size_t sof_height_pos, sos_end; // offset of the SOF image height field and end of the headers
+	unsigned seg_rows; // image rows per segment
+	vector<size_t> seg_start, seg_end; // excluding RST markers
+
+	jpeg_restart_layout_t() : sof_height_pos(0), sos_end(0), seg_rows(0) {}
+	unsigned num_segs() const {return seg_start.size();}
+	bool parse(vector<unsigned char> const &buf, jpeg_decompress_struct const &cinfo);
+	void build_band(vector<unsigned char> const &buf, unsigned s0, unsigned s1, unsigned band_height, vector<unsigned char> &out) const;
+};
+
+bool jpeg_restart_layout_t::parse(vector<unsigned char> const &buf, jpeg_decompress_struct const &cinfo) {
+
+	if (cinfo.restart_interval == 0 || cinfo.progressive_mode || cinfo.comps_in_scan != cinfo.num_components) return 0;
+#if JPEG_LIB_VERSION >= 80
+	if (cinfo.block_size != DCTSIZE) return 0;
+#endif
+	bool const interleaved(cinfo.comps_in_scan > 1);
+	unsigned const mcu_w(interleaved ? cinfo.max_h_samp_factor*DCTSIZE : DCTSIZE), mcu_h(interleaved ? cinfo.max_v_samp_factor*DCTSIZE : DCTSIZE);
+	unsigned const mcus_per_row((cinfo.image_width + mcu_w - 1)/mcu_w), mcu_rows((cinfo.image_height + mcu_h - 1)/mcu_h);
+	if (cinfo.restart_interval % mcus_per_row != 0) return 0; // segments must contain whole MCU rows
+	seg_rows = (cinfo.restart_interval/mcus_per_row)*mcu_h;
+	if (buf.size() < 4 || buf[0] != 0xFF || buf[1] != 0xD8) return 0; // no SOI
+	size_t pos(2);
+
+	while (1) { // parse header markers up to and including SOS
+		if (pos + 4 > buf.size() || buf[pos] != 0xFF) return 0;
+		unsigned char const m(buf[pos+1]);
+		if (m == 0xFF) {++pos; continue;} // fill byte
+		if (m == 0x01 || (m >= 0xD0 && m <= 0xD9)) return 0; // unexpected standalone marker
+		size_t const len((buf[pos+2] << 8) + buf[pos+3]);
+		if (len < 2 || pos + 2 + len > buf.size()) return 0;
+		if (m == 0xC0 || m == 0xC1) {sof_height_pos = pos + 5;} // baseline or extended sequential Huffman
+		else if (m >= 0xC2 && m <= 0xCF && m != 0xC4 && m != 0xC8 && m != 0xCC) return 0; // progressive, lossless, or arithmetic coded
+		pos += 2 + len;
+		if (m == 0xDA) break; // SOS
+	}
+	if (sof_height_pos == 0) return 0;
+	sos_end = pos;
+	size_t seg_begin(pos);
+
+	for (size_t i = pos; i+1 < buf.size(); ++i) { // scan entropy coded data for markers
+		if (buf[i] != 0xFF) continue;
+		unsigned char const m(buf[i+1]);
+		if (m == 0xFF) continue; // fill byte
+		if (m == 0x00) {++i; continue;} // stuffed zero byte
+		seg_start.push_back(seg_begin);
+		seg_end.push_back(i);
+		if (m == 0xD9) break; // EOI
+		if (m < 0xD0 || m > 0xD7) return 0; // DNL, another scan, etc.
+		seg_begin = i + 2;
+		++i;
+	}
+	return (num_segs() == (mcu_rows*mcu_h + seg_rows - 1)/seg_rows); // one segment per group of MCU rows, and EOI found
+}
+
+void jpeg_restart_layout_t::build_band(vector<unsigned char> const &buf, unsigned s0, unsigned s1, unsigned band_height, vector<unsigned char> &out) const {
+
+	assert(s0 < s1 && s1 <= num_segs());
+	out.assign(buf.begin(), buf.begin()+sos_end); // headers
+	out[sof_height_pos+0] = (unsigned char)(band_height >> 8);
+	out[sof_height_pos+1] = (unsigned char)(band_height & 0xFF);
+
+	for (unsigned s = s0; s < s1; ++s) {
+		if (s > s0) {out.push_back(0xFF); out.push_back((unsigned char)(0xD0 + ((s - s0 - 1) & 7)));} // renumbered RST marker
+		out.insert(out.end(), buf.begin()+seg_start[s], buf.begin()+seg_end[s]);
+	}
+	out.push_back(0xFF);
+	out.push_back(0xD9); // EOI
+}
+#endif
+
+
 void texture_t::load_jpeg(int index, bool allow_diff_width_height) {
 
 #ifdef ENABLE_JPEG
-	jpeg_decompress_struct cinfo;
-	jpeg_error_mgr jerr;
-	cinfo.err = jpeg_std_error(&jerr);
-	jpeg_create_decompress(&cinfo);
 	FILE *fp(open_texture_file(name));
 
 	if (fp == NULL) {
 		cerr << "Error opening jpeg file " << name << " for read." << endl;
 		exit(1);
 	}
-	jpeg_stdio_src(&cinfo, fp);
+	vector<unsigned char> buf;
+	fseek(fp, 0, SEEK_END);
+	long const file_size(ftell(fp));
+	fseek(fp, 0, SEEK_SET);
+	if (file_size > 0) {buf.resize(file_size);}
+
+	if (buf.empty() || fread(&buf.front(), 1, buf.size(), fp) != buf.size()) {
+		cerr << "Error reading jpeg file " << name << "." << endl;
+		exit(1);
+	}
+	fclose(fp);
+	jpeg_decompress_struct cinfo;
+	jpeg_error_mgr jerr;
+	cinfo.err = jpeg_std_error(&jerr);
+	jpeg_create_decompress(&cinfo);
+	jpeg_mem_src(&cinfo, &buf.front(), buf.size());
 	jpeg_read_header(&cinfo, TRUE);
-	jpeg_start_decompress(&cinfo);
+	jpeg_calc_output_dimensions(&cinfo);
 
 	if (allow_diff_width_height || (width == 0 && height == 0)) {
 		width  = cinfo.output_width;
@@ -424,23 +546,61 @@ void texture_t::load_jpeg(int index, bool allow_diff_width_height) {
 		cerr << "Incorrect image size for " << name << ": expected " << width << "x" << height << ", got " << cinfo.output_width << "x" << cinfo.output_height << endl;
 		exit(1);
 	}
-	bool const want_alpha_channel(ncolors == 4 && cinfo.output_components == 3);
-	ncolors = cinfo.output_components; // Note: can never be 4
+	unsigned const jpeg_ncolors(cinfo.output_components);
+	bool const want_alpha_channel(ncolors == 4 && jpeg_ncolors == 3); // alpha channel is added while decoding
+	ncolors = (want_alpha_channel ? 4 : jpeg_ncolors); // Note: can never be 4 in the file
 	unsigned const scanline_size(ncolors*width);
 	alloc();
-
-	while (cinfo.output_scanline < cinfo.output_height) {
-		JSAMPROW row_pointer[1] = {data + scanline_size*(cinfo.output_height - cinfo.output_scanline - 1)};
-		jpeg_read_scanlines(&cinfo, row_pointer, 1);
+	jpeg_restart_layout_t layout;
+	unsigned const max_bands(omp_in_parallel() ? 1 : omp_get_max_threads());
+	bool const parallel(max_bands > 1 && num_pixels() >= MIN_PARALLEL_DECODE_PX && layout.parse(buf, cinfo));
+
+	if (parallel) { // decode bands of restart segments in parallel; each band includes an extra segment above and below for chroma upsampling context
+		unsigned const nsegs(layout.num_segs()), nbands(min(nsegs, max_bands));
+
+#pragma omp parallel for schedule(dynamic,1)
+		for (int b = 0; b < (int)nbands; ++b) {
+			unsigned const s0(b*nsegs/nbands), s1((b+1)*nsegs/nbands); // segments owned by this band
+			unsigned const d0((s0 > 0) ? s0-1 : 0), d1(min(nsegs, s1+1)); // segments decoded
+			unsigned const row_start(d0*layout.seg_rows), row_end(min((unsigned)height, d1*layout.seg_rows));
+			unsigned const own_start(s0*layout.seg_rows), own_end(min((unsigned)height, s1*layout.seg_rows));
+			vector<unsigned char> band_buf, row_buf(jpeg_ncolors*width);
+			layout.build_band(buf, d0, d1, (row_end - row_start), band_buf);
+			jpeg_decompress_struct bcinfo;
+			jpeg_error_mgr bjerr;
+			bcinfo.err = jpeg_std_error(&bjerr);
+			jpeg_create_decompress(&bcinfo);
+			jpeg_mem_src(&bcinfo, &band_buf.front(), band_buf.size());
+			jpeg_read_header(&bcinfo, TRUE);
+			jpeg_start_decompress(&bcinfo);
+			assert(bcinfo.output_width == (unsigned)width && bcinfo.output_height == row_end - row_start && bcinfo.output_components == (int)jpeg_ncolors);
+
+			while (bcinfo.output_scanline < bcinfo.output_height) {
+				unsigned const row(row_start + bcinfo.output_scanline);
+				bool const is_own(row >= own_start && row < own_end);
+				unsigned char *const dest(data + scanline_size*get_dest_row(row, height, invert_y));
+				JSAMPROW row_pointer[1] = {((is_own && !want_alpha_channel) ? dest : &row_buf.front())};
+				jpeg_read_scanlines(&bcinfo, row_pointer, 1);
+				if (is_own && want_alpha_channel) {copy_row_add_alpha(&row_buf.front(), dest, width);}
+			}
+			jpeg_finish_decompress(&bcinfo);
+			jpeg_destroy_decompress(&bcinfo);
+		} // for b
 	}
-	jpeg_finish_decompress(&cinfo);
-	jpeg_destroy_decompress(&cinfo);
-	fclose(fp);
-
-	if (want_alpha_channel) {
-		add_alpha_channel();
-		auto_insert_alpha_channel(index);
+	else {
+		vector<unsigned char> row_buf(want_alpha_channel ? 3*width : 0);
+		jpeg_start_decompress(&cinfo);
+
+		while (cinfo.output_scanline < cinfo.output_height) {
+			unsigned char *const dest(data + scanline_size*get_dest_row(cinfo.output_scanline, height, invert_y));
+			JSAMPROW row_pointer[1] = {(want_alpha_channel ? &row_buf.front() : dest)};
+			jpeg_read_scanlines(&cinfo, row_pointer, 1);
+			if (want_alpha_channel) {copy_row_add_alpha(&row_buf.front(), dest, width);}
+		}
+		jpeg_finish_decompress(&cinfo);
 	}
+	jpeg_destroy_decompress(&cinfo);
+	if (want_alpha_channel) {auto_insert_alpha_channel(index);}
 #else
 	cerr << "Error loading texture image file " << name << ": jpeg support has not been enabled." << endl;
 	exit(1);
@@ -528,6 +688,7 @@ void texture_t::load_png(int index, bool allow_diff_width_height, bool allow_two
 	}
 	bool const want_alpha_channel(ncolors == 4 && png_ncolors == 3);
 	ncolors = png_ncolors;
+	// Note: PNG rows depend on the previous row and must be decoded serially, but alpha channel addition and invert_y are applied while decoding
 
 	if (allow_two_byte_grayscale && ncolors == 1 && bit_depth == 16) {
 		ncolors        = 2; // change from 1 to 2 colors so that we can encode the high and low bytes into different channes to have 16-bit values
@@ -538,22 +699,22 @@ void texture_t::load_png(int index, bool allow_diff_width_height, bool allow_two
 		if (bit_depth == 16) {png_set_strip_16(png_ptr);}
 		if (bit_depth < 8)   {png_set_packing(png_ptr);}
 	}
+	if (want_alpha_channel) {
+		png_set_filler(png_ptr, 0xFF, PNG_FILLER_AFTER); // RGB => RGBA with alpha of 255
+		ncolors = 4;
+	}
 	vector<unsigned char *> rows(height);
 	unsigned const scanline_size(ncolors*width);
 	alloc();
 	
 	for (int i = 0; i < height; ++i) {
-		rows[i] = data + (height - i - 1)*scanline_size;
+		rows[i] = data + get_dest_row(i, height, invert_y)*scanline_size;
 	}
 	png_read_image(png_ptr, &rows.front());
 	png_read_end(png_ptr, end_info);
 	png_destroy_read_struct(&png_ptr, &info_ptr, &end_info);
 	fclose(fp);
-
-	if (want_alpha_channel) {
-		add_alpha_channel();
-		auto_insert_alpha_channel(index);
-	}
+	if (want_alpha_channel) {auto_insert_alpha_channel(index);}
 #else
 	cerr << "Error loading texture image file " << name << ": png support has not been enabled." << endl;
 	exit(1);
@@ -619,8 +780,8 @@ int texture_t::write_to_png(string const &fn) const {
 void texture_t::load_tiff(int index, bool allow_diff_width_height, bool allow_two_byte_grayscale) {
 
 #ifdef ENABLE_TIFF
-	TIFF* tif = TIFFOpen(append_texture_dir(name).c_str(), "r"); // first try texture directory
-	if (tif == NULL) {tif = TIFFOpen(name.c_str(), "r");} // not found, try current directory
+	string const fn(get_texture_file_path(name)); // first try texture directory, then current directory
+	TIFF* tif = TIFFOpen(fn.c_str(), "r");
 
 	if (tif == NULL) {
 		cerr << "Error opening tiff file " << name << " for read." << endl;
@@ -639,47 +800,92 @@ void texture_t::load_tiff(int index, bool allow_diff_width_height, bool allow_tw
 		assert(width > 0 && height > 0);
 	}
 	assert((int)w == width && (int)h == height);
+	bool const is_tiled(TIFFIsTiled(tif) != 0);
+	uint32 tile_w(w), tile_h(0); // strips are treated as full width tiles
+
+	if (is_tiled) {
+		TIFFGetField(tif, TIFFTAG_TILEWIDTH,  &tile_w);
+		TIFFGetField(tif, TIFFTAG_TILELENGTH, &tile_h);
+	}
+	else {
+		TIFFGetFieldDefaulted(tif, TIFFTAG_ROWSPERSTRIP, &tile_h);
+		tile_h = min(tile_h, h);
+	}
+	assert(tile_w > 0 && tile_h > 0);
+	unsigned const ntx((w + tile_w - 1)/tile_w), nblocks(ntx*((h + tile_h - 1)/tile_h));
+	bool const is_16_bit(allow_two_byte_grayscale && (ncolors == 0 || ncolors == 1) && bit_depth == 16); // 16-bit grayscale
 	
-	if (allow_two_byte_grayscale && (ncolors == 0 || ncolors == 1) && bit_depth == 16) { // 16-bit grayscale
+	if (is_16_bit) {
 		ncolors        = 2; // change from 1 to 2 colors so that we can encode the high and low bytes into different channes to have 16-bit values
 		is_16_bit_gray = 1;
-		tmsize_t const sl_size(TIFFScanlineSize(tif));
-		assert(sl_size == 2*width);
-        tdata_t buf = _TIFFmalloc(sl_size);
-		assert(buf);
-		alloc();
+		assert(TIFFScanlineSize(tif) == 2*width);
 		assert(config == PLANARCONFIG_CONTIG); // no support for PLANARCONFIG_SEPARATE, but could be added later
+	}
+	else if (ncolors == 0) {ncolors = 4;} // 3?
+	alloc();
+	bool const parallel(!omp_in_parallel() && nblocks > 1 && num_pixels() >= MIN_PARALLEL_DECODE_PX);
+	unsigned num_errors(0);
+
+	// strips/tiles are independently compressed and can be decoded in parallel, but TIFF handles aren't thread safe, so each thread opens its own
+#pragma omp parallel if (parallel)
+	{
+		TIFF *ttif((omp_get_thread_num() == 0) ? tif : TIFFOpen(fn.c_str(), "r"));
+		vector<unsigned char> buf;
+		vector<uint32> raster;
+
+		if (ttif == NULL) {}
+		else if (is_16_bit) {buf.resize(is_tiled ? TIFFTileSize(ttif) : TIFFStripSize(ttif));}
+		else {raster.resize(tile_w*tile_h);}
+
+#pragma omp for schedule(dynamic,1)
+		for (int bix = 0; bix < (int)nblocks; ++bix) {
+			if (ttif == NULL) {
+#pragma omp atomic
+				++num_errors;
+				continue;
+			}
+			unsigned const x0((bix % ntx)*tile_w), y0((bix / ntx)*tile_h), bw(min(tile_w, w - x0)), bh(min(tile_h, h - y0)); // y0 is the top row
 
-		for (int row = 0; row < height; row++) {
-			TIFFReadScanline(tif, buf, row);
+			if (is_16_bit) {
+				tmsize_t const nread(is_tiled ? TIFFReadEncodedTile(ttif, TIFFComputeTile(ttif, x0, y0, 0, 0), &buf.front(), buf.size()) :
+					TIFFReadEncodedStrip(ttif, TIFFComputeStrip(ttif, y0, 0), &buf.front(), buf.size()));
 
-			for (int i = 0; i < sl_size; ++i) { // x-values
-				data[sl_size*(height - row - 1) + i] = ((unsigned char const *)buf)[i]; // assumes little endian byte ordering, no swap required, may need to check this?
+				if (nread < 0) {
+#pragma omp atomic
+					++num_errors;
+					continue;
+				}
+				for (unsigned y = 0; y < bh; ++y) { // assumes little endian byte ordering, no swap required, may need to check this?
+					memcpy(data + 2*(get_dest_row(y0 + y, height, invert_y)*width + x0), &buf[2*y*tile_w], 2*bw);
+				}
 			}
-		}
-        _TIFFfree(buf);
-	}
-	else {
-		if (ncolors == 0) {ncolors = 4;} // 3?
-		uint32 *raster = (uint32 *)_TIFFmalloc(num_pixels() * sizeof(uint32));
-		assert(raster != NULL);
+			else {
+				if (!(is_tiled ? TIFFReadRGBATile(ttif, x0, y0, &raster.front()) : TIFFReadRGBAStrip(ttif, y0, &raster.front()))) {
+#pragma omp atomic
+					++num_errors;
+					continue;
+				}
+				unsigned const raster_h(is_tiled ? tile_h : bh); // raster origin is at the lower left of the tile or strip
 
-		if (!TIFFReadRGBAImage(tif, width, height, raster, 0)) {
-			cerr << "Error reading data from tiff file " << name << "." << endl;
-			exit(1);
-		}
-		alloc();
+				for (unsigned y = 0; y < bh; ++y) {
+					uint32 const *const src(&raster[(raster_h - y - 1)*tile_w]);
+					unsigned char *const dest(data + ncolors*(get_dest_row(y0 + y, height, invert_y)*width + x0));
 
-		for (int y = 0; y < height; ++y) {
-			for (int x = 0; x < width; ++x) {
-				unsigned const ix(y*width + x);
-				unsigned char const *d((unsigned char const *)(raster + ix));
-				for (int i = 0; i < ncolors; ++i) {data[ncolors*ix+i] = d[i];} // not correct for lum+alpha textures?
+					for (unsigned x = 0; x < bw; ++x) {
+						unsigned char const *d((unsigned char const *)(src + x));
+						for (int i = 0; i < ncolors; ++i) {dest[ncolors*x+i] = d[i];} // not correct for lum+alpha textures?
+					}
+				}
 			}
-		}
-		_TIFFfree(raster);
-	}
+		} // for bix
+		if (ttif != NULL && ttif != tif) {TIFFClose(ttif);}
+	} // omp parallel
 	TIFFClose(tif);
+
+	if (num_errors > 0) {
+		cerr << "Error reading data from tiff file " << name << "." << endl;
+		exit(1);
+	}
 #else
 	cerr << "Error loading texture image file " << name << ": tiff support has not been enabled." << endl;
 	exit(1);
@@ -687,6 +893,55 @@ void texture_t::load_tiff(int index, bool allow_diff_width_height, bool allow_tw
 }
 
 
+// returns true if this is a large image that load_jpeg() or load_tiff() will decode on multiple threads: a JPEG with restart markers at MCU row
+// boundaries or a TIFF with more than one strip or tile; other images decode on a single thread, so they're better loaded in parallel with each other
+bool texture_t::can_decode_in_parallel() const {
+
+	if (type != 0 || !is_large_image_file(name)) return 0;
+	string const fn(get_texture_file_path(name)), ext(get_file_extension(name, 0, 1));
+	bool const is_jpeg((format == 5) || (format == 7 && (ext == "jpg" || ext == "jpeg")));
+	bool const is_tiff((format == 8) || (format == 7 && (ext == "tif" || ext == "tiff")));
+
+	if (is_jpeg) {
+#ifdef ENABLE_JPEG
+		FILE *fp(fopen(fn.c_str(), "rb"));
+		if (fp == NULL) return 0; // let load_jpeg() report the error
+		vector<unsigned char> buf;
+		fseek(fp, 0, SEEK_END);
+		long const file_size(ftell(fp));
+		fseek(fp, 0, SEEK_SET);
+		if (file_size > 0) {buf.resize(file_size);}
+		bool const read_ok(!buf.empty() && fread(&buf.front(), 1, buf.size(), fp) == buf.size());
+		fclose(fp);
+		if (!read_ok) return 0;
+		jpeg_decompress_struct cinfo;
+		jpeg_error_mgr jerr;
+		cinfo.err = jpeg_std_error(&jerr);
+		jpeg_create_decompress(&cinfo);
+		jpeg_mem_src(&cinfo, &buf.front(), buf.size());
+		jpeg_read_header(&cinfo, TRUE);
+		jpeg_restart_layout_t layout;
+		bool const ret(size_t(cinfo.image_width)*cinfo.image_height >= MIN_PARALLEL_DECODE_PX && layout.parse(buf, cinfo));
+		jpeg_destroy_decompress(&cinfo);
+		return ret;
+#endif
+	}
+	else if (is_tiff) {
+#ifdef ENABLE_TIFF
+		TIFF* tif = TIFFOpen(fn.c_str(), "r");
+		if (tif == NULL) return 0; // let load_tiff() report the error
+		uint32 w(0), h(0);
+		TIFFGetField(tif, TIFFTAG_IMAGEWIDTH,  &w);
+		TIFFGetField(tif, TIFFTAG_IMAGELENGTH, &h);
+		bool const ret(size_t(w)*h >= MIN_PARALLEL_DECODE_PX && (TIFFIsTiled(tif) ? TIFFNumberOfTiles(tif) : TIFFNumberOfStrips(tif)) > 1);
+		TIFFClose(tif);
+		return ret;
+#endif
+	}
+	return 0;
+}
+
+
 void texture_t::load_dds(int index) {
 	
 #ifdef ENABLE_DDS
@@ -741,3 +996,35 @@ void texture_t::deferred_load_and_bind() {
 #endif
 	}
 }
+
+
+bool is_tex_disabled(int i);
+
+// GL-free; enabled with the "tex_load_bench" config option; loads each texture image file with one thread and with all threads
+void run_texture_load_benchmark() {
+
+	unsigned const num_threads(omp_get_max_threads());
+	double total_time[2] = {0.0, 0.0};
+	cout << "Texture load benchmark:" << endl;
+
+	for (unsigned i = 0; i < NUM_PREDEF_TEXTURES; ++i) {
+		if (def_textures[i].type != 0 || is_tex_disabled(i)) continue; // skip generated textures
+		double time[2] = {0.0, 0.0};
+		texture_t tex;
+
+		for (unsigned n = 0; n < 2; ++n) {
+			omp_set_num_threads(n ? num_threads : 1);
+			tex = def_textures[i]; // not yet loaded
+			double const start_time(omp_get_wtime());
+			tex.load(i);
+			time[n] = omp_get_wtime() - start_time;
+			tex.free_client_mem();
+		}
+		omp_set_num_threads(num_threads);
+		if (tex.defer_load()) continue; // DDS, loaded later
+		cout << tex.name << " " << tex.width << "x" << tex.height << "x" << tex.ncolors << ": " << 1000.0*time[0] << " ms with 1 thread, "
+			 << 1000.0*time[1] << " ms with " << num_threads << " threads" << endl;
+		UNROLL_2X(total_time[i_] += time[i_];)
+	}
+	cout << "Total: " << 1000.0*total_time[0] << " ms with 1 thread, " << 1000.0*total_time[1] << " ms with " << num_threads << " threads" << endl;
+}
@@ -722,9 +722,9 @@ template<typename T> void matrix_clear_2d(T **data) {
 	matrix_clear_1d(data[0]);
 }
 
-template<typename T> void remove_excess_cap(vector<T> &v) {v.shrink_to_fit();}
+template<typename T, typename A> void remove_excess_cap(vector<T, A> &v) {v.shrink_to_fit();}
 
-template<typename T> void remove_element(vector<T> &v, unsigned &ix) {
+template<typename T, typename A> void remove_element(vector<T, A> &v, unsigned &ix) {
 	swap(v[ix], v.back());
 	v.pop_back();
 	--ix;
@@ -8,6 +8,7 @@
 #include "shaders.h"
 #include "binary_file_io.h"
 #include <functional>
+#include <cstring>
 
 using std::cerr;
 
@@ -25,7 +26,7 @@ float const FLASHLIGHT_RAD   = 4.0;
 colorRGBA const flashlight_colors[2] = {colorRGBA(1.0, 0.8, 0.5, 1.0), colorRGBA(0.8, 0.8, 1.0, 1.0)}; // incandescent, LED
 
 
-bool using_lightmap(0), lm_alloc(0), has_dl_sources(0), has_spotlights(0), has_line_lights(0), use_dense_voxels(0), has_indir_lighting(0), dl_smap_enabled(0), flashlight_on(0);
+bool using_lightmap(0), lm_alloc(0), has_dl_sources(0), has_spotlights(0), has_line_lights(0), use_dense_voxels(0), has_indir_lighting(0), dl_smap_enabled(0), flashlight_on(0), compact_lightmap(0);
 unsigned dl_tid(0), elem_tid(0), gb_tid(0), DL_GRID_BS(0), flashlight_color_id(0);
 float DZ_VAL2(0.0), DZ_VAL_INV2(0.0);
 float czmin0(0.0), lm_dz_adj(0.0), dlight_add_thresh(0.0);
@@ -38,6 +39,7 @@ llv_vect local_light_volumes;
 indir_dlight_group_manager_t indir_dlight_group_manager;
 
 
+extern bool smoke_bench;
 extern int animate2, display_mode, frame_counter, camera_coll_id, scrolling, read_light_files[], write_light_files[];
 extern unsigned create_voxel_landscape;
 extern float czmin, czmax, fticks, zbottom, ztop, XY_SCENE_SIZE, FAR_CLIP, CAMERA_RADIUS, indir_light_exp, light_int_scale[], force_czmin, force_czmax;
@@ -201,39 +203,172 @@ void lmcell::set_outside_colors() {
 }
 
 
+// *** lightmap cell packing ***
+
+unsigned short float_to_half(float v) { // round to nearest even; clamps to the max finite value and flushes denormals to zero
+
+	unsigned f;
+	memcpy(&f, &v, sizeof(unsigned));
+	unsigned const sign((f >> 16) & 0x8000), mant(f & 0x007FFFFF);
+	int const exp(int((f >> 23) & 0xFF) - 127 + 15);
+	if (exp <= 0 ) return (unsigned short)sign; // zero or too small
+	if (exp >= 31) return (unsigned short)(sign | 0x7BFF); // too large, Inf, or NaN
+	unsigned h(sign | (exp << 10) | (mant >> 13));
+	if ((mant & 0x1FFF) > 0x1000 || ((mant & 0x1FFF) == 0x1000 && (h & 1))) {++h;} // may carry into the exponent
+	if ((h & 0x7FFF) >= 0x7C00) {h = (sign | 0x7BFF);}
+	return (unsigned short)h;
+}
+
+float half_to_float(unsigned short h) {
+
+	unsigned const exp((h >> 10) & 0x1F);
+	unsigned const f(((h & 0x8000) << 16) | (exp ? (((exp + 127 - 15) << 23) | ((h & 0x3FF) << 13)) : 0)); // denormals aren't generated above
+	float v;
+	memcpy(&v, &f, sizeof(float));
+	return v;
+}
+
+unsigned pack_rgb9e5(float const c[3]) { // negative values are clamped to zero
+
+	float const max_val(65408.0); // (511/512)*2^16
+	float rc[3];
+	UNROLL_3X(rc[i_] = max(0.0f, min(max_val, c[i_]));) // also removes NaNs
+	float const maxc(max(rc[0], max(rc[1], rc[2])));
+	if (maxc == 0.0) return 0;
+	int exp(max(-16, int(floor(log2(maxc)))) + 16);
+	float scale(ldexp(1.0f, (exp - 24)));
+	if (int(floor(maxc/scale + 0.5f)) == 512) {scale *= 2.0; ++exp;}
+	unsigned v(unsigned(exp) << 27);
+	UNROLL_3X(v |= (min(511U, unsigned(floor(rc[i_]/scale + 0.5f))) << (9*i_));)
+	return v;
+}
+
+void unpack_rgb9e5(unsigned v, float c[3]) {
+	float const scale(ldexp(1.0f, (int(v >> 27) - 24)));
+	UNROLL_3X(c[i_] = ((v >> (9*i_)) & 0x1FF)*scale;)
+}
+
+void lmcell_packed::pack(lmcell const &c) {
+
+	sc = pack_rgb9e5(c.sc);
+	gc = pack_rgb9e5(c.gc);
+	lc = pack_rgb9e5(c.lc);
+	sv = float_to_half(c.sv);
+	gv = float_to_half(c.gv);
+	UNROLL_3X(pflow[i_] = c.pflow[i_];)
+	pad = 0;
+}
+
+void lmcell_packed::unpack(lmcell &c) const {
+
+	unpack_rgb9e5(sc, c.sc);
+	unpack_rgb9e5(gc, c.gc);
+	unpack_rgb9e5(lc, c.lc);
+	c.sv = half_to_float(sv);
+	c.gv = half_to_float(gv);
+	UNROLL_3X(c.pflow[i_] = pflow[i_];)
+}
+
+
+// *** lmap_manager_t ***
+
 inline bool is_inside_lmap(int x, int y, int z) {return (z >= 0 && z < MESH_SIZE[2] && !point_outside_mesh(x, y));}
-bool lmap_manager_t::is_valid_cell(int x, int y, int z) const {return (is_inside_lmap(x, y, z) && vlmap[y][x] != NULL);}
+bool lmap_manager_t::is_valid_cell(int x, int y, int z) const {return (is_inside_lmap(x, y, z) && is_valid_column(x, y));}
 
 // Note: only intended to work in ground mode where sizes are MESH_X_SIZE and MESH_Y_SIZE
-lmcell *lmap_manager_t::get_lmcell_round_down(point const &p) { // round down
+lmcell *lmap_manager_t::get_lmcell_round_down_mut(point const &p) { // round down
 	int const x(get_xpos_round_down(p.x)), y(get_ypos_round_down(p.y)), z(get_zpos(p.z));
-	return (is_valid_cell(x, y, z) ? &vlmap[y][x][z] : NULL);
+	return (is_valid_cell(x, y, z) ? &get_lmcell_mut(x, y, z) : NULL);
 }
-lmcell *lmap_manager_t::get_lmcell(point const &p) { // round to center
+lmcell *lmap_manager_t::get_lmcell_mut(point const &p) { // round to center
 	int const x(get_xpos(p.x)), y(get_ypos(p.y)), z(get_zpos(p.z));
-	return (is_valid_cell(x, y, z) ? &vlmap[y][x][z] : NULL);
+	return (is_valid_cell(x, y, z) ? &get_lmcell_mut(x, y, z) : NULL);
+}
+
+lmcell const &lmap_manager_t::get_packed_lmcell(brick_t const &b, unsigned cix, lmcell &tmp) const {
+
+	assert(b.state == BRICK_PACKED || b.state == BRICK_UNIFORM);
+	packed_cells[b.packed_ix + ((b.state == BRICK_UNIFORM) ? 0 : cix)].unpack(tmp);
+	return tmp;
+}
+
+// Note: not thread safe, except for different bricks; see unpack_all()
+void lmap_manager_t::unpack_brick(brick_t &b, unsigned ncells) {
+
+	assert(b.state == BRICK_PACKED || b.state == BRICK_UNIFORM);
+	b.cells.resize(ncells);
+	bool const uniform(b.state == BRICK_UNIFORM);
+	for (unsigned i = 0; i < ncells; ++i) {packed_cells[b.packed_ix + (uniform ? 0 : i)].unpack(b.cells[i]);}
+	b.state = BRICK_DENSE; // the packed cells are left in place until the next compact() call
+}
+
+// called before launching threads that write to the lightmap, since get_lmcell_mut() can't unpack bricks from multiple threads
+void lmap_manager_t::unpack_all() {
+
+	if (packed_cells.empty()) return; // never compacted, all bricks are dense
+#pragma omp parallel for schedule(static)
+	for (int i = 0; i < (int)bricks.size(); ++i) {
+		if (bricks[i].state == BRICK_PACKED || bricks[i].state == BRICK_UNIFORM) {unpack_brick(bricks[i], get_num_brick_cells(i));}
+	}
+	packed_vect_t().swap(packed_cells);
+}
+
+void lmap_manager_t::clear_cells() { // column headers are not cleared
+
+	bricks.clear();
+	brick_cols.clear();
+	packed_cells.clear();
+	num_cells = 0;
+	allocated = 0;
+}
+
+void lmap_manager_t::alloc_bricks(lmcell const &init_lmcell) {
+
+	bxsize = (lm_xsize + LMAP_BRICK_SZ - 1) >> LMAP_BRICK_BITS;
+	bysize = (lm_ysize + LMAP_BRICK_SZ - 1) >> LMAP_BRICK_BITS;
+	bzsize = (lm_zsize + LMAP_BRICK_SZ - 1) >> LMAP_BRICK_BITS;
+	bricks.clear();
+	brick_cols.clear();
+	packed_cells.clear();
+	bricks.resize(bxsize*bysize*bzsize);
+	brick_cols.resize(bxsize*bysize);
+	num_cells = 0;
+
+	for (auto i = brick_cols.begin(); i != brick_cols.end(); ++i) {
+		for (unsigned n = 0; n < LMAP_BRICK_SZ*LMAP_BRICK_SZ; ++n) {i->col_slot[n] = NO_COL;}
+		i->num_cols = 0;
+	}
+	for (unsigned y = 0; y < lm_ysize; ++y) { // assign a slot to each nonempty column within its bricks
+		for (unsigned x = 0; x < lm_xsize; ++x) {
+			if (!is_valid_column(x, y)) continue;
+			num_cells += lm_zsize;
+			unsigned const m(LMAP_BRICK_SZ-1);
+			brick_col_t &bc(brick_cols[get_brick_col_ix(x, y)]);
+			bc.col_slot[((y & m) << LMAP_BRICK_BITS) | (x & m)] = bc.num_cols++;
+		}
+	}
+	for (unsigned i = 0; i < bricks.size(); ++i) { // only allocate cells for the nonempty columns of each brick
+		unsigned const ncells(get_num_brick_cells(i));
+		if (ncells == 0) continue; // empty
+		brick_t &b(bricks[i]);
+		b.cells.assign(ncells, init_lmcell);
+		b.state = BRICK_DENSE;
+	}
+	allocated = 1;
 }
 
 template<typename T> void lmap_manager_t::alloc(unsigned nbins, unsigned xsize, unsigned ysize, unsigned zsize, T **nonempty_bins, lmcell const &init_lmcell) {
 
 	lm_xsize = xsize; lm_ysize = ysize; lm_zsize = zsize;
-	if (vlmap == NULL) {matrix_gen_2d(vlmap, lm_xsize, lm_ysize);} // create column headers once
-	vldata_alloc.resize(max(nbins, 1U), init_lmcell); // make size at least 1, even if there are no bins, so we can test on emptiness
-	unsigned cur_v(0);
+	col_valid.resize(lm_xsize*lm_ysize);
 
-	// initialize light volume
 	for (unsigned i = 0; i < lm_ysize; ++i) {
 		for (unsigned j = 0; j < lm_xsize; ++j) {
-			if (nonempty_bins != nullptr && !nonempty_bins[i][j]) { // nonempty_bins is used for sparse mode
-				vlmap[i][j] = NULL;
-				continue;
-			}
-			assert(cur_v + lm_zsize <= vldata_alloc.size());
-			vlmap[i][j] = &vldata_alloc[cur_v];
-			cur_v      += lm_zsize;
+			col_valid[i*lm_xsize + j] = (nonempty_bins == nullptr || nonempty_bins[i][j]); // nonempty_bins is used for sparse mode
 		}
 	}
-	assert(cur_v == nbins);
+	alloc_bricks(init_lmcell);
+	assert(num_cells == nbins);
 }
 
 template void lmap_manager_t::alloc(unsigned nbins, unsigned xsize, unsigned ysize, unsigned zsize, unsigned char **nonempty_bins, lmcell const &init_lmcell); // explicit instantiation
@@ -241,9 +376,11 @@ template void lmap_manager_t::alloc(unsigned nbins, unsigned xsize, unsigned ysi
 
 void lmap_manager_t::init_from(lmap_manager_t const &src) {
 
-	//assert(!is_allocated());
-	//clear_cells(); // probably unnecessary
-	alloc(src.vldata_alloc.size(), src.lm_xsize, src.lm_ysize, src.lm_zsize, src.vlmap, lmcell());
+	lm_xsize  = src.lm_xsize;
+	lm_ysize  = src.lm_ysize;
+	lm_zsize  = src.lm_zsize;
+	col_valid = src.col_valid;
+	alloc_bricks(lmcell());
 	copy_data(src);
 }
 
@@ -251,26 +388,126 @@ void lmap_manager_t::init_from(lmap_manager_t const &src) {
 // *this = blend_weight*dest + (1.0 - blend_weight)*(*this)
 void lmap_manager_t::copy_data(lmap_manager_t const &src, float blend_weight) {
 
-	assert(vlmap && src.vlmap);
+	assert(is_allocated() && src.is_allocated());
 	assert(src.lm_xsize == lm_xsize && src.lm_ysize == lm_ysize && src.lm_zsize == lm_zsize);
-	assert(src.vldata_alloc.size() == vldata_alloc.size());
+	assert(src.bricks.size() == bricks.size() && src.col_valid == col_valid); // same brick layout
 	assert(blend_weight >= 0.0);
 	if (blend_weight == 0.0) return; // keep existing dest
 
-	if (blend_weight == 1.0) {
-		vldata_alloc = src.vldata_alloc; // deep copy all lmcell data
-		return;
+#pragma omp parallel for schedule(static)
+	for (int i = 0; i < (int)bricks.size(); ++i) {
+		brick_t const &sb(src.bricks[i]);
+		brick_t &db(bricks[i]);
+		if (sb.state == BRICK_EMPTY) {assert(db.state == BRICK_EMPTY); continue;}
+		assert(db.state != BRICK_EMPTY);
+		unsigned const ncells(get_num_brick_cells(i));
+		if (db.state != BRICK_DENSE) {unpack_brick(db, ncells);} // different brick per thread, so this is safe
+		lmcell tmp;
+		
+		for (unsigned n = 0; n < ncells; ++n) {
+			lmcell const &lmc((sb.state == BRICK_DENSE) ? sb.cells[n] : src.get_packed_lmcell(sb, n, tmp));
+			if (blend_weight == 1.0) {db.cells[n] = lmc;} // copy all lmcell data
+			else {db.cells[n].mix_lighting_with(lmc, blend_weight);}
+		}
 	}
-	for (unsigned i = 0; i < lm_ysize; ++i) { // openmp?
-		for (unsigned j = 0; j < lm_xsize; ++j) {
-			if (!vlmap[i][j]) {assert(!src.vlmap[i][j]); continue;}
-			assert(src.vlmap[i][j]);
-			
-			for (unsigned z = 0; z < lm_zsize; ++z) {
-				vlmap[i][j][z].mix_lighting_with(src.vlmap[i][j][z], blend_weight);
-			}
+}
+
+// pack all bricks, and collapse bricks where all used cells are equal after packing into a single shared cell
+void lmap_manager_t::compact() {
+
+	if (!is_allocated()) return;
+	vector<packed_vect_t> row_cells(bysize);
+
+#pragma omp parallel for schedule(dynamic)
+	for (int by = 0; by < (int)bysize; ++by) {
+		packed_vect_t &rc(row_cells[by]);
+		lmcell_packed cells[LMAP_BRICK_CELLS];
+
+		for (unsigned bx = 0; bx < bxsize; ++bx) {
+			for (unsigned bz = 0; bz < bzsize; ++bz) {
+				brick_t &b(bricks[(by*bxsize + bx)*bzsize + bz]);
+				if (b.state == BRICK_EMPTY) continue;
+				unsigned const ncells(brick_cols[by*bxsize + bx].get_num_cells());
+				int first_used(-1);
+				bool uniform(1);
+
+				for (unsigned i = 0; i < ncells; ++i) {
+					if (b.state == BRICK_DENSE) {cells[i].pack(b.cells[i]);} else {cells[i] = packed_cells[b.packed_ix + ((b.state == BRICK_UNIFORM) ? 0 : i)];}
+					if ((bz << LMAP_BRICK_BITS) + (i & (LMAP_BRICK_SZ-1)) >= lm_zsize) continue; // cells above the top of the lightmap don't affect uniformity
+					if (first_used < 0) {first_used = i;} else if (uniform && !(cells[i] == cells[first_used])) {uniform = 0;}
+				}
+				assert(first_used >= 0); // nonempty bricks must contain at least one used cell
+				b.packed_ix = rc.size(); // relative to the row for now
+				b.cells.clear();
+				b.cells.shrink_to_fit();
+
+				if (uniform) {
+					rc.push_back(cells[first_used]);
+					b.state = BRICK_UNIFORM;
+				}
+				else {
+					rc.insert(rc.end(), cells, cells+ncells);
+					b.state = BRICK_PACKED;
+				}
+			} // for bz
+		} // for bx
+	} // for by
+	size_t num_packed(0);
+	for (auto i = row_cells.begin(); i != row_cells.end(); ++i) {num_packed += i->size();}
+	packed_vect_t new_cells;
+	new_cells.reserve(num_packed);
+
+	for (unsigned by = 0; by < bysize; ++by) { // concatenate rows
+		unsigned const row_start(new_cells.size());
+
+		for (unsigned i = by*bxsize*bzsize; i < (by+1)*bxsize*bzsize; ++i) {
+			if (bricks[i].state != BRICK_EMPTY) {bricks[i].packed_ix += row_start;}
 		}
+		new_cells.insert(new_cells.end(), row_cells[by].begin(), row_cells[by].end());
+		packed_vect_t().swap(row_cells[by]);
 	}
+	packed_cells.swap(new_cells);
+}
+
+size_t lmap_manager_t::get_mem_usage() const {
+
+	size_t mem(bricks.capacity()*sizeof(brick_t) + brick_cols.capacity()*sizeof(brick_col_t) + packed_cells.capacity()*sizeof(lmcell_packed) + col_valid.capacity());
+	for (unsigned i = 0; i < bricks.size(); ++i) {if (bricks[i].state == BRICK_DENSE) {mem += get_num_brick_cells(i)*sizeof(lmcell);}}
+	return mem;
+}
+
+void lmap_manager_t::print_stats(bool show_lookup_time) const {
+
+	unsigned counts[4] = {0};
+	for (auto i = bricks.begin(); i != bricks.end(); ++i) {++counts[i->state];}
+	cout << "Lightmap cells: " << num_cells << ", bricks: " << counts[BRICK_DENSE] << " dense, " << counts[BRICK_PACKED] << " packed, " << counts[BRICK_UNIFORM]
+		 << " uniform, " << counts[BRICK_EMPTY] << " empty, mem: " << get_mem_usage()/1024 << "KB (unbricked: " << num_cells*sizeof(lmcell)/1024 << "KB)";
+
+	if (show_lookup_time && num_cells > 0) { // time random read-only lookups of valid cells
+		unsigned const num_lookups(1 << 22);
+		vector<unsigned> cols;
+		for (unsigned i = 0; i < col_valid.size(); ++i) {if (col_valid[i]) {cols.push_back(i);}}
+		vector<unsigned> lookups(3*num_lookups);
+		rand_gen_t rgen;
+
+		for (unsigned i = 0; i < num_lookups; ++i) {
+			unsigned const col(cols[rgen.rand()%cols.size()]);
+			lookups[3*i+0] = col%lm_xsize;
+			lookups[3*i+1] = col/lm_xsize;
+			lookups[3*i+2] = rgen.rand()%lm_zsize;
+		}
+		int const start_time(GET_TIME_MS());
+		float sum(0.0); // prevent the compiler from removing the lookups
+		lmcell tmp;
+
+		for (unsigned i = 0; i < num_lookups; ++i) {
+			lmcell const &lmc(get_lmcell(lookups[3*i+0], lookups[3*i+1], lookups[3*i+2], tmp));
+			sum += lmc.sv + lmc.lc[0];
+		}
+		float const elapsed_ms(GET_TIME_MS() - start_time);
+		cout << ", lookup: " << 1.0E6*elapsed_ms/num_lookups << "ns" << ((sum < 0.0) ? " " : ""); // sum is never negative
+	}
+	cout << endl;
 }
 
 
@@ -497,9 +734,9 @@ void create_dlight_volumes() {indir_dlight_group_manager.create_needed_llvols();
 bool has_fixed_cobjs(int x, int y) {
 
 	assert(!point_outside_mesh(x, y));
-	vector<int> const &cvals(v_collision_matrix[y][x].cvals);
+	auto const &cvals(v_collision_matrix[y][x].cvals);
 
-	for (vector<int>::const_iterator i = cvals.begin(); i != cvals.end(); ++i) {
+	for (auto i = cvals.begin(); i != cvals.end(); ++i) {
 		if (coll_objects[*i].fixed && coll_objects[*i].status == COLL_STATIC) {return 1;}
 	}
 	return 0;
@@ -521,6 +758,7 @@ void clear_lightmap() {
 	if (!lmap_manager.is_allocated()) return;
 	kill_current_raytrace_threads(); // kill raytrace threads and wait for them to finish since they are using the current lightmap
 	lmap_manager.clear_cells();
+	reset_smoke_field(); // flow values come from the lightmap
 	using_lightmap = 0;
 	lm_alloc       = 0;
 	czmin0         = czmin;
@@ -530,8 +768,8 @@ void clear_lightmap() {
 void calc_flow_profile(r_profile flow_prof[3], int i, int j, bool proc_cobjs, float zstep) {
 
 	assert(zstep > 0.0);
-	lmcell *vldata(lmap_manager.get_column(j, i));
-	if (vldata == NULL) return;
+	lmap_column_t const vldata(lmap_manager.get_column_mut(j, i));
+	if (!vldata) return;
 	float const bbz[2][2] = {{get_xval(j), get_xval(j+1)}, {get_yval(i), get_yval(i+1)}}; // X x Y
 	vector<pair<float, unsigned> > cobj_z;
 
@@ -720,7 +958,7 @@ void build_lightmap(bool verbose) {
 
 			for (int y = bnds[1][0]; y <= bnds[1][1]; ++y) {
 				for (int x = bnds[0][0]; x <= bnds[0][1]; ++x) {
-					assert(lmap_manager.get_column(x, y));
+					assert(lmap_manager.is_valid_column(x, y));
 					float const xv(get_xval(x)), yv(get_yval(y));
 
 					for (int z = bnds[2][0]; z <= bnds[2][1]; ++z) {
@@ -737,7 +975,7 @@ void build_lightmap(bool verbose) {
 						point const lpos_ext(lpos + HALF_DXY*(p - lpos).get_norm()); // extend away from light to account for light fixtures
 						if ((last_cobj >= 0 && coll_objects[last_cobj].line_intersect(lpos_ext, p)) ||
 							check_coll_line(p, lpos_ext, last_cobj, cobj, 1, 3)) {continue;}
-						lmcell &lmc(lmap_manager.get_lmcell(x, y, z));
+						lmcell &lmc(lmap_manager.get_lmcell_mut(x, y, z));
 						UNROLL_3X(lmc.lc[i_] = min(1.0f, (lmc.lc[i_] + cscale*lcolor[i_]));) // what about diffuse/normals?
 					} // for z
 				} // for x
@@ -756,9 +994,21 @@ void build_lightmap(bool verbose) {
 			}
 		}
 	}
+	if (nbins > 0 && compact_lightmap) {
+		if (lmap_has_runtime_updates()) {
+			cout << "Lightmap compaction is disabled because lighting is updated at runtime" << endl;
+		}
+		else {
+			if (verbose) {lmap_manager.print_stats(1);}
+			lmap_manager.compact();
+			if (verbose) {PRINT_TIME(" Lightmap Compaction"); lmap_manager.print_stats(1);}
+		}
+	}
+	else if (verbose && nbins > 0) {lmap_manager.print_stats(0);}
 	reset_cobj_counters();
 	matrix_delete_2d(need_lmcell);
 	if (!scrolling) {PRINT_TIME(" Lighting Total");}
+	if (smoke_bench && nbins > 0) {run_smoke_benchmark();}
 }
 
 
@@ -1208,8 +1458,9 @@ void get_indir_light(colorRGBA &a, point const &p) { // used for particle clouds
 	if (!point_outside_mesh(x, y) && p.z > czmin0) { // inside the mesh range and above the lowest cobj
 		float val(get_voxel_terrain_ao_lighting_val(p));
 		
-		if (using_lightmap && p.z < czmax && lmap_manager.get_column(x, y) != NULL) { // not above all collision objects and not empty cell
-			lmap_manager.get_lmcell(x, y, z).get_final_color(cscale, 0.5, val);
+		if (using_lightmap && p.z < czmax && lmap_manager.is_valid_column(x, y)) { // not above all collision objects and not empty cell
+			lmcell tmp;
+			lmap_manager.get_lmcell(x, y, z, tmp).get_final_color(cscale, 0.5, val);
 		}
 		else if (val < 1.0) {
 			cscale *= val;
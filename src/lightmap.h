@@ -7,6 +7,7 @@
 
 #include "3DWorld.h"
 #include "trigger.h"
+#include "allocators.h"
 
 extern int MESH_X_SIZE, MESH_Y_SIZE, MESH_SIZE[3];
 
@@ -28,12 +29,12 @@ protected:
 
 unsigned const lmcell_ltype_off[NUM_LIGHTING_TYPES] = {0, 4, 8, 0}; // sky, global, local, sky cobj accum, dynamic
 
-struct lmcell { // size = 52
+struct lmcell { // size = 48
 
-	float sc[3], sv, gc[3], gv, lc[3], smoke; // *c[3]: RGB sky, global, local colors
+	float sc[3], sv, gc[3], gv, lc[3]; // *c[3]: RGB sky, global, local colors
 	unsigned char pflow[3]; // flow: x, y, z
 	
-	lmcell() : sv(0.0), gv(0.0), smoke(0.0) {UNROLL_3X(sc[i_] = gc[i_] = lc[i_] = 0.0; pflow[i_] = 255;)}
+	lmcell() : sv(0.0), gv(0.0) {UNROLL_3X(sc[i_] = gc[i_] = lc[i_] = 0.0; pflow[i_] = 255;)}
 	float       *get_offset(int ltype)       {return (sc + lmcell_ltype_off[ltype]);}
 	float const *get_offset(int ltype) const {return (sc + lmcell_ltype_off[ltype]);}
 	static unsigned get_dsz(int ltype)       {return ((ltype == LIGHTING_LOCAL) ? 3 : 4);}
@@ -43,37 +44,130 @@ struct lmcell { // size = 52
 };
 
 
+struct lmcell_packed { // size = 20; lossy: colors are RGB9E5 shared exponent, weights are half floats
+
+	unsigned sc, gc, lc;
+	unsigned short sv, gv;
+	unsigned char pflow[3], pad;
+
+	void pack(lmcell const &c);
+	void unpack(lmcell &c) const;
+	bool operator==(lmcell_packed const &p) const {return (sc == p.sc && gc == p.gc && lc == p.lc && sv == p.sv && gv == p.gv &&
+		pflow[0] == p.pflow[0] && pflow[1] == p.pflow[1] && pflow[2] == p.pflow[2]);}
+};
+
+
+unsigned const LMAP_BRICK_BITS  = 2; // 4x4x4 cells
+unsigned const LMAP_BRICK_SZ    = (1 << LMAP_BRICK_BITS);
+unsigned const LMAP_BRICK_CELLS = LMAP_BRICK_SZ*LMAP_BRICK_SZ*LMAP_BRICK_SZ;
+
+class lmap_manager_t;
+
+class lmap_column_t { // mutable view of one x,y column; evaluates to false for empty columns
+	lmap_manager_t *lmgr;
+	int x, y;
+public:
+	lmap_column_t(lmap_manager_t *lmgr_=nullptr, int x_=0, int y_=0) : lmgr(lmgr_), x(x_), y(y_) {}
+	explicit operator bool() const {return (lmgr != nullptr);}
+	lmcell &operator[](int z) const;
+};
+
+class lmap_ccolumn_t { // read-only view of one x,y column; cells of dense bricks are returned by reference, packed cells are unpacked into tmp
+	lmap_manager_t const *lmgr;
+	int x, y;
+	mutable lmcell tmp; // only valid until the next operator[] call
+public:
+	lmap_ccolumn_t(lmap_manager_t const *lmgr_=nullptr, int x_=0, int y_=0) : lmgr(lmgr_), x(x_), y(y_) {}
+	explicit operator bool() const {return (lmgr != nullptr);}
+	lmcell const &operator[](int z) const;
+};
+
+
+// sparse brick storage: bricks with no nonempty columns are not allocated, and each brick only stores cells for its nonempty columns;
+// after compact(), bricks are stored packed, and bricks where all cells are equal after packing share a single cell; mutable access unpacks the brick again
 class lmap_manager_t {
 
-	vector<lmcell> vldata_alloc;
-	unsigned lm_xsize, lm_ysize, lm_zsize;
-	lmcell ***vlmap; // y, x, z (size is determined by {MESH_Y_SIZE, MESH_X_SIZE, MESH_Z_SIZE}
+	enum {BRICK_EMPTY=0, BRICK_DENSE, BRICK_PACKED, BRICK_UNIFORM};
+	static unsigned char const NO_COL = 255;
+
+	struct brick_t {
+		tracked_vector<lmcell, MEM_CAT_LIGHTMAP> cells; // full precision, when dense
+		unsigned packed_ix; // index into packed_cells, when packed or uniform
+		unsigned char state;
+		brick_t() : packed_ix(0), state(BRICK_EMPTY) {}
+	};
+	struct brick_col_t { // shared by all bricks stacked in z at this x,y
+		unsigned char col_slot[LMAP_BRICK_SZ*LMAP_BRICK_SZ]; // slot of each x,y column's z run within the brick, or NO_COL if the column is empty
+		unsigned char num_cols;
+		unsigned get_num_cells() const {return num_cols*LMAP_BRICK_SZ;}
+	};
+	typedef tracked_vector<lmcell_packed, MEM_CAT_LIGHTMAP> packed_vect_t;
+
+	tracked_vector<brick_t, MEM_CAT_LIGHTMAP> bricks; // y, x, z
+	tracked_vector<brick_col_t, MEM_CAT_LIGHTMAP> brick_cols; // y, x
+	packed_vect_t packed_cells;
+	tracked_vector<unsigned char, MEM_CAT_LIGHTMAP> col_valid; // y, x
+	unsigned lm_xsize, lm_ysize, lm_zsize, bxsize, bysize, bzsize, num_cells;
+	bool allocated;
 
 	lmap_manager_t(lmap_manager_t const &); // forbidden
 	void operator=(lmap_manager_t const &); // forbidden
 
+	unsigned get_brick_col_ix(int x, int y) const {return ((unsigned(y) >> LMAP_BRICK_BITS)*bxsize + (unsigned(x) >> LMAP_BRICK_BITS));}
+	unsigned get_brick_ix(int x, int y, int z) const {return (get_brick_col_ix(x, y)*bzsize + (unsigned(z) >> LMAP_BRICK_BITS));}
+	unsigned get_cell_ix(int x, int y, int z) const { // index of the cell within its brick
+		unsigned const m(LMAP_BRICK_SZ-1);
+		unsigned const slot(brick_cols[get_brick_col_ix(x, y)].col_slot[((unsigned(y) & m) << LMAP_BRICK_BITS) | (unsigned(x) & m)]);
+		return ((slot << LMAP_BRICK_BITS) | (unsigned(z) & m));
+	}
+	unsigned get_num_brick_cells(unsigned bix) const {return brick_cols[bix/bzsize].get_num_cells();}
+	void alloc_bricks(lmcell const &init_lmcell);
+	void unpack_brick(brick_t &b, unsigned ncells);
+	lmcell const &get_packed_lmcell(brick_t const &b, unsigned cix, lmcell &tmp) const;
+
 public:
 	bool was_updated;
 	cube_t update_bcube;
 
-	lmap_manager_t() : lm_xsize(0), lm_ysize(0), lm_zsize(0), vlmap(NULL), was_updated(0) {update_bcube.set_to_zeros();}
-	void clear_cells() {vldata_alloc.clear();} // vlmap matrix headers are not cleared
-	bool is_allocated() const {return (vlmap != NULL && !vldata_alloc.empty());}
-	size_t size() const {return vldata_alloc.size();}
+	lmap_manager_t() : lm_xsize(0), lm_ysize(0), lm_zsize(0), bxsize(0), bysize(0), bzsize(0), num_cells(0), allocated(0), was_updated(0) {update_bcube.set_to_zeros();}
+	void clear_cells();
+	bool is_allocated() const {return allocated;}
+	size_t size() const {return num_cells;}
 	bool read_data_from_file(char const *const fn, int ltype);
 	bool write_data_to_file(char const *const fn, int ltype) const;
 	void clear_lighting_values(int ltype);
 	bool is_valid_cell(int x, int y, int z) const;
-	lmcell const *get_column(int x, int y) const {return vlmap[y][x];} // Note: no bounds checking
-	lmcell *get_column(int x, int y) {return vlmap[y][x];} // Note: no bounds checking
-	lmcell &get_lmcell(int x, int y, int z) {return get_column(x, y)[z];} // Note: no bounds checking
-	lmcell *get_lmcell_round_down(point const &p);
-	lmcell *get_lmcell(point const &p);
+	bool is_valid_column(int x, int y) const {return (col_valid[y*lm_xsize + x] != 0);} // Note: no bounds checking
+	// read-only access doesn't unpack bricks; use the *_mut() versions to modify cells
+	lmap_ccolumn_t get_column(int x, int y) const {return lmap_ccolumn_t((is_valid_column(x, y) ? this : nullptr), x, y);} // Note: no bounds checking
+	lmap_column_t  get_column_mut(int x, int y)   {return lmap_column_t ((is_valid_column(x, y) ? this : nullptr), x, y);} // Note: no bounds checking
+	lmcell const &get_lmcell(int x, int y, int z, lmcell &tmp) const { // Note: no bounds checking; tmp is only used for packed bricks
+		unsigned const bix(get_brick_ix(x, y, z));
+		brick_t const &b(bricks[bix]);
+		if (b.state == BRICK_DENSE) {return b.cells[get_cell_ix(x, y, z)];}
+		return get_packed_lmcell(b, get_cell_ix(x, y, z), tmp);
+	}
+	// Note: unpacking a brick is not thread safe; unpack_all() must be called before any multithreaded writes
+	lmcell &get_lmcell_mut(int x, int y, int z) { // Note: no bounds checking
+		unsigned const bix(get_brick_ix(x, y, z));
+		brick_t &b(bricks[bix]);
+		if (b.state != BRICK_DENSE) {unpack_brick(b, get_num_brick_cells(bix));}
+		return b.cells[get_cell_ix(x, y, z)];
+	}
+	lmcell *get_lmcell_round_down_mut(point const &p);
+	lmcell *get_lmcell_mut(point const &p);
 	template<typename T> void alloc(unsigned nbins, unsigned xsize, unsigned ysize, unsigned zsize, T **nonempty_bins, lmcell const &init_lmcell);
 	void init_from(lmap_manager_t const &src);
 	void copy_data(lmap_manager_t const &src, float blend_weight=1.0);
+	void compact();
+	void unpack_all();
+	size_t get_mem_usage() const;
+	void print_stats(bool show_lookup_time) const;
 };
 
+inline lmcell &lmap_column_t::operator[](int z) const {return lmgr->get_lmcell_mut(x, y, z);}
+inline lmcell const &lmap_ccolumn_t::operator[](int z) const {return lmgr->get_lmcell(x, y, z, tmp);}
+
 
 struct lmcell_local { // size = 12 (must be packed)
 	float lc[3];
@@ -308,6 +402,11 @@ public:
 
 void check_for_lighting_finished();
 void compute_ray_trace_lighting(unsigned ltype, bool verbose);
+bool lmap_has_runtime_updates();
+
+// smoke.cpp
+void reset_smoke_field();
+void run_smoke_benchmark();
 
 
 #endif
@@ -12,22 +12,33 @@
 #include "lightmap.h" // for lmap_manager_t
 #include <fstream>
 #include <queue>
+#include <unordered_map>
+#include <omp.h>
 
 bool const ENABLE_BUMP_MAPS  = 1;
 bool const ENABLE_SPEC_MAPS  = 1;
 bool const ENABLE_INTER_REFLECTIONS = 1;
 unsigned const MAGIC_NUMBER  = 42987143; // arbitrary file signature
 unsigned const BLOCK_SIZE    = 32768; // in vertex indices
+unsigned const MAX_SIMP_LODS = 8;
+unsigned const SIMP_MIN_TRIS = 256;   // don't simplify blocks with fewer triangles
+float const SIMP_NORMAL_WEIGHT = 1.0; // simplification attribute error weights, relative to squared edge length
+float const SIMP_TC_WEIGHT     = 1.0;
+float const SIMP_MAX_FLIP_DP   = 0.2; // min dot product of old and new triangle normals for a collapse
+float const SIMP_MIN_LOD_RATIO = 0.9; // min triangle reduction for a partial last LOD level
+float const SIMP_BORDER_WEIGHT = 10.0; // penalty quadric weights for moving border and attribute seam vertices off their edges
+float const SIMP_SEAM_WEIGHT   = 4.0;
 
 bool model_calc_tan_vect(1); // slower and more memory but sometimes better quality/smoother transitions
+bool model_simplify_bench(0);
 
 extern bool group_back_face_cull, enable_model3d_tex_comp, disable_shader_effects, texture_alpha_in_red_comp, use_model2d_tex_mipmaps, enable_model3d_bump_maps;
 extern bool two_sided_lighting, have_indir_smoke_tex, use_core_context, model3d_wn_normal, invert_model_nmap_bscale, use_z_prepass, all_model3d_ref_update;
 extern bool use_interior_cube_map_refl, enable_model3d_custom_mipmaps, enable_tt_model_indir, no_subdiv_model, auto_calc_tt_model_zvals, use_model_lod_blocks;
 extern bool flatten_tt_mesh_under_models, no_store_model_textures_in_memory, disable_model_textures;
-extern unsigned shadow_map_sz, reflection_tid;
+extern unsigned shadow_map_sz, reflection_tid, model_simplify_levels;
 extern int display_mode;
-extern float model3d_alpha_thresh, model3d_texture_anisotropy, model_triplanar_tc_scale, model_mat_lod_thresh, cobj_z_bias, light_int_scale[];
+extern float model3d_alpha_thresh, model3d_texture_anisotropy, model_triplanar_tc_scale, model_mat_lod_thresh, cobj_z_bias, light_int_scale[], model_simplify_lod_scale;
 extern pos_dir_up orig_camera_pdu;
 extern bool vert_opt_flags[3];
 extern vector<texture_t> textures;
@@ -163,7 +174,7 @@ template class indexed_vntc_vect_t<vert_norm>;
 template<typename T> void vntc_vect_t<T>::clear() {
 	
 	clear_vbos();
-	vector<T>::clear();
+	vect_t::clear();
 	finalized = has_tangents = 0;
 	bsphere.radius = 0.0;
 }
@@ -186,7 +197,8 @@ template<typename T> void vntc_vect_t<T>::calc_bounding_volumes() {
 }
 
 
-template<typename T> void indexed_vntc_vect_t<T>::subdiv_recur(vector<unsigned> const &ixs, unsigned npts, unsigned skip_dims, cube_t *bcube_in) {
+// Note: ixs is cleared; leaves are in deterministic (depth first) order independent of the number of threads
+template<typename T> void indexed_vntc_vect_t<T>::subdiv_recur(vector<unsigned> &ixs, unsigned npts, unsigned skip_dims, vector<subdiv_leaf_t> &leaves, cube_t const *bcube_in) const {
 
 	unsigned const num(ixs.size());
 	assert(num > 0 && (num % npts) == 0);
@@ -212,16 +224,53 @@ template<typename T> void indexed_vntc_vect_t<T>::subdiv_recur(vector<unsigned>
 				vector<unsigned> &dest(bins[(at(ixs[i]).v[dim] > sval)]); // use the first point to determine the bin
 				for (unsigned j = i; j < i+npts; ++j) {dest.push_back(ixs[j]);}
 			}
+			vector<unsigned>().swap(ixs); // free memory before recursing
 			if (bins[0].empty() || bins[1].empty()) {skip_dims |= (1 << dim);}
+			vector<subdiv_leaf_t> sub_leaves[2];
 
 			for (unsigned i = 0; i < 2; ++i) {
-				if (!bins[i].empty()) {subdiv_recur(bins[i], npts, skip_dims);}
+				if (bins[i].empty()) continue;
+#pragma omp task default(shared) firstprivate(i) if(bins[i].size() > 2*BLOCK_SIZE) // only spawn tasks for large subtrees
+				subdiv_recur(bins[i], npts, skip_dims, sub_leaves[i]);
+			}
+#pragma omp taskwait
+			for (unsigned i = 0; i < 2; ++i) {
+				for (auto l = sub_leaves[i].begin(); l != sub_leaves[i].end(); ++l) {leaves.push_back(std::move(*l));}
 			}
 			return;
 		}
 	}
-	blocks.push_back(geom_block_t(indices.size(), num, bc));
-	copy(ixs.begin(), ixs.end(), back_inserter(indices)); // make leaf
+	leaves.emplace_back(ixs, bc); // make leaf; takes ixs
+	if (vert_opt_flags[0]) {optimize_index_block(leaves.back().ixs, npts, vert_opt_flags[1]);} // optimize each block separately
+}
+
+template<typename T> bool indexed_vntc_vect_t<T>::use_subdiv() const {
+	return (!(use_model_lod_blocks && indices.size() > 1024) && !no_subdiv_model && num_verts() > 2*BLOCK_SIZE);
+}
+
+template<typename T> void indexed_vntc_vect_t<T>::subdivide(unsigned npts) {
+
+	//timer_t timer("Subdivide Model");
+	vector<unsigned> ixs(indices.begin(), indices.end());
+	vector<subdiv_leaf_t> leaves;
+	indices.clear();
+
+	if (omp_in_parallel()) { // called from a parallel loop over materials; tasks will be run by other threads as they become idle
+		subdiv_recur(ixs, npts, 0, leaves, &bcube);
+	}
+	else {
+#pragma omp parallel
+#pragma omp single
+		subdiv_recur(ixs, npts, 0, leaves, &bcube);
+	}
+	unsigned num_ixs(0);
+	for (auto l = leaves.begin(); l != leaves.end(); ++l) {num_ixs += l->ixs.size();}
+	indices.reserve(num_ixs);
+
+	for (auto l = leaves.begin(); l != leaves.end(); ++l) {
+		blocks.push_back(geom_block_t(indices.size(), l->ixs.size(), l->bcube));
+		indices.insert(indices.end(), l->ixs.begin(), l->ixs.end());
+	}
 }
 
 
@@ -231,10 +280,39 @@ template<typename T> void indexed_vntc_vect_t<T>::optimize(unsigned npts) {
 	optimized = 1;
 	vntc_vect_t<T>::optimize(npts);
 
-	if (vert_opt_flags[0]) { // only if not subdivided?
-		vert_optimizer optimizer(indices, size(), npts);
+	if (vert_opt_flags[0] && !use_subdiv()) { // subdivided blocks are optimized separately
+		vector<unsigned> ixs(indices.begin(), indices.end());
+		vert_optimizer optimizer(ixs, size(), npts);
 		optimizer.run(vert_opt_flags[1], vert_opt_flags[2]);
+		indices.assign(ixs.begin(), ixs.end());
+	}
+}
+
+// reorder vertices to match their first use in the index buffer for better vertex fetch locality; unused vertices are removed
+template<typename T> void indexed_vntc_vect_t<T>::reorder_verts() {
+
+	unsigned const nv(size());
+	vector<unsigned> remap(nv, nv);
+	typename vntc_vect_t<T>::vect_t new_verts;
+	new_verts.reserve(nv);
+
+	for (unsigned n = 0; n < 2; ++n) {
+		ix_vect_t &ixs(n ? simp_ixs : indices);
+
+		for (auto i = ixs.begin(); i != ixs.end(); ++i) {
+			assert(*i < nv);
+			if (remap[*i] == nv) {remap[*i] = new_verts.size(); new_verts.push_back((*this)[*i]);}
+			*i = remap[*i];
+		}
 	}
+	this->swap(new_verts);
+}
+
+template<typename T> void indexed_vntc_vect_t<T>::get_acmr_stats(model3d_stats_t &stats, unsigned npts) const {
+
+	if (indices.empty()) return;
+	stats.num_prims    += indices.size()/npts;
+	stats.cache_misses += double(calc_acmr(&indices.front(), indices.size()))*indices.size();
 }
 
 
@@ -275,7 +353,7 @@ template<typename T> void indexed_vntc_vect_t<T>::gen_lod_blocks(unsigned npts)
 	for (unsigned i = 0; i < num_blocks; ++i) {lod_blocks[i].num = 0;} // reset for next pass
 
 	// reorder indices based on LOD blocks
-	vector<unsigned> ixs(indices.size());
+	ix_vect_t ixs(indices.size());
 
 	for (unsigned i = 0; i < num_prims; ++i) {
 		unsigned const ix(get_block_ix(get_prim_area(i*npts, npts)));
@@ -298,16 +376,8 @@ template<typename T> void indexed_vntc_vect_t<T>::finalize(unsigned npts) {
 	if (!empty()) {this->ensure_bounding_volumes();}
 	if (indices.empty() || finalized) return; // nothing to do
 
-	unsigned const simplify_steps = 0; // TESTING, maybe this doesn't really go here
-	if (simplify_steps > 0 && npts == 3) { // Note: triangles only
-		cout << "*** SIMPLIFY: input=" << indices.size() << " ";
-		for (unsigned n = 0; n < simplify_steps; ++n) {
-			vector<unsigned> v;
-			simplify(v, 0.5);
-			if (v.size() == indices.size()) break; // no change, done
-			indices.swap(v);
-		}
-		cout << " output=" << indices.size() << endl;
+	if (model_simplify_levels > 0 && npts == 3 && indices.size() >= 3*SIMP_MIN_TRIS) { // Note: triangles only
+		gen_simplified_lods(); // must be before subdivision and LOD block reordering
 	}
 	finalized = 1;
 	assert((num_verts() % npts) == 0); // triangles or quads
@@ -316,154 +386,455 @@ template<typename T> void indexed_vntc_vect_t<T>::finalize(unsigned npts) {
 	if (use_model_lod_blocks && indices.size() > 1024) {
 		gen_lod_blocks(npts);
 	}
-	else if (!no_subdiv_model && num_verts() > 2*BLOCK_SIZE) { // subdivide large buffers
-		//timer_t timer("Subdivide Model");
-		vector<unsigned> ixs;
-		ixs.swap(indices);
-		subdiv_recur(ixs, npts, 0, &bcube);
+	else if (use_subdiv()) { // subdivide large buffers
+		subdivide(npts);
 	}
+	if (vert_opt_flags[0]) {reorder_verts();}
 }
 
 
-template<unsigned N> struct vert_to_tri_t {
+// ************ Quadric Error Metric Mesh Simplification ************
 
-	unsigned t[N], n; // if this vertex is used in more than N triangles we give up and never remove it
+struct quadric_t { // symmetric 4x4 plane distance error matrix (Garland-Heckbert)
 
-	vert_to_tri_t() : n(0) {}
-	void add(unsigned ix) {if (n < N) {t[n] = ix;} ++n;} // only add if it fits, but always increment n
-	void remove(unsigned tix) {assert(tix < min(n, N)); t[tix] = t[n-1]; --n;} // move last element to position tix
-	unsigned get_first_index_ix(unsigned tix) const {assert(tix < min(n, N)); return 3*t[tix];} // multiply by 3 to convert from triangle to index
-	bool ix_overflow() const {return (n > N);}
+	double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+
+	quadric_t() : a2(0), ab(0), ac(0), ad(0), b2(0), bc(0), bd(0), c2(0), cd(0), d2(0) {}
+
+	void add_plane(vector3d const &n, double d, double w=1.0) { // n must be normalized; w = weight
+		a2 += w*n.x*n.x; ab += w*n.x*n.y; ac += w*n.x*n.z; ad += w*n.x*d;
+		b2 += w*n.y*n.y; bc += w*n.y*n.z; bd += w*n.y*d;
+		c2 += w*n.z*n.z; cd += w*n.z*d;
+		d2 += w*d*d;
+	}
+	void add(quadric_t const &q) {
+		a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad; b2 += q.b2; bc += q.bc; bd += q.bd; c2 += q.c2; cd += q.cd; d2 += q.d2;
+	}
+	double eval(point const &p) const { // sum of squared distances from p to all planes
+		double const x(p.x), y(p.y), z(p.z);
+		return (a2*x*x + 2*ab*x*y + 2*ac*x*z + 2*ad*x + b2*y*y + 2*bc*y*z + 2*bd*y + c2*z*z + 2*cd*z + d2);
+	}
 };
 
-struct merge_entry_t {
+struct simp_collapse_t { // half edge collapse from => to
 
-	unsigned vix;
-	float val;
+	float cost, geom_err;
+	unsigned from, to, from_ver, to_ver;
 
-	merge_entry_t(unsigned vix_=0, float val_=0.0) : vix(vix_), val(val_) {}
-	bool operator<(merge_entry_t const &e) const {return (val < e.val);}
+	simp_collapse_t(float c, float ge, unsigned f, unsigned t, unsigned fv, unsigned tv) : cost(c), geom_err(ge), from(f), to(t), from_ver(fv), to_ver(tv) {}
+	bool operator<(simp_collapse_t const &c) const {return (cost > c.cost);} // min heap
 };
 
-struct vertex_remap_t {
+inline bool get_vert_tc(vert_norm    const &v, float tc[2]) {return 0;} // no tcs
+inline bool get_vert_tc(vert_norm_tc const &v, float tc[2]) {tc[0] = v.t[0]; tc[1] = v.t[1]; return 1;}
+
+
+// half edge collapses only, so that all LOD levels index into the original vertex data; vertices with the same position (wedges on attribute seams)
+// are collapsed together to keep the surface closed, and border and seam edges add penalty quadrics so that they stay in place
+template<typename T> class mesh_simplifier_t {
+
+	T const *const verts;
+	vector<unsigned> tris; // 3 indices per triangle, updated in place as vertices are collapsed
+	vector<unsigned char> tri_valid, removed;
+	vector<vector<unsigned> > vert_tris; // triangles using each vertex; may contain invalid triangles
+	vector<unsigned> pos_id, wedge_next; // welded position of each vertex, and circular list of the vertices sharing each position
+	vector<quadric_t> quadrics, penalties; // per position: triangle planes (geometric error), and border/seam constraint planes
+	vector<unsigned> version, nbors; // version is per position
+	vector<pair<unsigned, unsigned> > wedge_pairs; // {from, to} vertex pairs of the current collapse
+	std::priority_queue<simp_collapse_t> heap;
+	unsigned num_valid_tris;
+
+	bool tri_has_vert(unsigned t, unsigned v) const {return (tris[3*t] == v || tris[3*t+1] == v || tris[3*t+2] == v);}
+	bool tri_has_pos (unsigned t, unsigned p) const {return (pos_id[tris[3*t]] == p || pos_id[tris[3*t+1]] == p || pos_id[tris[3*t+2]] == p);}
+
+	float calc_geom_err(unsigned from, unsigned to) const {
+		quadric_t q(quadrics[pos_id[from]]);
+		q.add(quadrics[pos_id[to]]);
+		return float(max(0.0, q.eval(verts[to].v)));
+	}
+	float calc_penalty(unsigned from, unsigned to) const {
+		quadric_t q(penalties[pos_id[from]]);
+		q.add(penalties[pos_id[to]]);
+		return float(max(0.0, q.eval(verts[to].v)));
+	}
+	float calc_attr_err(unsigned from, unsigned to) const { // weighted by squared edge length to match the units of the quadric error
+		T const &a(verts[from]), &b(verts[to]);
+		float err(SIMP_NORMAL_WEIGHT*(a.n - b.n).mag_sq());
+		float ta[2], tb[2];
+		if (get_vert_tc(a, ta) && get_vert_tc(b, tb)) {err += SIMP_TC_WEIGHT*min(1.0f, ((ta[0] - tb[0])*(ta[0] - tb[0]) + (ta[1] - tb[1])*(ta[1] - tb[1])));}
+		return err*p2p_dist_sq(a.v, b.v);
+	}
+	void add_edge(unsigned a, unsigned b) { // pick the lower cost direction
+		float best_cost(0.0), best_geom_err(0.0);
+		unsigned from(0), to(0);
+
+		for (unsigned d = 0; d < 2; ++d) {
+			unsigned const f(d ? b : a), t(d ? a : b);
+			float const geom_err(calc_geom_err(f, t)), cost(geom_err + calc_penalty(f, t) + calc_attr_err(f, t));
+			if (d == 0 || cost < best_cost) {best_cost = cost; best_geom_err = geom_err; from = f; to = t;}
+		}
+		heap.push(simp_collapse_t(best_cost, best_geom_err, from, to, version[pos_id[from]], version[pos_id[to]]));
+	}
+	void get_vert_nbors(unsigned v, vector<unsigned> &out) const { // neighbor vertices
+		out.clear();
 
-	vector<unsigned> remap;
+		for (auto t = vert_tris[v].begin(); t != vert_tris[v].end(); ++t) {
+			if (!tri_valid[*t]) continue;
+			for (unsigned n = 0; n < 3; ++n) {if (tris[3*(*t)+n] != v) {out.push_back(tris[3*(*t)+n]);}}
+		}
+		sort(out.begin(), out.end());
+		out.erase(unique(out.begin(), out.end()), out.end());
+	}
+	void get_pos_nbors(unsigned v, vector<unsigned> &out) const { // neighbor positions of all wedges of v
+		out.clear();
+		unsigned w(v);
 
-	vertex_remap_t(unsigned num_verts) {
-		remap.resize(num_verts);
-		for (unsigned i = 0; i < num_verts; ++i) {remap[i] = i;}
+		do {
+			for (auto t = vert_tris[w].begin(); t != vert_tris[w].end(); ++t) {
+				if (!tri_valid[*t]) continue;
+				for (unsigned n = 0; n < 3; ++n) {if (pos_id[tris[3*(*t)+n]] != pos_id[v]) {out.push_back(pos_id[tris[3*(*t)+n]]);}}
+			}
+			w = wedge_next[w];
+		} while (w != v);
+		sort(out.begin(), out.end());
+		out.erase(unique(out.begin(), out.end()), out.end());
+	}
+	bool is_collapse_valid(unsigned from, unsigned to) {
+		// each wedge of from with triangles must share an edge with exactly one wedge of to, which it's collapsed into; this keeps seams closed
+		unsigned const pt(pos_id[to]);
+		wedge_pairs.clear();
+		unsigned f(from), num_edge_tris(0);
+
+		do {
+			int target(-1);
+
+			for (auto t = vert_tris[f].begin(); t != vert_tris[f].end(); ++t) {
+				if (!tri_valid[*t]) continue;
+
+				for (unsigned n = 0; n < 3; ++n) {
+					unsigned const v(tris[3*(*t)+n]);
+					if (pos_id[v] != pt) continue;
+					if (target >= 0 && (unsigned)target != v) return 0; // adjacent to two wedges of to
+					target = v;
+				}
+			}
+			if (target >= 0) {wedge_pairs.push_back(make_pair(f, (unsigned)target));}
+			else {
+				for (auto t = vert_tris[f].begin(); t != vert_tris[f].end(); ++t) {if (tri_valid[*t]) return 0;} // wedge not connected to to
+			}
+			f = wedge_next[f];
+		} while (f != from);
+		if (wedge_pairs.empty()) return 0;
+
+		for (auto i = wedge_pairs.begin(); i != wedge_pairs.end(); ++i) {
+			for (auto t = vert_tris[i->first].begin(); t != vert_tris[i->first].end(); ++t) {
+				if (!tri_valid[*t]) continue;
+				if (tri_has_pos(*t, pt)) {++num_edge_tris; continue;}
+				// reject collapses that flip or degenerate any remaining triangles
+				unsigned const *const ixs(&tris[3*(*t)]);
+				point p[3], pn[3];
+				for (unsigned n = 0; n < 3; ++n) {p[n] = verts[ixs[n]].v; pn[n] = ((ixs[n] == i->first) ? verts[to].v : p[n]);}
+				vector3d const n_old(cross_product((p[1] - p[0]), (p[2] - p[0]))), n_new(cross_product((pn[1] - pn[0]), (pn[2] - pn[0])));
+				float const mag_old(n_old.mag()), mag_new(n_new.mag());
+				if (mag_new < 1.0E-6f*mag_old || dot_product(n_old, n_new) < SIMP_MAX_FLIP_DP*mag_old*mag_new) return 0;
+			}
+		}
+		// link condition in welded position space: the only shared neighbors must be the opposite vertices of triangles containing the edge
+		vector<unsigned> to_nbors;
+		get_pos_nbors(from, nbors);
+		get_pos_nbors(to,   to_nbors);
+		unsigned num_shared(0);
+		for (auto i = nbors.begin(); i != nbors.end(); ++i) {num_shared += std::binary_search(to_nbors.begin(), to_nbors.end(), *i);}
+		return (num_edge_tris > 0 && num_shared <= num_edge_tris);
+	}
+	void collapse_wedge(unsigned from, unsigned to) {
+		for (auto t = vert_tris[from].begin(); t != vert_tris[from].end(); ++t) {
+			if (!tri_valid[*t]) continue;
+
+			if (tri_has_vert(*t, to)) { // triangle along the collapsed edge becomes degenerate
+				tri_valid[*t] = 0;
+				assert(num_valid_tris > 0);
+				--num_valid_tris;
+				continue;
+			}
+			for (unsigned n = 0; n < 3; ++n) {if (tris[3*(*t)+n] == from) {tris[3*(*t)+n] = to;}}
+			vert_tris[to].push_back(*t);
+		}
+		vector<unsigned>().swap(vert_tris[from]);
+	}
+	void collapse(unsigned from, unsigned to) { // uses the wedge pairs from is_collapse_valid()
+		unsigned const pf(pos_id[from]), pt(pos_id[to]);
+		for (auto i = wedge_pairs.begin(); i != wedge_pairs.end(); ++i) {collapse_wedge(i->first, i->second);}
+		unsigned w(from);
+		do {removed[w] = 1; vector<unsigned>().swap(vert_tris[w]); w = wedge_next[w];} while (w != from); // all wedges of from are removed
+		quadrics [pt].add(quadrics [pf]);
+		penalties[pt].add(penalties[pf]);
+		++version[pt]; // lazy update: invalidates all queued collapses using this position
+		w = to;
+
+		do {
+			vector<unsigned> &vt(vert_tris[w]);
+			vt.erase(std::remove_if(vt.begin(), vt.end(), [this](unsigned t) {return !tri_valid[t];}), vt.end());
+			get_vert_nbors(w, nbors);
+			for (auto i = nbors.begin(); i != nbors.end(); ++i) {add_edge(w, *i);}
+			w = wedge_next[w];
+		} while (w != to);
+	}
+	void get_cur_ixs(vector<unsigned> &out) const {
+		out.clear();
+		out.reserve(3*num_valid_tris);
+		for (unsigned t = 0; t < tri_valid.size(); ++t) {if (tri_valid[t]) {UNROLL_3X(out.push_back(tris[3*t+i_]);)}}
+	}
+	static unsigned long long get_edge_key(unsigned a, unsigned b) {return ((((unsigned long long)min(a, b)) << 32) + max(a, b));}
+
+	void add_edge_penalty(unsigned t, unsigned n, vector3d const &normal, float weight) { // plane through the edge, perpendicular to the triangle
+		point const &a(verts[tris[3*t+n]].v), &b(verts[tris[3*t+(n+1)%3]].v);
+		vector3d pn(cross_product((b - a), normal));
+		if (pn == zero_vector) return; // zero length edge
+		pn.normalize();
+		quadric_t q;
+		q.add_plane(pn, -dot_product(pn, a), weight);
+		penalties[pos_id[tris[3*t+n]]].add(q);
+		penalties[pos_id[tris[3*t+(n+1)%3]]].add(q);
+	}
+
+public:
+	template<typename V, typename I> mesh_simplifier_t(V const &verts_, I const &indices) : verts(&verts_.front()), tris(indices.begin(), indices.end()), num_valid_tris(0) {
+		unsigned const num_verts(verts_.size()), num_tris(tris.size()/3);
+		assert((tris.size() % 3) == 0);
+		tri_valid.resize(num_tris, 0);
+		removed.resize(num_verts, 0);
+		vert_tris.resize(num_verts);
+		pos_id.resize(num_verts);
+		wedge_next.resize(num_verts);
+		// weld vertices by position so that attribute seams aren't treated as mesh borders
+		std::unordered_map<point, unsigned, hash_by_bytes<point> > pos_map;
+		vector<unsigned> pos_first;
+
+		for (unsigned i = 0; i < num_verts; ++i) {
+			auto it(pos_map.insert(make_pair(verts[i].v, (unsigned)pos_first.size())));
+			unsigned const p(it.first->second);
+			pos_id[i] = p;
+			if (it.second) {pos_first.push_back(i); wedge_next[i] = i;} // first wedge
+			else {wedge_next[i] = wedge_next[pos_first[p]]; wedge_next[pos_first[p]] = i;} // insert into the circular list
+		}
+		quadrics .resize(pos_first.size());
+		penalties.resize(pos_first.size());
+		version  .resize(pos_first.size(), 0);
+		vector<vector3d> tri_normals(num_tris, zero_vector);
+		std::unordered_map<unsigned long long, unsigned> pos_edge_counts, vert_edge_counts;
+
+		for (unsigned t = 0; t < num_tris; ++t) {
+			unsigned const *const ixs(&tris[3*t]);
+			for (unsigned n = 0; n < 3; ++n) {assert(ixs[n] < num_verts);}
+			if (ixs[0] == ixs[1] || ixs[1] == ixs[2] || ixs[2] == ixs[0]) continue; // degenerate, drop
+			point const &p0(verts[ixs[0]].v);
+			vector3d normal(cross_product((verts[ixs[1]].v - p0), (verts[ixs[2]].v - p0)));
+			if (normal == zero_vector) continue; // zero area, drop
+			normal.normalize();
+			tri_normals[t] = normal;
+			tri_valid[t] = 1;
+			++num_valid_tris;
+
+			for (unsigned n = 0; n < 3; ++n) {
+				vert_tris[ixs[n]].push_back(t);
+				quadrics[pos_id[ixs[n]]].add_plane(normal, -dot_product(normal, p0));
+				++pos_edge_counts [get_edge_key(pos_id[ixs[n]], pos_id[ixs[(n+1)%3]])];
+				++vert_edge_counts[get_edge_key(ixs[n], ixs[(n+1)%3])];
+			}
+		}
+		for (unsigned t = 0; t < num_tris; ++t) {
+			if (!tri_valid[t]) continue;
+			unsigned const *const ixs(&tris[3*t]);
+
+			for (unsigned n = 0; n < 3; ++n) {
+				unsigned const a(ixs[n]), b(ixs[(n+1)%3]);
+				if (pos_edge_counts[get_edge_key(pos_id[a], pos_id[b])] != 2) {add_edge_penalty(t, n, tri_normals[t], SIMP_BORDER_WEIGHT);} // border or non-manifold edge
+				else if (vert_edge_counts[get_edge_key(a, b)] != 2) {add_edge_penalty(t, n, tri_normals[t], SIMP_SEAM_WEIGHT);} // attribute seam
+			}
+		}
+		for (unsigned t = 0; t < num_tris; ++t) {
+			if (!tri_valid[t]) continue;
+			for (unsigned n = 0; n < 3; ++n) {if (tris[3*t+n] < tris[3*t+(n+1)%3]) {add_edge(tris[3*t+n], tris[3*t+(n+1)%3]);}}
+		}
 	}
-	unsigned get_remapped_val(unsigned ix) { // union find with path compression
-		if (is_remapped(ix)) {remap[ix] = get_remapped_val(remap[ix]);} // follow the chain
-		return remap[ix];
+
+	// target_tris must be in decreasing order; levels that can't be reached are omitted; returns the max geometric error (distance)
+	float build_lod_chain(vector<unsigned> const &target_tris, vector<vector<unsigned> > &lods) {
+		float max_err(0.0);
+		unsigned level(0), last_tris(num_valid_tris);
+		lods.clear();
+
+		while (level < target_tris.size()) {
+			if (num_valid_tris <= target_tris[level]) { // reached the next LOD level
+				lods.push_back(vector<unsigned>());
+				get_cur_ixs(lods.back());
+				last_tris = num_valid_tris;
+				++level;
+				continue;
+			}
+			if (heap.empty()) break; // can't simplify further
+			simp_collapse_t const c(heap.top());
+			heap.pop();
+			if (removed[c.from] || removed[c.to] || version[pos_id[c.from]] != c.from_ver || version[pos_id[c.to]] != c.to_ver) continue; // stale entry
+			if (!is_collapse_valid(c.from, c.to)) continue; // may be re-added later when a neighbor is collapsed
+			collapse(c.from, c.to);
+			max_err = max(max_err, sqrt(c.geom_err));
+		}
+		if (level < target_tris.size() && num_valid_tris < SIMP_MIN_LOD_RATIO*last_tris) { // partial progress toward the next level
+			lods.push_back(vector<unsigned>());
+			get_cur_ixs(lods.back());
+		}
+		return max_err;
 	}
-	bool is_remapped(unsigned ix) const {assert(ix < remap.size()); return (remap[ix] != ix);}
-	void remap_vertex(unsigned from, unsigned to) {assert(from != to); assert(!is_remapped(from)); remap[from] = to;}
 };
 
-struct mesh_edge_t {
-	unsigned a, b; // a < b
-	mesh_edge_t(unsigned a_=0, unsigned b_=0) : a(min(a_, b_)), b(max(a_, b_)) {assert(a != b);}
-	bool operator==(mesh_edge_t const &e) const {return (a == e.a && b == e.b);}
-};
 
+// targets = ratio of output to input triangles in (0.0, 1.0), in decreasing order; returns the max geometric error
+// Note: works on triangles only (not quads)
+template<typename T> float indexed_vntc_vect_t<T>::simplify_lod_chain(vector<vector<unsigned> > &lods, vector<float> const &targets) const {
 
-// target = ratio of output to input vertices in (0.0, 1.0)
-// Note: works on triangles only (not quads), intended for 2-manifold meshes
-template<typename T> void indexed_vntc_vect_t<T>::simplify(vector<unsigned> &out, float target) const {
+	assert((indices.size() % 3) == 0);
+	vector<unsigned> target_tris;
 
-	RESET_TIME;
-	assert(target < 1.0 && target > 0.0);
-	out.clear();
-	unsigned const num_verts(size()), num_ixs(indices.size()), target_num_verts(unsigned(target*num_verts));
-	if (target_num_verts <= 3) {out = indices; return;} // can't simplify
-
-	// build vertex to face/triangle mapping
-	assert((num_ixs % 3) == 0); // must be triangles; num_tris = num_ixs/3
-	vector<vert_to_tri_t<8>> vert_to_tri(num_verts);
-
-	for (unsigned i = 0; i < num_ixs; ++i) {
-		assert(indices[i] < num_verts);
-		vert_to_tri[indices[i]].add(i);
-	}
-
-	// determine which verts/edges can be removed
-	std::priority_queue<merge_entry_t> merge_queue; // of vertices
-
-	for (unsigned i = 0; i < num_verts; ++i) {
-		auto const &vt(vert_to_tri[i]);
-		if (vt.ix_overflow()) continue; // don't remove this vertex
-		bool on_mesh_edge(0);
-		counted_normal normal_sum;
-
-		for (unsigned t = 0; t < vt.n && !on_mesh_edge; ++t) { // iterate over triangles at this vertex
-			assert(vt.t[t] < num_ixs);
-			unsigned const tix(vt.t[t]/3), six(3*tix);
-			assert(six+3 <= num_ixs);
-			
-			for (unsigned j = 0; j < 3; ++j) {
-				normal_sum.add_normal(operator[](indices[six+j]).n);
-				mesh_edge_t const e1(indices[six+j], indices[six+((j+1)%3)]);
-				if (e1.a != i && e1.b != i) continue; // edge doesn't contain the vertex of interest
-				bool found(0);
-
-				for (unsigned t2 = 0; t2 < vt.n && !found; ++t2) {
-					if (t2 == t) continue; // same triangle
-					unsigned const tix2(vt.t[t2]/3), six2(3*tix2);
-					if (e1 == mesh_edge_t(indices[six2+0], indices[six2+1]) ||
-						e1 == mesh_edge_t(indices[six2+1], indices[six2+2]) ||
-						e1 == mesh_edge_t(indices[six2+2], indices[six2+0])) {found = 1; break;}
-				} // for t2
-				if (!found) {on_mesh_edge = 1; break;}
-			} // for j
-		} // for t
-		if (on_mesh_edge) continue; // can't remove this vertex
-		float const val(normal_sum.mag()/normal_sum.count);
-		merge_queue.push(merge_entry_t(i, val));
-	}
-
-	// mapping from orig vertex to collapsed (new) vertex
-	unsigned const cand_verts(merge_queue.size());
-	vertex_remap_t remap(num_verts);
-	unsigned num_valid_verts(num_verts);
-
-	while (!merge_queue.empty() && num_valid_verts > target_num_verts) {
-		unsigned const src_ix(merge_queue.top().vix); // remove this one (half edge collapse)
-		merge_queue.pop();
-		assert(src_ix < num_verts);
-		unsigned dest_ix(src_ix);
-		float min_edge_len_sq(0.0);
-		
-		for (unsigned t = 0; t < vert_to_tri[src_ix].n; ++t) { // iterate over triangles at this vertex
-			unsigned const tix(vert_to_tri[src_ix].t[t]/3), six(3*tix);
+	for (auto i = targets.begin(); i != targets.end(); ++i) {
+		assert(*i < 1.0 && *i > 0.0);
+		assert(i == targets.begin() || *i < *(i-1));
+		target_tris.push_back(unsigned((*i)*indices.size()/3));
+	}
+	mesh_simplifier_t<T> simplifier(*this, indices);
+	return simplifier.build_lod_chain(target_tris, lods);
+}
 
-			for (unsigned j = 0; j < 3; ++j) {
-				if (remap.is_remapped(indices[six+j])) continue; // already remapped
-				float const edge_len_sq(p2p_dist_sq(operator[](src_ix).v, operator[](indices[six+j]).v));
+// target = ratio of output to input triangles in (0.0, 1.0)
+template<typename T> void indexed_vntc_vect_t<T>::simplify(ix_vect_t &out, float target) const {
 
-				if (min_edge_len_sq == 0.0 || edge_len_sq < min_edge_len_sq) { // first or shortest edge
-					dest_ix = indices[six+j]; // new vertex
-					min_edge_len_sq = edge_len_sq;
-				}
+	vector<vector<unsigned> > lods;
+	simplify_lod_chain(lods, vector<float>(1, target));
+	if (lods.empty()) {out = indices;} else {out.assign(lods.front().begin(), lods.front().end());} // can't simplify
+}
+
+template<typename T> void indexed_vntc_vect_t<T>::gen_simplified_lods() {
+
+	int const start_time(GET_TIME_MS());
+	vector<float> targets;
+	for (unsigned i = 0; i < min(model_simplify_levels, MAX_SIMP_LODS); ++i) {targets.push_back(1.0/(2U << i));} // halve the number of triangles per level
+	vector<vector<unsigned> > lods;
+	simp_err = simplify_lod_chain(lods, targets);
+
+	for (auto i = lods.begin(); i != lods.end(); ++i) {
+		if (vert_opt_flags[0]) {optimize_index_block(*i, 3, vert_opt_flags[1]);}
+		simp_ixs.insert(simp_ixs.end(), i->begin(), i->end());
+		simp_lod_ends.push_back(simp_ixs.size());
+	}
+	simp_time_ms = GET_TIME_MS() - start_time;
+}
+
+// simplifies a gently curved heightfield grid with a texture seam down the middle, and checks triangle counts, error bound, and for cracks
+void run_model_simplify_benchmark() {
+
+	unsigned const N = 64, seam_x = N/2; // N quads per side; vertices in column seam_x are duplicated with different tcs
+	float const zscale = 0.02;
+	vector<vert_norm_tc> verts;
+	vector<unsigned> indices, col_ix[2]; // column seam_x: {left side, right side}
+	vector<unsigned> grid_ix((N+1)*(N+1));
+	auto get_z = [&](float x, float y) {return zscale*sin(2.0*PI*x)*cos(3.0*PI*y);};
+
+	for (unsigned y = 0; y <= N; ++y) {
+		for (unsigned x = 0; x <= N; ++x) {
+			float const fx(float(x)/N), fy(float(y)/N);
+			point const pos(fx, fy, get_z(fx, fy));
+			grid_ix[y*(N+1) + x] = verts.size();
+			verts.push_back(vert_norm_tc(pos, plus_z, ((x <= seam_x) ? 2.0*fx : 2.0*fx - 1.0), fy));
+			if (x == seam_x) {verts.push_back(vert_norm_tc(pos, plus_z, 0.0, fy));} // right side of the seam
+		}
+	}
+	for (unsigned y = 0; y < N; ++y) {
+		for (unsigned x = 0; x < N; ++x) {
+			unsigned ix[4] = {grid_ix[y*(N+1) + x], grid_ix[y*(N+1) + x+1], grid_ix[(y+1)*(N+1) + x+1], grid_ix[(y+1)*(N+1) + x]};
+			if (x == seam_x) {++ix[0]; ++ix[3];} // use the right side seam vertices
+			unsigned const quad_tris[6] = {0, 1, 2, 0, 2, 3};
+			for (unsigned i = 0; i < 6; ++i) {indices.push_back(ix[quad_tris[i]]);}
+		}
+	}
+	unsigned const num_tris(indices.size()/3);
+	vector<unsigned> target_tris;
+	target_tris.push_back(num_tris/2);
+	target_tris.push_back(num_tris/4);
+	vector<vector<unsigned> > lods;
+	int const start_time(GET_TIME_MS());
+	mesh_simplifier_t<vert_norm_tc> simplifier(verts, indices);
+	float const max_err(simplifier.build_lod_chain(target_tris, lods));
+	cout << "Model simplify bench: " << num_tris << " tris, " << verts.size() << " verts, time " << (GET_TIME_MS() - start_time) << " ms, max err " << max_err << endl;
+	assert(lods.size() == target_tris.size());
+	float const eps(1.0E-5);
+
+	for (unsigned L = 0; L < lods.size(); ++L) {
+		vector<unsigned> const &ixs(lods[L]);
+		unsigned const lod_tris(ixs.size()/3);
+		assert(lod_tris <= target_tris[L]);
+		// every original vertex must be covered by a simplified triangle in xy, within the error bound in z
+		float max_dev(0.0);
+
+		for (auto v = verts.begin(); v != verts.end(); ++v) {
+			bool found(0);
+
+			for (unsigned t = 0; t < lod_tris && !found; ++t) {
+				point const &a(verts[ixs[3*t]].v), &b(verts[ixs[3*t+1]].v), &c(verts[ixs[3*t+2]].v);
+				float const det((b.x - a.x)*(c.y - a.y) - (c.x - a.x)*(b.y - a.y));
+				if (fabs(det) < 1.0E-12) continue;
+				float const u(((v->v.x - a.x)*(c.y - a.y) - (c.x - a.x)*(v->v.y - a.y))/det), w(((b.x - a.x)*(v->v.y - a.y) - (v->v.x - a.x)*(b.y - a.y))/det);
+				if (u < -eps || w < -eps || u + w > 1.0 + eps) continue;
+				max_dev = max(max_dev, fabs(a.z + u*(b.z - a.z) + w*(c.z - a.z) - v->v.z));
+				found = 1;
 			}
-		} // for i
-		if (min_edge_len_sq == 0.0) continue; // can't remove this one
-		remap.remap_vertex(src_ix, dest_ix);
-		assert(num_valid_verts > 0);
-		--num_valid_verts;
-	} // while
+			assert(found); // no holes
+		}
+		// edges used by only one triangle (by position) must be on the outer border of the grid; any others are cracks along the seam
+		std::unordered_map<unsigned long long, unsigned> edge_counts;
+		std::unordered_map<point, unsigned, hash_by_bytes<point> > pos_map;
+		vector<unsigned> pos_ix(ixs.size());
 
-	// generate output
-	out.reserve(unsigned(target*num_ixs));
+		for (unsigned i = 0; i < ixs.size(); ++i) {
+			pos_ix[i] = pos_map.insert(make_pair(verts[ixs[i]].v, (unsigned)pos_map.size())).first->second;
+		}
+		for (unsigned i = 0; i < ixs.size(); ++i) {
+			unsigned const a(pos_ix[i]), b(pos_ix[3*(i/3) + (i+1)%3]);
+			++edge_counts[(((unsigned long long)min(a, b)) << 32) + max(a, b)];
+		}
+		unsigned num_cracks(0);
+
+		for (unsigned i = 0; i < ixs.size(); ++i) {
+			unsigned const a(pos_ix[i]), b(pos_ix[3*(i/3) + (i+1)%3]);
+			if (edge_counts[(((unsigned long long)min(a, b)) << 32) + max(a, b)] != 1) continue;
+			point const &pa(verts[ixs[i]].v), &pb(verts[ixs[3*(i/3) + (i+1)%3]].v);
+			bool const on_border((pa.x < eps && pb.x < eps) || (pa.x > 1.0-eps && pb.x > 1.0-eps) || (pa.y < eps && pb.y < eps) || (pa.y > 1.0-eps && pb.y > 1.0-eps));
+			num_cracks += !on_border;
+		}
+		cout << "LOD " << L << ": " << lod_tris << " tris (target " << target_tris[L] << "), max z deviation " << max_dev << ", cracks " << num_cracks << endl;
+		assert(num_cracks == 0);
+		assert(max_dev <= 2.0*max_err + eps);
+	}
+}
+
+template<typename T> unsigned indexed_vntc_vect_t<T>::get_simp_lod_level() const {
+
+	if (simp_lod_ends.empty() || model_simplify_lod_scale <= 0.0) return 0;
+	float const dmin(2.0*bsphere.radius*model_simplify_lod_scale), dist(p2p_dist(camera_pdu.pos, bsphere.pos));
+	if (dist <= dmin) return 0; // full detail
+	return min((unsigned)simp_lod_ends.size(), unsigned(log2(dist/dmin)) + 1); // each doubling of distance selects the next level
+}
+
+template<typename T> void indexed_vntc_vect_t<T>::get_simp_stats(model3d_stats_t &stats) const {
+
+	if (simp_lod_ends.empty()) return;
+	if (stats.lod_tris.size() < simp_lod_ends.size()) {stats.lod_tris.resize(simp_lod_ends.size(), 0);}
 
-	for (unsigned i = 0; i < num_ixs; i += 3) { // iterate by triangle
-		unsigned new_ixs[3];
-		for (unsigned n = 0; n < 3; ++n) {new_ixs[n] = remap.get_remapped_val(indices[i+n]);}
-		if (new_ixs[0] == new_ixs[1] || new_ixs[1] == new_ixs[2] || new_ixs[2] == new_ixs[0]) continue; // duplicate vertices, degenerate triangle, skip
-		UNROLL_3X(out.push_back(new_ixs[i_]);)
+	for (unsigned i = 0; i < simp_lod_ends.size(); ++i) {
+		stats.lod_tris[i] += (simp_lod_ends[i] - ((i > 0) ? simp_lod_ends[i-1] : 0))/3;
 	}
-	cout << TXT(num_verts) << TXT(num_ixs) << TXT(target_num_verts) << TXT(cand_verts) << TXT(num_valid_verts) << TXT(out.size()) << endl;
-	PRINT_TIME("Simplify");
+	if (bsphere.radius > 0.0) {stats.max_simp_err = max(stats.max_simp_err, simp_err/bsphere.radius);}
+	stats.simp_time_ms += simp_time_ms;
 }
 
 
@@ -473,6 +844,8 @@ template<typename T> void indexed_vntc_vect_t<T>::clear() {
 	indices.clear();
 	blocks.clear();
 	lod_blocks.clear();
+	simp_ixs.clear();
+	simp_lod_ends.clear();
 	need_normalize = 0;
 }
 
@@ -546,7 +919,9 @@ template<typename T> void indexed_vntc_vect_t<T>::render(shader_t &shader, bool
 	int prim_type(GL_TRIANGLES);
 	unsigned ixn(1), ixd(1), end_ix(indices.size());
 
-	if (!is_shadow_pass && !lod_blocks.empty()) { // block LOD
+	unsigned const simp_lod(is_shadow_pass ? 0 : get_simp_lod_level());
+
+	if (!is_shadow_pass && simp_lod == 0 && !lod_blocks.empty()) { // block LOD
 		float const dmin(2.0*bsphere.radius), dist(p2p_dist(camera_pdu.pos, bsphere.pos));
 
 		if (dist > dmin) { // no LOD if within the bounding sphere
@@ -566,14 +941,24 @@ template<typename T> void indexed_vntc_vect_t<T>::render(shader_t &shader, bool
 	}
 	else {
 		if (npts == 4) {prim_type = GL_QUADS;}
-		this->create_and_upload(*this, indices);
+
+		if (!simp_ixs.empty() && !this->ivbo) { // append simplified LOD indices
+			vector<unsigned> all_ixs(indices.begin(), indices.end());
+			all_ixs.insert(all_ixs.end(), simp_ixs.begin(), simp_ixs.end());
+			this->create_and_upload(*this, all_ixs);
+		}
+		else {this->create_and_upload(*this, indices);}
 	}
 	this->pre_render();
 	// Note: we need this call here because we don't know if the VAO was created with the same enables/locations: consider normal vs. shadow pass
 	//if (is_shadow_pass) {T::set_vbo_arrays_shadow(0);} else
 	T::set_vbo_arrays(); // calls check_mvm_update()
 
-	if (is_shadow_pass || blocks.empty() || no_vfc || camera_pdu.sphere_completely_visible_test(bsphere.pos, bsphere.radius)) { // draw the entire range
+	if (simp_lod > 0) { // draw the entire simplified level
+		unsigned const start_ix((simp_lod > 1) ? simp_lod_ends[simp_lod-2] : 0), num(simp_lod_ends[simp_lod-1] - start_ix);
+		glDrawRangeElements(prim_type, 0, (unsigned)size(), num, GL_UNSIGNED_INT, (void *)((indices.size() + start_ix)*sizeof(unsigned)));
+	}
+	else if (is_shadow_pass || blocks.empty() || no_vfc || camera_pdu.sphere_completely_visible_test(bsphere.pos, bsphere.radius)) { // draw the entire range
 		glDrawRangeElements(prim_type, 0, (unsigned)size(), (unsigned)(ixn*end_ix/ixd), GL_UNSIGNED_INT, 0);
 	}
 	else { // draw each block independently
@@ -821,6 +1206,18 @@ template<typename T> unsigned vntc_vect_block_t<T>::num_verts() const {
 	return s;
 }
 
+template<typename T> void vntc_vect_block_t<T>::get_stats(model3d_stats_t &stats, unsigned npts) const {
+
+	stats.blocks += (unsigned)this->size();
+	stats.verts  += num_unique_verts();
+	
+	for (auto i = begin(); i != end(); ++i) {
+		i->get_simp_stats(stats);
+		if (stats.calc_acmr) {i->get_acmr_stats(stats, npts);}
+		stats.cpu_mem += i->get_cpu_mem();
+	}
+}
+
 template<typename T> unsigned vntc_vect_block_t<T>::num_unique_verts() const {
 
 	unsigned s(0);
@@ -943,8 +1340,8 @@ template<typename T> void geometry_t<T>::get_stats(model3d_stats_t &stats) const
 	
 	stats.tris  += triangles.num_verts()/3;
 	stats.quads += quads.num_verts()/4;
-	triangles.get_stats(stats);
-	quads.get_stats(stats);
+	triangles.get_stats(stats, 3);
+	quads.get_stats(stats, 4);
 }
 
 template<typename T> void geometry_t<T>::calc_area(float &area, unsigned &ntris) {
@@ -1461,9 +1858,20 @@ void model3d::mark_mat_as_used(int mat_id) {
 
 void model3d::finalize() {
 
+	bool const verbose(vert_opt_flags[2]); // report vertex cache efficiency and time
+	model3d_stats_t stats_in(1);
+	if (verbose) {get_stats(stats_in);}
+	RESET_TIME;
 #pragma omp parallel for schedule(dynamic)
 	for (int i = 0; i < (int)materials.size(); ++i) {materials[i].finalize();}
 	unbound_geom.finalize();
+
+	if (verbose) {
+		PRINT_TIME("Model3d Finalize");
+		model3d_stats_t stats_out(1);
+		get_stats(stats_out);
+		cout << "Model3d ACMR (cache misses per primitive): " << stats_in.get_acmr() << " => " << stats_out.get_acmr() << endl;
+	}
 }
 
 
@@ -1865,8 +2273,8 @@ void model3d::create_indir_texture() {
 	for (unsigned y = 0; y < ysize; ++y) {
 		for (unsigned x = 0; x < xsize; ++x) {
 			unsigned const off(zsize*(y*xsize + x));
-			lmcell const *const vlm(local_lmap_manager.get_column(x, y));
-			assert(vlm != nullptr); // not supported in this flow
+			lmap_ccolumn_t const vlm(local_lmap_manager.get_column(x, y));
+			assert(vlm); // not supported in this flow
 
 			for (unsigned z = 0; z < zsize; ++z) {
 				unsigned const off2(ncomp*(off + z));
@@ -2302,7 +2710,14 @@ void model3d_stats_t::print() const {
 	
 	cout << "verts: " << verts << ", quads: " << quads << ", tris: " << tris << ", blocks: " << blocks << ", mats: " << mats;
 	if (transforms) {cout << ", transforms: " << transforms;}
+	cout << ", mem: " << cpu_mem/1024 << "KB";
 	cout << endl;
+
+	if (!lod_tris.empty()) {
+		cout << "simplified LOD tris:";
+		for (auto i = lod_tris.begin(); i != lod_tris.end(); ++i) {cout << " " << *i;}
+		cout << ", max error: " << max_simp_err << " (relative to block radius), simplify time: " << simp_time_ms << "ms" << endl;
+	}
 }
 
 
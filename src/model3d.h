@@ -138,7 +138,16 @@ struct poly_data_block {
 
 struct model3d_stats_t {
 	unsigned verts, quads, tris, blocks, mats, transforms;
-	model3d_stats_t() : verts(0), quads(0), tris(0), blocks(0), mats(0), transforms(0) {}
+	vector<unsigned> lod_tris; // simplified LOD levels
+	float max_simp_err; // relative to block bounding sphere radius
+	unsigned simp_time_ms; // summed across threads
+	bool calc_acmr; // vertex cache stats, which are slow to compute
+	unsigned num_prims;
+	double cache_misses;
+	size_t cpu_mem; // vertex and index data
+	model3d_stats_t(bool calc_acmr_=0) : verts(0), quads(0), tris(0), blocks(0), mats(0), transforms(0), max_simp_err(0.0), simp_time_ms(0),
+		calc_acmr(calc_acmr_), num_prims(0), cache_misses(0.0), cpu_mem(0) {}
+	float get_acmr() const {return (num_prims ? cache_misses/num_prims : 0.0);} // average cache misses per primitive
 	void print() const;
 };
 
@@ -201,16 +210,17 @@ struct get_polygon_args_t {
 };
 
 
-template<typename T> class vntc_vect_t : public vector<T>, public indexed_vao_manager_t {
+template<typename T> class vntc_vect_t : public tracked_vector<T, MEM_CAT_MODELS>, public indexed_vao_manager_t {
 
 protected:
+	typedef tracked_vector<T, MEM_CAT_MODELS> vect_t;
 	bool has_tangents, finalized;
 	sphere_t bsphere;
 	cube_t bcube;
 
 public:
-	using vector<T>::empty;
-	using vector<T>::size;
+	using vect_t::empty;
+	using vect_t::size;
 	unsigned obj_id;
 
 	vntc_vect_t(unsigned obj_id_=0) : has_tangents(0), finalized(0), obj_id(obj_id_) {bcube.set_to_zeros();}
@@ -224,7 +234,7 @@ public:
 	point get_center () const {return bsphere.pos;}
 	float get_bradius() const {return bsphere.radius;}
 	void optimize(unsigned npts) {remove_excess_cap();}
-	void remove_excess_cap() {if (20*vector<T>::size() < 19*vector<T>::capacity()) vector<T>(*this).swap(*this);} // shrink_to_fit()?
+	void remove_excess_cap() {if (20*vect_t::size() < 19*vect_t::capacity()) vect_t(*this).swap(*this);} // shrink_to_fit()?
 	void write(ostream &out) const;
 	void read(istream &in);
 };
@@ -232,7 +242,8 @@ public:
 
 template<typename T> class indexed_vntc_vect_t : public vntc_vect_t<T> {
 
-	vector<unsigned> indices;
+	typedef tracked_vector<unsigned, MEM_CAT_MODELS> ix_vect_t;
+	ix_vect_t indices;
 	bool need_normalize, optimized;
 	float avg_area_per_tri, amin, amax;
 
@@ -244,6 +255,16 @@ template<typename T> class indexed_vntc_vect_t : public vntc_vect_t<T> {
 	};
 	vector<geom_block_t> blocks;
 
+	struct subdiv_leaf_t {
+		vector<unsigned> ixs;
+		cube_t bcube;
+		subdiv_leaf_t(vector<unsigned> &ixs_, cube_t const &bcube_) : bcube(bcube_) {ixs.swap(ixs_);}
+	};
+	void subdiv_recur(vector<unsigned> &ixs, unsigned npts, unsigned skip_dims, vector<subdiv_leaf_t> &leaves, cube_t const *bcube_in=nullptr) const;
+	bool use_subdiv() const;
+	void subdivide(unsigned npts);
+	void reorder_verts();
+
 	struct lod_block_t {
 		unsigned start_ix, num;
 		float tri_area;
@@ -254,6 +275,13 @@ template<typename T> class indexed_vntc_vect_t : public vntc_vect_t<T> {
 	vector<lod_block_t> lod_blocks;
 	unsigned get_block_ix(float area) const;
 
+	// simplified LOD chain: concatenated indices of all levels, uploaded after the full detail indices
+	ix_vect_t simp_ixs;
+	vector<unsigned> simp_lod_ends;
+	float simp_err;
+	unsigned simp_time_ms;
+	unsigned get_simp_lod_level() const;
+
 public:
 	using vntc_vect_t<T>::size;
 	using vntc_vect_t<T>::empty;
@@ -265,7 +293,7 @@ public:
 	using vntc_vect_t<T>::bcube;
 	using vntc_vect_t<T>::bsphere;
 	
-	indexed_vntc_vect_t(unsigned obj_id_=0) : vntc_vect_t<T>(obj_id_), need_normalize(0), optimized(0), avg_area_per_tri(0.0), amin(0.0), amax(0.0) {}
+	indexed_vntc_vect_t(unsigned obj_id_=0) : vntc_vect_t<T>(obj_id_), need_normalize(0), optimized(0), avg_area_per_tri(0.0), amin(0.0), amax(0.0), simp_err(0.0), simp_time_ms(0) {}
 	void calc_tangents(unsigned npts) {assert(0);}
 	void render(shader_t &shader, bool is_shadow_pass, point const *const xlate, unsigned npts, bool no_vfc=0);
 	void reserve_for_num_verts(unsigned num_verts);
@@ -273,11 +301,14 @@ public:
 	void add_triangle(triangle const &t, vertex_map_t<T> &vmap);
 	unsigned add_vertex(T const &v, vertex_map_t<T> &vmap);
 	void add_index(unsigned ix) {assert(ix < size()); indices.push_back(ix);}
-	void subdiv_recur(vector<unsigned> const &ixs, unsigned npts, unsigned skip_dims, cube_t *bcube_in=nullptr);
 	void optimize(unsigned npts);
 	void gen_lod_blocks(unsigned npts);
 	void finalize(unsigned npts);
-	void simplify(vector<unsigned> &out, float target) const;
+	void simplify(ix_vect_t &out, float target) const;
+	float simplify_lod_chain(vector<vector<unsigned> > &lods, vector<float> const &targets) const;
+	void gen_simplified_lods();
+	void get_simp_stats(model3d_stats_t &stats) const;
+	void get_acmr_stats(model3d_stats_t &stats, unsigned npts) const;
 	void clear();
 	unsigned num_verts() const {return unsigned(indices.empty() ? size() : indices.size());}
 	T       &get_vert(unsigned i)       {return (*this)[indices.empty() ? i : indices[i]];}
@@ -291,6 +322,7 @@ public:
 	void read(istream &in);
 	bool indexing_enabled() const {return !indices.empty();}
 	void mark_need_normalize() {need_normalize = 1;}
+	size_t get_cpu_mem() const {return (this->capacity()*sizeof(T) + (indices.capacity() + simp_ixs.capacity())*sizeof(unsigned));}
 };
 
 
@@ -306,7 +338,7 @@ template<typename T> struct vntc_vect_block_t : public deque<indexed_vntc_vect_t
 	float calc_draw_order_score() const;
 	unsigned num_verts() const;
 	unsigned num_unique_verts() const;
-	void get_stats(model3d_stats_t &stats) const {stats.blocks += (unsigned)this->size(); stats.verts += num_unique_verts();}
+	void get_stats(model3d_stats_t &stats, unsigned npts) const;
 	float calc_area(unsigned npts);
 	void get_polygons(get_polygon_args_t &args, unsigned npts) const;
 	void invert_tcy();
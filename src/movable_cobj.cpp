@@ -8,12 +8,16 @@
 #include "player_state.h"
 #include "csg.h"
 #include "openal_wrap.h"
+#include <cfloat> // for FLT_MAX
 
 set<unsigned> moving_cobjs;
+bool movable_cobj_bench(0), movable_cobj_use_toi(1); // use the TOI solver in get_max_cobj_move_delta()
+
+extern bool use_gjk_narrow_phase, gjk_bench;
 
 extern unsigned scene_smap_vbo_invalid;
 extern int num_groups, frame_counter;
-extern float base_gravity, tstep, temperature;
+extern float base_gravity, tstep, temperature, czmin, czmax, ztop;
 extern double camera_zh;
 extern coll_obj_group coll_objects;
 extern cobj_groups_t cobj_groups;
@@ -23,7 +27,7 @@ extern obj_type object_types[NUM_TOT_OBJS];
 extern obj_group obj_groups[NUM_TOT_OBJS];
 
 
-bool push_cobj(unsigned index, vector3d &delta, set<unsigned> &seen, point const &pushed_from);
+bool push_cobj(unsigned index, vector3d &delta, frame_set<unsigned> &seen, point const &pushed_from);
 
 bool coll_obj::is_moving() const {return (is_movable() && moving_cobjs.find(id) != moving_cobjs.end());}
 
@@ -186,10 +190,17 @@ int torus_cylinder_int(coll_obj const &t, coll_obj const &c) {
 // 0: no intersection, 1: intersection, 2: maybe intersection (incomplete)
 // 21 total: 15 complete, 5 partial (all cylinder cases), 1 incomplete (capsule-capsule)
 // Note: pos toler => adjacency doesn't count; neg toler => adjacency counts
-int coll_obj::intersects_cobj(coll_obj const &c, float toler) const {
+// if allow_gjk, convex non-cube pairs use the GJK/EPA narrow phase, which is exact to within a small contact epsilon (checked by run_gjk_benchmark());
+// the pairwise tests below are used for tori and when GJK is disabled, and some of their definite results for cones, capsules, and polygons are approximate
+int coll_obj::intersects_cobj(coll_obj const &c, float toler, bool allow_gjk) const {
 
 	if (!intersects(c, toler)) return 0; // cube-cube intersection
-	if (c.type < type) {return c.intersects_cobj(*this, toler);} // swap arguments
+	
+	if (allow_gjk && use_gjk_narrow_phase && (type != COLL_CUBE || c.type != COLL_CUBE)) {
+		int const ret(gjk_cobj_intersect(*this, c, toler));
+		if (ret >= 0) return ret;
+	}
+	if (c.type < type) {return c.intersects_cobj(*this, toler, 0);} // swap arguments
 	float const r1(radius-toler), r2(radius2-toler), cr1(c.radius-toler), cr2(c.radius2-toler);
 
 	if (c.type == COLL_TORUS && c.norm.x == 0.0 && c.norm.y == 0.0) { // check cobj inside torus center case
@@ -698,9 +709,177 @@ bool coll_obj::is_point_supported(point const &pos) const {
 	return 0; // never gets here
 }
 
-float get_max_cobj_move_delta(coll_obj const &c1, coll_obj const &c2, vector3d const &delta, float step_thresh, float tolerance=0.0) {
+// time of impact (TOI) solver: computes the range of t for which c1 moved by t*delta intersects c2;
+// exact for cube, vertical cylinder, sphere, and convex polygon pairs; other pairs fall back to the binary search in get_max_cobj_move_delta()
+
+// clips [t1, t2] to the range where [a1, a2] moving by t*v overlaps [b1, b2]; returns 0 if empty
+bool clip_swept_range(float a1, float a2, float b1, float b2, float v, float &t1, float &t2) {
+
+	if (fabs(v) < 1.0E-12) {return (a2 >= b1 && a1 <= b2);} // not moving in this dim
+	float ta((b1 - a2)/v), tb((b2 - a1)/v);
+	if (ta > tb) {swap(ta, tb);}
+	t1 = max(t1, ta);
+	t2 = min(t2, tb);
+	return (t1 <= t2);
+}
+
+// dp = relative position, v = relative velocity, r = sum of radii
+bool clip_swept_sphere_range(vector3d const &dp, vector3d const &v, float r, float &t1, float &t2) {
+
+	if (r <= 0.0) return 0;
+	float const a(dot_product(v, v)), b(2.0*dot_product(dp, v)), c(dot_product(dp, dp) - r*r);
+	if (a < 1.0E-12) {return (c < 0.0);} // not moving
+	float const disc(b*b - 4.0*a*c);
+	if (disc < 0.0) return 0; // never intersects
+	float const s(sqrt(disc));
+	t1 = max(t1, (-b - s)/(2.0f*a));
+	t2 = min(t2, (-b + s)/(2.0f*a));
+	return (t1 <= t2);
+}
+
+// circle of radius r centered at p moving by t*v vs. the xy projection of cube; the rounded rect is the union of two expanded rects and four corner circles
+bool clip_swept_circle_rect_range(point const &p, vector3d const &v, float r, cube_t const &cube, float &t1, float &t2) {
+
+	if (r <= 0.0) return 0;
+	float u1(FLT_MAX), u2(-FLT_MAX); // union of ranges (the rounded rect is convex, so this is a single range)
+
+	for (unsigned d = 0; d < 2; ++d) { // rect expanded by r in dim d
+		float a1(-FLT_MAX), a2(FLT_MAX);
+		bool hit(1);
+
+		for (unsigned e = 0; e < 2 && hit; ++e) {
+			float const exp((e == d) ? r : 0.0);
+			hit = clip_swept_range(p[e], p[e], cube.d[e][0]-exp, cube.d[e][1]+exp, v[e], a1, a2);
+		}
+		if (hit) {u1 = min(u1, a1); u2 = max(u2, a2);}
+	}
+	for (unsigned i = 0; i < 4; ++i) { // corners
+		float a1(-FLT_MAX), a2(FLT_MAX);
+		vector3d const dp((p.x - cube.d[0][i&1]), (p.y - cube.d[1][i>>1]), 0.0);
+		if (clip_swept_sphere_range(dp, vector3d(v.x, v.y, 0.0), r, a1, a2)) {u1 = min(u1, a1); u2 = max(u2, a2);}
+	}
+	if (u1 > u2) return 0;
+	t1 = max(t1, u1);
+	t2 = min(t2, u2);
+	return (t1 <= t2);
+}
+
+struct convex_cobj_t { // cube or convex (possibly extruded) polygon as verts + face normals + edge dirs for the separating axis test
+
+	unsigned nverts, nfaces, nedges;
+	point verts[2*N_COLL_POLY_PTS];
+	vector3d faces[N_COLL_POLY_PTS+1], edges[N_COLL_POLY_PTS+1];
+
+	convex_cobj_t() : nverts(0), nfaces(0), nedges(0) {}
+
+	bool init(coll_obj const &c) {
+		if (c.type == COLL_CUBE) {
+			for (unsigned i = 0; i < 8; ++i) {verts[nverts++] = point(c.d[0][i&1], c.d[1][(i>>1)&1], c.d[2][i>>2]);}
+			for (unsigned d = 0; d < 3; ++d) {vector3d n(zero_vector); n[d] = 1.0; faces[nfaces++] = edges[nedges++] = n;}
+			return 1;
+		}
+		if (c.type != COLL_POLYGON || c.npoints < 3 || c.npoints > N_COLL_POLY_PTS) return 0;
+
+		if (c.thickness > MIN_POLY_THICK) {
+			point pts[2][4];
+			gen_poly_planes(c.points, c.npoints, c.norm, c.thickness, pts);
+			for (unsigned j = 0; j < 2; ++j) {for (int i = 0; i < c.npoints; ++i) {verts[nverts++] = pts[j][i];}}
+			edges[nedges++] = c.norm;
+		}
+		else {
+			for (int i = 0; i < c.npoints; ++i) {verts[nverts++] = c.points[i];}
+		}
+		faces[nfaces++] = c.norm;
+
+		for (int i = 0; i < c.npoints; ++i) {
+			vector3d const edge((c.points[(i+1)%c.npoints] - c.points[i]).get_norm());
+			edges[nedges++] = edge;
+			faces[nfaces++] = cross_product(c.norm, edge); // side face normal
+		}
+		return 1;
+	}
+	void project(vector3d const &n, float &pmin, float &pmax) const {
+		pmin = pmax = dot_product(n, verts[0]);
+
+		for (unsigned i = 1; i < nverts; ++i) {
+			float const val(dot_product(n, verts[i]));
+			pmin = min(pmin, val);
+			pmax = max(pmax, val);
+		}
+	}
+};
+
+// swept separating axis test; skipping near-degenerate edge cross products only widens the range, which is conservative
+bool clip_swept_convex_range(convex_cobj_t const &a, convex_cobj_t const &b, vector3d const &v, float &t1, float &t2) {
+
+	vector3d axes[2*(N_COLL_POLY_PTS+1) + (N_COLL_POLY_PTS+1)*(N_COLL_POLY_PTS+1)];
+	unsigned naxes(0);
+	for (unsigned i = 0; i < a.nfaces; ++i) {axes[naxes++] = a.faces[i];}
+	for (unsigned i = 0; i < b.nfaces; ++i) {axes[naxes++] = b.faces[i];}
+
+	for (unsigned i = 0; i < a.nedges; ++i) {
+		for (unsigned j = 0; j < b.nedges; ++j) {
+			vector3d const n(cross_product(a.edges[i], b.edges[j]));
+			if (n.mag_sq() > 1.0E-8) {axes[naxes++] = n;}
+		}
+	}
+	for (unsigned i = 0; i < naxes; ++i) {
+		float a1, a2, b1, b2;
+		a.project(axes[i], a1, a2);
+		b.project(axes[i], b1, b2);
+		if (!clip_swept_range(a1, a2, b1, b2, dot_product(v, axes[i]), t1, t2)) return 0;
+	}
+	return 1;
+}
+
+// returns 0 if this pair of cobj types isn't supported; otherwise sets [t_enter, t_exit], where t_enter > t_exit means no intersection for any t
+bool get_cobj_move_toi(coll_obj const &c1, coll_obj const &c2, vector3d const &delta, float tolerance, float &t_enter, float &t_exit) {
+
+	if (c2.type < c1.type) {return get_cobj_move_toi(c2, c1, -delta, tolerance, t_enter, t_exit);} // swap so that c1.type <= c2.type; relative motion is reversed
+	t_enter = -FLT_MAX; t_exit = FLT_MAX;
+	bool hit(1);
+	// bcube test, same as cube_t::intersects() with tolerance; valid for all cobj types
+	for (unsigned d = 0; d < 3 && hit; ++d) {hit = clip_swept_range(c1.d[d][0]+tolerance, c1.d[d][1]-tolerance, c2.d[d][0], c2.d[d][1], delta[d], t_enter, t_exit);}
+
+	if (hit) {
+		if (c1.type == COLL_CUBE && c2.type == COLL_CUBE) {} // bcube test is exact
+		else if (c1.type == COLL_CUBE && c2.type == COLL_CYLINDER) { // vertical cylinder; z-range is handled by the bcube test
+			hit = clip_swept_circle_rect_range(c2.points[0], -delta, (c2.radius - tolerance), c1, t_enter, t_exit);
+		}
+		else if (c1.type == COLL_CYLINDER && c2.type == COLL_CYLINDER) {
+			vector3d const dp((c1.points[0].x - c2.points[0].x), (c1.points[0].y - c2.points[0].y), 0.0);
+			hit = clip_swept_sphere_range(dp, vector3d(delta.x, delta.y, 0.0), (c1.radius + c2.radius - tolerance), t_enter, t_exit);
+		}
+		else if (c1.type == COLL_SPHERE && c2.type == COLL_SPHERE) {
+			hit = clip_swept_sphere_range((c1.points[0] - c2.points[0]), delta, (c1.radius + c2.radius - tolerance), t_enter, t_exit);
+		}
+		else if ((c1.type == COLL_CUBE || c1.type == COLL_POLYGON) && c2.type == COLL_POLYGON) {
+			convex_cobj_t cc1, cc2;
+			if (!cc1.init(c1) || !cc2.init(c2)) return 0; // non-convex polygon?
+			hit = clip_swept_convex_range(cc1, cc2, delta, t_enter, t_exit);
+		}
+		else return 0; // not supported
+	}
+	if (!hit) {t_enter = 1.0; t_exit = 0.0;} // empty
+	return 1;
+}
+
+float get_max_cobj_move_delta(coll_obj const &c1, coll_obj const &c2, vector3d const &delta, float step_thresh, float tolerance=0.0, bool use_toi=1) {
 
 	assert(step_thresh > 0.0);
+	float t_enter(0.0), t_exit(0.0);
+
+	if (use_toi && get_cobj_move_toi(c1, c2, delta, tolerance, t_enter, t_exit)) {
+		if (t_enter > t_exit || t_enter > 1.0 || t_exit < 0.0) return 1.0; // no intersection over the range of movement
+		
+		if (t_enter > 0.0) { // else already in contact; use binary search
+			float const valid_t(max(0.0f, (t_enter - step_thresh))); // back off slightly from the contact point to account for FP error
+			coll_obj test_cobj(c1); // deep copy
+			test_cobj.cgroup_id = -1;
+			test_cobj.shift_by(valid_t*delta);
+			if (!test_cobj.intersects_cobj(c2, tolerance)) return valid_t; // verified; else use binary search
+		}
+	}
 	float valid_t(0.0), prev_t(0.0);
 	unsigned num_iters(0);
 	coll_obj test_cobj(c1); // deep copy
@@ -716,7 +895,7 @@ float get_max_cobj_move_delta(coll_obj const &c1, coll_obj const &c2, vector3d c
 	return valid_t;
 }
 
-bool binary_step_moving_cobj_delta(coll_obj const &cobj, vector<unsigned> const &cobjs, vector3d &delta, float tolerance=0.0) {
+template<typename A> bool binary_step_moving_cobj_delta(coll_obj const &cobj, vector<unsigned, A> const &cobjs, vector3d &delta, float tolerance=0.0) {
 
 	float step_thresh(0.001);
 
@@ -725,7 +904,7 @@ bool binary_step_moving_cobj_delta(coll_obj const &cobj, vector<unsigned> const
 		// moving object resting (stacked) on cobj, ignore it
 		if (cobj.has_flat_top_bot() && c.has_flat_top_bot() && c.is_movable() && c.get_cube_center().z > cobj.d[2][1]) continue;
 		if (cobj.intersects_cobj(c, 1.5*tolerance)) return 0; // intersects at the starting location, don't allow it to move (stuck) (larger tolerance to allow for slight movement)
-		float const valid_t(get_max_cobj_move_delta(cobj, c, delta, step_thresh, tolerance));
+		float const valid_t(get_max_cobj_move_delta(cobj, c, delta, step_thresh, tolerance, movable_cobj_use_toi));
 		if (valid_t < TOLERANCE) return 0; // can't move (avoid div-by-zero and negative t)
 		step_thresh /= valid_t; // adjust thresh to avoid tiny steps for large number of cobjs
 		delta       *= valid_t;
@@ -733,7 +912,7 @@ bool binary_step_moving_cobj_delta(coll_obj const &cobj, vector<unsigned> const
 	return 1;
 }
 
-bool intersects_any_cobj(coll_obj const &cobj, vector<unsigned> const &cobjs, float tolerance=0.0) {
+template<typename A> bool intersects_any_cobj(coll_obj const &cobj, vector<unsigned, A> const &cobjs, float tolerance=0.0) {
 
 	for (auto i = cobjs.begin(); i != cobjs.end(); ++i) {
 		if (cobj.intersects_cobj(coll_objects.get_cobj(*i), tolerance)) return 1;
@@ -749,7 +928,7 @@ void register_moving_cobj(unsigned index) {
 void check_moving_cobj_int_with_dynamic_objs(unsigned index, vector3d const &delta) {
 
 	coll_obj &cobj(coll_objects.get_cobj(index));
-	vector<unsigned> cobjs;
+	frame_vector<unsigned> cobjs;
 
 	// wake up adjacent/nearby moving cobjs in case they need to move
 	cube_t bcube(cobj);
@@ -891,7 +1070,7 @@ void check_cobj_alignment(unsigned index) {
 }
 
 
-void remove_cobjs_with_same_cgroup(coll_obj const &cobj, vector<unsigned> &cobjs) {
+template<typename A> void remove_cobjs_with_same_cgroup(coll_obj const &cobj, vector<unsigned, A> &cobjs) {
 
 	if (cobj.cgroup_id < 0) return; // not in a group
 
@@ -1001,7 +1180,7 @@ vector3d get_cobj_drop_delta(unsigned index) {
 			}
 		}
 		delta = 0.05*cobj_height*move_dir; // move 5% of cobj height
-		set<unsigned> seen;
+		frame_set<unsigned> seen;
 		push_cobj(index, delta, seen, all_zeros); // return value is ignored
 		return zero_vector; // done
 	}
@@ -1092,7 +1271,7 @@ void shift_cobj_up_down(coll_obj &cobj, unsigned index, vector3d const &delta) {
 	check_moving_cobj_int_with_dynamic_objs(index, delta);
 }
 
-void try_drop_movable_cobj(unsigned index, set<unsigned> &seen) {
+void try_drop_movable_cobj(unsigned index, frame_set<unsigned> &seen) {
 
 	if (seen.find(index) != seen.end()) return; // already seen (needed for grouped cobjs)
 	coll_obj &cobj(coll_objects.get_cobj(index));
@@ -1123,7 +1302,7 @@ void try_drop_movable_cobj(unsigned index, set<unsigned> &seen) {
 }
 
 
-int check_push_cobj(unsigned index, vector3d &delta, set<unsigned> &seen, point const &pushed_from, float &delta_z) {
+int check_push_cobj(unsigned index, vector3d &delta, frame_set<unsigned> const &seen, point const &pushed_from, float &delta_z) {
 
 	delta_z = 0.0;
 	coll_obj &cobj(coll_objects.get_cobj(index));
@@ -1145,26 +1324,13 @@ int check_push_cobj(unsigned index, vector3d &delta, set<unsigned> &seen, point
 	bcube += delta; // move to new pos
 	bcube.union_with_cube(cobj); // union of original and new pos
 	bcube.expand_by(-tolerance); // shrink slightly to avoid false collisions (in prticular with extruded polygons)
-	vector<unsigned> cobjs;
+	frame_vector<unsigned> cobjs;
 	get_intersecting_cobjs_tree(bcube, cobjs, index, tolerance, 0, 0, -1); // duplicates should be okay
 	remove_cobjs_with_same_cgroup(cobj, cobjs);
 	vector3d const start_delta(delta);
 	
-	if (cobj.type == COLL_CUBE) { // check for horizontally stackable movable cobjs - limited to cubes for now
-		seen.insert(index);
-
-		for (unsigned i = 0; i < cobjs.size(); ++i) {
-			unsigned const cid(cobjs[i]);
-			coll_obj const &c(coll_objects.get_cobj(cid));
-			if (!c.is_movable() || c.type != COLL_CUBE) continue;
-			if (!cobj.intersects_cobj(c, -tolerance))   continue; // no initial intersection/adjacency
-			if (seen.find(cid) != seen.end())           continue; // prevent infinite recursion
-			seen.insert(cid);
-			vector3d delta2(delta);
-			if (!push_cobj(cid, delta2, seen, cobj.get_cube_center())) return 0; // can't push (recursive call)
-			delta = delta2; // update with maybe reduced delta
-			cobjs[i] = cobjs.back(); cobjs.pop_back(); --i; // remove this cobj
-		}
+	for (unsigned i = 0; i < cobjs.size(); ++i) { // remove cobjs from the push contact group, which have already moved out of the way or are behind this cobj
+		if (seen.find(cobjs[i]) != seen.end()) {cobjs[i] = cobjs.back(); cobjs.pop_back(); --i;}
 	}
 	if (!binary_step_moving_cobj_delta(cobj, cobjs, delta, tolerance)) { // failed to move
 		// if there is a ledge (cobj z top) slightly above the bottom of the cobj, maybe we can lift it up;
@@ -1245,7 +1411,59 @@ void move_cobj_and_update_state(unsigned index, vector3d const &cobj_delta) {
 	check_moving_cobj_int_with_dynamic_objs(index, cobj_delta);
 }
 
-bool push_cobj(unsigned index, vector3d &delta, set<unsigned> &seen, point const &pushed_from) {
+void add_cobj_and_cgroup(unsigned index, frame_set<unsigned> &seen) {
+
+	seen.insert(index);
+	int const cgroup_id(coll_objects.get_cobj(index).cgroup_id);
+	if (cgroup_id < 0) return;
+	cobj_id_set_t const &group(cobj_groups.get_set(cgroup_id));
+	for (auto i = group.begin(); i != group.end(); ++i) {seen.insert(*i);}
+}
+
+// finds the movable cubes adjacent to index in the direction of the push, then the cubes adjacent to those, etc.;
+// breadth first, so that long rows of cubes are handled iteratively rather than with a recursive call per cube
+void get_push_contact_group(unsigned index, vector3d const &delta, frame_set<unsigned> &seen, point const &pushed_from, frame_vector<pair<unsigned, point>> &group) {
+
+	float const tolerance(1.0E-6);
+	vector3d const push_delta(delta.x, delta.y, 0.0); // objects can only be pushed in xy
+	frame_vector<unsigned> cobjs, members;
+	group.clear();
+	group.emplace_back(index, pushed_from);
+	add_cobj_and_cgroup(index, seen);
+
+	for (unsigned n = 0; n < group.size(); ++n) { // Note: group grows during iteration
+		int const cgroup_id(coll_objects.get_cobj(group[n].first).cgroup_id);
+		members.clear();
+
+		if (cgroup_id >= 0) { // grouped cobj: check the whole group
+			cobj_id_set_t const &cgroup(cobj_groups.get_set(cgroup_id));
+			members.insert(members.end(), cgroup.begin(), cgroup.end());
+		}
+		else {members.push_back(group[n].first);}
+
+		for (auto m = members.begin(); m != members.end(); ++m) {
+			coll_obj const &cobj(coll_objects.get_cobj(*m));
+			if (!cobj.is_movable() || cobj.type != COLL_CUBE) continue; // check for horizontally stackable movable cobjs - limited to cubes for now
+			cube_t bcube(cobj); // orig pos
+			bcube += push_delta; // move to new pos
+			bcube.union_with_cube(cobj); // union of original and new pos
+			bcube.expand_by(-tolerance);
+			cobjs.clear();
+			get_intersecting_cobjs_tree(bcube, cobjs, *m, tolerance, 0, 0, -1);
+
+			for (auto i = cobjs.begin(); i != cobjs.end(); ++i) {
+				coll_obj const &c(coll_objects.get_cobj(*i));
+				if (!c.is_movable() || c.type != COLL_CUBE) continue;
+				if (seen.find(*i) != seen.end())            continue; // already in the group
+				if (!cobj.intersects_cobj(c, -tolerance))   continue; // no initial intersection/adjacency
+				add_cobj_and_cgroup(*i, seen);
+				group.emplace_back(*i, cobj.get_cube_center());
+			}
+		} // for m
+	} // for n
+}
+
+bool push_cobj_or_cgroup(unsigned index, vector3d &delta, frame_set<unsigned> const &seen, point const &pushed_from) {
 
 	coll_obj &cobj(coll_objects.get_cobj(index));
 	cobj_id_set_t const *group(nullptr);
@@ -1257,7 +1475,6 @@ bool push_cobj(unsigned index, vector3d &delta, set<unsigned> &seen, point const
 		float max_dz(0.0);
 		
 		for (auto i = group->begin(); i != group->end(); ++i) { // if this cobj in a a group, we need to push the whole group (or fail)
-			seen.insert(*i); // prevent infinite recursion
 			int const ret(check_push_cobj(*i, delta, seen, pushed_from, delta_z));
 			if (ret == 0) return 0; // not pushed, not moved up
 			if (ret == 2) {max_dz = max(max_dz, delta_z);}
@@ -1290,8 +1507,22 @@ bool push_cobj(unsigned index, vector3d &delta, set<unsigned> &seen, point const
 	return 1; // moved
 }
 
+bool push_cobj(unsigned index, vector3d &delta, frame_set<unsigned> &seen, point const &pushed_from) {
+
+	frame_vector<pair<unsigned, point>> group;
+	get_push_contact_group(index, delta, seen, pushed_from, group);
+
+	// push the cobjs farthest from index first so that each one moves out of the way of the one pushing it
+	for (auto i = group.rbegin(); i != group.rend(); ++i) {
+		vector3d delta2(delta);
+		if (!push_cobj_or_cgroup(i->first, delta2, seen, i->second)) return 0; // can't push
+		delta = delta2; // update with maybe reduced delta
+	}
+	return 1; // moved
+}
+
 bool push_movable_cobj(unsigned index, vector3d &delta, point const &pushed_from) {
-	set<unsigned> seen;
+	frame_set<unsigned> seen;
 	return push_cobj(index, delta, seen, pushed_from);
 }
 
@@ -1325,10 +1556,186 @@ bool proc_movable_cobj(point const &orig_pos, point &player_pos, unsigned index,
 	return 1; // moved
 }
 
+coll_obj make_bench_cube(cube_t const &cube) {
+
+	coll_obj cobj;
+	cobj.copy_from(cube);
+	cobj.type   = COLL_CUBE;
+	cobj.status = COLL_STATIC;
+	cobj.fixed  = 1;
+	cobj.cp.flags |= COBJ_MOVABLE;
+	return cobj;
+}
+
+// moves each cube toward end_cobj by up to delta, starting with the one closest to end_cobj; returns the number of intersecting cube pairs
+unsigned move_bench_stack(vector<coll_obj> &cubes, coll_obj const &end_cobj, vector3d const &delta, bool use_toi) {
+
+	float const tolerance(1.0E-6);
+	unsigned num_ints(0);
+
+	for (unsigned i = 0; i < cubes.size(); ++i) {
+		coll_obj const &next((i == 0) ? end_cobj : cubes[i-1]);
+		cubes[i].shift_by(get_max_cobj_move_delta(cubes[i], next, delta, 0.001, tolerance, use_toi)*delta);
+		num_ints += (cubes[i].intersects_cobj(next, tolerance) != 0);
+	}
+	return num_ints;
+}
+
+// GL-free benchmark of the TOI solver vs. binary search: pushes a row of N cubes against a wall and drops a stack of N cubes onto a floor;
+// uses standalone cobjs rather than the scene's cobjs, so the results don't depend on the current scene; enabled with the "movable_cobj_bench" config option
+void run_movable_cobj_benchmark() {
+
+	unsigned const NUM_STEPS = 1000, sizes[3] = {16, 64, 256};
+	float const sz(0.1), gap(0.05*sz), step_dist(0.02*gap);
+	coll_obj const wall (make_bench_cube(cube_t(-sz, 0.0, -sz, sz, -sz, sz)));
+	coll_obj const floor(make_bench_cube(cube_t(-sz, sz, -sz, sz, -sz, 0.0)));
+
+	for (unsigned n = 0; n < 3; ++n) {
+		vector<coll_obj> cubes[2][2]; // {TOI, binary search} x {row, stack}
+		unsigned num_ints[2] = {0, 0};
+		int times[2] = {0, 0};
+
+		for (unsigned pass = 0; pass < 2; ++pass) {
+			for (unsigned i = 0; i < sizes[n]; ++i) {
+				float const pos(gap + i*(sz + gap));
+				cubes[pass][0].push_back(make_bench_cube(cube_t(pos, pos+sz, -0.5*sz, 0.5*sz, 0.0, sz))); // row along +x
+				cubes[pass][1].push_back(make_bench_cube(cube_t(-0.5*sz, 0.5*sz, -0.5*sz, 0.5*sz, pos, pos+sz))); // stack along +z
+			}
+			int const start_time(GET_TIME_MS());
+
+			for (unsigned s = 0; s < NUM_STEPS; ++s) {
+				num_ints[pass] += move_bench_stack(cubes[pass][0], wall,  vector3d(-step_dist, 0.0, 0.0), (pass == 0)); // push
+				num_ints[pass] += move_bench_stack(cubes[pass][1], floor, vector3d(0.0, 0.0, -step_dist), (pass == 0)); // drop
+			}
+			times[pass] = GET_TIME_MS() - start_time;
+		} // for pass
+		float max_diff(0.0); // max final position difference between TOI and binary search
+
+		for (unsigned d = 0; d < 2; ++d) {
+			for (unsigned i = 0; i < sizes[n]; ++i) {max_diff = max(max_diff, p2p_dist(cubes[0][d][i].get_cube_center(), cubes[1][d][i].get_cube_center()));}
+		}
+		cout << "Movable cobj benchmark: " << sizes[n] << " cubes, " << NUM_STEPS << " steps, TOI " << times[0] << "ms, binary search " << times[1]
+			 << "ms, intersections " << num_ints[0] << "/" << num_ints[1] << ", max pos diff " << max_diff << endl;
+	} // for n
+}
+
+// adds a movable (or fixed) cube to the scene; used for the live part of the benchmark
+unsigned add_bench_scene_cube(cube_t cube, bool movable) {
+
+	cobj_params cp(0.5, WHITE, 0, 0); // not drawn
+	if (movable) {cp.flags |= COBJ_MOVABLE;}
+	unsigned const index(add_coll_cube(cube, cp, -1, 0));
+	coll_objects.get_cobj(index).fixed = 1; // so that it can be re-added when moved
+	moving_cobjs.insert(index); // include in cobj_tree_static_moving
+	return index;
+}
+
+unsigned count_bench_cube_ints(vector<unsigned> const &cids) {
+
+	unsigned num_ints(0);
+
+	for (unsigned i = 0; i < cids.size(); ++i) {
+		for (unsigned j = i+1; j < cids.size(); ++j) {num_ints += (coll_objects.get_cobj(cids[i]).intersects_cobj(coll_objects.get_cobj(cids[j]), 1.0E-6) != 0);}
+	}
+	return num_ints;
+}
+
+unsigned count_resting_bench_cubes(vector<unsigned> const &stack, float floor_z, float tolerance) { // cubes resting on the floor or the cube below
+
+	unsigned num(0);
+
+	for (unsigned i = 0; i < stack.size(); ++i) {
+		float const below_z((i == 0) ? floor_z : coll_objects.get_cobj(stack[i-1]).d[2][1]);
+		num += (fabs(coll_objects.get_cobj(stack[i]).d[2][0] - below_z) < tolerance);
+	}
+	return num;
+}
+
+unsigned get_push_group_size(unsigned index, vector3d const &delta) {
+
+	frame_set<unsigned> seen;
+	frame_vector<pair<unsigned, point>> group;
+	get_push_contact_group(index, delta, seen, all_zeros, group);
+	return group.size();
+}
+
+// pushes a row of N scene cubes against a wall with push_movable_cobj() and drops a stack of N scene cubes onto a floor with try_drop_movable_cobj(),
+// once with the TOI solver and once with binary search; the cubes are placed above the scene so that they don't interact with existing cobjs, and are removed after
+void run_live_movable_cobj_benchmark() {
+
+	unsigned const NUM_FRAMES = 1000, sizes[2] = {16, 64};
+	float const sz(0.4*min(X_SCENE_SIZE, Y_SCENE_SIZE)/(1.05*sizes[1])), gap(0.05*sz), step_dist(0.1*gap), base_z(max(czmax, ztop) + 2.0*sz);
+	float const saved_czmin(czmin), saved_czmax(czmax);
+	bool const saved_use_toi(movable_cobj_use_toi);
+	// save the collision matrix cells under the cubes, since adding cobjs expands their z ranges
+	int const x1(max(0, get_xpos_clamp(-2.0*sz)-1)), y1(max(0, get_ypos_clamp(-sz)-1));
+	int const x2(min(MESH_X_SIZE-1, get_xpos_clamp(0.45*X_SCENE_SIZE)+1)), y2(min(MESH_Y_SIZE-1, get_ypos_clamp(4.0*sz)+1));
+	vector<coll_cell> saved_cells;
+	for (int y = y1; y <= y2; ++y) {saved_cells.insert(saved_cells.end(), v_collision_matrix[y]+x1, v_collision_matrix[y]+x2+1);}
+
+	for (unsigned n = 0; n < 2; ++n) {
+		vector<point> final_pos[2];
+
+		for (unsigned pass = 0; pass < 2; ++pass) { // {TOI, binary search}
+			movable_cobj_use_toi = (pass == 0);
+			vector<unsigned> row, stack, all;
+			all.push_back(add_bench_scene_cube(cube_t(-sz, 0.0, -0.5*sz, 0.5*sz, base_z, base_z+sz), 0)); // wall
+			all.push_back(add_bench_scene_cube(cube_t(-sz, sz, 2.5*sz, 3.5*sz, base_z-sz, base_z), 0)); // floor
+
+			for (unsigned i = 0; i < sizes[n]; ++i) {
+				float const pos(gap + i*(sz + gap));
+				row  .push_back(add_bench_scene_cube(cube_t(pos, pos+sz, -0.5*sz, 0.5*sz, base_z, base_z+sz), 1)); // row along +x
+				stack.push_back(add_bench_scene_cube(cube_t(-0.5*sz, 0.5*sz, 2.5*sz, 3.5*sz, base_z+pos, base_z+pos+sz), 1)); // stack along +z
+			}
+			all.insert(all.end(), row  .begin(), row  .end());
+			all.insert(all.end(), stack.begin(), stack.end());
+			build_static_moving_cobj_tree();
+			vector3d const push_dir(-1.0, 0.0, 0.0);
+			unsigned const group_before(get_push_group_size(row.back(), sz*push_dir)), rest_before(count_resting_bench_cubes(stack, base_z, 0.02*gap));
+			unsigned num_pushed(0);
+			int const start_time(GET_TIME_MS());
+
+			for (unsigned f = 0; f < NUM_FRAMES; ++f) { // same order as proc_moving_cobjs(), followed by the per-frame BVH rebuild
+				vector3d delta(step_dist*push_dir);
+				coll_obj const &pusher(coll_objects.get_cobj(row.back()));
+				num_pushed += push_movable_cobj(row.back(), delta, (pusher.get_cube_center() - sz*push_dir));
+				frame_set<unsigned> seen;
+				for (auto i = stack.begin(); i != stack.end(); ++i) {try_drop_movable_cobj(*i, seen);} // stack is sorted bottom to top
+				build_static_moving_cobj_tree();
+			}
+			int const time(GET_TIME_MS() - start_time);
+			unsigned const group_after(get_push_group_size(row.back(), sz*push_dir)), rest_after(count_resting_bench_cubes(stack, base_z, 0.02*gap));
+			unsigned const num_ints(count_bench_cube_ints(all));
+			for (auto i = all.begin(); i != all.end(); ++i) {final_pos[pass].push_back(coll_objects.get_cobj(*i).get_cube_center());}
+			cout << "Live movable cobj benchmark (" << (pass ? "binary search" : "TOI") << "): " << sizes[n] << " cubes, " << NUM_FRAMES << " frames, " << time
+				 << "ms, push frames " << num_pushed << ", push group " << group_before << " => " << group_after << ", resting in stack " << rest_before << " => "
+				 << rest_after << ", intersections " << num_ints << endl;
+
+			for (auto i = all.begin(); i != all.end(); ++i) { // remove the cubes
+				coll_objects.get_cobj(*i).fixed = 0;
+				remove_coll_object(*i);
+				moving_cobjs.erase(*i);
+			}
+		} // for pass
+		float max_diff(0.0); // max final position difference between TOI and binary search
+		for (unsigned i = 0; i < final_pos[0].size(); ++i) {max_diff = max(max_diff, p2p_dist(final_pos[0][i], final_pos[1][i]));}
+		cout << "Live movable cobj benchmark: " << sizes[n] << " cubes, max pos diff " << max_diff << endl;
+	} // for n
+	for (int y = y1, ix = 0; y <= y2; ++y) {
+		for (int x = x1; x <= x2; ++x) {v_collision_matrix[y][x] = saved_cells[ix++];}
+	}
+	czmin = saved_czmin;
+	czmax = saved_czmax;
+	movable_cobj_use_toi = saved_use_toi;
+	build_static_moving_cobj_tree();
+}
+
 void proc_moving_cobjs() {
 
-	vector<pair<float, unsigned>> by_z1;
-	set<unsigned> seen;
+	if (movable_cobj_bench) {run_movable_cobj_benchmark(); run_live_movable_cobj_benchmark(); movable_cobj_bench = 0;} // run once
+	if (gjk_bench) {run_gjk_benchmark(); gjk_bench = 0;} // run once
+	frame_vector<pair<float, unsigned>> by_z1;
+	frame_set<unsigned> seen;
 
 	for (auto i = moving_cobjs.begin(); i != moving_cobjs.end();) {
 		coll_obj &cobj(coll_objects.get_cobj(*i));
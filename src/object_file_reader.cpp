@@ -15,7 +15,7 @@
 //#include "D:\Frank\Desktop\Open Source SW Code\tinyobjloader-master\tiny_obj_loader.h"
 
 
-extern bool use_obj_file_bump_grayscale;
+extern bool use_obj_file_bump_grayscale, model_simplify_bench;
 extern float model_auto_tc_scale, model_mat_lod_thresh;
 extern model3ds all_models;
 
@@ -810,6 +810,7 @@ bool write_model3d_file(string const &base_fn, model3d &cur_model) {
 
 bool read_3ds_file_model(string const &filename, model3d &model, geom_xform_t const &xf, int use_vertex_normals, bool verbose);
 bool read_3ds_file_pts(string const &filename, vector<coll_tquad> *ppts, geom_xform_t const &xf, colorRGBA const &def_c, bool verbose);
+void run_model_simplify_benchmark();
 
 
 void test_tiny_obj_loader(string const &filename) {
@@ -830,6 +831,7 @@ void test_tiny_obj_loader(string const &filename) {
 bool load_model_file(string const &filename, model3ds &models, geom_xform_t const &xf, int def_tid, colorRGBA const &def_c,
 	int reflective, float metalness, int recalc_normals, int group_cobjs_level, bool write_file, bool verbose)
 {
+	if (model_simplify_bench) {run_model_simplify_benchmark(); model_simplify_bench = 0;} // run once
 	string const ext(get_file_extension(filename, 0, 1));
 	models.push_back(model3d(filename, models.tmgr, def_tid, def_c, reflective, metalness, recalc_normals, group_cobjs_level));
 	model3d &cur_model(models.back());
@@ -340,7 +340,9 @@ void coll_obj::set_from_pts(point const *const pts, unsigned npts) {
 
 bool coll_obj::is_occluded_from_viewer(point const &viewer) const {
 
-	if (!(display_mode & 0x08) || occluders.empty()) return 0;
+	if (!(display_mode & 0x08)) return 0;
+	if (sw_occlusion_valid_for(viewer)) {return sw_cube_occluded(*this);}
+	if (occluders.empty()) return 0;
 	if (is_thin_poly()) {return is_occluded(occluders, points, npoints, viewer);}
 	point pts[8];
 	unsigned const ncorners(get_cube_corners(d, pts, viewer, 0)); // 8 corners allocated, but only 6 used
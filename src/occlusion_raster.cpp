@@ -0,0 +1,339 @@
+// 3D World - Software Occlusion Rasterizer
+// by 3DWorld contributors
+// 10/18/26
+
+#include "3DWorld.h"
+#include "collision_detect.h"
+#include <xmmintrin.h>
+#include <cfloat> // for FLT_MAX
+
+unsigned const OCC_TILE_SZ       = 8; // hierarchical Z tile size in pixels
+float    const MIN_OCCLUDER_SIZE = 0.02; // min bounding radius / distance for an occluder
+float    const OCC_DEPTH_BIAS    = 1.0E-4; // relative 1/z bias to prevent self occlusion from rounding error
+
+bool use_sw_occlusion(1), occlusion_bench(0);
+unsigned sw_occlusion_width(256), sw_max_occluders(128);
+
+extern int display_mode, world_mode;
+extern float NEAR_CLIP, FAR_CLIP, CAMERA_RADIUS;
+extern double camera_zh;
+extern pos_dir_up camera_pdu;
+extern coll_obj_group coll_objects;
+
+
+// low resolution depth buffer of the largest on-screen occluders, with a tile level hierarchical Z for fast cube tests;
+// depth is stored as 1/z (view space), so 0.0 is empty and larger values are closer to the viewer;
+// ground mode only: buildings and tiled terrain don't fill or query the raster yet
+class occlusion_raster_t {
+
+	struct screen_tri_t {
+		float x[3], y[3], iz[3]; // pixel coords and 1/z
+		int y1, y2; // inclusive pixel row range
+	};
+	unsigned w, h, tw, th; // size in pixels and tiles
+	float xscale, yscale; // view space to NDC
+	vector<float> depth, tile_min; // nearest occluder per pixel, farthest occluder per tile
+	vector<screen_tri_t> tris;
+	vector<pair<float, unsigned>> cands; // {size, cobj index}
+	vector<unsigned> undrawn_ids; // model3d collision cobjs, which are occluders but aren't drawn
+	pos_dir_up pdu;
+	bool valid;
+
+	point to_view(point const &p) const {
+		vector3d const v(p - pdu.pos);
+		return point(dot_product(v, pdu.cp), dot_product(v, pdu.upv_), dot_product(v, pdu.dir));
+	}
+	void project(point const &v, float &sx, float &sy) const {
+		float const iz(1.0/v.z);
+		sx = 0.5*w*(1.0 + xscale*v.x*iz);
+		sy = 0.5*h*(1.0 + yscale*v.y*iz);
+	}
+	void add_tri(float const x[3], float const y[3], float const iz[3]);
+	void add_polygon(point const *const pts, unsigned npts);
+	void add_cobj(coll_obj const &c);
+	void maybe_add_cand(unsigned cix);
+	void raster_tile_row(unsigned ty);
+
+public:
+	unsigned num_occluders;
+
+	occlusion_raster_t() : w(0), h(0), tw(0), th(0), xscale(1.0), yscale(1.0), valid(0), num_occluders(0) {}
+	void invalidate() {valid = 0;}
+	bool is_valid_for(point const &viewer) const {return (valid && viewer == pdu.pos);}
+	void update(pos_dir_up const &pdu_);
+	bool is_cube_occluded(cube_t const &c) const;
+};
+
+
+void occlusion_raster_t::add_tri(float const x[3], float const y[3], float const iz[3]) {
+
+	float const area((x[1] - x[0])*(y[2] - y[0]) - (x[2] - x[0])*(y[1] - y[0]));
+	if (fabs(area) < 0.01) return; // degenerate or sub-pixel
+	float const xmin(min(x[0], min(x[1], x[2]))), xmax(max(x[0], max(x[1], x[2])));
+	float const ymin(min(y[0], min(y[1], y[2]))), ymax(max(y[0], max(y[1], y[2])));
+	if (xmax < 0.0 || xmin > w || ymax < 0.0 || ymin > h) return; // off screen
+	screen_tri_t tri;
+	for (unsigned i = 0; i < 3; ++i) {tri.x[i] = x[i]; tri.y[i] = y[i]; tri.iz[i] = iz[i];}
+	tri.y1 = max(0, (int)ceil(ymin - 0.5)); // sample at pixel centers
+	tri.y2 = min(int(h)-1, (int)floor(ymax - 0.5));
+	if (tri.y1 <= tri.y2) {tris.push_back(tri);}
+}
+
+void occlusion_raster_t::add_polygon(point const *const pts, unsigned npts) {
+
+	assert(npts >= 3 && npts <= N_COLL_POLY_PTS);
+	point vpts[N_COLL_POLY_PTS], clipped[N_COLL_POLY_PTS+1];
+	unsigned nclip(0);
+	for (unsigned i = 0; i < npts; ++i) {vpts[i] = to_view(pts[i]);}
+
+	for (unsigned i = 0; i < npts; ++i) { // clip to the near plane
+		point const &a(vpts[i]), &b(vpts[(i+1)%npts]);
+		bool const a_in(a.z >= pdu.near_), b_in(b.z >= pdu.near_);
+		if (a_in) {clipped[nclip++] = a;}
+		if (a_in != b_in) {clipped[nclip++] = a + (b - a)*((pdu.near_ - a.z)/(b.z - a.z));}
+	}
+	if (nclip < 3) return; // behind the viewer
+	float x[N_COLL_POLY_PTS+1], y[N_COLL_POLY_PTS+1], iz[N_COLL_POLY_PTS+1];
+
+	for (unsigned i = 0; i < nclip; ++i) {
+		project(clipped[i], x[i], y[i]);
+		iz[i] = 1.0/clipped[i].z;
+	}
+	for (unsigned i = 1; i+1 < nclip; ++i) { // triangle fan
+		float const tx[3] = {x[0], x[i], x[i+1]}, ty[3] = {y[0], y[i], y[i+1]}, tiz[3] = {iz[0], iz[i], iz[i+1]};
+		add_tri(tx, ty, tiz);
+	}
+}
+
+void occlusion_raster_t::add_cobj(coll_obj const &c) {
+
+	if (c.type == COLL_POLYGON) {add_polygon(c.points, c.npoints); return;}
+	assert(c.type == COLL_CUBE);
+
+	for (unsigned dim = 0; dim < 3; ++dim) { // add front faces only
+		unsigned const d1((dim+1)%3), d2((dim+2)%3);
+
+		for (unsigned dir = 0; dir < 2; ++dir) {
+			if (dir ? (pdu.pos[dim] <= c.d[dim][1]) : (pdu.pos[dim] >= c.d[dim][0])) continue; // back face
+			point pts[4];
+
+			for (unsigned i = 0; i < 4; ++i) {
+				pts[i][dim] = c.d[dim][dir];
+				pts[i][d1]  = c.d[d1][(i == 1 || i == 2)];
+				pts[i][d2]  = c.d[d2][(i >= 2)];
+			}
+			add_polygon(pts, 4);
+		} // for dir
+	} // for dim
+}
+
+void occlusion_raster_t::maybe_add_cand(unsigned cix) {
+
+	coll_obj const &c(coll_objects.get_cobj(cix));
+	if (c.group_id >= 0 || !c.is_occluder() || c.contains_pt(pdu.pos)) return; // Note: is_occluder() accepts model3d cobjs that are not drawn
+	point center;
+	float brad;
+	c.bounding_sphere(center, brad);
+	float const size(brad/max(pdu.near_, (p2p_dist(pdu.pos, center) - brad)));
+	if (size < MIN_OCCLUDER_SIZE || !c.check_pdu_visible(pdu)) return;
+	cands.push_back(make_pair(size, cix));
+}
+
+void occlusion_raster_t::raster_tile_row(unsigned ty) {
+
+	int const r1(ty*OCC_TILE_SZ), r2(r1 + OCC_TILE_SZ);
+	__m128 const xoffs(_mm_set_ps(3.5, 2.5, 1.5, 0.5)), zero(_mm_setzero_ps());
+
+	for (auto t = tris.begin(); t != tris.end(); ++t) {
+		int const y1(max(r1, t->y1)), y2(min(r2-1, t->y2));
+		if (y1 > y2) continue;
+		float const area((t->x[1] - t->x[0])*(t->y[2] - t->y[0]) - (t->x[2] - t->x[0])*(t->y[1] - t->y[0]));
+		float const sign((area < 0.0) ? -1.0 : 1.0), inv_area(1.0/fabs(area));
+		float ea[3], eb[3], ec[3]; // edge functions, positive inside; edge i is opposite vertex (i+2)%3
+		float za(0.0), zb(0.0), zc(0.0); // 1/z plane equation
+
+		for (unsigned i = 0; i < 3; ++i) {
+			unsigned const j((i+1)%3), k((i+2)%3);
+			ea[i] = sign*(t->y[i] - t->y[j]);
+			eb[i] = sign*(t->x[j] - t->x[i]);
+			ec[i] = sign*(t->x[i]*t->y[j] - t->x[j]*t->y[i]);
+			za += ea[i]*t->iz[k]*inv_area;
+			zb += eb[i]*t->iz[k]*inv_area;
+			zc += ec[i]*t->iz[k]*inv_area;
+		}
+		int const x1(max(0, (int)floor(min(t->x[0], min(t->x[1], t->x[2])))) & ~3); // align to 4 pixels
+		int const x2(min(int(w), (int)ceil(max(t->x[0], max(t->x[1], t->x[2])))));
+		__m128 const ea0(_mm_set1_ps(ea[0])), ea1(_mm_set1_ps(ea[1])), ea2(_mm_set1_ps(ea[2])), zav(_mm_set1_ps(za));
+
+		for (int y = y1; y <= y2; ++y) {
+			float const py(y + 0.5);
+			__m128 const eby0(_mm_set1_ps(eb[0]*py + ec[0])), eby1(_mm_set1_ps(eb[1]*py + ec[1])), eby2(_mm_set1_ps(eb[2]*py + ec[2])), zby(_mm_set1_ps(zb*py + zc));
+			float *const row(&depth[y*w]);
+
+			for (int x = x1; x < x2; x += 4) { // 4 pixels at a time
+				__m128 const px(_mm_add_ps(_mm_set1_ps(float(x)), xoffs));
+				__m128 mask(_mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(ea0, px), eby0), zero));
+				mask = _mm_and_ps(mask, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(ea1, px), eby1), zero));
+				mask = _mm_and_ps(mask, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(ea2, px), eby2), zero));
+				if (_mm_movemask_ps(mask) == 0) continue;
+				__m128 const cur(_mm_loadu_ps(row + x)), z(_mm_max_ps(cur, _mm_add_ps(_mm_mul_ps(zav, px), zby)));
+				_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(mask, z), _mm_andnot_ps(mask, cur)));
+			}
+		} // for y
+	} // for t
+	for (unsigned tx = 0; tx < tw; ++tx) { // update hierarchical Z
+		__m128 zmin(_mm_set1_ps(FLT_MAX));
+
+		for (int y = r1; y < r2; ++y) {
+			float const *const row(&depth[y*w + tx*OCC_TILE_SZ]);
+			for (unsigned x = 0; x < OCC_TILE_SZ; x += 4) {zmin = _mm_min_ps(zmin, _mm_loadu_ps(row + x));}
+		}
+		float vals[4];
+		_mm_storeu_ps(vals, zmin);
+		tile_min[ty*tw + tx] = min(min(vals[0], vals[1]), min(vals[2], vals[3]));
+	}
+}
+
+void occlusion_raster_t::update(pos_dir_up const &pdu_) {
+
+	valid = 0;
+	num_occluders = 0;
+	if (!pdu_.valid || !(display_mode & 0x08) || world_mode != WMODE_GROUND) return;
+	pdu = pdu_;
+	pdu.dir.normalize();
+	pdu.upv_.normalize();
+	pdu.cp.normalize();
+	assert(pdu.A > 0.0 && pdu.tterm > 0.0);
+	w  = max(OCC_TILE_SZ, (sw_occlusion_width/OCC_TILE_SZ)*OCC_TILE_SZ);
+	h  = max(OCC_TILE_SZ, unsigned(w/(OCC_TILE_SZ*pdu.A) + 0.5)*OCC_TILE_SZ);
+	tw = w/OCC_TILE_SZ;
+	th = h/OCC_TILE_SZ;
+	xscale = 1.0/(pdu.tterm*pdu.A);
+	yscale = 1.0/pdu.tterm;
+	depth.resize(w*h);
+	tile_min.resize(tw*th);
+	std::fill(depth.begin(), depth.end(), 0.0);
+	cands.clear();
+	tris.clear();
+
+	undrawn_ids.clear();
+	get_undrawn_occluder_ids(undrawn_ids);
+	// select the largest occluders in screen space
+	for (auto i = coll_objects.drawn_ids.begin(); i != coll_objects.drawn_ids.end(); ++i) {maybe_add_cand(*i);}
+	for (auto i = undrawn_ids.begin(); i != undrawn_ids.end(); ++i) {maybe_add_cand(*i);}
+	if (cands.size() > sw_max_occluders) {
+		std::nth_element(cands.begin(), cands.begin()+sw_max_occluders, cands.end(), std::greater<pair<float, unsigned>>());
+		cands.resize(sw_max_occluders);
+	}
+	for (auto i = cands.begin(); i != cands.end(); ++i) {add_cobj(coll_objects.get_cobj(i->second));}
+	num_occluders = cands.size();
+
+#pragma omp parallel for schedule(dynamic,1)
+	for (int ty = 0; ty < (int)th; ++ty) {raster_tile_row(ty);} // each thread owns a row of tiles
+	valid = 1;
+}
+
+bool occlusion_raster_t::is_cube_occluded(cube_t const &c) const {
+
+	if (!valid) return 0;
+	float xmin(FLT_MAX), xmax(-FLT_MAX), ymin(FLT_MAX), ymax(-FLT_MAX), iz_near(0.0);
+
+	for (unsigned i = 0; i < 8; ++i) {
+		point const v(to_view(point(c.d[0][i&1], c.d[1][(i>>1)&1], c.d[2][i>>2])));
+		if (v.z < pdu.near_) return 0; // crosses the near plane or behind the viewer
+		float sx, sy;
+		project(v, sx, sy);
+		xmin = min(xmin, sx); xmax = max(xmax, sx);
+		ymin = min(ymin, sy); ymax = max(ymax, sy);
+		iz_near = max(iz_near, 1.0f/v.z);
+	}
+	int const x1(max(0, (int)floor(xmin))), x2(min(int(w), (int)ceil(xmax))); // conservative pixel range
+	int const y1(max(0, (int)floor(ymin))), y2(min(int(h), (int)ceil(ymax)));
+	if (x1 >= x2 || y1 >= y2) return 0; // off screen
+	float const thresh(iz_near*(1.0 + OCC_DEPTH_BIAS));
+
+	for (int ty = y1/OCC_TILE_SZ; ty <= (y2-1)/int(OCC_TILE_SZ); ++ty) {
+		for (int tx = x1/OCC_TILE_SZ; tx <= (x2-1)/int(OCC_TILE_SZ); ++tx) {
+			if (tile_min[ty*tw + tx] > thresh) continue; // entire tile is in front of the cube
+			int const px1(max(x1, int(tx*OCC_TILE_SZ))), px2(min(x2, int((tx+1)*OCC_TILE_SZ)));
+			int const py1(max(y1, int(ty*OCC_TILE_SZ))), py2(min(y2, int((ty+1)*OCC_TILE_SZ)));
+			if ((px2 - px1) == OCC_TILE_SZ && (py2 - py1) == OCC_TILE_SZ) return 0; // tile fully covered, so some pixel is visible
+
+			for (int y = py1; y < py2; ++y) {
+				for (int x = px1; x < px2; ++x) {
+					if (depth[y*w + x] <= thresh) return 0;
+				}
+			}
+		} // for tx
+	} // for ty
+	return 1;
+}
+
+
+occlusion_raster_t sw_occ_raster;
+
+void update_sw_occlusion_raster(pos_dir_up const &pdu) {
+	if (use_sw_occlusion) {sw_occ_raster.update(pdu);} else {sw_occ_raster.invalidate();}
+}
+bool sw_occlusion_valid_for(point const &viewer) {return sw_occ_raster.is_valid_for(viewer);}
+bool sw_cube_occluded(cube_t const &cube) {return sw_occ_raster.is_cube_occluded(cube);}
+
+
+// compares the ray cast occluder lists from get_occluders() with the software rasterizer along a fixed camera path around the scene;
+// the ray method is evaluated for every cobj each frame rather than spread across frames
+void run_occlusion_benchmark() {
+
+	unsigned const NUM_FRAMES = 64;
+	if (world_mode != WMODE_GROUND || !have_occluders()) {cout << "Occlusion benchmark: no occluders" << endl; return;}
+	occlusion_raster_t raster;
+	vector<unsigned> vis;
+	vector<int> occluders;
+	unsigned num_tested(0), num_culled[2] = {0}, num_sw_only(0), num_ray_only(0), tot_occluders(0);
+	double times[3] = {0.0}; // {ray, raster build, raster test}
+
+	for (unsigned f = 0; f < NUM_FRAMES; ++f) {
+		float const angle(TWO_PI*f/NUM_FRAMES);
+		point pos(0.5*X_SCENE_SIZE*cosf(angle), 0.5*Y_SCENE_SIZE*sinf(angle), 0.0);
+		pos.z = interpolate_mesh_zval(pos.x, pos.y, 0.0, 0, 0) + camera_zh + 2.0*CAMERA_RADIUS;
+		vector3d const dir(vector3d(-pos.x, -pos.y, 0.0).get_norm()); // look toward the scene center
+		pos_dir_up const pdu(pos, dir, plus_z, 0.0, NEAR_CLIP, FAR_CLIP, 16.0/9.0);
+		vis.clear();
+
+		for (auto i = coll_objects.drawn_ids.begin(); i != coll_objects.drawn_ids.end(); ++i) {
+			coll_obj const &c(coll_objects.get_cobj(*i));
+			if (c.group_id < 0 && !c.no_draw() && c.check_pdu_visible(pdu)) {vis.push_back(*i);}
+		}
+		vector<unsigned char> ray_occ(vis.size(), 0);
+		double const t0(get_hr_time_ms());
+
+		for (unsigned i = 0; i < vis.size(); ++i) {
+			coll_obj const &c(coll_objects.get_cobj(vis[i]));
+			occluders.clear();
+			get_coll_line_cobjs_tree(pos, c.get_cube_center(), vis[i], &occluders, NULL, 0, 1, 1);
+			if (occluders.empty()) continue;
+			point pts[8];
+			if (c.is_thin_poly()) {ray_occ[i] = is_occluded(occluders, c.points, c.npoints, pos);}
+			else {ray_occ[i] = is_occluded(occluders, pts, get_cube_corners(c.d, pts, pos, 0), pos);}
+		}
+		double const t1(get_hr_time_ms());
+		raster.update(pdu);
+		double const t2(get_hr_time_ms());
+
+		for (unsigned i = 0; i < vis.size(); ++i) {
+			bool const sw_occ(raster.is_cube_occluded(coll_objects.get_cobj(vis[i])));
+			num_culled[0] += ray_occ[i];
+			num_culled[1] += sw_occ;
+			num_sw_only   += ( sw_occ && !ray_occ[i]);
+			num_ray_only  += (!sw_occ &&  ray_occ[i]);
+		}
+		double const t3(get_hr_time_ms());
+		times[0] += t1 - t0; times[1] += t2 - t1; times[2] += t3 - t2;
+		num_tested    += vis.size();
+		tot_occluders += raster.num_occluders;
+	} // for f
+	float const pct_mult(100.0/max(num_tested, 1U));
+	cout << "Occlusion benchmark: " << NUM_FRAMES << " frames, " << num_tested/NUM_FRAMES << " visible cobjs/frame, " << tot_occluders/NUM_FRAMES << " raster occluders/frame" << endl;
+	cout << "Ray cast: " << times[0]/NUM_FRAMES << " ms/frame, " << pct_mult*num_culled[0] << "% culled" << endl;
+	cout << "Raster: " << times[1]/NUM_FRAMES << " ms/frame build + " << times[2]/NUM_FRAMES << " ms/frame test, " << pct_mult*num_culled[1] << "% culled" << endl;
+	cout << "Culled by raster only: " << num_sw_only << ", by ray cast only: " << num_ray_only << endl;
+}
@@ -107,13 +107,13 @@ bool check_for_metal(point const &pos, float radius) {
 
 	cube_t bcube;
 	bcube.set_from_sphere(pos, radius);
-	vector<unsigned> cobjs;
+	frame_vector<unsigned> cobjs;
 
 	for (unsigned dynamic = 0; dynamic < 2; ++dynamic) { // check both dynamic (material spheres) and static (movable) cobjs
 		cobjs.clear();
 		get_intersecting_cobjs_tree(bcube, cobjs, -1, 0.0, (dynamic != 0), 0);
 
-		for (vector<unsigned>::const_iterator i = cobjs.begin(); i != cobjs.end(); ++i) {
+		for (auto i = cobjs.begin(); i != cobjs.end(); ++i) {
 			coll_obj const &cobj(coll_objects.get_cobj(*i));
 			if (cobj.cp.metalness == 0.0) continue;
 			if (!cobj.may_be_dynamic())   continue; // assume fully static cobjs don't count, otherwise the result will always be the same
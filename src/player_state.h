@@ -55,8 +55,7 @@ typedef vector<wpt_ix_t> waypt_adj_vect;
 struct waypoint_t {
 
 	bool user_placed, placed_item, goal, temp, visited, disabled, next_valid;
-	int came_from, item_group, item_ix, coll_id, connected_to;
-	float g_score, h_score, f_score;
+	int item_group, item_ix, coll_id, connected_to;
 	point pos;
 	double last_smiley_time;
 	waypt_adj_vect next_wpts, prev_wpts;
@@ -72,11 +71,15 @@ struct waypoint_t {
 class waypoint_vector : public vector<waypoint_t> {
 
 	vector<wpt_ix_t> free_list;
+	unsigned version; // incremented when the graph changes
 
 public:
+	waypoint_vector() : version(0) {}
 	wpt_ix_t add(waypoint_t const &w);
 	void remove(wpt_ix_t ix);
-	void clear() {vector<waypoint_t>::clear(); free_list.clear();}
+	void clear() {vector<waypoint_t>::clear(); free_list.clear(); mark_changed();}
+	void mark_changed() {++version;}
+	unsigned get_version() const {return version;}
 };
 
 
@@ -88,6 +91,18 @@ struct wpt_goal {
 
 	wpt_goal(int m=0, unsigned w=0, point const &p=all_zeros);
 	bool is_reachable() const;
+	bool operator==(wpt_goal const &g) const {return (mode == g.mode && wpt == g.wpt && pos == g.pos);}
+};
+
+
+struct wpt_path_query_t { // for batched path queries
+
+	unsigned start;
+	wpt_goal goal;
+	int next_wpt; // output: next waypoint on the path, -1 if no path
+	float dist; // output: path distance to goal
+
+	wpt_path_query_t(unsigned s, wpt_goal const &g) : start(s), goal(g), next_wpt(-1), dist(0.0) {}
 };
 
 
@@ -150,6 +165,21 @@ struct type_wt_t {
 };
 
 
+struct smiley_sense_t { // results of the per-frame parallel sense phase, valid for the smiley position and orientation they were computed from
+	bool valid;
+	int enemy, enemy_visible;
+	int path_start, path_next_wpt; // batched next waypoint query for a smiley that reached its waypoint; only used if the start and goal still match
+	float enemy_dist;
+	point pos, enemy_pos;
+	vector3d orient, avoid_dir;
+	wpt_goal path_goal;
+
+	smiley_sense_t() : valid(0), enemy(NO_SOURCE), enemy_visible(0), path_start(-1), path_next_wpt(-1), enemy_dist(0.0), pos(all_zeros), enemy_pos(all_zeros),
+		orient(zero_vector), avoid_dir(zero_vector) {}
+	bool matches(point const &p, vector3d const &o) const {return (valid && p == pos && o == orient);}
+};
+
+
 struct user_waypt_t {
 	int type;
 	point pos;
@@ -183,6 +213,7 @@ struct player_state { // size = big
 	waypt_used_set waypts_used;
 	unreachable_pts unreachable[2]; // {objects, waypoints}
 	destination_marker dest_mark;
+	smiley_sense_t sensed;
 	rand_gen_t player_rgen;
 
 	// footstep/snow footprint state
@@ -223,10 +254,15 @@ struct player_state { // size = big
 	
 	void smiley_fire_weapon(int smiley_id);
 	int find_nearest_enemy(point const &pos, pos_dir_up const &pdu, point const &avoid_dir, int smiley_id,
-		point &target, int &target_visible, float &min_dist) const;
+		point &target, int &target_visible, float &min_dist, vector<od_data> &odv, vector<unsigned char> const *in_darkness=nullptr) const;
+	void smiley_sense(dwobject const &obj, int smiley_id);
+	int get_nearest_enemy(point const &pos, pos_dir_up const &pdu, point const &avoid_dir, int smiley_id,
+		point &target, int &target_visible, float &min_dist, bool use_sensed) const;
 	void check_cand_waypoint(point const &pos, point const &avoid_dir, int smiley_id,
 		vector<od_data> &oddatav, unsigned i, int curw, float dmult, pos_dir_up const &pdu, bool next, float max_dist_sq);
 	void mark_waypoint_reached(int curw, int smiley_id);
+	wpt_goal get_wpt_goal(int smiley_id, int last_target_visible, int last_target_type) const;
+	int find_next_path_wpt(int curw, wpt_goal const &goal, int smiley_id);
 	int find_nearest_obj(point const &pos, pos_dir_up const &pdu, point const &avoid_dir, int smiley_id, point &target_pt,
 		float &min_dist, vector<type_wt_t> types, int last_target_visible, int last_target_type);
 	int check_smiley_status(dwobject &obj, int smiley_id);
@@ -294,6 +330,8 @@ struct jump_pad : public sphere_t {
 bool check_step_dz(point &cur, point const &lpos, float radius);
 int find_optimal_next_waypoint(unsigned cur, wpt_goal const &goal, set<unsigned> const &wps_penalty);
 void find_optimal_waypoint(point const &pos, vector<od_data> &oddatav, wpt_goal const &goal);
+void find_optimal_next_waypoints(vector<wpt_path_query_t> &queries);
+void run_waypoint_path_benchmark(unsigned num_agents);
 bool can_make_progress(point const &pos, point const &opos, bool check_uw);
 bool is_valid_path(point const &start, point const &end, bool check_uw);
 
@@ -3,6 +3,9 @@
 // 4/20/13
 
 #include "3DWorld.h"
+#include <omp.h>
+#include <atomic>
+#include <cstring>
 
 using std::string;
 
@@ -11,9 +14,9 @@ class timing_profiler {
 
 	struct entry_t {
 		unsigned count;
-		int time, tmax;
+		double time, tmax; // in ms
 		entry_t() : count(0), time(0), tmax(0) {}
-		void add(int t) {++count; time += t; tmax = max(tmax, t);}
+		void add(double t) {++count; time += t; tmax = max(tmax, t);}
 	};
 
 	map<string, entry_t> entries;
@@ -24,7 +27,7 @@ public:
 	timing_profiler() : enabled(0) {}
 	void clear() {entries.clear();}
 
-	void register_time(const char *str, int delta_time) {
+	void register_time(const char *str, double delta_time) {
 		if (enabled) {
 			entries[str].add(delta_time);
 		}
@@ -40,7 +43,7 @@ public:
 		for (auto i = entries.begin(); i != entries.end(); ++i) {
 			string const spaces((max_name - i->first.size()), ' ');
 			cout << i->first << spaces << ": " << i->second.count << "\t" << i->second.time << "\t"
-					<< i->second.tmax << "\t" << float(i->second.time)/float(i->second.count) << endl;
+					<< i->second.tmax << "\t" << i->second.time/i->second.count << endl;
 		}
 	}
 };
@@ -56,10 +59,61 @@ void register_timing_value(const char *str, int delta_time) {
 	global_profiler.register_time(str, delta_time);
 }
 
+void register_timing_value_ms(const char *str, double delta_time) {
+	global_profiler.register_time(str, delta_time);
+}
+
+double get_hr_time_ms() { // wall time with sub-ms resolution
+	return 1000.0*omp_get_wtime();
+}
+
 void timing_profiler_stats() {
 	global_profiler.stats();
 	global_profiler.clear();
 }
 
 
+// per-subsystem CPU memory accounting; bytes are registered by mem_track_allocator_t as the big containers allocate and free,
+// or by explicit add_mem_usage()/sub_mem_usage() calls for raw allocations; all members are atomic because containers are filled in parallel loops,
+// and the object is zero-initialized without a constructor so that it's valid during static init and destruction of the containers it tracks
+class mem_usage_tracker {
+
+	std::atomic<size_t> cur[NUM_MEM_CATS], peak[NUM_MEM_CATS], total, peak_total;
+
+	static void update_peak(std::atomic<size_t> &pv, size_t val) {
+		size_t prev(pv.load(std::memory_order_relaxed));
+		while (val > prev && !pv.compare_exchange_weak(prev, val, std::memory_order_relaxed)) {}
+	}
+public:
+	void add(unsigned cat, size_t bytes) {
+		assert(cat < NUM_MEM_CATS);
+		update_peak(peak[cat], (cur[cat].fetch_add(bytes, std::memory_order_relaxed) + bytes));
+		update_peak(peak_total, (total.fetch_add(bytes, std::memory_order_relaxed) + bytes)); // peak of the sum of all categories at the same time
+	}
+	void sub(unsigned cat, size_t bytes) {
+		assert(cat < NUM_MEM_CATS);
+		size_t const prev(cur[cat].fetch_sub(bytes, std::memory_order_relaxed));
+		assert(prev >= bytes);
+		total.fetch_sub(bytes, std::memory_order_relaxed);
+	}
+	void print() const { // one "mem:" line per category for easy parsing of headless runs
+		char const *const names[NUM_MEM_CATS] = {"cobjs", "lightmap", "voxels", "grass", "tiles", "buildings", "models", "textures", "universe", "frame_arena"};
+		cout << "memory usage: current_KB peak_KB" << endl;
+
+		for (unsigned i = 0; i < NUM_MEM_CATS; ++i) {
+			string const spaces((11 - strlen(names[i])), ' ');
+			cout << "mem: " << names[i] << spaces << cur[i]/1024 << "\t" << peak[i]/1024 << endl;
+		}
+		cout << "mem: total      " << total/1024 << "\t" << peak_total/1024 << endl;
+	}
+};
+
+mem_usage_tracker mem_tracker;
+
+
+void add_mem_usage(unsigned cat, size_t bytes) {mem_tracker.add(cat, bytes);}
+void sub_mem_usage(unsigned cat, size_t bytes) {mem_tracker.sub(cat, bytes);}
+void print_mem_usage() {mem_tracker.print();}
+
+
 
@@ -239,7 +239,7 @@ void add_path_to_lmcs(lmap_manager_t *lmgr, cube_t *bcube, point p1, point const
 		assert(lmgr != nullptr && lmgr->is_allocated());
 
 		for (unsigned s = 0; s < nsteps; ++s) {
-			lmcell *lmc(lmgr->get_lmcell_round_down(p1));
+			lmcell *lmc(lmgr->get_lmcell_round_down_mut(p1));
 		
 			if (lmc != NULL) { // could use a mutex here, but it seems too slow
 				float *color(lmc->get_offset(ltype));
@@ -600,6 +600,7 @@ void launch_threaded_job(unsigned num_threads, void (*start_func)(rt_data *), bo
 	if (verbose) cout << "Computing lighting on " << num_threads << " threads." << endl;
 	thread_manager.create(num_threads);
 	vector<rt_data> &data(thread_manager.data);
+	lmap_manager.unpack_all(); // the threads may write to any cell, and bricks can't be unpacked concurrently
 	if (use_temp_lmap) {thread_temp_lmap.init_from(lmap_manager);}
 
 	for (unsigned t = 0; t < data.size(); ++t) {
@@ -1087,6 +1088,9 @@ void compute_ray_trace_lighting(unsigned ltype, bool verbose) {
 }
 
 
+// lightmap updates after the initial lighting computation, which may run on multiple threads
+bool lmap_has_runtime_updates() {return (global_lighting_update || !merged_accum_map.empty());}
+
 bool pre_lighting_update() {
 	if (!lmap_manager.is_allocated()) return 0; // too early
 	tot_rays = num_hits = cells_touched = 0;
@@ -1144,9 +1148,9 @@ bool lmap_manager_t::read_data_from_file(char const *const fn, int ltype) {
 	unsigned data_size(0);
 	if (!reader.read(&data_size, sizeof(unsigned), 1)) return 0;
 
-	if (data_size != vldata_alloc.size()) {
+	if (data_size != num_cells) {
 		cerr << "Error: Lighting file " << fn << " data size of " << data_size
-			 << " does not equal the expected size of " << vldata_alloc.size() << ". Ignoring file." << endl;
+			 << " does not equal the expected size of " << num_cells << ". Ignoring file." << endl;
 		return 0;
 	}
 	unsigned const sz = lmcell::get_dsz(ltype);
@@ -1157,9 +1161,15 @@ bool lmap_manager_t::read_data_from_file(char const *const fn, int ltype) {
 		cerr << "Error reading data from ligthing file " << fn << endl;
 		return 0;
 	}
-	for (vector<lmcell>::iterator i = vldata_alloc.begin(); i != vldata_alloc.end(); ++i) {
-		float *ptr(i->get_offset(ltype));
-		for (unsigned n = 0; n < sz; ++n) {ptr[n] = data[pos++];}
+	for (unsigned y = 0; y < lm_ysize; ++y) { // same order as write_data_to_file()
+		for (unsigned x = 0; x < lm_xsize; ++x) {
+			if (!is_valid_column(x, y)) continue;
+
+			for (unsigned z = 0; z < lm_zsize; ++z) {
+				float *ptr(get_lmcell_mut(x, y, z).get_offset(ltype));
+				for (unsigned n = 0; n < sz; ++n) {ptr[n] = data[pos++];}
+			}
+		}
 	}
 	assert(pos == data.size());
 	return 1;
@@ -1172,14 +1182,23 @@ bool lmap_manager_t::write_data_to_file(char const *const fn, int ltype) const {
 	binary_file_writer writer;
 	if (!writer.open(fn)) return 0;
 	cout << "Writing lighting file to " << fn << endl;
-	unsigned const data_size((unsigned)vldata_alloc.size()); // should be size_t?
+	unsigned const data_size(num_cells); // should be size_t?
 	if (!writer.write(&data_size, sizeof(unsigned), 1)) return 0;
 	unsigned const sz(lmcell::get_dsz(ltype));
+	lmcell tmp;
+
+	for (unsigned y = 0; y < lm_ysize; ++y) { // cells of nonempty columns in y, x, z order
+		for (unsigned x = 0; x < lm_xsize; ++x) {
+			if (!is_valid_column(x, y)) continue;
 
-	for (vector<lmcell>::const_iterator i = vldata_alloc.begin(); i != vldata_alloc.end(); ++i) { // const_iterator?
-		if (!writer.write(i->get_offset(ltype), sizeof(float), sz)) {
-			cerr << "Error writing data to ligthing file " << fn << endl;
-			return 0;
+			for (unsigned z = 0; z < lm_zsize; ++z) {
+				lmcell const &lmc(get_lmcell(x, y, z, tmp));
+
+				if (!writer.write(lmc.get_offset(ltype), sizeof(float), sz)) {
+					cerr << "Error writing data to ligthing file " << fn << endl;
+					return 0;
+				}
+			}
 		}
 	}
 	return 1;
@@ -1191,9 +1210,16 @@ void lmap_manager_t::clear_lighting_values(int ltype) {
 	assert(ltype < NUM_LIGHTING_TYPES && !is_ltype_dynamic(ltype));
 	unsigned const num(lmcell::get_dsz(ltype));
 
-	for (vector<lmcell>::iterator i = vldata_alloc.begin(); i != vldata_alloc.end(); ++i) {
-		float *color(i->get_offset(ltype));
-		for (unsigned j = 0; j < num; ++j) {color[j] = 0.0;}
+	for (unsigned bix = 0; bix < bricks.size(); ++bix) { // unused cells are cleared as well
+		brick_t &b(bricks[bix]);
+		if (b.state == BRICK_EMPTY) continue;
+		unsigned const ncells(get_num_brick_cells(bix));
+		if (b.state != BRICK_DENSE) {unpack_brick(b, ncells);}
+
+		for (unsigned i = 0; i < ncells; ++i) {
+			float *color(b.cells[i].get_offset(ltype));
+			for (unsigned j = 0; j < num; ++j) {color[j] = 0.0;}
+		}
 	}
 }
 
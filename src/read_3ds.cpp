@@ -9,13 +9,19 @@
 
 bool const EXTRA_VERBOSE = 0;
 
+bool model_3ds_bench(0);
 
-class file_reader_3ds : public base_file_reader {
 
-protected:
-	geom_xform_t cur_xf;
-	float master_scale;
-	string name; // unused?
+// reads chunks from an in-memory copy of the file; cheap to copy, so each mesh can be parsed by a different thread with its own read position;
+// can also read directly from the FILE* as the original reader did, which is serial only and used by the reference reader in run_3ds_load_benchmark()
+class chunk_reader_3ds {
+
+	unsigned char const *data;
+	size_t data_len, pos;
+	FILE *fp; // if non-null, read from this file instead of data
+
+public:
+	bool verbose;
 
 	struct face_t {
 		unsigned short ix[3], flags;
@@ -23,10 +29,22 @@ protected:
 		face_t() : flags(0), mat(-1) {}
 	};
 
-	long get_end_pos(unsigned read_len) {return (ftell(fp) + read_len - 6);}
+	chunk_reader_3ds() : data(nullptr), data_len(0), pos(0), fp(nullptr), verbose(0) {}
+	void init(vector<unsigned char> const &file_data) {data = (file_data.empty() ? nullptr : &file_data.front()); data_len = file_data.size(); pos = 0; fp = nullptr;}
+	void init_file(FILE *fp_) {data = nullptr; data_len = pos = 0; fp = fp_;}
+	long tell() const {return (fp ? ftell(fp) : pos);}
+	void seek(long pos_) {if (fp) {fseek(fp, pos_, SEEK_SET);} else {pos = pos_;}}
+	long get_end_pos(unsigned read_len) const {return (tell() + read_len - 6);}
 
 	bool read_data(void *dest, size_t sz, size_t count, char const *const str) {
-		size_t const nread(fread(dest, sz, count, fp));
+		size_t nread(0);
+
+		if (fp) {nread = fread(dest, sz, count, fp);}
+		else {
+			nread = ((pos < data_len) ? min(count, (data_len - pos)/sz) : 0);
+			if (nread > 0) {memcpy(dest, (data + pos), nread*sz);}
+			pos += nread*sz;
+		}
 		if (nread == count) return 1;
 		if (str != nullptr) {cerr << "Error reading 3DS file " << str << " data: expected " << count << " elements of size " << sz << " but got " << nread << endl;}
 		return 0;
@@ -58,14 +76,6 @@ protected:
 		return 1;
 	}
 
-	void transform_vertices(vector<vert_tc_t> &verts, xform_matrix &matrix) {
-		for (vector<vert_tc_t>::iterator i = verts.begin(); i != verts.end(); ++i) {
-			matrix.apply_to_vector3d(i->v);
-			i->v *= master_scale;
-			cur_xf.xform_pos(i->v);
-		}
-	}
-
 	bool read_mapping_block(vector<vert_tc_t> &verts) {
 		unsigned short num;
 		if (!read_data(&num, sizeof(unsigned short), 1, "mapping size")) return 0;
@@ -140,7 +150,7 @@ protected:
 		default:
 			assert(0);
 		} // end switch
-		assert(ftell(fp) == end_pos);
+		assert(tell() == end_pos);
 		return 1;
 	}
 
@@ -159,13 +169,48 @@ protected:
 		return 1;
 	}
 
-	void skip_chunk(unsigned chunk_len) {fseek(fp, chunk_len-6, SEEK_CUR);}
+	void skip_chunk(unsigned chunk_len) {if (fp) {fseek(fp, chunk_len-6, SEEK_CUR);} else {pos += (chunk_len - 6);}}
+};
+
+
+class file_reader_3ds : public base_file_reader {
+
+protected:
+	geom_xform_t cur_xf;
+	float master_scale;
+	bool use_file_io; // read through the FILE* rather than an in-memory copy, and use the original serial mesh reader
+	string name; // unused?
+	vector<unsigned char> file_data; // the entire file; empty if use_file_io
+	chunk_reader_3ds cr;
+	typedef chunk_reader_3ds::face_t face_t;
+
+	bool read_file_data() {
+		assert(fp);
+		if (fseek(fp, 0, SEEK_END) != 0) {cerr << "Error seeking in 3DS file " << filename << endl; return 0;}
+		long const file_len(ftell(fp));
+		if (file_len < 0) {cerr << "Error getting size of 3DS file " << filename << endl; return 0;}
+		rewind(fp);
+		file_data.resize(file_len);
+		if (file_len > 0 && fread(&file_data.front(), 1, file_len, fp) != (size_t)file_len) {cerr << "Error reading 3DS file " << filename << endl; return 0;}
+		close_file();
+		cr.init(file_data);
+		cr.verbose = verbose;
+		return 1;
+	}
+
+	void transform_vertices(vector<vert_tc_t> &verts, xform_matrix &matrix, float mscale) const {
+		for (vector<vert_tc_t>::iterator i = verts.begin(); i != verts.end(); ++i) {
+			matrix.apply_to_vector3d(i->v);
+			i->v *= mscale;
+			cur_xf.xform_pos(i->v);
+		}
+	}
 
 	// return value: 0 = error, 1 = processed, 2 = can't handle/skip
 	virtual int proc_other_chunks(unsigned short chunk_id, unsigned chunk_len) {return 2;}
 
 public:
-	file_reader_3ds(string const &fn) : base_file_reader(fn), master_scale(1.0) {}
+	file_reader_3ds(string const &fn, bool use_file_io_=0) : base_file_reader(fn), master_scale(1.0), use_file_io(use_file_io_) {}
 	virtual ~file_reader_3ds() {}
 
 	bool read(geom_xform_t const &xf, bool verbose_) {
@@ -173,10 +218,16 @@ public:
 		cur_xf = xf;
 		if (!open_file(1)) return 0; // binary file
 		cout << "Reading 3DS file " << filename << endl;
+
+		if (use_file_io) {
+			cr.init_file(fp);
+			cr.verbose = verbose;
+		}
+		else if (!read_file_data()) return 0;
 		unsigned short chunk_id;
 		unsigned chunk_len;
 
-		while (read_chunk_header(chunk_id, chunk_len, 1)) { // read each chunk from the file 
+		while (cr.read_chunk_header(chunk_id, chunk_len, 1)) { // read each chunk from the file 
 			switch (chunk_id) {
 				// MAIN3DS: Main chunk, contains all the other chunks; length: 0 + sub chunks
 			case 0x4d4d:
@@ -186,17 +237,17 @@ public:
 				break;
 				// EDIT_OBJECT: Object block, info for each object; length: len(object name) + sub chunks
 			case 0x4000:
-				if (!read_null_term_string(name)) return 0;
+				if (!cr.read_null_term_string(name)) return 0;
 				break;
 				// master scale factor
 			case 0x0100:
-				if (!read_data(&master_scale, sizeof(float), 1, "master scale")) return 0;
+				if (!cr.read_data(&master_scale, sizeof(float), 1, "master scale")) return 0;
 				break;
 			default: // send to derived class reader, and skip chunk if it isn't handled
 				{
 					int const ret(proc_other_chunks(chunk_id, chunk_len));
 					if (ret == 0) return 0; // error
-					else if (ret == 2) {skip_chunk(chunk_len);} // skip
+					else if (ret == 2) {cr.skip_chunk(chunk_len);} // skip
 				}
 			} // end switch
 		}
@@ -227,40 +278,40 @@ class file_reader_3ds_triangles : public file_reader_3ds {
 	bool read_mesh(unsigned read_len) {
 		unsigned short chunk_id;
 		unsigned chunk_len;
-		long const end_pos(get_end_pos(read_len));
+		long const end_pos(cr.get_end_pos(read_len));
 		vector<vert_tc_t> verts;
 		vector<face_t> faces;
 		xform_matrix matrix;
 
-		while (ftell(fp) < end_pos) { // read each chunk from the file 
-			if (!read_chunk_header(chunk_id, chunk_len)) return 0;
+		while (cr.tell() < end_pos) { // read each chunk from the file 
+			if (!cr.read_chunk_header(chunk_id, chunk_len)) return 0;
 
 			switch (chunk_id) {
 				// TRI_FACEL1: Polygons (faces) list
 				// Chunk Length: 1 x unsigned short (# polygons) + 3 x unsigned short (polygon points) x (# polygons) + sub chunks
 			case 0x4120:
-				if (!read_faces(faces)) return 0;
+				if (!cr.read_faces(faces)) return 0;
 				break;
 				// TRI_VERTEXL: Vertices list
 				// Chunk Length: 1 x unsigned short (# vertices) + 3 x float (vertex coordinates) x (# vertices) + sub chunks
 			case 0x4110:
-				if (!read_vertex_block(verts)) return 0;
+				if (!cr.read_vertex_block(verts)) return 0;
 				break;
 				// TRI_MAPPINGCOORS: Vertices list
 				// Chunk Length: 1 x unsigned short (# mapping points) + 2 x float (mapping coordinates) x (# mapping points) + sub chunks
 			case 0x4140:
-				if (!read_mapping_block(verts)) return 0;
+				if (!cr.read_mapping_block(verts)) return 0;
 				break;
 				// mesh matrix
 			case 0x4160:
-				read_matrix(matrix, chunk_len);
+				cr.read_matrix(matrix, chunk_len);
 				break;
 			default:
-				skip_chunk(chunk_len);
+				cr.skip_chunk(chunk_len);
 			} // end switch
 		} // end while
-		assert(ftell(fp) == end_pos);
-		transform_vertices(verts, matrix);
+		assert(cr.tell() == end_pos);
+		transform_vertices(verts, matrix, master_scale);
 		triangle tri;
 
 		for (vector<face_t>::const_iterator i = faces.begin(); i != faces.end(); ++i) {
@@ -291,8 +342,20 @@ public:
 
 class file_reader_3ds_model : public file_reader_3ds, public model_from_file_t {
 
+	// a mesh chunk found by the serial pass over the file, which is parsed and triangulated later (possibly in parallel with other meshes)
+	struct mesh_t {
+		long start_pos;
+		unsigned read_len, obj_id;
+		float master_scale; // at the point in the file where the mesh was found
+		vector<int> mat_ids; // one per faces material chunk, in file order; looked up in the serial pass so that material indices match file order
+		vector<pair<int, vector<vert_norm_tc> > > mat_tris; // output: {material, 3 verts per triangle}
+		mesh_t(long sp, unsigned rl, unsigned oid, float ms) : start_pos(sp), read_len(rl), obj_id(oid), master_scale(ms) {}
+	};
+
 	int use_vertex_normals;
 	unsigned obj_id;
+	bool parallel;
+	vector<mesh_t> meshes; // pending, not yet added to the model
 
 	virtual int proc_other_chunks(unsigned short chunk_id, unsigned chunk_len) {
 
@@ -300,10 +363,12 @@ class file_reader_3ds_model : public file_reader_3ds, public model_from_file_t {
 		switch (chunk_id) {
 			// OBJ_TRIMESH: Triangular mesh, contains chunks for 3d mesh info; length: 0 + sub chunks
 		case 0x4100:
-			return read_mesh(chunk_len); // handled
+			return (use_file_io ? read_mesh_ref(chunk_len) : index_mesh(chunk_len)); // handled
 
 		case 0xAFFF: // material
 			{
+				// add pending meshes first, in case this material overwrites one that they use
+				if (!proc_pending_meshes()) return 0;
 				// since the material properties may be defined before its name, we can't get the material by name and fill it in;
 				// instead, we create a temporary material, fill it in, then look it up by name and overwrite the material in the model with cur_mat
 				material_t cur_mat("", filename);
@@ -316,71 +381,217 @@ class file_reader_3ds_model : public file_reader_3ds, public model_from_file_t {
 		return 2; // skip
 	}
 
-	bool read_mesh(unsigned read_len) {
+	// serial pass: record the mesh location and look up its materials, skipping everything else
+	bool index_mesh(unsigned read_len) {
 		unsigned short chunk_id;
 		unsigned chunk_len;
-		long const end_pos(get_end_pos(read_len));
+		long const end_pos(cr.get_end_pos(read_len));
+		meshes.push_back(mesh_t(cr.tell(), read_len, obj_id++, master_scale));
+		mesh_t &mesh(meshes.back());
+
+		while (cr.tell() < end_pos) {
+			if (!cr.read_chunk_header(chunk_id, chunk_len)) return 0;
+			long const chunk_end(cr.get_end_pos(chunk_len));
+
+			if (chunk_id == 0x4120) { // Faces: skip the face data, then continue with its subchunks, which include the faces materials
+				unsigned short num;
+				if (!cr.read_data(&num, sizeof(unsigned short), 1, "number of faces")) return 0;
+				cr.seek(cr.tell() + 4*sizeof(unsigned short)*num);
+				continue;
+			}
+			if (chunk_id == 0x4130) { // Faces Material
+				string mat_name;
+				if (!cr.read_null_term_string(mat_name)) return 0;
+				mesh.mat_ids.push_back(model.get_material_ix(mat_name, filename, 1));
+				
+				if (verbose) {
+					unsigned short num;
+					if (!cr.read_data(&num, sizeof(unsigned short), 1, "number of faces for material")) return 0;
+					cout << "Material " << mat_name << " is used for " << num << " faces" << endl;
+				}
+			}
+			cr.seek(chunk_end);
+		} // end while
+		assert(cr.tell() == end_pos);
+		return 1;
+	}
+
+	// the original serial mesh reader, which parses the mesh and adds it to the model in one pass; used as the reference in run_3ds_load_benchmark()
+	bool read_mesh_ref(unsigned read_len) {
+		unsigned short chunk_id;
+		unsigned chunk_len;
+		long const end_pos(cr.get_end_pos(read_len));
+		vector<vert_tc_t> verts;
+		vector<face_t> faces;
+		vector<unsigned> sgroups;
+		typedef map<int, vector<unsigned short> > face_mat_map_t;
+		face_mat_map_t face_materials;
+		xform_matrix matrix;
+
+		while (cr.tell() < end_pos) { // read each chunk from the file 
+			if (!cr.read_chunk_header(chunk_id, chunk_len)) return 0;
+
+			switch (chunk_id) {
+			case 0x4120:
+				if (!cr.read_faces(faces)) return 0;
+				break;
+			case 0x4130: // Faces Material: asciiz name, short nfaces, short face_ids (after faces)
+				{
+					string mat_name;
+					if (!cr.read_null_term_string(mat_name)) return 0;
+					int const mat_id(model.get_material_ix(mat_name, filename, 1));
+					vector<unsigned short> &faces_mat(face_materials[mat_id]);
+					assert(faces_mat.empty());
+					unsigned short num;
+					if (!cr.read_data(&num, sizeof(unsigned short), 1, "number of faces for material")) return 0;
+					faces_mat.resize(num);
+					if (num > 0 && !cr.read_data(&faces_mat.front(), sizeof(unsigned short), num, "faces for material")) return 0;
+					break;
+				}
+			case 0x4150: // Smoothing Group List (after mapping coords)
+				assert(chunk_len == sizeof(unsigned)*faces.size() + 6);
+				sgroups.resize(faces.size());
+				if (!cr.read_data(&sgroups.front(), sizeof(unsigned), faces.size(), "smoothing groups")) return 0;
+				break;
+			case 0x4110:
+				if (!cr.read_vertex_block(verts)) return 0;
+				break;
+			case 0x4140:
+				if (!cr.read_mapping_block(verts)) return 0;
+				break;
+			case 0x4160:
+				cr.read_matrix(matrix, chunk_len);
+				break;
+			default:
+				cr.skip_chunk(chunk_len);
+			} // end switch
+		} // end while
+		assert(cr.tell() == end_pos);
+		vector<counted_normal> normals;
+		if (use_vertex_normals) {normals.resize(verts.size());}
+		transform_vertices(verts, matrix, master_scale);
+
+		for (vector<face_t>::const_iterator i = faces.begin(); i != faces.end(); ++i) {
+			point pts[3];
+			
+			for (unsigned n = 0; n < 3; ++n) {
+				unsigned const ix(i->ix[n]);
+				assert(ix < verts.size());
+				pts[n] = verts[n].v;
+			}
+			if (use_vertex_normals) {
+				vector3d normal(get_poly_norm(pts));
+				if (use_vertex_normals > 1) {normal *= polygon_area(pts, 3);} // weight normal by face area
+				UNROLL_3X(normals[i->ix[i_]].add_normal(normal);)
+			}
+		}
+		model3d::proc_model_normals(normals, use_vertex_normals); // if use_vertex_normals
+
+		for (face_mat_map_t::const_iterator i = face_materials.begin(); i != face_materials.end(); ++i) {
+			for (vector<unsigned short>::const_iterator f = i->second.begin(); f != i->second.end(); ++f) {
+				assert(*f < faces.size());
+				assert(faces[*f].mat == -1); // material not yet assigned
+				faces[*f].mat = i->first;
+			}
+		}
+		vector<unsigned short> &def_mat(face_materials[-1]); // create default material
+
+		for (unsigned i = 0; i < faces.size(); ++i) {
+			if (faces[i].mat == -1) {def_mat.push_back(i);} // faces not assigned to a material get the default material
+		}
+		polygon_t tri;
+		tri.resize(3);
+
+		for (face_mat_map_t::const_iterator i = face_materials.begin(); i != face_materials.end(); ++i) {
+			vntc_map_t vmap[2]; // average_normals=0
+			vntct_map_t vmap_tan[2]; // average_normals=0
+
+			for (vector<unsigned short>::const_iterator f = i->second.begin(); f != i->second.end(); ++f) {
+				unsigned short const *ixs(faces[*f].ix);
+				point pts[3];
+				UNROLL_3X(pts[i_] = verts[ixs[i_]].v;)
+				vector3d const face_n(get_poly_norm(pts));
+
+				for (unsigned j = 0; j < 3; ++j) {
+					unsigned const ix(ixs[j]);
+					vector3d const normal((use_vertex_normals == 0 || (face_n != zero_vector && !normals[ix].is_valid())) ? face_n : normals[ix]);
+					tri[j] = vert_norm_tc(pts[j], normal, verts[ix].t[0], verts[ix].t[1]);
+				}
+				model.add_polygon(tri, vmap, vmap_tan, i->first, obj_id);
+			}
+		} // for i
+		++obj_id;
+		return 1;
+	}
+
+	// parse one mesh from its own copy of the chunk reader and build its triangles; thread safe
+	bool build_mesh(mesh_t &mesh, chunk_reader_3ds mcr) const {
+		unsigned short chunk_id;
+		unsigned chunk_len;
+		mcr.seek(mesh.start_pos);
+		long const end_pos(mcr.get_end_pos(mesh.read_len));
 		vector<vert_tc_t> verts;
 		vector<face_t> faces;
 		vector<unsigned> sgroups;
 		typedef map<int, vector<unsigned short> > face_mat_map_t;
 		face_mat_map_t face_materials;
 		xform_matrix matrix;
+		unsigned mat_ix(0);
 
-		while (ftell(fp) < end_pos) { // read each chunk from the file 
-			if (!read_chunk_header(chunk_id, chunk_len)) return 0;
+		while (mcr.tell() < end_pos) { // read each chunk from the file 
+			if (!mcr.read_chunk_header(chunk_id, chunk_len)) return 0;
 
 			switch (chunk_id) {
 				// TRI_FACEL1: Polygons (faces) list
 				// Chunk Length: 1 x unsigned short (# polygons) + 3 x unsigned short (polygon points) x (# polygons) + sub chunks
 			case 0x4120:
-				if (!read_faces(faces)) return 0;
+				if (!mcr.read_faces(faces)) return 0;
 				break;
 			// faces data
 			case 0x4130: // Faces Material: asciiz name, short nfaces, short face_ids (after faces)
 				{
-					// read and process material name
+					// read material name; the material was already looked up in index_mesh()
 					string mat_name;
-					if (!read_null_term_string(mat_name)) return 0;
-					int const mat_id(model.get_material_ix(mat_name, filename, 1));
-					vector<unsigned short> &faces_mat(face_materials[mat_id]);
+					if (!mcr.read_null_term_string(mat_name)) return 0;
+					assert(mat_ix < mesh.mat_ids.size());
+					vector<unsigned short> &faces_mat(face_materials[mesh.mat_ids[mat_ix++]]);
 					assert(faces_mat.empty());
 					// read and process face materials
 					unsigned short num;
-					if (!read_data(&num, sizeof(unsigned short), 1, "number of faces for material")) return 0;
+					if (!mcr.read_data(&num, sizeof(unsigned short), 1, "number of faces for material")) return 0;
 					faces_mat.resize(num);
-					if (num > 0 && !read_data(&faces_mat.front(), sizeof(unsigned short), num, "faces for material")) return 0;
-					if (verbose) {cout << "Material " << mat_name << " is used for " << num << " faces" << endl;}
+					if (num > 0 && !mcr.read_data(&faces_mat.front(), sizeof(unsigned short), num, "faces for material")) return 0;
 					break;
 				}
 			case 0x4150: // Smoothing Group List (after mapping coords)
 				// nfaces*4bytes: Long int where the nth bit indicates if the face belongs to the nth smoothing group
 				assert(chunk_len == sizeof(unsigned)*faces.size() + 6);
 				sgroups.resize(faces.size());
-				if (!read_data(&sgroups.front(), sizeof(unsigned), faces.size(), "smoothing groups")) return 0;
+				if (!mcr.read_data(&sgroups.front(), sizeof(unsigned), faces.size(), "smoothing groups")) return 0;
 				break;
 				// TRI_VERTEXL: Vertices list
 				// Chunk Length: 1 x unsigned short (# vertices) + 3 x float (vertex coordinates) x (# vertices) + sub chunks
 			case 0x4110:
-				if (!read_vertex_block(verts)) return 0;
+				if (!mcr.read_vertex_block(verts)) return 0;
 				break;
 				// TRI_MAPPINGCOORS: Vertices list
 				// Chunk Length: 1 x unsigned short (# mapping points) + 2 x float (mapping coordinates) x (# mapping points) + sub chunks
 			case 0x4140:
-				if (!read_mapping_block(verts)) return 0;
+				if (!mcr.read_mapping_block(verts)) return 0;
 				break;
 				// mesh matrix
 			case 0x4160:
-				read_matrix(matrix, chunk_len);
+				mcr.read_matrix(matrix, chunk_len);
 				break;
 			default:
-				skip_chunk(chunk_len);
+				mcr.skip_chunk(chunk_len);
 			} // end switch
 		} // end while
-		assert(ftell(fp) == end_pos);
+		assert(mcr.tell() == end_pos);
+		assert(mat_ix == mesh.mat_ids.size());
 		vector<counted_normal> normals; // weighted_normal can also be used, but doesn't work well
 		if (use_vertex_normals) {normals.resize(verts.size());}
-		transform_vertices(verts, matrix);
+		transform_vertices(verts, matrix, mesh.master_scale);
 
 		// build vertex lists and compute face normals
 		// FIXME: use sgroups
@@ -414,16 +625,17 @@ class file_reader_3ds_model : public file_reader_3ds, public model_from_file_t {
 			if (faces[i].mat == -1) {def_mat.push_back(i);} // faces not assigned to a material get the default material
 		}
 
-		// add triangles to model for each material
-		polygon_t tri;
-		tri.resize(3);
+		// build triangles for each material
+		mesh.mat_tris.resize(face_materials.size());
+		unsigned mix(0);
 
-		for (face_mat_map_t::const_iterator i = face_materials.begin(); i != face_materials.end(); ++i) {
-			vntc_map_t vmap[2]; // average_normals=0
-			vntct_map_t vmap_tan[2]; // average_normals=0
+		for (face_mat_map_t::const_iterator i = face_materials.begin(); i != face_materials.end(); ++i, ++mix) {
+			mesh.mat_tris[mix].first = i->first;
+			vector<vert_norm_tc> &tris(mesh.mat_tris[mix].second);
+			tris.reserve(3*i->second.size());
 
 			for (vector<unsigned short>::const_iterator f = i->second.begin(); f != i->second.end(); ++f) {
-				unsigned short *ixs(faces[*f].ix);
+				unsigned short const *ixs(faces[*f].ix);
 				point pts[3];
 				UNROLL_3X(pts[i_] = verts[ixs[i_]].v;)
 				vector3d const face_n(get_poly_norm(pts));
@@ -431,12 +643,42 @@ class file_reader_3ds_model : public file_reader_3ds, public model_from_file_t {
 				for (unsigned j = 0; j < 3; ++j) {
 					unsigned const ix(ixs[j]);
 					vector3d const normal((use_vertex_normals == 0 || (face_n != zero_vector && !normals[ix].is_valid())) ? face_n : normals[ix]);
-					tri[j] = vert_norm_tc(pts[j], normal, verts[ix].t[0], verts[ix].t[1]);
+					tris.push_back(vert_norm_tc(pts[j], normal, verts[ix].t[0], verts[ix].t[1]));
 				}
-				model.add_polygon(tri, vmap, vmap_tan, i->first, obj_id);
 			}
 		} // for i
-		++obj_id;
+		return 1;
+	}
+
+	// parse and triangulate pending meshes in parallel, then add them to the model serially in file order
+	bool proc_pending_meshes() {
+		if (meshes.empty()) return 1;
+		int const num_meshes(meshes.size());
+		chunk_reader_3ds mcr(cr);
+		mcr.verbose = (verbose && !parallel); // avoid interleaved printouts
+		unsigned num_errors(0);
+
+#pragma omp parallel for schedule(dynamic,1) reduction(+:num_errors) if (parallel)
+		for (int i = 0; i < num_meshes; ++i) {
+			if (!build_mesh(meshes[i], mcr)) {++num_errors;}
+		}
+		if (num_errors > 0) {meshes.clear(); return 0;}
+		polygon_t tri;
+		tri.resize(3);
+
+		for (vector<mesh_t>::const_iterator m = meshes.begin(); m != meshes.end(); ++m) {
+			for (auto i = m->mat_tris.begin(); i != m->mat_tris.end(); ++i) {
+				vntc_map_t vmap[2]; // average_normals=0
+				vntct_map_t vmap_tan[2]; // average_normals=0
+				assert((i->second.size() % 3) == 0);
+
+				for (unsigned t = 0; t < i->second.size(); t += 3) {
+					UNROLL_3X(tri[i_] = i->second[t+i_];)
+					model.add_polygon(tri, vmap, vmap_tan, i->first, m->obj_id);
+				}
+			}
+		} // for m
+		meshes.clear();
 		return 1;
 	}
 
@@ -453,31 +695,31 @@ class file_reader_3ds_model : public file_reader_3ds, public model_from_file_t {
 	bool read_material(unsigned read_len, material_t &cur_mat) {
 		unsigned short chunk_id;
 		unsigned chunk_len;
-		long const end_pos(get_end_pos(read_len));
+		long const end_pos(cr.get_end_pos(read_len));
 
-		while (ftell(fp) < end_pos) { // read each chunk from the file 
-			if (!read_chunk_header(chunk_id, chunk_len)) return 0;
+		while (cr.tell() < end_pos) { // read each chunk from the file 
+			if (!cr.read_chunk_header(chunk_id, chunk_len)) return 0;
 
 			switch (chunk_id) {
 			case 0xA000: // material name
-				if (!read_null_term_string(cur_mat.name)) return 0;
+				if (!cr.read_null_term_string(cur_mat.name)) return 0;
 				break;
 			case 0xA010: // material ambient color
-				if (!read_color(cur_mat.ka)) return 0;
+				if (!cr.read_color(cur_mat.ka)) return 0;
 				break;
 			case 0xA020: // material diffuse color
-				if (!read_color(cur_mat.kd)) return 0;
+				if (!cr.read_color(cur_mat.kd)) return 0;
 				break;
 			case 0xA030: // material specular color
-				if (!read_color(cur_mat.ks)) return 0;
+				if (!cr.read_color(cur_mat.ks)) return 0;
 				break;
 			case 0xA040: // material shininess
-				if (!read_percentage(chunk_len, cur_mat.ns)) return 0;
+				if (!cr.read_percentage(chunk_len, cur_mat.ns)) return 0;
 				//cur_mat.ns = 1.0 - cur_mat.ns;
 				cur_mat.ns *= 100.0;
 				break;
 			case 0xA050: // material transparency
-				if (!read_percentage(chunk_len, cur_mat.alpha)) return 0;
+				if (!cr.read_percentage(chunk_len, cur_mat.alpha)) return 0;
 				cur_mat.alpha = 1.0 - cur_mat.alpha; // convert from transparency to opacity
 				break;
 			case 0xA200: // texture map 1
@@ -496,10 +738,10 @@ class file_reader_3ds_model : public file_reader_3ds, public model_from_file_t {
 				if (!read_and_proc_texture(chunk_len, cur_mat.refl_tid, "reflection map")) return 0;
 				break;
 			default:
-				skip_chunk(chunk_len);
+				cr.skip_chunk(chunk_len);
 			} // end switch
 		} // end while
-		assert(ftell(fp) == end_pos);
+		assert(cr.tell() == end_pos);
 
 		if (cur_mat.bump_tid >= 0 && cur_mat.bump_tid == cur_mat.d_tid) {
 			cout << "Bump map texture is the same as the diffuse texture; ignoring." << endl;
@@ -512,33 +754,35 @@ class file_reader_3ds_model : public file_reader_3ds, public model_from_file_t {
 	bool read_texture(unsigned read_len, string &tex_name, unsigned short &map_tiling) {
 		unsigned short chunk_id;
 		unsigned chunk_len;
-		long const end_pos(get_end_pos(read_len));
+		long const end_pos(cr.get_end_pos(read_len));
 		map_tiling = 0; // in case it's not specified
 
-		while (ftell(fp) < end_pos) { // read each chunk from the file 
-			if (!read_chunk_header(chunk_id, chunk_len)) return 0;
+		while (cr.tell() < end_pos) { // read each chunk from the file 
+			if (!cr.read_chunk_header(chunk_id, chunk_len)) return 0;
 
 			switch (chunk_id) {
 			case 0xA300: // mapping filename
-				if (!read_null_term_string(tex_name)) return 0;
+				if (!cr.read_null_term_string(tex_name)) return 0;
 				break;
 			case 0xA351: // mapping parameters
-				if (!read_data(&map_tiling, sizeof(unsigned short), 1, "texture map tiling flags")) return 0;
+				if (!cr.read_data(&map_tiling, sizeof(unsigned short), 1, "texture map tiling flags")) return 0;
 				break;
 			default:
-				skip_chunk(chunk_len);
+				cr.skip_chunk(chunk_len);
 			} // end switch
 		} // end while
-		assert(ftell(fp) == end_pos);
+		assert(cr.tell() == end_pos);
 		return 1;
 	}
 
 public:
-	file_reader_3ds_model(string const &fn, int use_vertex_normals_, model3d &model_) :
-	  file_reader_3ds(fn), model_from_file_t(fn, model_), use_vertex_normals(use_vertex_normals_), obj_id(0) {}
+	file_reader_3ds_model(string const &fn, int use_vertex_normals_, model3d &model_, bool parallel_=1, bool use_file_io_=0) :
+	  file_reader_3ds(fn, use_file_io_), model_from_file_t(fn, model_), use_vertex_normals(use_vertex_normals_), obj_id(0), parallel(parallel_ && !use_file_io_) {}
 
-	bool read(geom_xform_t const &xf, bool verbose) {
+	bool read(geom_xform_t const &xf, bool verbose, bool finalize=1) {
 		if (!file_reader_3ds::read(xf, verbose)) return 0;
+		if (!proc_pending_meshes()) return 0;
+		if (!finalize) return 1;
 		model.finalize(); // optimize vertices, remove excess capacity, compute bounding sphere, subdivide, compute LOD blocks
 		if (verbose) {cout << "bcube: " << model.get_bcube().str() << endl << "model stats: "; model.show_stats();}
 		return 1;
@@ -546,14 +790,158 @@ public:
 };
 
 
+unsigned count_model_polygon_diffs(vector<coll_tquad> const &a, vector<coll_tquad> const &b) {
+
+	if (a.size() != b.size()) return max(a.size(), b.size());
+	unsigned num_diff(0);
+
+	for (unsigned i = 0; i < a.size(); ++i) {
+		bool same(a[i].npts == b[i].npts && a[i].normal == b[i].normal && a[i].cid == b[i].cid);
+		for (unsigned p = 0; p < a[i].npts && same; ++p) {same = (a[i].pts[p] == b[i].pts[p]);}
+		num_diff += !same;
+	}
+	return num_diff;
+}
+
+// writes a small 3DS file with two meshes; the first has two faces material groups and a smoothing group list nested in its faces chunk,
+// which exercises the subchunk handling of both the original and the indexed mesh readers
+bool write_3ds_bench_fixture(string const &fn) {
+
+	vector<unsigned char> d;
+	vector<size_t> open_chunks;
+	auto add_bytes   = [&](void const *v, size_t sz) {unsigned char const *p((unsigned char const *)v); d.insert(d.end(), p, p+sz);};
+	auto add_short   = [&](unsigned short v) {add_bytes(&v, sizeof(v));};
+	auto add_str     = [&](char const *s) {add_bytes(s, strlen(s)+1);};
+	auto begin_chunk = [&](unsigned short id) {open_chunks.push_back(d.size()); add_short(id); unsigned const len(0); add_bytes(&len, sizeof(len));};
+	auto end_chunk   = [&]() {size_t const start(open_chunks.back()); open_chunks.pop_back(); unsigned const len(d.size() - start); memcpy(&d[start+2], &len, sizeof(len));};
+	char const *const mat_names[2] = {"bench_red", "bench_blue"};
+	unsigned const N = 4; // vertices per side of the first mesh
+	begin_chunk(0x4d4d);
+	begin_chunk(0x3d3d);
+
+	for (unsigned m = 0; m < 2; ++m) {
+		begin_chunk(0xAFFF);
+		begin_chunk(0xA000); add_str(mat_names[m]); end_chunk();
+		float const color[3] = {1.0f-m, 0.0f, float(m)};
+		begin_chunk(0xA020); begin_chunk(0x0010); add_bytes(color, sizeof(color)); end_chunk(); end_chunk();
+		end_chunk();
+	}
+	for (unsigned mesh = 0; mesh < 2; ++mesh) {
+		unsigned const n(mesh ? 2 : N), nfaces(2*(n-1)*(n-1));
+		begin_chunk(0x4000);
+		add_str(mesh ? "bench_quad" : "bench_grid");
+		begin_chunk(0x4100);
+		begin_chunk(0x4110);
+		add_short(n*n);
+
+		for (unsigned y = 0; y < n; ++y) {
+			for (unsigned x = 0; x < n; ++x) {
+				float const v[3] = {float(x), float(y), (mesh ? 1.0f : 0.25f*((x*x + 3*y) % 5))};
+				add_bytes(v, sizeof(v));
+			}
+		}
+		end_chunk();
+		begin_chunk(0x4140);
+		add_short(n*n);
+
+		for (unsigned i = 0; i < n*n; ++i) {
+			float const tc[2] = {float(i%n)/(n-1), float(i/n)/(n-1)};
+			add_bytes(tc, sizeof(tc));
+		}
+		end_chunk();
+		begin_chunk(0x4120);
+		add_short(nfaces);
+
+		for (unsigned y = 0; y+1 < n; ++y) {
+			for (unsigned x = 0; x+1 < n; ++x) {
+				unsigned short const v0(y*n + x), f[8] = {v0, (unsigned short)(v0+1), (unsigned short)(v0+n+1), 0, v0, (unsigned short)(v0+n+1), (unsigned short)(v0+n), 0};
+				add_bytes(f, sizeof(f));
+			}
+		}
+		for (unsigned m = 0; m < (mesh ? 1U : 2U); ++m) { // first mesh: 1/3 red, 1/3 blue, 1/3 default; second mesh: all red
+			unsigned short const num(mesh ? nfaces : nfaces/3);
+			begin_chunk(0x4130);
+			add_str(mat_names[m]);
+			add_short(num);
+			for (unsigned i = 0; i < num; ++i) {add_short(m*num + i);}
+			end_chunk();
+		}
+		begin_chunk(0x4150);
+		for (unsigned i = 0; i < nfaces; ++i) {unsigned const sg(1U << (i&3)); add_bytes(&sg, sizeof(sg));}
+		end_chunk();
+		end_chunk(); // 0x4120
+
+		if (mesh) {
+			float const m[12] = {1,0,0, 0,1,0, 0,0,1, 0,0,0};
+			begin_chunk(0x4160); add_bytes(m, sizeof(m)); end_chunk();
+		}
+		end_chunk(); // 0x4100
+		end_chunk(); // 0x4000
+	} // for mesh
+	end_chunk(); // 0x3d3d
+	end_chunk(); // 0x4d4d
+	assert(open_chunks.empty());
+	FILE *fp(fopen(fn.c_str(), "wb"));
+	if (fp == nullptr) {cerr << "Error opening 3DS benchmark fixture file " << fn << " for write" << endl; return 0;}
+	bool const success(fwrite(&d.front(), 1, d.size(), fp) == d.size());
+	fclose(fp);
+	if (!success) {cerr << "Error writing 3DS benchmark fixture file " << fn << endl;}
+	return success;
+}
+
+// compares load time and results of the original serial FILE* reader with the serial and parallel in-memory indexed readers
+void run_3ds_load_benchmark(string const &filename, model3d const &model, geom_xform_t const &xf, int use_vertex_normals, unsigned expected_polys=0) {
+	model3d model_f(filename, model.tmgr), model_s(filename, model.tmgr), model_p(filename, model.tmgr); // textures are shared with the loaded model
+	model3d *models[3] = {&model_f, &model_s, &model_p}; // {FILE* reference, serial, parallel}
+	char const *const names[3] = {"FILE*", "serial", "parallel"};
+	unsigned times[3] = {0};
+	vector<coll_tquad> polys[3];
+	model3d_stats_t stats[3];
+
+	for (unsigned n = 0; n < 3; ++n) {
+		int const start_time(GET_TIME_MS());
+		file_reader_3ds_model reader(filename, use_vertex_normals, *models[n], (n == 2), (n == 0));
+		if (!reader.read(xf, 0, 0)) {cerr << "Error reading 3DS file " << filename << " in benchmark" << endl; return;} // not verbose or finalized
+		times[n] = GET_TIME_MS() - start_time;
+		models[n]->get_polygons(polys[n]);
+		models[n]->get_stats(stats[n]);
+	}
+	cout << "3DS load benchmark for " << filename << ": " << polys[0].size() << " polygons, " << stats[0].verts << " verts, " << stats[0].mats << " materials" << endl;
+	assert(expected_polys == 0 || polys[0].size() == expected_polys);
+
+	for (unsigned n = 0; n < 3; ++n) {
+		unsigned num_diff(0);
+
+		if (n > 0) { // compare to the FILE* reader
+			num_diff = count_model_polygon_diffs(polys[0], polys[n]);
+			if (stats[n].verts != stats[0].verts || stats[n].tris != stats[0].tris || stats[n].quads != stats[0].quads || stats[n].mats != stats[0].mats) {++num_diff;}
+		}
+		cout << "  " << names[n] << ": " << times[n] << "ms";
+		if (n > 0) {cout << ", " << num_diff << " differences from FILE*";}
+		cout << endl;
+		assert(num_diff == 0);
+	}
+}
+
 bool read_3ds_file_model(string const &filename, model3d &model, geom_xform_t const &xf, int use_vertex_normals, bool verbose) {
 	file_reader_3ds_model reader(filename, use_vertex_normals, model);
-	return reader.read(xf, verbose);
+	if (!reader.read(xf, verbose)) return 0;
+
+	if (model_3ds_bench) {
+		static bool fixture_done(0);
+
+		if (!fixture_done) { // run once on a generated file with faces material and smoothing group subchunks, which may not be in the scene's files
+			string const fixture_fn("3ds_bench_fixture.3ds");
+			if (write_3ds_bench_fixture(fixture_fn)) {run_3ds_load_benchmark(fixture_fn, model, geom_xform_t(), use_vertex_normals, 20);} // 18 + 2 triangles
+			remove(fixture_fn.c_str());
+			fixture_done = 1;
+		}
+		run_3ds_load_benchmark(filename, model, xf, use_vertex_normals);
+	}
+	return 1;
 }
 
 bool read_3ds_file_pts(string const &filename, vector<coll_tquad> *ppts, geom_xform_t const &xf, colorRGBA const &def_c, bool verbose) {
 	file_reader_3ds_triangles reader(filename);
 	return reader.read(ppts, xf, def_c, verbose);
 }
-
-
@@ -10,7 +10,7 @@
 
 
 bool const DYNAMIC_SMOKE     = 1; // looks cool
-int const SMOKE_SKIPVAL      = 8;
+int const SMOKE_SKIPVAL      = 8; // rows were previously updated every SMOKE_SKIPVAL frames; z rates were not amortized, so they're divided by this
 int const SMOKE_SEND_SKIP    = 8;
 int const INDIR_LT_SEND_SKIP = 12;
 
@@ -23,8 +23,8 @@ float const SMOKE_DIS_ZD     = 0.03;
 float const SMOKE_THRESH     = 1.0/255.0;
 
 
-bool smoke_visible(0), smoke_exists(0), have_indir_smoke_tex(0);
-unsigned smoke_tid(0), last_smoke_update(0);
+bool smoke_visible(0), smoke_exists(0), have_indir_smoke_tex(0), smoke_bench(0), fire_bench(0);
+unsigned smoke_tid(0), last_smoke_update(0), smoke_substeps(1);
 colorRGB const_indir_color(BLACK);
 cube_t cur_smoke_bb;
 vector<unsigned char> smoke_tex_data; // several MB
@@ -103,12 +103,20 @@ struct smoke_manager {
 
 		if (is_smoke_visible(pos) && check_smoke_bounds(pos)) {
 			bbox.union_with_pt(pos);
-			cur_smoke_bb.union_with_pt(pos);
 			smoke_vis = 1;
 		}
 		tot_smoke += smoke_amt;
 		enabled    = 1;
 	}
+	void merge(smoke_manager const &sm) {
+		if (sm.smoke_vis) {
+			bbox.union_with_cube(sm.bbox);
+			cur_smoke_bb.union_with_cube(sm.bbox);
+			smoke_vis = 1;
+		}
+		tot_smoke += sm.tot_smoke;
+		enabled   |= sm.enabled;
+	}
 	void adj_bbox() {
 		for (unsigned i = 0; i < 3; ++i) {
 			float const dval(SCENE_SIZE[i]/MESH_SIZE[i]);
@@ -118,46 +126,225 @@ struct smoke_manager {
 	}
 };
 
-smoke_manager smoke_man, next_smoke_man;
+smoke_manager smoke_man;
 
 
 inline void adjust_smoke_val(float &val, float delta) {val = max(0.0f, min(SMOKE_MAX_VAL, (val + delta)));}
 
+
+// double-buffered smoke density stored separately from the lightmap, indexed {z, x, y} like the lightmap; allocated when smoke is first added;
+// each step is a Jacobi update of the flux between neighboring cells that only reads the current buffer, so columns can be processed in parallel
+class smoke_field_t {
+
+	struct cell_flow_t {
+		unsigned char pflow[3], valid; // flow into the +x, +y, +z neighbor
+	};
+	struct row_stats_t {
+		smoke_manager sman;
+		int xmin, xmax, zmin, zmax; // [min, max)
+		double removed;
+		row_stats_t() : xmin(MESH_X_SIZE), xmax(0), zmin(MESH_SIZE[2]), zmax(0), removed(0.0) {}
+	};
+	int xsize, ysize, zsize;
+	unsigned cur;
+	vector<float> smoke[2];
+	vector<cell_flow_t> flow;
+	vector<row_stats_t> row_stats;
+	int bounds[2][3][2]; // nonzero range of each buffer, [lo, hi) in x, y, z
+
+	unsigned get_ix(int x, int y, int z) const {return ((y*xsize + x)*zsize + z);}
+	void clear_bounds(unsigned buf) {UNROLL_3X(bounds[buf][i_][0] = MESH_SIZE[i_]; bounds[buf][i_][1] = 0;)}
+	bool bounds_empty(unsigned buf) const {return (bounds[buf][0][0] >= bounds[buf][0][1]);}
+
+	float get_flux(float from, float to, unsigned char pflow, float pos_rate, float neg_rate) const { // amount moving from => to
+		float const delta((pflow/255.0f)*(from - to));
+		return delta*((delta < 0.0) ? neg_rate : pos_rate);
+	}
+	void step_row(int y, int const r[3][2], float xy_rate, float zu_rate, float zd_rate, bool update_state);
+
+public:
+	smoke_field_t() : xsize(0), ysize(0), zsize(0), cur(0) {clear_bounds(0); clear_bounds(1);}
+	bool is_allocated() const {return !flow.empty();}
+	bool empty() const {return bounds_empty(cur);}
+	void clear();
+	void ensure_alloc();
+	float get(int x, int y, int z) const {return (is_allocated() ? smoke[cur][get_ix(x, y, z)] : 0.0f);}
+	bool is_valid_cell(int x, int y, int z) const {return flow[get_ix(x, y, z)].valid;}
+	bool add(int x, int y, int z, float val);
+	double get_total() const;
+	double step(unsigned num_substeps, bool update_state);
+};
+
+
+void smoke_field_t::clear() {
+
+	xsize = ysize = zsize = 0;
+	cur   = 0;
+	for (unsigned i = 0; i < 2; ++i) {smoke[i].clear(); clear_bounds(i);}
+	flow.clear();
+	row_stats.clear();
+}
+
+void smoke_field_t::ensure_alloc() {
+
+	if (is_allocated() && xsize == MESH_X_SIZE && ysize == MESH_Y_SIZE && zsize == MESH_SIZE[2]) return; // already allocated
+	clear();
+	xsize = MESH_X_SIZE; ysize = MESH_Y_SIZE; zsize = MESH_SIZE[2];
+	unsigned const num(xsize*ysize*zsize);
+	for (unsigned i = 0; i < 2; ++i) {smoke[i].resize(num, 0.0);}
+	flow.resize(num);
+	row_stats.resize(ysize);
+
+	#pragma omp parallel for schedule(static,1)
+	for (int y = 0; y < ysize; ++y) { // flow values are static after the lightmap is built
+		for (int x = 0; x < xsize; ++x) {
+			lmap_ccolumn_t const vldata(lmap_manager.get_column(x, y));
+
+			for (int z = 0; z < zsize; ++z) {
+				cell_flow_t &f(flow[get_ix(x, y, z)]);
+				f.valid = (vldata && lmap_manager.is_valid_cell(x, y, z));
+				if (f.valid) {lmcell const &lmc(vldata[z]); UNROLL_3X(f.pflow[i_] = lmc.pflow[i_];)} else {UNROLL_3X(f.pflow[i_] = 0;)}
+			}
+		}
+	}
+}
+
+bool smoke_field_t::add(int x, int y, int z, float val) {
+
+	ensure_alloc();
+	if (x < 0 || y < 0 || z < 0 || x >= xsize || y >= ysize || z >= zsize || !is_valid_cell(x, y, z)) return 0;
+	adjust_smoke_val(smoke[cur][get_ix(x, y, z)], val);
+	int const pos[3] = {x, y, z};
+	UNROLL_3X(bounds[cur][i_][0] = min(bounds[cur][i_][0], pos[i_]); bounds[cur][i_][1] = max(bounds[cur][i_][1], pos[i_]+1);)
+	return 1;
+}
+
+double smoke_field_t::get_total() const {
+
+	if (empty()) return 0.0;
+	double total(0.0);
+	int const (&b)[3][2](bounds[cur]);
+
+	for (int y = b[1][0]; y < b[1][1]; ++y) {
+		for (int x = b[0][0]; x < b[0][1]; ++x) {
+			for (int z = b[2][0]; z < b[2][1]; ++z) {total += smoke[cur][get_ix(x, y, z)];}
+		}
+	}
+	return total;
+}
+
+// reads only the current buffer and writes only row y of the next buffer
+void smoke_field_t::step_row(int y, int const r[3][2], float xy_rate, float zu_rate, float zd_rate, bool update_state) {
+
+	float const *const s(&smoke[cur].front());
+	float *const n(&smoke[!cur].front());
+	row_stats_t &rs(row_stats[y]);
+	rs = row_stats_t();
+	float const xy_sink(xy_rate), z_sink(0.5*(zu_rate + zd_rate)); // edge cells have infinite smoke capacity and zero total smoke
+	int const dims[3] = {xsize, ysize, zsize};
+
+	for (int x = r[0][0]; x < r[0][1]; ++x) {
+		bool any_z_has_smoke(0);
+		smoke_entry_t zrange;
+
+		for (int z = r[2][0]; z < r[2][1]; ++z) {
+			unsigned const ix(get_ix(x, y, z));
+			cell_flow_t const &f(flow[ix]);
+			if (!f.valid) continue; // always zero
+			float const val(s[ix]);
+			float next(val), sunk(0.0);
+			int const pos[3] = {x, y, z};
+			unsigned const stride[3] = {unsigned(zsize), unsigned(xsize*zsize), 1};
+
+			for (unsigned d = 0; d < 3; ++d) {
+				float const pos_rate((d == 2) ? zu_rate : xy_rate), neg_rate((d == 2) ? zd_rate : xy_rate), sink((d == 2) ? z_sink : xy_sink);
+				// +d neighbor: uses our flow
+				if (pos[d]+1 < dims[d] && flow[ix + stride[d]].valid) {next -= get_flux(val, s[ix + stride[d]], f.pflow[d], pos_rate, neg_rate);}
+				else if (val > 0.0) {sunk += sink;}
+				// -d neighbor: uses its flow
+				if (pos[d] > 0 && flow[ix - stride[d]].valid) {next += get_flux(s[ix - stride[d]], val, flow[ix - stride[d]].pflow[d], pos_rate, neg_rate);}
+				else if (val > 0.0) {sunk += sink;}
+			}
+			next -= sunk;
+			float const clamped((next < SMOKE_THRESH) ? 0.0f : min(next, SMOKE_MAX_VAL));
+			rs.removed += sunk + (next - clamped);
+			n[ix] = clamped;
+			if (clamped == 0.0) continue;
+			rs.xmin = min(rs.xmin, x); rs.xmax = max(rs.xmax, x+1);
+			rs.zmin = min(rs.zmin, z); rs.zmax = max(rs.zmax, z+1);
+			if (update_state) {rs.sman.add_smoke(x, y, z, clamped);}
+			zrange.update(z);
+			any_z_has_smoke = 1;
+		} // for z
+		if (update_state) {smoke_grid.get_z_range(x, y) = (any_z_has_smoke ? zrange : smoke_entry_t());}
+	} // for x
+}
+
+// returns the amount of smoke removed at grid edges, under SMOKE_THRESH, and over SMOKE_MAX_VAL
+double smoke_field_t::step(unsigned num_substeps, bool update_state) {
+
+	assert(num_substeps > 0);
+	if (!is_allocated()) return 0.0;
+	float const rate_scale(1.0/num_substeps), z_rate_scale(rate_scale/SMOKE_SKIPVAL);
+	float const xy_rate(SMOKE_DIS_XY*rate_scale), zu_rate(SMOKE_DIS_ZU*z_rate_scale), zd_rate(SMOKE_DIS_ZD*z_rate_scale);
+	if (update_state) {smoke_grid.ensure_zrng();}
+	double removed(0.0);
+	smoke_manager sman;
+
+	for (unsigned n = 0; n < num_substeps; ++n) {
+		if (empty()) break;
+		bool const last_substep(update_state && n+1 == num_substeps);
+		int r[3][2]; // process the current nonzero range expanded by one cell, plus the next buffer's old range so that it gets cleared
+
+		for (unsigned d = 0; d < 3; ++d) {
+			r[d][0] = max(0, bounds[cur][d][0]-1);
+			r[d][1] = min(int(MESH_SIZE[d]), bounds[cur][d][1]+1);
+			if (!bounds_empty(!cur)) {r[d][0] = min(r[d][0], bounds[!cur][d][0]); r[d][1] = max(r[d][1], bounds[!cur][d][1]);}
+		}
+		#pragma omp parallel for schedule(dynamic,1)
+		for (int y = r[1][0]; y < r[1][1]; ++y) {step_row(y, r, xy_rate, zu_rate, zd_rate, last_substep);}
+		int (&b)[3][2](bounds[!cur]);
+		clear_bounds(!cur);
+
+		for (int y = r[1][0]; y < r[1][1]; ++y) { // serial reduction of the per-row stats
+			row_stats_t const &rs(row_stats[y]);
+			removed += rs.removed;
+			if (rs.xmin >= rs.xmax) continue; // no smoke in this row
+			b[0][0] = min(b[0][0], rs.xmin); b[0][1] = max(b[0][1], rs.xmax);
+			b[1][0] = min(b[1][0], y);       b[1][1] = max(b[1][1], y+1);
+			b[2][0] = min(b[2][0], rs.zmin); b[2][1] = max(b[2][1], rs.zmax);
+			if (last_substep) {sman.merge(rs.sman);}
+		}
+		cur = !cur;
+	} // for n
+	if (update_state) {
+		smoke_man     = sman;
+		smoke_man.adj_bbox();
+		smoke_visible = smoke_man.smoke_vis;
+		smoke_exists  = smoke_man.enabled;
+	}
+	return removed;
+}
+
+smoke_field_t smoke_field;
+
+
+void reset_smoke_field() {smoke_field.clear();}
+
+
 void add_smoke(point const &pos, float val) {
 
 	if (!DYNAMIC_SMOKE || (display_mode & 0x80) || !game_mode || val == 0.0 || pos.z >= czmax) return;
-	lmcell *const lmc(lmap_manager.get_lmcell(pos));
-	if (!lmc) return;
+	if (!lmap_manager.is_allocated()) return;
 	int const xpos(get_xpos(pos.x)), ypos(get_ypos(pos.y));
 	if (point_outside_mesh(xpos, ypos) || pos.z >= v_collision_matrix[ypos][xpos].zmax || pos.z < mesh_height[ypos][xpos]) return; // above all cobjs/outside
 	if (no_smoke_over_mesh && !is_mesh_disabled(xpos, ypos)) return;
 	if (!check_smoke_bounds(pos)) return;
 	//if (!check_coll_line(pos, point(pos.x, pos.y, czmax), cindex, -1, 1, 0)) return; // too slow
-	adjust_smoke_val(lmc->smoke, SMOKE_DENSITY*val);
+	int const zpos(get_zpos(pos.z));
+	if (!smoke_field.add(xpos, ypos, zpos, SMOKE_DENSITY*val)) return;
 	smoke_exists |= smoke_man.is_smoke_visible(pos);
-	smoke_grid.register_smoke(xpos, ypos, get_zpos(pos.z));
-}
-
-
-void diffuse_smoke(int x, int y, int z, lmcell &adj, float pos_rate, float neg_rate, int dim, int dir) {
-
-	float delta(0.0); // Note: not using fticks due to instability
-	
-	if (lmap_manager.is_valid_cell(x, y, z)) {
-		lmcell &lmc(lmap_manager.get_lmcell(x, y, z));
-		unsigned char const flow(dir ? adj.pflow[dim] : lmc.pflow[dim]);
-		if (flow == 0) return;
-		float const cur_smoke(lmc.smoke);
-		delta  = (flow/255.0)*(adj.smoke - cur_smoke); // diffusion out of current cell and into cell xyz (can be negative)
-		delta *= ((delta < 0.0) ? neg_rate : pos_rate);
-		adjust_smoke_val(lmc.smoke, delta);
-		delta  = (lmc.smoke - cur_smoke); // actual change
-		if (lmc.smoke > 0.0) {smoke_grid.register_smoke(x, y, z);}
-	}
-	else { // edge cell has infinite smoke capacity and zero total smoke
-		delta = 0.5*(pos_rate + neg_rate);
-	}
-	adjust_smoke_val(adj.smoke, -delta);
+	smoke_grid.register_smoke(xpos, ypos, zpos);
 }
 
 
@@ -165,64 +352,48 @@ void distribute_smoke() { // called at most once per frame
 
 	//RESET_TIME;
 	if (!DYNAMIC_SMOKE || !smoke_exists || !animate2) return;
-	assert(SMOKE_SKIPVAL > 0);
-	static int cur_skip(0);
-	static rand_gen_t rgen;
-	
-	if (cur_skip == 0) {
-		//cout << "tot_smoke: " << smoke_man.tot_smoke << ", enabled: " << smoke_exists << ", visible: " << smoke_visible << endl;
-		smoke_man     = next_smoke_man;
-		smoke_man.adj_bbox();
-		smoke_visible = smoke_man.smoke_vis;
-		smoke_exists  = smoke_man.enabled;
-		next_smoke_man.reset();
-	}
 	/*if ((display_mode & 0x10) && !smoke_bounds.empty()) {
 		cur_smoke_bb = smoke_bounds[0];
 		for (vector<cube_t>::const_iterator i = smoke_bounds.begin()+1; i != smoke_bounds.end(); ++i) {cur_smoke_bb.union_with_cube(*i);}
 	}*/
-	float const xy_rate(SMOKE_DIS_XY*SMOKE_SKIPVAL);
-	int const dx(rgen.rand() & 1), dy(rgen.rand() & 1); // randomize the processing order
-	
-	// openmp doesn't really help here
-	for (int y = cur_skip; y < MESH_Y_SIZE; y += SMOKE_SKIPVAL) { // split the computation across several frames
-		for (int x = 0; x < MESH_X_SIZE; ++x) {
-			lmcell *vldata(lmap_manager.get_column(x, y));
-			if (vldata == NULL) continue;
-			smoke_entry_t &zrange(smoke_grid.get_z_range(x, y));
-			if (!zrange.valid()) continue;
-			bool any_z_has_smoke(0);
-			
-			for (int z = zrange.zmin; z < zrange.zmax; ++z) {
-				lmcell &lmc(vldata[z]);
-				if (lmc.smoke < SMOKE_THRESH) {lmc.smoke = 0.0;}
-				if (lmc.smoke == 0.0) continue;
-				//if (get_zval(z) > v_collision_matrix[y][x].zmax) {lmc.smoke = 0.0; continue;} // open space above - smoke goes up
-				next_smoke_man.add_smoke(x, y, z, lmc.smoke);
-				diffuse_smoke(x+(dx ?  1 : -1), y, z, lmc, xy_rate, xy_rate, 0,  dx);
-				diffuse_smoke(x+(dx ? -1 :  1), y, z, lmc, xy_rate, xy_rate, 0, !dx);
-				diffuse_smoke(x, y+(dy ?  1 : -1), z, lmc, xy_rate, xy_rate, 1,  dy);
-				diffuse_smoke(x, y+(dy ? -1 :  1), z, lmc, xy_rate, xy_rate, 1, !dy);
-				diffuse_smoke(x, y, (z - 1), lmc, SMOKE_DIS_ZD, SMOKE_DIS_ZU, 2, 0);
-				diffuse_smoke(x, y, (z + 1), lmc, SMOKE_DIS_ZU, SMOKE_DIS_ZD, 2, 1);
-				any_z_has_smoke = 1;
-			} // for z
-			if (!any_z_has_smoke) {zrange.clear();} // mark this xy as not having smoke
-		} // for x
-	} // for y
-	cur_skip = (cur_skip+1) % SMOKE_SKIPVAL;
+	if (!smoke_field.is_allocated() || smoke_field.empty()) {smoke_exists = smoke_visible = 0; return;}
+	smoke_field.step(max(smoke_substeps, 1U), 1); // full grid update every frame
 	//PRINT_TIME("Distribute Smoke");
 }
 
 
+// places a block of smoke in the center of the lightmap on a private field and checks mass conservation and timing
+void run_smoke_benchmark() {
+
+	unsigned const NUM_STEPS = 100;
+	smoke_field_t field;
+	field.ensure_alloc();
+	int const xc(MESH_X_SIZE/2), yc(MESH_Y_SIZE/2), rxy(max(1, MESH_X_SIZE/8)), rz(max(1, MESH_SIZE[2]/4));
+
+	for (int y = max(0, yc-rxy); y < min(MESH_Y_SIZE, yc+rxy); ++y) {
+		for (int x = max(0, xc-rxy); x < min(MESH_X_SIZE, xc+rxy); ++x) {
+			for (int z = 0; z < rz; ++z) {field.add(x, y, z, 0.5*SMOKE_MAX_VAL);}
+		}
+	}
+	double const start_total(field.get_total());
+	double removed(0.0);
+	int const start_time(GET_TIME_MS());
+	for (unsigned n = 0; n < NUM_STEPS; ++n) {removed += field.step(1, 0);}
+	int const elapsed(GET_TIME_MS() - start_time);
+	double const end_total(field.get_total()), error(start_total - removed - end_total);
+	cout << "Smoke benchmark: " << NUM_STEPS << " steps in " << elapsed << "ms (" << float(elapsed)/NUM_STEPS << "ms/step), smoke start " << start_total
+		 << ", end " << end_total << ", removed " << removed << ", conservation error " << error << " (" << ((start_total > 0.0) ? 100.0*fabs(error)/start_total : 0.0) << "%)" << endl;
+	assert(fabs(error) <= 1.0E-3*start_total); // 0.1% tolerance for float rounding in the per-cell updates
+}
+
+
 float get_smoke_at_pos(point const &pos) {
 
 	if (!DYNAMIC_SMOKE  || !smoke_exists)  return 0.0;
 	if (pos.z <= czmin0 || pos.z >= czmax) return 0.0;
 	int const x(get_xpos(pos.x)), y(get_ypos(pos.y)), z(get_zpos(pos.z));
 	if (point_outside_mesh(x, y) || z < 0 || z >= MESH_SIZE[2]) return 0.0;
-	lmcell const *const vldata(lmap_manager.get_column(x, y));
-	return ((vldata == NULL) ? 0.0 : vldata[z].smoke);
+	return smoke_field.get(x, y, z);
 }
 
 
@@ -241,8 +412,8 @@ void update_smoke_row(vector<unsigned char> &data, vector<unsigned> const &llvol
 	default_lmc.get_final_color(default_color, 1.0);
 
 	for (unsigned x = x_start; x < x_end; ++x) {
-		lmcell const *const vlm(lmap_manager.get_column(x, y));
-		if (vlm == NULL && !update_lighting) continue; // x/y pairs that get into here should also be constant
+		lmap_ccolumn_t const vlm(lmap_manager.get_column(x, y));
+		if (!vlm && !update_lighting) continue; // x/y pairs that get into here should also be constant
 		unsigned const off(zsize*(y*MESH_X_SIZE + x));
 		bool const check_z_thresh((display_mode & 0x01) && !is_mesh_disabled(x, y));
 		float const mh(mesh_height[y][x]);
@@ -267,9 +438,10 @@ void update_smoke_row(vector<unsigned char> &data, vector<unsigned> const &llvol
 		}
 		for (unsigned z = z_start; z < z_end; ++z) {
 			unsigned const off2(ncomp*(off + z));
-			if (vlm == NULL || vlm[z].smoke == 0.0) {data[off2+3] = 0;}
-			else {data[off2+3] = (unsigned char)(255*CLIP_TO_01(smoke_scale*vlm[z].smoke));} // alpha: smoke
+			float const smoke(vlm ? smoke_field.get(x, y, z) : 0.0f);
+			data[off2+3] = ((smoke == 0.0) ? 0 : (unsigned char)(255*CLIP_TO_01(smoke_scale*smoke))); // alpha: smoke
 			if (!do_lighting) continue; // lighting not needed
+			lmcell const &lmc(vlm ? vlm[z] : default_lmc);
 				
 			if (check_z_thresh && get_zval(z+1) < mh) { // adjust by one because GPU will interpolate the texel
 				UNROLL_3X(data[off2+i_] = 0;)
@@ -279,10 +451,10 @@ void update_smoke_row(vector<unsigned char> &data, vector<unsigned> const &llvol
 
 				if (create_voxel_landscape) {
 					float const indir_scale(get_voxel_terrain_ao_lighting_val(get_xyz_pos(x, y, z)));
-					if (vlm == NULL) {color = default_color*indir_scale;} else {vlm[z].get_final_color(color, 1.0, 1.0, indir_scale);}
+					if (!vlm) {color = default_color*indir_scale;} else {lmc.get_final_color(color, 1.0, 1.0, indir_scale);}
 				}
 				else {
-					if (vlm == NULL) {color = default_color;} else {vlm[z].get_final_color(color, 1.0, 1.0);}
+					if (!vlm) {color = default_color;} else {lmc.get_final_color(color, 1.0, 1.0);}
 				}
 				for (unsigned i = llv_ix_s; i < llv_ix_e; ++i) {local_light_volumes[llvol_ixs[i]]->add_lighting(color, x, y, z);} // add local light volumes
 				UNROLL_3X(data[off2+i_] = (unsigned char)(255*CLIP_TO_01(color[i_]));) // lmc.pflow[i_]
@@ -431,77 +603,148 @@ void update_dist_to_fire(point const &pos, float dist_mult) {
 	dist_to_fire_sq = ((dist_to_fire_sq == 0.0) ? dist_sq : min(dist_to_fire_sq, dist_sq));
 }
 
+enum {FIRE_EVENT_NONE=0, FIRE_EVENT_COBJS, FIRE_EVENT_GRASS, FIRE_EVENT_CRATER, FIRE_EVENT_SURF_DAMAGE, FIRE_EVENT_SMOKE, FIRE_EVENT_TREE};
+
 class ground_fire_manager_t {
-	
-	vector<fire_elem_t> grid;
+
+	// SoA state for each mesh cell, plus a list of burning cells in ignition order
+	vector<float> hp, fuel, burn_amt;
+	vector<unsigned char> is_burning; // cell is in active
+	vector<unsigned> active;
+
+	struct cell_update_t { // phase 1 output for each active cell, applied serially in phase 2
+		float spread, radius;
+		unsigned char event;
+		point pos;
+		cell_update_t() : spread(0.0), radius(0.0), event(FIRE_EVENT_NONE) {}
+	};
+	vector<cell_update_t> updates;
 	fire_drawer_t fire_drawer;
 	bool has_fire;
 
+	fire_elem_t get_elem(unsigned ix) const {fire_elem_t elem; elem.hp = hp[ix]; elem.fuel = fuel[ix]; elem.burn_amt = burn_amt[ix]; return elem;}
+	void set_elem(unsigned ix, fire_elem_t const &elem) {hp[ix] = elem.hp; fuel[ix] = elem.fuel; burn_amt[ix] = elem.burn_amt;}
+
 	bool burn_elem(int x, int y, float val) {
 		assert(val >= 0.0); // not negative
-		if (val > 0.0 && !point_outside_mesh(x, y) && !mesh_is_underwater(x, y)) {return grid[y*MESH_X_SIZE + x].burn(val);}
-		return 0;
+		if (val <= 0.0 || point_outside_mesh(x, y) || mesh_is_underwater(x, y)) return 0;
+		unsigned const ix(y*MESH_X_SIZE + x);
+		fire_elem_t elem(get_elem(ix));
+		bool const ret(elem.burn(val));
+		set_elem(ix, elem);
+		if (ret && !is_burning[ix]) {is_burning[ix] = 1; active.push_back(ix);}
+		return ret;
+	}
+	bool empty() const {return burn_amt.empty();}
+
+	void alloc() {
+		unsigned const num(XY_MULT_SIZE);
+		hp.assign(num, 0.0); fuel.assign(num, 0.0); burn_amt.assign(num, 0.0);
+		is_burning.assign(num, 0);
+		active.clear();
+		has_fire = 0;
+	}
+	// phase 1: update each burning cell independently and compute its spread amount and side effect; rgen is seeded per cell so results don't depend on threads
+	void calc_cell_update(unsigned i, float burn_rate, float spread_rate, bool sim_only) {
+		unsigned const ix(active[i]);
+		cell_update_t &u(updates[i]);
+		u = cell_update_t();
+		fire_elem_t elem(get_elem(ix));
+		elem.next_frame(burn_rate, 0.1);
+		set_elem(ix, elem);
+		//if (elem.fuel > 0.0) {elem.burn_amt = 1.0;} // for perf testing
+		if (spread_rate <= 0.0 || elem.burn_amt == 0.0) return;
+		u.spread = elem.burn_amt*spread_rate;
+		if (sim_only) return;
+		int const x(ix%MESH_X_SIZE), y(ix/MESH_X_SIZE);
+		rand_gen_t rgen;
+		rgen.set_state(ix, frame_counter);
+		rgen.rand_mix();
+		int const val(rgen.rand()&31);
+		if (val == 5) {u.event = FIRE_EVENT_COBJS; return;}
+		if (val > 4) return;
+		u.radius = HALF_DXY*elem.burn_amt;
+		u.pos.assign((get_xval(x) + 0.5*DX_VAL + 0.5*DX_VAL*rgen.signed_rand_float()), (get_yval(y) + 0.5*DY_VAL + 0.5*DY_VAL*rgen.signed_rand_float()), mesh_height[y][x]);
+		if      (val == 0) {u.event = FIRE_EVENT_GRASS;}
+		else if (val == 1) {if ((rgen.rand()&1 ) == 0) {u.event = FIRE_EVENT_CRATER;}}
+		else if (val == 2) {u.event = FIRE_EVENT_SURF_DAMAGE;}
+		else if (val == 3) {if ((rgen.rand()&15) == 0) {u.event = FIRE_EVENT_SMOKE;}}
+		else if (val == 4) {u.event = FIRE_EVENT_TREE;}
+	}
+	// phase 2: apply ignition requests and side effects in active list order; newly ignited cells are appended to the active list
+	void apply_cell_update(unsigned i, int dx, int dy, bool sim_only) {
+		cell_update_t const &u(updates[i]);
+		if (u.spread == 0.0) return;
+		unsigned const ix(active[i]);
+		int const x(ix%MESH_X_SIZE), y(ix/MESH_X_SIZE);
+		// Note: assumes the mesh is continuous and connected so that fire can spread in X and Y
+		burn_elem((x + dx), (y + dy), u.spread); // try to burn a neighbor
+		if (sim_only) return;
+		update_dist_to_fire(point((get_xval(x) + 0.5*DX_VAL), (get_yval(y) + 0.5*DY_VAL), mesh_height[y][x]), 0.25);
+
+		switch (u.event) {
+		case FIRE_EVENT_NONE: break;
+		case FIRE_EVENT_COBJS:       fire_damage_cobjs(x, y); break;
+		case FIRE_EVENT_GRASS:       modify_grass_at(u.pos, 0.5*u.radius, 0, 2); break; // sharp burn, only update every 31 frames
+		case FIRE_EVENT_CRATER:      add_crater_to_landscape_texture(u.pos.x, u.pos.y, 2.0*u.radius); break;
+		case FIRE_EVENT_SURF_DAMAGE: surface_damage[y][x] += 0.05*burn_amt[ix]; break;
+		case FIRE_EVENT_SMOKE:       gen_smoke(u.pos, 1.0, 1.0, colorRGBA(0.2, 0.2, 0.2, 0.25), 1); break; // no_lighting=1
+		case FIRE_EVENT_TREE:        apply_tree_fire(u.pos, 0.5*u.radius, 200.0); break;
+		default: assert(0);
+		}
 	}
-	bool empty() const {return grid.empty();}
 public:
 	ground_fire_manager_t() : has_fire(0) {}
 	bool is_active() const {return (!empty() && has_fire);}
+	unsigned num_burning() const {return active.size();}
 
 	void init() {
 		if (snow_enabled()) return; // fires don't mix with snow
-		grid.resize(XY_MULT_SIZE);
+		alloc();
 		rand_gen_t rgen;
 
 		for (int y = 0; y < MESH_Y_SIZE; ++y) {
 			for (int x = 0; x < MESH_X_SIZE; ++x) {
-				fire_elem_t &elem(grid[y*MESH_X_SIZE + x]);
 				float const grass_density(get_grass_density(x, y)); // Note: should return 0 underwater and on disabled mesh areas
 				if (grass_density == 0) continue; // leave HP and fuel at 0
-				elem.fuel = grass_density*rgen.rand_uniform(100.0, 150.0);
-				elem.hp   = rgen.rand_uniform(50.0, 100.0); // dryness factor
+				unsigned const ix(y*MESH_X_SIZE + x);
+				fuel[ix] = grass_density*rgen.rand_uniform(100.0, 150.0);
+				hp  [ix] = rgen.rand_uniform(50.0, 100.0); // dryness factor
 			}
 		}
 	}
-	void next_frame() {
-		if (!is_active() || !animate2) return; // not inited or no fire
-		//timer_t timer("Ground Fire Update");
-		assert((int)grid.size() == XY_MULT_SIZE);
+	void init_uniform(float fuel_amt, float hp_min, float hp_max, int rseed) { // for benchmarking
+		alloc();
+		rand_gen_t rgen;
+		rgen.set_state(rseed, 123);
+		for (unsigned ix = 0; ix < fuel.size(); ++ix) {fuel[ix] = fuel_amt; hp[ix] = rgen.rand_uniform(hp_min, hp_max);}
+	}
+	void update(bool sim_only, bool parallel) {
+		assert((int)burn_amt.size() == XY_MULT_SIZE);
 		int const dirs[4][2] = {{-1,0}, {1,0}, {0,-1}, {0,1}}; // W, E, S, N
 		int const dx(dirs[frame_counter&3][0]), dy(dirs[frame_counter&3][1]);
 		vector3d const dir(dx, dy, 0.0);
 		float const burn_rate(fire_elem_t::get_burn_rate());
 		float const spread_rate(2.5*fticks*burn_rate*min(2.5, max(0.0, (1.0 + 0.5*dot_product(wind, dir)))));
-		rand_gen_t rgen;
-		rgen.set_state(frame_counter, 123);
-		has_fire = 0; // reset for next frame
+		unsigned const num_active(active.size());
+		updates.resize(num_active);
 
-		for (int y = 0; y < MESH_Y_SIZE; ++y) {
-			float const yval(get_yval(y) + 0.5*DY_VAL);
+		#pragma omp parallel for schedule(static,256) if (parallel && num_active > 1024)
+		for (int i = 0; i < (int)num_active; ++i) {calc_cell_update(i, burn_rate, spread_rate, sim_only);}
+		for (unsigned i = 0; i < num_active; ++i) {apply_cell_update(i, dx, dy, sim_only);}
+		unsigned num_out(0);
 
-			for (int x = 0; x < MESH_X_SIZE; ++x) {
-				fire_elem_t &elem(grid[y*MESH_X_SIZE + x]);
-				elem.next_frame(burn_rate, 0.1);
-				has_fire |= (elem.burn_amt > 0.0);
-				//if (elem.fuel > 0.0) {elem.burn_amt = 1.0;} // for perf testing
-				if (spread_rate <= 0.0 || elem.burn_amt == 0.0) continue;
-				// Note: assumes the mesh is continuous and connected so that fire can spread in X and Y
-				burn_elem((x + dx), (y + dy), elem.burn_amt*spread_rate); // try to burn a neighbor
-				point pos((get_xval(x) + 0.5*DX_VAL), yval, mesh_height[y][x]);
-				update_dist_to_fire(pos, 0.25);
-				int const val(rgen.rand()&31);
-				if (val == 5) {fire_damage_cobjs(x, y);}
-				if (val > 4) continue;
-				float const radius(HALF_DXY*elem.burn_amt);
-				pos.x += 0.5*DX_VAL*rgen.signed_rand_float();
-				pos.y += 0.5*DY_VAL*rgen.signed_rand_float();
-				if      (val == 0) {modify_grass_at(pos, 0.5*radius, 0, 2);} // sharp burn, only update every 31 frames
-				//else if (val == 1) {add_color_to_landscape_texture(BLACK, pos.x, pos.y, 0.5*radius);}
-				else if (val == 1 && (rgen.rand()&1) == 0) {add_crater_to_landscape_texture(pos.x, pos.y, 2.0*radius);}
-				else if (val == 2) {surface_damage[y][x] += 0.05*elem.burn_amt;}
-				else if (val == 3 && (rgen.rand()&15) == 0) {gen_smoke(pos, 1.0, 1.0, colorRGBA(0.2, 0.2, 0.2, 0.25), 1);} // no_lighting=1
-				else if (val == 4) {apply_tree_fire(pos, 0.5*radius, 200.0);}
-			} // for x
-		} // for y
+		for (unsigned i = 0; i < active.size(); ++i) { // remove cells that have stopped burning, preserving order
+			unsigned const ix(active[i]);
+			if (burn_amt[ix] > 0.0) {active[num_out++] = ix;} else {is_burning[ix] = 0;}
+		}
+		active.resize(num_out);
+		has_fire = !active.empty();
+	}
+	void next_frame() {
+		if (!is_active() || !animate2) return; // not inited or no fire
+		//timer_t timer("Ground Fire Update");
+		update(0, 1);
 	}
 	void add_fire(point const &pos, float radius, float val) { // val is around 0.01 for fires
 		if (empty() || !animate2) return; // not inited
@@ -511,50 +754,91 @@ public:
 		if (abs(zval - (pos.z - radius)) > 2.0*radius) return; // too far above/below the mesh
 		has_fire |= burn_elem(get_xpos(pos.x), get_ypos(pos.y), 100.0*val*fire_elem_t::get_burn_rate());
 	}
+	bool ignite(int x, int y, float val) {return (has_fire |= burn_elem(x, y, val));} // for benchmarking
+	unsigned get_state_hash() const {
+		if (empty()) return 0;
+		unsigned hash(jenkins_one_at_a_time_hash((uint8_t const *)burn_amt.data(), burn_amt.size()*sizeof(float)));
+		hash ^= 31*jenkins_one_at_a_time_hash((uint8_t const *)fuel.data(), fuel.size()*sizeof(float));
+		if (!active.empty()) {hash ^= 17*jenkins_one_at_a_time_hash((uint8_t const *)active.data(), active.size()*sizeof(unsigned));}
+		return hash;
+	}
 	float get_burn_intensity(point const &pos, float radius) const {
 		if (!is_active() || world_mode != WMODE_GROUND) return 0.0; // not inited or no fire
 		int const x(get_xpos(pos.x)), y(get_ypos(pos.y));
 		if (point_outside_mesh(x, y)) return 0.0;
 		float const zval(interpolate_mesh_zval(pos.x, pos.y, 0.0, 0, 1));
 		if (abs(zval - (pos.z - radius)) > 2.0*radius) return 0.0; // too far above/below the mesh
-		return grid[y*MESH_X_SIZE + x].burn_amt;
+		return burn_amt[y*MESH_X_SIZE + x];
 	}
 	void draw(shader_t &s) { // Note: not const because fire_drawer is modified
 		if (!is_active()) return; // not inited or no fire
 		//timer_t timer("Ground Fire Draw"); // 9.7ms / 4.4ms
 		rand_gen_t rgen;
 
-		for (int y = 0; y < MESH_Y_SIZE; ++y) {
-			float const yval(get_yval(y) + 0.5*DY_VAL);
-
-			for (int x = 0; x < MESH_X_SIZE; ++x) {
-				float const burn_amt(grid[y*MESH_X_SIZE + x].burn_amt);
-				if (burn_amt == 0.0) continue; // not burning
-				point const pos((get_xval(x) + 0.5*DX_VAL), yval, mesh_height[y][x]);
-				if (!camera_pdu.sphere_visible_test(pos, 2.0*HALF_DXY)) continue; // VFC
-				rgen.set_state(845631*x, 667239*y);
-				rgen.rand_mix();
-				unsigned const num((rgen.rand()%int(1.0 + 5.5*burn_amt)) + 1);
-
-				for (unsigned n = 0; n < num; ++n) {
-					float const radius(burn_amt*HALF_DXY*rgen.rand_uniform(0.8, 1.3));
-					point pos2(pos);
-					pos2.x += 0.5*DX_VAL*rgen.signed_rand_float();
-					pos2.y += 0.5*DY_VAL*rgen.signed_rand_float();
-					pos2.z  = interpolate_mesh_zval(pos2.x, pos2.y, 0.0, 0, 1) + 0.5*radius;
-					fire_drawer.add_fire(pos2, radius, rgen.rand(), 0.45);
-				}
-			} // for x
-		} // for y
+		for (auto i = active.begin(); i != active.end(); ++i) {
+			float const burn(burn_amt[*i]);
+			if (burn == 0.0) continue; // not burning
+			int const x(*i%MESH_X_SIZE), y(*i/MESH_X_SIZE);
+			point const pos((get_xval(x) + 0.5*DX_VAL), (get_yval(y) + 0.5*DY_VAL), mesh_height[y][x]);
+			if (!camera_pdu.sphere_visible_test(pos, 2.0*HALF_DXY)) continue; // VFC
+			rgen.set_state(845631*x, 667239*y);
+			rgen.rand_mix();
+			unsigned const num((rgen.rand()%int(1.0 + 5.5*burn)) + 1);
+
+			for (unsigned n = 0; n < num; ++n) {
+				float const radius(burn*HALF_DXY*rgen.rand_uniform(0.8, 1.3));
+				point pos2(pos);
+				pos2.x += 0.5*DX_VAL*rgen.signed_rand_float();
+				pos2.y += 0.5*DY_VAL*rgen.signed_rand_float();
+				pos2.z  = interpolate_mesh_zval(pos2.x, pos2.y, 0.0, 0, 1) + 0.5*radius;
+				fire_drawer.add_fire(pos2, radius, rgen.rand(), 0.45);
+			}
+		} // for i
 		fire_drawer.draw(s);
 	}
 };
 
 ground_fire_manager_t ground_fire_manager;
 
-void init_ground_fire() {ground_fire_manager.init();}
+void run_ground_fire_benchmark();
+
+void init_ground_fire() {
+	if (fire_bench) {run_ground_fire_benchmark();}
+	ground_fire_manager.init();
+}
 void next_frame_ground_fire() {ground_fire_manager.next_frame();}
 void add_ground_fire(point const &pos, float radius, float val) {ground_fire_manager.add_fire(pos, radius, val);}
 float get_ground_fire_intensity(point const &pos, float radius) {return ground_fire_manager.get_burn_intensity(pos, radius);}
 void draw_ground_fires(shader_t &s) {ground_fire_manager.draw(s);}
 bool ground_fires_active() {return ground_fire_manager.is_active();}
+
+
+// ignites the center of a fully fueled mesh and runs the fire simulation with and without threads, checking that the results match
+void run_ground_fire_benchmark() {
+
+	unsigned const NUM_FRAMES = 500;
+	float const prev_fticks(fticks);
+	int const prev_frame_counter(frame_counter), prev_precip_mode(precip_mode);
+	fticks = 1.0; precip_mode = 0;
+	unsigned hash[2] = {0, 0}, max_burning(0);
+	int times[2] = {0, 0};
+
+	for (unsigned pass = 0; pass < 2; ++pass) { // {parallel, serial}
+		ground_fire_manager_t gfm;
+		gfm.init_uniform(150.0, 50.0, 100.0, 456);
+		int const xc(MESH_X_SIZE/2), yc(MESH_Y_SIZE/2);
+		for (int y = yc-2; y <= yc+2; ++y) {for (int x = xc-2; x <= xc+2; ++x) {gfm.ignite(x, y, 200.0);}}
+		int const start_time(GET_TIME_MS());
+
+		for (unsigned n = 0; n < NUM_FRAMES && gfm.is_active(); ++n) {
+			frame_counter = n;
+			gfm.update(1, (pass == 0)); // sim_only=1
+			max_burning = max(max_burning, gfm.num_burning());
+		}
+		times[pass] = GET_TIME_MS() - start_time;
+		hash [pass] = gfm.get_state_hash();
+	}
+	fticks = prev_fticks; frame_counter = prev_frame_counter; precip_mode = prev_precip_mode;
+	cout << "Ground fire benchmark: " << MESH_X_SIZE << "x" << MESH_Y_SIZE << " mesh, " << NUM_FRAMES << " frames, max burning cells " << max_burning
+		 << ", parallel " << times[0] << "ms, serial " << times[1] << "ms, " << ((hash[0] == hash[1]) ? "results match" : "RESULTS DIFFER") << endl;
+}
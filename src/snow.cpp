@@ -7,6 +7,7 @@
 #include "shaders.h"
 #include "model3d.h"
 #include <omp.h>
+#include <unordered_map>
 
 
 unsigned const VOXELS_PER_DIV = 8; // 1024 for 128 vertex mesh
@@ -46,6 +47,12 @@ struct zval_avg {
 	//       so we can have at max 64M snowflakes.
 	//       However, we can get snow to stack up at a vertical edge so we need to clamp the count
 	void update(float zval) {if (c < MAX_COUNT) {++c; z += zval;}}
+
+	void merge(zval_avg const &zv) { // combine partial sums, clamping to MAX_COUNT while preserving the average
+		unsigned const tot_c(unsigned(c) + unsigned(zv.c));
+		z += zv.z;
+		if (tot_c > MAX_COUNT) {z *= float(MAX_COUNT)/float(tot_c); c = MAX_COUNT;} else {c = tot_c;}
+	}
 	bool valid() const {return (c > 0);}
 	float getz() const {return z/c;}
 };
@@ -56,7 +63,7 @@ struct voxel_t {
 
 	voxel_t(void) {}
 	voxel_t(coord_type x, coord_type y, coord_type z) {p[0] = x; p[1] = y; p[2] = z;}
-	
+
 	voxel_t(point const &pt) {
 		p[0] = int(vox_delta.x*(pt.x + X_SCENE_SIZE) + 0.5);
 		p[1] = int(vox_delta.y*(pt.y + Y_SCENE_SIZE) + 0.5);
@@ -75,6 +82,16 @@ struct voxel_t {
 	bool operator==(voxel_t const &v) const {return (p[0] == v.p[0] && p[1] == v.p[1] && p[2] == v.p[2]);}
 };
 
+struct voxel_hash_t {
+	size_t operator()(voxel_t const &v) const {
+		uint64_t const key((uint64_t(uint16_t(v.p[0])) << 32) | (uint64_t(uint16_t(v.p[1])) << 16) | uint64_t(uint16_t(v.p[2])));
+		return size_t((key*0x9E3779B97F4A7C15ULL) >> 16); // Fibonacci hashing
+	}
+};
+
+typedef std::unordered_map<voxel_t, zval_avg, voxel_hash_t> voxel_hash_map; // unsorted per-thread accumulator
+typedef pair<voxel_t, zval_avg> voxel_zval_pair_t;
+
 
 struct voxel_z_pair {
 	voxel_t v;
@@ -300,7 +317,7 @@ bool voxel_map::read(char const *const fn) {
 	unsigned map_size(0);
 	size_t const sz_read(fread(&map_size, sizeof(unsigned), 1, fp));
 	assert(sz_read == 1);
-	
+
 	for (unsigned i = 0; i < map_size; ++i) {
 		data_block data;
 		size_t const n(fread(&data, sizeof(data_block), 1, fp));
@@ -490,6 +507,29 @@ bool check_snow_line_coll(point const &pos1, point const &pos2, point &cpos, vec
 }
 
 
+void merge_snow_maps(vector<voxel_hash_map> &thread_maps, voxel_map &vmap) {
+
+	// flatten all per-thread maps into one vector, sort once, then merge duplicates and build the sorted map in order
+	size_t tot_sz(0);
+	for (auto i = thread_maps.begin(); i != thread_maps.end(); ++i) {tot_sz += i->size();}
+	vector<voxel_zval_pair_t> vz;
+	vz.reserve(tot_sz);
+
+	for (auto i = thread_maps.begin(); i != thread_maps.end(); ++i) {
+		vz.insert(vz.end(), i->begin(), i->end());
+		voxel_hash_map().swap(*i); // free memory as we go
+	}
+	sort(vz.begin(), vz.end(), [](voxel_zval_pair_t const &a, voxel_zval_pair_t const &b) {return (a.first < b.first);});
+	vmap.clear();
+
+	for (auto i = vz.begin(); i != vz.end();) {
+		voxel_zval_pair_t cur(*i);
+		for (++i; i != vz.end() && i->first == cur.first; ++i) {cur.second.merge(i->second);}
+		vmap.emplace_hint(vmap.end(), cur); // always inserted at the end since vz is sorted
+	}
+}
+
+
 void create_snow_map(voxel_map &vmap) {
 
 	// distribute snowflakes over the scene and build the voxel map of hits
@@ -497,10 +537,13 @@ void create_snow_map(voxel_map &vmap) {
 	float const zval(max(ztop, czmax)), zv_scale(1.0/(zval - zbottom));
 	float const xscale(2.0*X_SCENE_SIZE/num_per_dim), yscale(2.0*Y_SCENE_SIZE/num_per_dim);
 	all_models.build_cobj_trees(1);
-	cout << "Snow accumulation progress (out of " << num_per_dim << "):     0";
+	unsigned const num_threads(max(1, omp_get_max_threads()));
+	vector<voxel_hash_map> thread_maps(num_threads); // one per thread, no locking required
+	cout << "Snow accumulation progress (out of " << num_per_dim << ", " << num_threads << " threads):     0";
 
-#pragma omp parallel for schedule(dynamic,1)
+#pragma omp parallel for schedule(dynamic,1) num_threads(num_threads)
 	for (int y = 0; y < num_per_dim; ++y) {
+		voxel_hash_map &tmap(thread_maps[omp_get_thread_num()]);
 		if (omp_get_thread_num() == 0) {increment_printed_number(y);} // progress for thread 0
 		rand_gen_t rgen;
 		rgen.set_state(123, y);
@@ -539,14 +582,11 @@ void create_snow_map(voxel_map &vmap) {
 				}
 				++iter;
 			} // end while
-			if (!invalid) {
-				voxel_t const voxel(pos2);
-#pragma omp critical(snow_map_update)
-				vmap[voxel].update(pos2.z);
-			}
+			if (!invalid) {tmap[voxel_t(pos2)].update(pos2.z);}
 		} // for x
 	} // for y
 	cout << endl;
+	merge_snow_maps(thread_maps, vmap);
 }
 
 
@@ -674,7 +714,7 @@ void gen_snow_coverage() {
 
 	// setup voxel scales
 	vox_delta.assign(VOXELS_PER_DIV/DX_VAL, VOXELS_PER_DIV/DY_VAL, 1.0/(max(DZ_VAL/VOXELS_PER_DIV, snow_depth)));
-	
+
 	if (read_snow_file) {
 		RESET_TIME;
 		if (!vmap.read(snow_file)) {has_snow = 0; return;}
@@ -750,7 +790,7 @@ bool get_snow_height(point const &p, float radius, float &zval, vector3d &norm,
 	if (it == x_strip_map.end()) return 0; // x-value not found
 	assert(it->second < snow_strips.size());
 	assert(snow_strips[it->second].xval == xval);
-	
+
 	for (unsigned i = it->second; i < snow_strips.size(); ++i) {
 		strip_t const &s(snow_strips[i]);
 		if (s.xval > xval)    break; // went too far in x
@@ -0,0 +1,507 @@
+// 3D World - CPU BC1/BC3/BC5 Texture Block Compression and Compressed Texture Cache
+// by 3DWorld contributors
+// 10/18/26
+
+#include "3DWorld.h"
+#include "textures_3dw.h"
+#include "gl_ext_arb.h"
+#include <omp.h>
+#include <cstring>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+unsigned const BC_CACHE_VERSION = 1; // increment when the encoder or mipmap generation changes
+unsigned const BC_NUM_REFINE    = 2; // least squares endpoint refinement iterations
+char const BC_CACHE_MAGIC[4]    = {'3', 'B', 'C', 'T'};
+
+bool cpu_tex_compress(0), bc5_normal_maps(0), tex_compress_bench(0); // CPU compression is off by default; the driver compresses at upload
+std::string texture_cache_dir("texture_cache"); // relative paths are under cache_dir; empty = disabled
+
+extern bool mipmap_gamma_correct, mipmap_use_kaiser;
+extern std::string cache_dir;
+extern vector<texture_t> textures;
+
+
+// ************ Block Encoders/Decoders ************
+
+unsigned get_bc_block_bytes(unsigned fmt) {
+	assert(fmt != TEX_COMP_NONE && fmt < NUM_TEX_COMP);
+	return ((fmt == TEX_COMP_BC1) ? 8 : 16);
+}
+
+unsigned get_bc_level_size(unsigned w, unsigned h, unsigned fmt) {return ((w+3)/4)*((h+3)/4)*get_bc_block_bytes(fmt);}
+
+GLenum get_bc_gl_format(unsigned fmt) {
+	GLenum const formats[NUM_TEX_COMP] = {0, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, GL_COMPRESSED_RG_RGTC2};
+	assert(fmt != TEX_COMP_NONE && fmt < NUM_TEX_COMP);
+	return formats[fmt];
+}
+
+inline void write_u16(unsigned char *dst, unsigned v) {dst[0] = (v & 0xFF); dst[1] = ((v >> 8) & 0xFF);}
+inline unsigned read_u16(unsigned char const *src) {return (src[0] | (src[1] << 8));}
+
+inline unsigned pack_565(float const c[3]) {
+	unsigned const r(unsigned(CLIP_TO_01(c[0]/255.0f)*31.0f + 0.5f)), g(unsigned(CLIP_TO_01(c[1]/255.0f)*63.0f + 0.5f)), b(unsigned(CLIP_TO_01(c[2]/255.0f)*31.0f + 0.5f));
+	return ((r << 11) | (g << 5) | b);
+}
+inline void unpack_565(unsigned v, int c[3]) {
+	unsigned const r(v >> 11), g((v >> 5) & 63), b(v & 31);
+	c[0] = ((r << 3) | (r >> 2)); c[1] = ((g << 2) | (g >> 4)); c[2] = ((b << 3) | (b >> 2));
+}
+
+void get_bc1_palette(unsigned c0, unsigned c1, int pal[4][3]) { // 4-color mode if c0 > c1, otherwise 3-color + black
+	unpack_565(c0, pal[0]);
+	unpack_565(c1, pal[1]);
+
+	for (unsigned i = 0; i < 3; ++i) {
+		if (c0 > c1) {
+			pal[2][i] = (2*pal[0][i] + pal[1][i])/3;
+			pal[3][i] = (pal[0][i] + 2*pal[1][i])/3;
+		}
+		else {
+			pal[2][i] = (pal[0][i] + pal[1][i])/2;
+			pal[3][i] = 0;
+		}
+	}
+}
+
+// returns the 2-bit indices for 4-color mode with endpoints in either order; err is the sum of squared errors
+unsigned calc_bc1_indices(float const px[16][3], unsigned c0, unsigned c1, float &err) {
+
+	int pal[4][3];
+	get_bc1_palette(max(c0, c1), min(c0, c1), pal);
+	if (c0 < c1) {for (unsigned i = 0; i < 3; ++i) {swap(pal[0][i], pal[1][i]); swap(pal[2][i], pal[3][i]);}}
+	unsigned indices(0);
+	err = 0.0;
+
+	for (unsigned p = 0; p < 16; ++p) {
+		float best_dist(0.0);
+		unsigned best_ix(0);
+
+		for (unsigned n = 0; n < ((c0 == c1) ? 1U : 4U); ++n) {
+			float dist(0.0);
+			for (unsigned i = 0; i < 3; ++i) {float const d(px[p][i] - pal[n][i]); dist += d*d;}
+			if (n == 0 || dist < best_dist) {best_dist = dist; best_ix = n;}
+		}
+		indices |= (best_ix << (2*p));
+		err += best_dist;
+	}
+	return indices;
+}
+
+// solves for the endpoints that minimize squared error given fixed palette indices
+bool calc_bc1_ls_endpoints(float const px[16][3], unsigned indices, float e0[3], float e1[3]) {
+
+	float const weights[4] = {1.0f, 0.0f, 2.0f/3.0f, 1.0f/3.0f}; // weight of e0 for each index
+	float aa(0.0), ab(0.0), bb(0.0), ax[3] = {0.0}, bx[3] = {0.0};
+
+	for (unsigned p = 0; p < 16; ++p) {
+		float const a(weights[(indices >> (2*p)) & 3]), b(1.0f - a);
+		aa += a*a; ab += a*b; bb += b*b;
+		for (unsigned i = 0; i < 3; ++i) {ax[i] += a*px[p][i]; bx[i] += b*px[p][i];}
+	}
+	float const det(aa*bb - ab*ab);
+	if (fabs(det) < 1.0E-6f) return 0; // singular (all the same index)
+
+	for (unsigned i = 0; i < 3; ++i) {
+		e0[i] = (ax[i]*bb - bx[i]*ab)/det;
+		e1[i] = (bx[i]*aa - ax[i]*ab)/det;
+	}
+	return 1;
+}
+
+void encode_bc1_block(unsigned char const rgba[16][4], unsigned char *dst) {
+
+	float px[16][3], mean[3] = {0.0}, cov[6] = {0.0};
+
+	for (unsigned p = 0; p < 16; ++p) {
+		for (unsigned i = 0; i < 3; ++i) {px[p][i] = rgba[p][i]; mean[i] += px[p][i]/16.0f;}
+	}
+	for (unsigned p = 0; p < 16; ++p) {
+		float const d[3] = {px[p][0]-mean[0], px[p][1]-mean[1], px[p][2]-mean[2]};
+		cov[0] += d[0]*d[0]; cov[1] += d[0]*d[1]; cov[2] += d[0]*d[2]; cov[3] += d[1]*d[1]; cov[4] += d[1]*d[2]; cov[5] += d[2]*d[2];
+	}
+	float axis[3] = {1.0f, 1.0f, 1.0f}; // principal axis of the block colors by power iteration
+
+	for (unsigned n = 0; n < 8; ++n) {
+		float const a[3] = {(cov[0]*axis[0] + cov[1]*axis[1] + cov[2]*axis[2]), (cov[1]*axis[0] + cov[3]*axis[1] + cov[4]*axis[2]), (cov[2]*axis[0] + cov[4]*axis[1] + cov[5]*axis[2])};
+		float const mag(max(fabs(a[0]), max(fabs(a[1]), fabs(a[2]))));
+		if (mag < 1.0E-6f) break; // single color
+		for (unsigned i = 0; i < 3; ++i) {axis[i] = a[i]/mag;}
+	}
+	unsigned min_p(0), max_p(0);
+	float min_d(0.0), max_d(0.0);
+
+	for (unsigned p = 0; p < 16; ++p) {
+		float const d(px[p][0]*axis[0] + px[p][1]*axis[1] + px[p][2]*axis[2]);
+		if (p == 0 || d < min_d) {min_d = d; min_p = p;}
+		if (p == 0 || d > max_d) {max_d = d; max_p = p;}
+	}
+	unsigned c0(pack_565(px[max_p])), c1(pack_565(px[min_p]));
+	float err(0.0);
+	unsigned indices(calc_bc1_indices(px, c0, c1, err));
+
+	for (unsigned n = 0; n < BC_NUM_REFINE && err > 0.0; ++n) {
+		float e0[3], e1[3], new_err(0.0);
+		if (!calc_bc1_ls_endpoints(px, indices, e0, e1)) break;
+		unsigned const nc0(pack_565(e0)), nc1(pack_565(e1));
+		unsigned const new_indices(calc_bc1_indices(px, nc0, nc1, new_err));
+		if (new_err >= err) break; // no improvement
+		c0 = nc0; c1 = nc1; indices = new_indices; err = new_err;
+	}
+	if (c0 < c1) {swap(c0, c1); indices ^= 0x55555555;} // swap endpoints to get 4-color mode, and swap index pairs 0<=>1 and 2<=>3
+	if (c0 == c1) {indices = 0;} // 3-color mode: only use the first color
+	write_u16(dst+0, c0);
+	write_u16(dst+2, c1);
+	write_u16(dst+4, (indices & 0xFFFF));
+	write_u16(dst+6, (indices >> 16));
+}
+
+void decode_bc1_block(unsigned char const *src, unsigned char rgba[16][4]) {
+
+	int pal[4][3];
+	unsigned const c0(read_u16(src)), c1(read_u16(src+2)), indices(read_u16(src+4) | (read_u16(src+6) << 16));
+	get_bc1_palette(c0, c1, pal);
+
+	for (unsigned p = 0; p < 16; ++p) {
+		unsigned const ix((indices >> (2*p)) & 3);
+		for (unsigned i = 0; i < 3; ++i) {rgba[p][i] = (unsigned char)pal[ix][i];}
+		rgba[p][3] = ((c0 <= c1 && ix == 3) ? 0 : 255);
+	}
+}
+
+void get_bc4_palette(unsigned a0, unsigned a1, float pal[8]) {
+	pal[0] = a0; pal[1] = a1;
+
+	if (a0 > a1) {for (unsigned i = 1; i < 7; ++i) {pal[i+1] = ((7-i)*a0 + i*a1)/7.0f;}} // 8-value mode
+	else {
+		for (unsigned i = 1; i < 5; ++i) {pal[i+1] = ((5-i)*a0 + i*a1)/5.0f;} // 6-value mode
+		pal[6] = 0.0; pal[7] = 255.0;
+	}
+}
+
+void encode_bc4_block(unsigned char const vals[16], unsigned char *dst) { // single channel; used for BC3 alpha and BC5
+
+	unsigned a0(vals[0]), a1(vals[0]);
+	for (unsigned p = 1; p < 16; ++p) {a0 = max(a0, (unsigned)vals[p]); a1 = min(a1, (unsigned)vals[p]);}
+	dst[0] = (unsigned char)a0;
+	dst[1] = (unsigned char)a1;
+	for (unsigned i = 2; i < 8; ++i) {dst[i] = 0;}
+	if (a0 == a1) return; // single value, all indices are 0
+	float pal[8];
+	get_bc4_palette(a0, a1, pal);
+	unsigned long long bits(0);
+
+	for (unsigned p = 0; p < 16; ++p) {
+		unsigned best_ix(0);
+		float best_dist(fabs(vals[p] - pal[0]));
+
+		for (unsigned n = 1; n < 8; ++n) {
+			float const dist(fabs(vals[p] - pal[n]));
+			if (dist < best_dist) {best_dist = dist; best_ix = n;}
+		}
+		bits |= ((unsigned long long)best_ix << (3*p));
+	}
+	for (unsigned i = 0; i < 6; ++i) {dst[i+2] = (unsigned char)((bits >> (8*i)) & 0xFF);}
+}
+
+void decode_bc4_block(unsigned char const *src, unsigned char vals[16]) {
+
+	float pal[8];
+	get_bc4_palette(src[0], src[1], pal);
+	unsigned long long bits(0);
+	for (unsigned i = 0; i < 6; ++i) {bits |= ((unsigned long long)src[i+2] << (8*i));}
+	for (unsigned p = 0; p < 16; ++p) {vals[p] = (unsigned char)(pal[(bits >> (3*p)) & 7] + 0.5f);}
+}
+
+
+// ************ Image Compression ************
+
+void get_rgba_block(unsigned char const *src, unsigned w, unsigned h, unsigned nc, unsigned bx, unsigned by, unsigned char rgba[16][4]) {
+
+	for (unsigned y = 0; y < 4; ++y) {
+		unsigned const yy(min(4*by+y, h-1)); // clamp to the image edge for partial blocks
+
+		for (unsigned x = 0; x < 4; ++x) {
+			unsigned char const *p(src + nc*(yy*w + min(4*bx+x, w-1)));
+			unsigned char *d(rgba[4*y+x]);
+			if (nc >= 3) {UNROLL_3X(d[i_] = p[i_];)} else {UNROLL_3X(d[i_] = p[min(unsigned(i_), nc-1)];)}
+			d[3] = ((nc == 4) ? p[3] : 255);
+		}
+	}
+}
+
+void compress_image_bc(unsigned char const *src, unsigned w, unsigned h, unsigned nc, unsigned fmt, unsigned char *dst) {
+
+	assert(src != nullptr && dst != nullptr && w > 0 && h > 0);
+	assert(nc >= ((fmt == TEX_COMP_BC3) ? 4U : ((fmt == TEX_COMP_BC5) ? 2U : 3U)));
+	unsigned const bw((w+3)/4), bh((h+3)/4), block_bytes(get_bc_block_bytes(fmt));
+
+#pragma omp parallel for schedule(dynamic,4) if (bw*bh >= 256)
+	for (int by = 0; by < (int)bh; ++by) {
+		for (unsigned bx = 0; bx < bw; ++bx) {
+			unsigned char rgba[16][4], chan[16];
+			unsigned char *d(dst + block_bytes*(by*bw + bx));
+			get_rgba_block(src, w, h, nc, bx, by, rgba);
+
+			if (fmt == TEX_COMP_BC1) {encode_bc1_block(rgba, d);}
+			else if (fmt == TEX_COMP_BC3) {
+				for (unsigned p = 0; p < 16; ++p) {chan[p] = rgba[p][3];}
+				encode_bc4_block(chan, d); // alpha block first
+				encode_bc1_block(rgba, d+8);
+			}
+			else { // BC5: R and G only
+				for (unsigned c = 0; c < 2; ++c) {
+					for (unsigned p = 0; p < 16; ++p) {chan[p] = rgba[p][c];}
+					encode_bc4_block(chan, d+8*c);
+				}
+			}
+		} // for bx
+	} // for by
+}
+
+void decompress_image_bc(unsigned char const *src, unsigned w, unsigned h, unsigned fmt, unsigned char *dst_rgba) {
+
+	unsigned const bw((w+3)/4), bh((h+3)/4), block_bytes(get_bc_block_bytes(fmt));
+
+#pragma omp parallel for schedule(dynamic,4) if (bw*bh >= 256)
+	for (int by = 0; by < (int)bh; ++by) {
+		for (unsigned bx = 0; bx < bw; ++bx) {
+			unsigned char rgba[16][4], chan[16];
+			unsigned char const *s(src + block_bytes*(by*bw + bx));
+
+			if (fmt == TEX_COMP_BC1) {decode_bc1_block(s, rgba);}
+			else if (fmt == TEX_COMP_BC3) {
+				decode_bc1_block(s+8, rgba);
+				decode_bc4_block(s, chan);
+				for (unsigned p = 0; p < 16; ++p) {rgba[p][3] = chan[p];}
+			}
+			else {
+				for (unsigned c = 0; c < 2; ++c) {
+					decode_bc4_block(s+8*c, chan);
+					for (unsigned p = 0; p < 16; ++p) {rgba[p][c] = chan[p];}
+				}
+				for (unsigned p = 0; p < 16; ++p) {rgba[p][2] = 0; rgba[p][3] = 255;}
+			}
+			for (unsigned y = 0; y < 4 && 4*by+y < h; ++y) {
+				for (unsigned x = 0; x < 4 && 4*bx+x < w; ++x) {
+					for (unsigned i = 0; i < 4; ++i) {dst_rgba[4*((4*by+y)*w + 4*bx+x) + i] = rgba[4*y+x][i];}
+				}
+			}
+		} // for bx
+	} // for by
+}
+
+
+// ************ Compressed Texture Cache ************
+
+struct bc_cache_header_t {
+	char magic[4];
+	unsigned version, format, width, height, num_levels, data_size;
+	unsigned long long key;
+};
+
+unsigned long long hash_bytes_64(unsigned char const *data, size_t len, unsigned long long h) { // FNV-1a
+	for (size_t i = 0; i < len; ++i) {h ^= data[i]; h *= 1099511628211ULL;}
+	return h;
+}
+
+bool is_abs_path(std::string const &path) {
+	return (!path.empty() && (path[0] == '/' || path[0] == '\\' || (path.size() > 1 && path[1] == ':')));
+}
+
+std::string get_cache_base_dir() { // per-user cache dir, unless overridden with cache_dir in the config file
+
+	if (!cache_dir.empty()) return cache_dir;
+#ifdef _WIN32
+	char const *const local_app_data(getenv("LOCALAPPDATA"));
+	if (local_app_data && *local_app_data) return std::string(local_app_data) + "/3DWorld";
+#else
+	char const *const xdg_cache(getenv("XDG_CACHE_HOME"));
+	if (xdg_cache && *xdg_cache) return std::string(xdg_cache) + "/3dworld";
+	char const *const home(getenv("HOME"));
+	if (home && *home) return std::string(home) + "/.cache/3dworld";
+#endif
+	return "."; // no user dir; use the working directory
+}
+
+std::string const &get_tex_cache_dir() { // empty if the cache is disabled; computed once, after the config file has been read
+	static std::string const dir(texture_cache_dir.empty() ? "" : (is_abs_path(texture_cache_dir) ? texture_cache_dir : (get_cache_base_dir() + "/" + texture_cache_dir)));
+	return dir;
+}
+
+void create_dirs(std::string const &path) { // create path and any missing parents; okay if they already exist
+	for (size_t pos = 1; pos <= path.size(); ++pos) {
+		if (pos < path.size() && path[pos] != '/' && path[pos] != '\\') continue;
+		if (path[pos-1] == ':') continue; // windows drive letter
+		std::string const dir(path.substr(0, pos));
+#ifdef _WIN32
+		_mkdir(dir.c_str());
+#else
+		mkdir(dir.c_str(), 0755);
+#endif
+	}
+}
+
+std::string get_tex_cache_fn(unsigned long long key) {
+	std::ostringstream oss;
+	oss << get_tex_cache_dir() << "/" << std::hex << key << ".bct";
+	return oss.str();
+}
+
+bool read_compressed_tex_cache(bc_cache_header_t const &exp_header, vector<unsigned char> &cdata) {
+
+	if (get_tex_cache_dir().empty()) return 0;
+	FILE *fp(fopen(get_tex_cache_fn(exp_header.key).c_str(), "rb"));
+	if (fp == nullptr) return 0; // not cached
+	bc_cache_header_t header;
+	bool valid(fread(&header, sizeof(header), 1, fp) == 1);
+	valid &= (memcmp(header.magic, exp_header.magic, 4) == 0 && header.version == exp_header.version && header.format == exp_header.format &&
+		header.width == exp_header.width && header.height == exp_header.height && header.num_levels == exp_header.num_levels &&
+		header.data_size == exp_header.data_size && header.key == exp_header.key);
+
+	if (valid) {
+		cdata.resize(header.data_size);
+		valid = (fread(&cdata.front(), 1, cdata.size(), fp) == cdata.size());
+	}
+	fclose(fp);
+	if (!valid) {std::cerr << "Warning: Ignoring invalid compressed texture cache file " << get_tex_cache_fn(exp_header.key) << endl;}
+	return valid;
+}
+
+void write_compressed_tex_cache(bc_cache_header_t const &header, vector<unsigned char> const &cdata) {
+
+	if (get_tex_cache_dir().empty()) return;
+	static bool dir_created(0), write_failed(0);
+
+	if (!dir_created) {
+#pragma omp critical(create_tex_cache_dir)
+		{
+			if (!dir_created) {create_dirs(get_tex_cache_dir());}
+			dir_created = 1;
+		}
+	}
+	std::string const fn(get_tex_cache_fn(header.key)), tmp_fn(fn + ".tmp");
+	FILE *fp(fopen(tmp_fn.c_str(), "wb"));
+
+	if (fp == nullptr) {
+		if (!write_failed) {std::cerr << "Warning: Failed to write to texture cache directory " << get_tex_cache_dir() << "; compressed textures will not be cached" << endl;}
+		write_failed = 1;
+		return;
+	}
+	bool const success(fwrite(&header, sizeof(header), 1, fp) == 1 && fwrite(&cdata.front(), 1, cdata.size(), fp) == cdata.size());
+	fclose(fp);
+	remove(fn.c_str()); // required on windows, where rename() fails if the target exists
+	if (!success || rename(tmp_fn.c_str(), fn.c_str()) != 0) {remove(tmp_fn.c_str());} // write to a temp file so that partial files are never read
+}
+
+
+// ************ texture_t Integration ************
+
+// fills cdata with all compressed mip levels, loading from the cache if possible; doesn't make any GL calls
+void texture_t::get_compressed_data(unsigned fmt, vector<unsigned char> &cdata, vector<unsigned> &level_offsets) {
+
+	assert(fmt != TEX_COMP_NONE && is_allocated() && !is_16_bit_gray);
+	unsigned num_levels(1), data_size(0);
+	if (use_mipmaps) {calc_mipmap_offsets(width, height, ncolors, level_offsets); num_levels += level_offsets.size();} // full mip chain
+	level_offsets.clear();
+
+	for (unsigned level = 0; level < num_levels; ++level) {
+		level_offsets.push_back(data_size);
+		data_size += get_bc_level_size(max(width >> level, 1), max(height >> level, 1), fmt);
+	}
+	image_scale_params_t const params(get_tex_scale_params(*this));
+	bc_cache_header_t header;
+	memset(&header, 0, sizeof(header)); // zero padding so that the hash is deterministic
+	memcpy(header.magic, BC_CACHE_MAGIC, 4);
+	header.version = BC_CACHE_VERSION; header.format = fmt; header.width = width; header.height = height; header.num_levels = num_levels; header.data_size = data_size;
+	// content hash: image data + anything that affects the output
+	unsigned const params_key[4] = {(unsigned)params.linear_space, (unsigned)params.use_kaiser, (unsigned)params.preserve_coverage, (unsigned)ncolors};
+	header.key = hash_bytes_64(data, num_bytes(), 14695981039346656037ULL);
+	header.key = hash_bytes_64((unsigned char const *)&header, offsetof(bc_cache_header_t, key), header.key);
+	header.key = hash_bytes_64((unsigned char const *)params_key, sizeof(params_key), header.key);
+	if (read_compressed_tex_cache(header, cdata)) return; // cache hit
+	cdata.resize(data_size);
+	compress_image_bc(data, width, height, ncolors, fmt, &cdata.front());
+
+	if (num_levels > 1) {
+		vector<unsigned> mm_offs;
+		vector<unsigned char> mm_buf;
+		unsigned char const *mm(mm_data);
+
+		if (mm_offsets.empty()) { // CPU mipmaps not already built (use_mipmaps != 2)
+			mm_buf.resize(calc_mipmap_offsets(width, height, ncolors, mm_offs));
+			gen_mipmaps(data, width, height, ncolors, 0, params, &mm_buf.front(), mm_offs);
+			mm = &mm_buf.front();
+		}
+		else {mm_offs = mm_offsets;}
+		assert(mm_offs.size()+1 == num_levels);
+
+		for (unsigned level = 1; level < num_levels; ++level) {
+			compress_image_bc((mm + mm_offs[level-1]), max(width >> level, 1), max(height >> level, 1), ncolors, fmt, &cdata[level_offsets[level]]);
+		}
+	}
+	write_compressed_tex_cache(header, cdata);
+}
+
+bool texture_t::upload_cpu_compressed() {
+
+	unsigned const fmt(get_cpu_compress_format());
+	if (fmt == TEX_COMP_NONE) return 0;
+	vector<unsigned char> cdata;
+	vector<unsigned> level_offsets;
+	get_compressed_data(fmt, cdata, level_offsets);
+	GLenum const gl_fmt(get_bc_gl_format(fmt));
+
+	for (unsigned level = 0; level < level_offsets.size(); ++level) {
+		unsigned const end_ix((level+1 < level_offsets.size()) ? level_offsets[level+1] : (unsigned)cdata.size());
+		glCompressedTexImage2D(GL_TEXTURE_2D, level, gl_fmt, max(width >> level, 1), max(height >> level, 1), 0, (end_ix - level_offsets[level]), &cdata[level_offsets[level]]);
+	}
+	return 1;
+}
+
+
+// ************ Benchmark ************
+
+float calc_psnr(unsigned char const *orig, unsigned char const *rgba, unsigned npixels, unsigned nc, unsigned num_chan) {
+
+	double sse(0.0);
+
+	for (unsigned i = 0; i < npixels; ++i) {
+		for (unsigned c = 0; c < num_chan; ++c) {double const d(double(orig[nc*i+c]) - double(rgba[4*i+c])); sse += d*d;}
+	}
+	double const mse(sse/(double(npixels)*num_chan));
+	return ((mse > 0.0) ? float(10.0*log10(255.0*255.0/mse)) : 99.0f);
+}
+
+// GL-free; enabled with the "tex_compress_bench" config option
+void run_texture_compress_benchmark() {
+
+	double total_time(0.0), total_mb(0.0), psnr_sum[NUM_TEX_COMP] = {0.0};
+	unsigned num_tex[NUM_TEX_COMP] = {0};
+	vector<unsigned char> cdata, rgba;
+
+	for (auto t = textures.begin(); t != textures.end(); ++t) {
+		if (!t->is_allocated() || t->defer_load() || t->is_16_bit_gray || t->ncolors < 3) continue;
+		unsigned const fmt(t->normal_map ? TEX_COMP_BC5 : ((t->ncolors == 4) ? TEX_COMP_BC3 : TEX_COMP_BC1));
+		cdata.resize(get_bc_level_size(t->width, t->height, fmt));
+		rgba.resize(4*t->num_pixels());
+		double const start_time(omp_get_wtime());
+		compress_image_bc(t->get_data(), t->width, t->height, t->ncolors, fmt, &cdata.front());
+		total_time += omp_get_wtime() - start_time;
+		total_mb   += 1.0E-6*t->num_bytes();
+		decompress_image_bc(&cdata.front(), t->width, t->height, fmt, &rgba.front());
+		psnr_sum[fmt] += calc_psnr(t->get_data(), &rgba.front(), t->num_pixels(), t->ncolors, ((fmt == TEX_COMP_BC5) ? 2 : t->ncolors));
+		++num_tex[fmt];
+	}
+	char const *const fmt_names[NUM_TEX_COMP] = {"", "BC1", "BC3", "BC5"};
+	cout << "Texture compression benchmark: " << total_mb << " MB in " << 1000.0*total_time << " ms = " << ((total_time > 0.0) ? total_mb/total_time : 0.0)
+		 << " MB/s using " << omp_get_max_threads() << " threads" << endl;
+
+	for (unsigned fmt = 1; fmt < NUM_TEX_COMP; ++fmt) {
+		if (num_tex[fmt] > 0) {cout << fmt_names[fmt] << ": " << num_tex[fmt] << " textures, average PSNR " << psnr_sum[fmt]/num_tex[fmt] << " dB" << endl;}
+	}
+}
+
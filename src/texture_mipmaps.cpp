@@ -0,0 +1,382 @@
+// 3D World - CPU Image Scaling and Mipmap Generation (no GL context required)
+// by 3DWorld contributors
+// 10/18/26
+
+#include "3DWorld.h"
+#include "textures_3dw.h"
+#include <omp.h>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define USE_SSE_SCALE 1
+#include <xmmintrin.h>
+#else
+#define USE_SSE_SCALE 0
+#endif
+
+float const KAISER_ALPHA     = 4.0;
+float const KAISER_RADIUS    = 3.0;   // in destination pixels
+unsigned const LIN2SRGB_SZ   = 16384; // linear => sRGB table size; must be large enough for exact 8-bit round trip
+unsigned const MIN_PAR_PIXELS = 16384; // min number of dest pixels/source rows to use multiple threads
+unsigned const SCALE_BAND_ROWS = 32; // dest rows per band; only the source rows used by a band are held as floats
+unsigned const COV_SEARCH_ITERS = 16;
+
+bool mipmap_gamma_correct(0), mipmap_use_kaiser(0), mipmap_bench(0);
+
+extern vector<texture_t> textures;
+
+
+class srgb_lut_t {
+
+	float to_lin[256];
+	unsigned char to_srgb[LIN2SRGB_SZ];
+
+public:
+	srgb_lut_t() {
+		for (unsigned i = 0; i < 256; ++i) {
+			float const v(i/255.0f);
+			to_lin[i] = ((v <= 0.04045f) ? v/12.92f : pow((v + 0.055f)/1.055f, 2.4f));
+		}
+		for (unsigned i = 0; i < LIN2SRGB_SZ; ++i) {
+			float const v(i/float(LIN2SRGB_SZ-1)), s((v <= 0.0031308f) ? 12.92f*v : (1.055f*pow(v, 1.0f/2.4f) - 0.055f));
+			to_srgb[i] = (unsigned char)(255.0f*s + 0.5f);
+		}
+	}
+	float lin(unsigned char v) const {return to_lin[v];}
+	unsigned char srgb(float v) const {return to_srgb[unsigned(CLIP_TO_01(v)*(LIN2SRGB_SZ-1) + 0.5f)];}
+};
+
+srgb_lut_t const &get_srgb_lut() {
+	static srgb_lut_t lut; // thread safe static init
+	return lut;
+}
+
+
+inline float unpack_val(unsigned char  v, bool srgb, srgb_lut_t const &lut) {return (srgb ? lut.lin(v) : v*(1.0f/255.0f));}
+inline float unpack_val(unsigned short v, bool srgb, srgb_lut_t const &lut) {return v*(1.0f/65535.0f);} // always linear
+inline void pack_val(float v, unsigned char  &d, bool srgb, srgb_lut_t const &lut) {d = (srgb ? lut.srgb(v) : (unsigned char)(255.0f*CLIP_TO_01(v) + 0.5f));}
+inline void pack_val(float v, unsigned short &d, bool srgb, srgb_lut_t const &lut) {d = (unsigned short)(65535.0f*CLIP_TO_01(v) + 0.5f);}
+
+
+float bessel_i0(float x) { // modified Bessel function of the first kind, order 0 (power series)
+
+	float sum(1.0), term(1.0);
+	float const x2(0.25f*x*x);
+
+	for (unsigned k = 1; k < 32; ++k) {
+		term *= x2/float(k*k);
+		sum  += term;
+		if (term < 1.0E-7f*sum) break;
+	}
+	return sum;
+}
+
+float kaiser_sinc(float t) { // t in dest pixels, with |t| < KAISER_RADIUS
+	float const x(t/KAISER_RADIUS), sinc((fabs(t) < 1.0E-6f) ? 1.0f : sin(PI*t)/(PI*t));
+	return sinc*bessel_i0(KAISER_ALPHA*sqrt(max(0.0f, 1.0f - x*x)))/bessel_i0(KAISER_ALPHA);
+}
+
+
+// 1D filter taps for each output pixel: box/Kaiser when downsampling, bilinear when upsampling; edges are clamped
+struct filter_taps_t {
+
+	vector<unsigned> start, ixs; // start has one extra entry at the end
+	vector<float> weights;
+
+	void add_tap(unsigned ix, float w) {ixs.push_back(ix); weights.push_back(w);}
+
+	void calc(unsigned src_sz, unsigned dst_sz, bool use_kaiser) {
+		assert(src_sz > 0 && dst_sz > 0);
+		float const scale(float(src_sz)/float(dst_sz));
+		start.clear(); ixs.clear(); weights.clear();
+
+		for (unsigned x = 0; x < dst_sz; ++x) {
+			unsigned const first(ixs.size());
+			start.push_back(first);
+
+			if (scale <= 1.0f) { // same size or upsample: bilinear
+				float const c(max(0.0f, (x + 0.5f)*scale - 0.5f));
+				unsigned const i0(min(unsigned(c), src_sz-1)), i1(min(i0+1, src_sz-1));
+				float const t(c - i0);
+				add_tap(i0, 1.0f - t);
+				if (t > 0.0f && i1 != i0) {add_tap(i1, t);}
+			}
+			else if (use_kaiser) { // windowed sinc
+				float const center((x + 0.5f)*scale), radius(KAISER_RADIUS*scale);
+
+				for (int i = int(floor(center - radius)); i <= int(ceil(center + radius)); ++i) {
+					float const t(((i + 0.5f) - center)/scale);
+					if (fabs(t) >= KAISER_RADIUS) continue;
+					add_tap(max(0, min(i, int(src_sz)-1)), kaiser_sinc(t));
+				}
+			}
+			else { // box filter, handles non-integer scales (NPOT textures) with fractional edge weights
+				float const x1(x*scale), x2(min((x+1)*scale, float(src_sz)));
+
+				for (unsigned i = unsigned(x1); i < src_sz && float(i) < x2; ++i) {
+					float const w(min(x2, float(i+1)) - max(x1, float(i)));
+					if (w > 0.0f) {add_tap(i, w);}
+				}
+			}
+			float wsum(0.0);
+			for (unsigned t = first; t < weights.size(); ++t) {wsum += weights[t];}
+			assert(wsum > 0.0f);
+			for (unsigned t = first; t < weights.size(); ++t) {weights[t] /= wsum;}
+		} // for x
+		start.push_back(ixs.size());
+	}
+};
+
+
+void filter_row(float const *in, float *out, filter_taps_t const &f, unsigned num, unsigned nc) {
+
+	for (unsigned x = 0; x < num; ++x) {
+		unsigned const s(f.start[x]), e(f.start[x+1]);
+#if USE_SSE_SCALE
+		if (nc == 4) { // one RGBA pixel per SSE register
+			__m128 acc(_mm_setzero_ps());
+			for (unsigned t = s; t < e; ++t) {acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(f.weights[t]), _mm_loadu_ps(in + 4*f.ixs[t])));}
+			_mm_storeu_ps(out + 4*x, acc);
+			continue;
+		}
+#endif
+		for (unsigned c = 0; c < nc; ++c) {
+			float acc(0.0);
+			for (unsigned t = s; t < e; ++t) {acc += f.weights[t]*in[nc*f.ixs[t] + c];}
+			out[nc*x + c] = acc;
+		}
+	}
+}
+
+void add_scaled_row(float const *in, float *out, float w, unsigned num) { // out += w*in
+
+	unsigned i(0);
+#if USE_SSE_SCALE
+	__m128 const wv(_mm_set1_ps(w));
+	for (; i+4 <= num; i += 4) {_mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), _mm_mul_ps(wv, _mm_loadu_ps(in + i))));}
+#endif
+	for (; i < num; ++i) {out[i] += w*in[i];}
+}
+
+
+float calc_alpha_coverage(float const *vals, unsigned npixels, unsigned nc, float alpha_ref, float alpha_scale) {
+
+	unsigned const ref(unsigned(255.0f*alpha_ref));
+	unsigned num(0);
+	// quantize the same way as pack_val() so that the coverage of the 8-bit result matches
+	for (unsigned i = 0; i < npixels; ++i) {num += (unsigned(255.0f*CLIP_TO_01(alpha_scale*vals[nc*i + nc-1]) + 0.5f) > ref);}
+	return float(num)/max(npixels, 1U);
+}
+
+float calc_alpha_coverage(unsigned char const *data, unsigned npixels, unsigned nc, float alpha_ref) {
+
+	assert(nc == 4);
+	unsigned const ref(unsigned(255.0f*alpha_ref));
+	unsigned num(0);
+	for (unsigned i = 0; i < npixels; ++i) {num += (data[nc*i + 3] > ref);}
+	return float(num)/max(npixels, 1U);
+}
+
+// binary search for the alpha scale that gives the same fraction of pixels above alpha_ref as the source level (see Castano's alpha test coverage)
+float calc_alpha_coverage_scale(float const *vals, unsigned npixels, unsigned nc, float alpha_ref, float target_coverage) {
+
+	float lo(0.0), hi(4.0), lo_cov(0.0), hi_cov(1.0);
+
+	for (unsigned n = 0; n < COV_SEARCH_ITERS; ++n) {
+		float const mid(0.5f*(lo + hi)), cov(calc_alpha_coverage(vals, npixels, nc, alpha_ref, mid));
+		if (cov < target_coverage) {lo = mid; lo_cov = cov;} else {hi = mid; hi_cov = cov;}
+	}
+	// coverage is a step function of scale, so pick the closer side rather than the midpoint, which may be on either side of the step
+	return (((target_coverage - lo_cov) < (hi_cov - target_coverage)) ? lo : hi);
+}
+
+
+template<typename T> void scale_image_int(T const *src, unsigned sw, unsigned sh, T *dst, unsigned dw, unsigned dh, unsigned nc,
+	image_scale_params_t const &params, float target_coverage)
+{
+	assert(src != nullptr && dst != nullptr);
+	assert(sw > 0 && sh > 0 && dw > 0 && dh > 0 && nc >= 1 && nc <= 4);
+	srgb_lut_t const &lut(get_srgb_lut());
+	bool const linear_space(params.linear_space && nc >= 3 && sizeof(T) == 1); // alpha is always linear
+	bool const preserve_coverage(params.preserve_coverage && nc == 4 && target_coverage >= 0.0);
+	filter_taps_t xf, yf;
+	xf.calc(sw, dw, params.use_kaiser);
+	yf.calc(sh, dh, params.use_kaiser);
+	unsigned const src_row_sz(nc*sw), dst_row_sz(nc*dw), num_bands((dh + SCALE_BAND_ROWS - 1)/SCALE_BAND_ROWS);
+	vector<float> alpha_vals(preserve_coverage ? dw*dh : 0); // unscaled alpha, since the coverage scale depends on the entire image
+	struct band_bufs_t {vector<float> row, hbuf, obuf;};
+	vector<band_bufs_t> bufs(omp_get_max_threads());
+
+	// process bands of dest rows so that the float intermediates are a few rows rather than the full image
+#pragma omp parallel for schedule(dynamic,1) if (sh*dw >= MIN_PAR_PIXELS && num_bands > 1)
+	for (int b = 0; b < (int)num_bands; ++b) {
+		band_bufs_t &bb(bufs[omp_get_thread_num()]);
+		unsigned const y0(b*SCALE_BAND_ROWS), y1(min(dh, y0+SCALE_BAND_ROWS));
+		unsigned ymin(sh), ymax(0); // range of source rows used by this band
+		for (unsigned t = yf.start[y0]; t < yf.start[y1]; ++t) {ymin = min(ymin, yf.ixs[t]); ymax = max(ymax, yf.ixs[t]);}
+		bb.row.resize(src_row_sz);
+		bb.hbuf.resize((ymax - ymin + 1)*dst_row_sz);
+		bb.obuf.resize(dst_row_sz);
+
+		// horizontal pass: source rows => hbuf
+		for (unsigned y = ymin; y <= ymax; ++y) {
+			T const *s(src + y*src_row_sz);
+
+			for (unsigned i = 0; i < src_row_sz; ++i) {
+				bb.row[i] = unpack_val(s[i], (linear_space && (i % nc) < 3), lut);
+			}
+			filter_row(&bb.row.front(), &bb.hbuf[(y - ymin)*dst_row_sz], xf, dw, nc);
+		}
+		// vertical pass: hbuf => obuf, then convert back to integer values
+		for (unsigned y = y0; y < y1; ++y) {
+			float *out(&bb.obuf.front());
+			T *d(dst + y*dst_row_sz);
+			std::fill(bb.obuf.begin(), bb.obuf.end(), 0.0f);
+			for (unsigned t = yf.start[y]; t < yf.start[y+1]; ++t) {add_scaled_row(&bb.hbuf[(yf.ixs[t] - ymin)*dst_row_sz], out, yf.weights[t], dst_row_sz);}
+
+			for (unsigned i = 0; i < dst_row_sz; ++i) {
+				unsigned const c(i % nc);
+				if (preserve_coverage && c == 3) {alpha_vals[y*dw + i/nc] = out[i]; continue;} // packed below, once the alpha scale is known
+				pack_val(out[i], d[i], (linear_space && c < 3), lut);
+			}
+		}
+	} // for b
+	if (preserve_coverage) {
+		float const alpha_scale(calc_alpha_coverage_scale(&alpha_vals.front(), dw*dh, 1, params.alpha_ref, target_coverage));
+		for (unsigned i = 0; i < dw*dh; ++i) {pack_val(alpha_scale*alpha_vals[i], dst[nc*i + 3], 0, lut);}
+	}
+}
+
+void scale_image(unsigned char const *src, unsigned sw, unsigned sh, unsigned char *dst, unsigned dw, unsigned dh, unsigned nc,
+	image_scale_params_t const &params, float target_coverage)
+{
+	if (params.preserve_coverage && nc == 4 && target_coverage < 0.0) {target_coverage = calc_alpha_coverage(src, sw*sh, nc, params.alpha_ref);} // match src coverage
+	scale_image_int(src, sw, sh, dst, dw, dh, nc, params, target_coverage);
+}
+
+void scale_image(unsigned short const *src, unsigned sw, unsigned sh, unsigned short *dst, unsigned dw, unsigned dh, unsigned nc,
+	image_scale_params_t const &params)
+{
+	scale_image_int(src, sw, sh, dst, dw, dh, nc, params, -1.0f);
+}
+
+
+// computes byte offsets of mipmap levels 1..N (level 0 is the source image); supports NPOT and non-square sizes; returns the total size in bytes
+unsigned calc_mipmap_offsets(unsigned w, unsigned h, unsigned bytes_per_pixel, vector<unsigned> &offsets) {
+
+	unsigned data_size(0);
+	offsets.clear();
+
+	while (w > 1 || h > 1) {
+		w = max(w>>1, 1U);
+		h = max(h>>1, 1U);
+		offsets.push_back(data_size);
+		data_size += bytes_per_pixel*w*h;
+	}
+	return data_size;
+}
+
+void gen_mipmaps(unsigned char const *src, unsigned w, unsigned h, unsigned nc, bool is_16_bit, image_scale_params_t const &params,
+	unsigned char *mm_data, vector<unsigned> const &offsets)
+{
+	assert(src != nullptr && mm_data != nullptr);
+	// all levels match the alpha test coverage of the base level rather than the previous level to avoid accumulated error
+	float const target_coverage((params.preserve_coverage && nc == 4 && !is_16_bit) ? calc_alpha_coverage(src, w*h, nc, params.alpha_ref) : -1.0f);
+	unsigned char const *prev(src);
+
+	for (unsigned level = 0; level < offsets.size(); ++level) {
+		unsigned const w2(max(w>>1, 1U)), h2(max(h>>1, 1U));
+		unsigned char *cur(mm_data + offsets[level]);
+
+		if (is_16_bit) {scale_image((unsigned short const *)prev, w, h, (unsigned short *)cur, w2, h2, nc, params);}
+		else {scale_image(prev, w, h, cur, w2, h2, nc, params, target_coverage);}
+		prev = cur;
+		w = w2;
+		h = h2;
+	}
+}
+
+
+// GL-free self test and throughput benchmark; enabled with the "mipmap_bench" config option
+bool test_image_scale() {
+
+	bool passed(1);
+	rand_gen_t rgen;
+	unsigned const sizes[4][2] = {{64,64}, {37,23}, {1,9}, {256,128}};
+	vector<unsigned> offsets;
+	vector<unsigned char> src, mm;
+
+	for (unsigned s = 0; s < 4; ++s) { // constant images must stay constant at all levels for all filters, sizes, and color spaces
+		unsigned const w(sizes[s][0]), h(sizes[s][1]);
+
+		for (unsigned nc = 1; nc <= 4; ++nc) {
+			if (nc == 2) continue;
+			src.resize(nc*w*h);
+			for (unsigned c = 0; c < nc; ++c) {unsigned char const val(rgen.rand() & 255); for (unsigned i = c; i < src.size(); i += nc) {src[i] = val;}}
+			mm.resize(calc_mipmap_offsets(w, h, nc, offsets));
+
+			for (unsigned mode = 0; mode < 4; ++mode) {
+				image_scale_params_t const params((mode & 1) != 0, (mode & 2) != 0, 0);
+				gen_mipmaps(&src.front(), w, h, nc, 0, params, &mm.front(), offsets);
+				unsigned max_err(0);
+				for (unsigned i = 0; i < mm.size(); ++i) {max_err = max(max_err, (unsigned)abs(int(mm[i]) - int(src[i % nc])));}
+				if (max_err > (params.use_kaiser ? 1U : 0U)) {cout << "Mipmap test: constant " << w << "x" << h << "x" << nc << " mode " << mode << " error " << max_err << endl; passed = 0;}
+			}
+		}
+	}
+	{ // exact 2x2 box filter of a gray ramp
+		unsigned char const ramp[16] = {0,4,8,12, 16,20,24,28, 32,36,40,44, 48,52,56,60}, expected[4] = {10,18,42,50};
+		unsigned char result[4] = {0};
+		scale_image(ramp, 4, 4, result, 2, 2, 1, image_scale_params_t());
+		if (!std::equal(result, result+4, expected)) {cout << "Mipmap test: box filter error" << endl; passed = 0;}
+	}
+	{ // 16-bit grayscale upsample + downsample round trip
+		unsigned short const val(12345);
+		vector<unsigned short> s16(7*5, val), d16(16*16), r16(7*5);
+		scale_image(&s16.front(), 7, 5, &d16.front(), 16, 16, 1, image_scale_params_t());
+		scale_image(&d16.front(), 16, 16, &r16.front(), 7, 5, 1, image_scale_params_t());
+		for (unsigned i = 0; i < r16.size(); ++i) {if (r16[i] != val) {cout << "Mipmap test: 16-bit resize error" << endl; passed = 0; break;}}
+	}
+	{ // alpha coverage preservation for a sparse binary alpha pattern (foliage)
+		unsigned const sz(256);
+		src.resize(4*sz*sz);
+
+		for (unsigned i = 0; i < sz*sz; ++i) {
+			UNROLL_3X(src[4*i+i_] = 128;)
+			src[4*i+3] = ((rgen.rand() % 100) < 30) ? 255 : 0;
+		}
+		mm.resize(calc_mipmap_offsets(sz, sz, 4, offsets));
+		image_scale_params_t const params(1, 0, 1);
+		gen_mipmaps(&src.front(), sz, sz, 4, 0, params, &mm.front(), offsets);
+		float const cov0(calc_alpha_coverage(&src.front(), sz*sz, 4, params.alpha_ref));
+
+		for (unsigned level = 0, lsz = sz/2; lsz >= 8; ++level, lsz /= 2) {
+			float const cov(calc_alpha_coverage(&mm[offsets[level]], lsz*lsz, 4, params.alpha_ref));
+			if (fabs(cov - cov0) > 0.05) {cout << "Mipmap test: coverage " << cov << " at level " << (level+1) << " vs. " << cov0 << endl; passed = 0;}
+		}
+	}
+	cout << "Mipmap tests " << (passed ? "passed" : "FAILED") << endl;
+	return passed;
+}
+
+void run_mipmap_benchmark() {
+
+	test_image_scale();
+	vector<unsigned> offsets;
+	vector<unsigned char> mm;
+	double total_time(0.0), mp_src(0.0);
+	unsigned num_tex(0);
+
+	for (auto t = textures.begin(); t != textures.end(); ++t) {
+		if (!t->is_allocated() || t->defer_load() || t->width < 2 || t->height < 2) continue;
+		image_scale_params_t const params(get_tex_scale_params(*t)); // same parameters as texture_t::build_mipmaps()
+		mm.resize(calc_mipmap_offsets(t->width, t->height, t->ncolors*t->bytes_per_channel(), offsets));
+		double const start_time(omp_get_wtime());
+		gen_mipmaps(t->get_data(), t->width, t->height, t->ncolors, t->is_16_bit_gray, params, &mm.front(), offsets);
+		total_time += omp_get_wtime() - start_time;
+		mp_src     += 1.0E-6*t->num_pixels();
+		++num_tex;
+	}
+	cout << "Mipmap benchmark: " << num_tex << " textures, " << mp_src << " MP in " << 1000.0*total_time << " ms = "
+		 << ((total_time > 0.0) ? mp_src/total_time : 0.0) << " MP/s using " << omp_get_max_threads() << " threads" << endl;
+}
+
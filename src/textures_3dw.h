@@ -34,4 +34,38 @@ inline void unpack_color(unsigned char dst[3], colorRGBA const &src) {
 }
 
 
+struct image_scale_params_t {
+
+	bool linear_space, use_kaiser, preserve_coverage; // filter sRGB colors in linear space; Kaiser vs. box filter; preserve alpha test coverage
+	float alpha_ref;
+
+	image_scale_params_t(bool ls=0, bool uk=0, bool pc=0, float ar=0.5) : linear_space(ls), use_kaiser(uk), preserve_coverage(pc), alpha_ref(ar) {}
+};
+
+// Textures.cpp
+image_scale_params_t get_tex_scale_params(texture_t const &t);
+
+// texture_mipmaps.cpp
+void scale_image(unsigned char const *src, unsigned sw, unsigned sh, unsigned char *dst, unsigned dw, unsigned dh, unsigned nc,
+	image_scale_params_t const &params, float target_coverage=-1.0);
+void scale_image(unsigned short const *src, unsigned sw, unsigned sh, unsigned short *dst, unsigned dw, unsigned dh, unsigned nc, image_scale_params_t const &params);
+float calc_alpha_coverage(unsigned char const *data, unsigned npixels, unsigned nc, float alpha_ref);
+unsigned calc_mipmap_offsets(unsigned w, unsigned h, unsigned bytes_per_pixel, vector<unsigned> &offsets);
+void gen_mipmaps(unsigned char const *src, unsigned w, unsigned h, unsigned nc, bool is_16_bit, image_scale_params_t const &params,
+	unsigned char *mm_data, vector<unsigned> const &offsets);
+void run_mipmap_benchmark();
+
+enum {TEX_COMP_NONE=0, TEX_COMP_BC1, TEX_COMP_BC3, TEX_COMP_BC5, NUM_TEX_COMP};
+
+// texture_compress.cpp
+unsigned get_bc_block_bytes(unsigned fmt);
+unsigned get_bc_level_size(unsigned w, unsigned h, unsigned fmt);
+void compress_image_bc(unsigned char const *src, unsigned w, unsigned h, unsigned nc, unsigned fmt, unsigned char *dst);
+void decompress_image_bc(unsigned char const *src, unsigned w, unsigned h, unsigned fmt, unsigned char *dst_rgba);
+void run_texture_compress_benchmark();
+
+// image_io.cpp
+void run_texture_load_benchmark();
+
+
 #endif
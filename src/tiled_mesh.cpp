@@ -501,7 +501,7 @@ void tile_t::calc_mesh_ao_lighting() {
 	// create context zvals, which may overlap with other tiles (that need not be created at this point)
 	unsigned const context_sz(stride + 2*AO_RAY_LEN);
 	bool const using_hmap(using_tiled_terrain_hmap_tex()), add_detail(using_hmap_with_detail()), use_ao_zvals(!ao_zvals.empty());
-	vector<float> czv;
+	float_vect_t czv;
 	mesh_xy_grid_cache_t height_gen;
 	
 	if (use_ao_zvals) {czv.swap(ao_zvals);} // use precomputed values, will clear ao_zvals at the end
@@ -579,7 +579,7 @@ void tile_t::calc_shadows_for_light(unsigned l) {
 		sh_out[l][!d].resize(zvsize, MESH_MIN_Z); // init value really should not be used, but it sometimes is
 		tile_t *adj_tile(get_tile_from_xy(adj_tp[d]));
 		if (adj_tile == NULL || adj_tile->is_distant) continue; // no adjacent tile
-		vector<float> const &adj_sh_out(adj_tile->sh_out[l][!d]);
+		float_vect_t const &adj_sh_out(adj_tile->sh_out[l][!d]);
 				
 		if (adj_sh_out.empty()) { // adjacent tile not initialized
 			adj_tile->calc_shadows((l == LIGHT_SUN), (l == LIGHT_MOON), 1); // recursive call on adjacent tile
@@ -606,7 +606,7 @@ void tile_t::proc_tile_queue(tile_t *init_tile, unsigned l) {
 		tile_queue.pop_back();
 		assert(t->in_queue);
 		t->in_queue = 0;
-		vector<float> const prev_sh_out[2] = {t->sh_out[l][0], t->sh_out[l][1]};
+		float_vect_t const prev_sh_out[2] = {t->sh_out[l][0], t->sh_out[l][1]};
 		t->calc_shadows_for_light(l);
 		tile_xy_pair const tp(t->x1/int(t->size), t->y1/int(t->size));
 		tile_xy_pair const adj_tp2[2] = {tile_xy_pair((tp.x + ((lpos.x < 0.0) ? 1 : -1)), tp.y),
@@ -784,7 +784,7 @@ void tile_t::upload_shadow_map_texture(bool tid_is_valid) {
 	//timer_t timer("Create Shadow Map Texture");
 	bool const has_sun(light_factor >= 0.4), has_moon(light_factor <= 0.6), mesh_shadows(mesh_shadows_enabled());
 	vector<unsigned char> shadow_data(4*stride*stride, 0);
-	vector<unsigned char> const &cur_smask(smask[has_sun ? LIGHT_SUN : LIGHT_MOON]);
+	uchar_vect_t const &cur_smask(smask[has_sun ? LIGHT_SUN : LIGHT_MOON]);
 
 	for (unsigned y = 0; y < stride; ++y) { // Note: shadow texture is stored as {mesh_shadow, tree_shadow, ambient_occlusion}
 		for (unsigned x = 0; x < stride; ++x) {
@@ -170,11 +170,13 @@ private:
 	colorRGB avg_mesh_tex_color;
 	tile_offset_t mesh_off, ptree_off, dtree_off, scenery_off;
 	float sub_zmin[4][4], sub_zmax[4][4];
-	vector<float> zvals, ao_zvals;
-	vector<tree_map_val> tree_map;
-	vector<unsigned char> mesh_weight_data, weight_data, ao_lighting;
-	vector<unsigned char> smask[NUM_LIGHT_SRC];
-	vector<float> sh_out[NUM_LIGHT_SRC][2];
+	typedef tracked_vector<float, MEM_CAT_TILES> float_vect_t;
+	typedef tracked_vector<unsigned char, MEM_CAT_TILES> uchar_vect_t;
+	float_vect_t zvals, ao_zvals;
+	tracked_vector<tree_map_val, MEM_CAT_TILES> tree_map;
+	uchar_vect_t mesh_weight_data, weight_data, ao_lighting;
+	uchar_vect_t smask[NUM_LIGHT_SRC];
+	float_vect_t sh_out[NUM_LIGHT_SRC][2];
 	vect_smap_t<tile_smap_data_t> smap_data;
 	small_tree_group pine_trees;
 	scenery_group scenery;
@@ -133,9 +133,10 @@ struct tree_xform_t {
 
 class tree_builder_t : public tree_xform_t {
 
-	static vector<tree_cylin >   cylin_cache;
-	static vector<tree_branch>   branch_cache;
-	static vector<tree_branch *> branch_ptr_cache;
+	// per-builder scratch storage, so that multiple trees can be generated in parallel
+	vector<tree_cylin >   cylin_cache;
+	vector<tree_branch>   branch_cache;
+	vector<tree_branch *> branch_ptr_cache;
 
 	tree_branch base, roots, *branches_34[2], **branches;
 	int base_num_cylins, root_num_cylins, ncib, num_1_branches, num_big_branches_min, num_big_branches_max;
@@ -217,6 +218,8 @@ public:
 	void make_private_copy(tree_data_t &dest) const;
 	void gen_tree_data(int tree_type_, int size, float tree_depth, float height_scale, float br_scale_mult, float nl_scale,
 		float bbo_scale, bool has_4th_branches_, cube_t const *clip_cube, bool create_bush, rand_gen_t &rgen);
+	int gen_tree_data_of_type(int type, int size, float tree_depth, float height_scale, float br_scale_mult, float nl_scale,
+		bool has_4th_branches_, cube_t const *clip_cube, bool allow_bushes, rand_gen_t &rgen);
 	void mark_leaf_changed(unsigned ix);
 	void gen_leaf_color();
 	void update_all_leaf_colors();
@@ -377,6 +380,7 @@ class tree_data_manager_t : public vector<tree_data_t> {
 public:
 	tree_data_manager_t() : last_tree_scale(1.0), last_rgi(0) {}
 	void ensure_init();
+	void gen_all_tree_data(int size, float height_scale, float br_scale_mult, float nl_scale, bool has_4th_branches, bool allow_bushes);
 	void clear_context();
 	void on_leaf_color_change();
 	unsigned get_gpu_mem() const;
@@ -459,6 +463,7 @@ void regen_trees(bool keep_old);
 void shift_trees(vector3d const &vd);
 void add_tree_cobjs();
 void clear_tree_context();
+void run_tree_gen_benchmark();
 
 // function prototypes - small trees
 int add_small_tree(point const &pos, float height, float width, int tree_type, bool calc_z);
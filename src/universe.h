@@ -9,6 +9,7 @@
 #include "upsurface.h"
 #include "draw_utils.h"
 #include "gl_ext_arb.h"
+#include "allocators.h"
 #include <map>
 #include <sstream>
 
@@ -25,6 +26,8 @@ class uasteroid_belt;
 class uasteroid_belt_system;
 class uasteroid_belt_planet;
 
+template<typename T> using uobj_vect_t = tracked_vector<T, MEM_CAT_UNIVERSE>; // object hierarchy containers, registered with the memory tracker
+
 
 // stellar object types - must be ordered largest to smallest
 enum {UTYPE_NONE=0, UTYPE_CELL, UTYPE_GALAXY, UTYPE_SYSTEM, UTYPE_STAR, UTYPE_PLANET, UTYPE_MOON, UTYPE_SURFACE, UTYPE_ASTEROID, NUM_UTYPES};
@@ -222,7 +225,7 @@ public:
 		water(0.0), lava(0.0), resources(0.0), cloud_density(1.0), cloud_scale(1.0), wr_scale(1.0), snow_thresh(0.0), population(0.0), prev_pop(0.0), orbit_scale(all_ones) {}
 	virtual ~urev_body() {unset_owner();}
 	void gen_rotrev();
-	template<typename T> bool create_orbit(vector<T> const &objs, int i, point const &pos0, vector3d const &raxis,
+	template<typename T> bool create_orbit(uobj_vect_t<T> const &objs, int i, point const &pos0, vector3d const &raxis,
 		float radius0, float max_size, float min_size, float rspacing, float ispacing, float minspacing, float min_gap, vector3d const &oscale);
 	void gen_surface();
 	void check_gen_texture(unsigned size);
@@ -281,8 +284,8 @@ public:
 	float mosize, ring_ri, ring_ro;
 	colorRGBA ai_color, ao_color; // atmosphere colors
 	vector3d rscale;
-	vector<umoon> moons;
-	vector<color_wrapper> ring_data;
+	uobj_vect_t<umoon> moons;
+	uobj_vect_t<color_wrapper> ring_data;
 	ussystem *system;
 	std::shared_ptr<uasteroid_belt_planet> asteroid_belt;
 	unsigned ring_tid;
@@ -378,7 +381,7 @@ class ussystem : public uobj_rgen { // size = 312
 public:
 	unsigned cluster_id;
 	ustar sun;
-	vector<uplanet> planets;
+	uobj_vect_t<uplanet> planets;
 	std::shared_ptr<uasteroid_belt_system> asteroid_belt;
 	ugalaxy *galaxy;
 	colorRGBA galaxy_color;
@@ -425,15 +428,15 @@ public:
 		float radius, bounds;
 		point center;
 		colorRGBA color;
-		vector<point> systems;
+		uobj_vect_t<point> systems;
 		unsigned s1, s2;
 
 		system_cluster(float radius_, point const &center_) : radius(radius_), bounds(0.0), center(center_), color(BLACK), s1(0), s2(0) {}
 	};
 
-	vector<ussystem> sols;
+	uobj_vect_t<ussystem> sols;
 	deque<system_cluster> clusters;
-	vector<uasteroid_field> asteroid_fields;
+	uobj_vect_t<uasteroid_field> asteroid_fields;
 	unebula nebula;
 	colorRGBA color;
 
@@ -466,7 +469,7 @@ class ucell : public uobj_rgen { // size = 216
 
 public:
 	point rel_center;
-	std::shared_ptr<vector<ugalaxy> > galaxies; // must be a pointer to a vector to avoid deep copies
+	std::shared_ptr<uobj_vect_t<ugalaxy> > galaxies; // must be a pointer to a vector to avoid deep copies
 
 	ucell() : last_bkg_color(BLACK), last_player_pos(all_zeros), last_star_cache_ix(0), cached_stars_valid(0) {}
 	void gen_cell(int const ii[3]);
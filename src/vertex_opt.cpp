@@ -7,13 +7,19 @@
 
 unsigned const VBUF_SZ = 32;
 
+struct vbuf_entry_t {
+	unsigned ix, pos;
+	vbuf_entry_t() : ix((unsigned)-1), pos(0) {}
+};
 
-float vert_optimizer::calc_acmr() const {
+float calc_acmr(unsigned const *const indices, unsigned num) {
 
 	vbuf_entry_t vbuf[VBUF_SZ];
 	unsigned num_cm(0); // cache misses
 
-	for (unsigned i = 0; i < indices.size(); ++i) {
+	if (num == 0) return 0.0;
+
+	for (unsigned i = 0; i < num; ++i) {
 		bool found(0);
 		unsigned best_entry(0), oldest_pos((unsigned)-1);
 
@@ -26,7 +32,7 @@ float vert_optimizer::calc_acmr() const {
 		vbuf[best_entry].pos = i;
 		++num_cm;
 	}
-	return float(num_cm)/float(indices.size());
+	return float(num_cm)/float(num);
 }
 
 
@@ -65,3 +71,16 @@ void vert_optimizer::run(bool full_opt, bool verbose) {
 }
 
 
+// optimizes a subset of a larger index buffer by first remapping its vertices to a compact range,
+// so that the optimizer's per-vertex data is proportional to the block size; thread safe
+void optimize_index_block(vector<unsigned> &indices, unsigned npts_per_prim, bool full_opt) {
+
+	if (indices.empty()) return;
+	vector<unsigned> verts(indices);
+	sort(verts.begin(), verts.end());
+	verts.erase(unique(verts.begin(), verts.end()), verts.end());
+	for (auto i = indices.begin(); i != indices.end(); ++i) {*i = unsigned(lower_bound(verts.begin(), verts.end(), *i) - verts.begin());} // global => local
+	vert_optimizer optimizer(indices, verts.size(), npts_per_prim);
+	optimizer.run(full_opt, 0); // not verbose, since this may be called from multiple threads
+	for (auto i = indices.begin(); i != indices.end(); ++i) {*i = verts[*i];} // local => global
+}
@@ -8,16 +8,14 @@
 #include "3DWorld.h"
 
 
+float calc_acmr(unsigned const *const indices, unsigned num); // average cache miss ratio per index
+inline float calc_acmr(vector<unsigned> const &indices) {return calc_acmr((indices.empty() ? nullptr : &indices.front()), indices.size());}
+
 class vert_optimizer {
 
 	vector<unsigned> &indices;
 	unsigned num_verts, npts_per_prim;
 
-	struct vbuf_entry_t {
-		unsigned ix, pos;
-		vbuf_entry_t() : ix((unsigned)-1), pos(0) {}
-	};
-
 	template<unsigned N> struct vert_block_t {
 		unsigned v[N];
 
@@ -31,12 +29,13 @@ class vert_optimizer {
 		}
 	};
 
-	float calc_acmr() const;
-
 public:
 	vert_optimizer(vector<unsigned> &indices_, unsigned num_verts_, unsigned npts_per_prim_) :
 	  indices(indices_), num_verts(num_verts_), npts_per_prim(npts_per_prim_) {}
+	float calc_acmr() const {return ::calc_acmr(indices);}
 	void run(bool full_opt, bool verbose);
 };
 
+void optimize_index_block(vector<unsigned> &indices, unsigned npts_per_prim, bool full_opt);
+
 #endif // _VERT_OPT_H_
@@ -269,6 +269,7 @@ public:
 bool cube_cobj_occluded(point const &viewer, cube_t const &cube) {
 
 	if (!have_occluders() || cube.contains_pt(viewer)) return 0; // no occluders, or viewer is inside the cube
+	if (sw_occlusion_valid_for(viewer)) {return sw_cube_occluded(cube);}
 	//return cube_occlusion_query(viewer, cube).get_is_occluded(); // Note: slower, and makes very little difference
 	point pts[8];
 	unsigned const ncorners(get_cube_corners(cube.d, pts, viewer, 0)); // 8 corners allocated, but only 6 used
@@ -12,6 +12,14 @@
 #include "openal_wrap.h"
 #include "cobj_bsp_tree.h"
 #include <glm/gtc/noise.hpp>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define USE_SSE_MC 1
+#include <emmintrin.h>
+#else
+#define USE_SSE_MC 0
+#endif
 
 
 bool const DEBUG_BLOCKS    = 0;
@@ -27,7 +35,7 @@ unsigned char const UNDER_MESH_BIT = 0x08;
 voxel_params_t global_voxel_params;
 voxel_model_ground terrain_voxel_model(GROUND_NUM_LOD);
 voxel_brush_params_t voxel_brush_params;
-bool voxel_ppb_enable_falling(0);
+bool voxel_ppb_enable_falling(0), voxel_mc_bench(0);
 
 extern bool group_back_face_cull, voxel_shadows_updated;
 extern int dynamic_mesh_scroll, rand_gen_index, scrolling, display_mode, display_framerate, voxel_editing, mesh_gen_mode, mesh_freq_filter;
@@ -153,7 +161,7 @@ template<> void voxel_grid<float>::downsample_2x() { // modify in place, perserv
 	assert(nx > 1 && ny > 1 && nz > 1);
 	assert(!(nx&1) && !(ny&1) && !(nz&1));
 	unsigned const dsnx(nx/2), dsny(ny/2), dsnz(nz/2);
-	vector<value_type> dsv(dsnx*dsny*dsnz, 0);
+	vect_t dsv(dsnx*dsny*dsnz, 0);
 
 	for (unsigned y = 0; y < ny; ++y) {
 		for (unsigned x = 0; x < nx; ++x) {
@@ -301,7 +309,9 @@ void voxel_manager::create_procedural(float mag, float freq, vector3d const &off
 		cshader.add_uniform_float("start_freq", 0.25*freq);
 		cshader.add_uniform_float("rx", rx);
 		cshader.add_uniform_float("ry", ry);
-		cshader.gen_matrix_R32F(*this, tid); // write directly to voxel values
+		vector<float> vals;
+		cshader.gen_matrix_R32F(vals, tid);
+		assign(vals.begin(), vals.end()); // write to voxel values
 		if (normalize_to_1) {for (iterator i = begin(); i != end(); ++i) {*i = CLIP_TO_pm1(*i);}}
 		cshader.end_shader();
 		free_texture(tid);
@@ -492,12 +502,15 @@ point voxel_manager::interpolate_pt(float isolevel, point const &pt1, point cons
 }
 
 
-unsigned voxel_manager::add_triangles_for_voxel(tri_data_t::value_type &tri_verts, voxel_ix_cache &vix_cache,
-	unsigned x, unsigned y, unsigned z, unsigned block_x0, unsigned block_y0, bool count_only, unsigned lod_level) const
-{
+bool voxel_manager::check_under_mesh() const {return (params.remove_under_mesh && (display_mode & 0x01));} // if mesh draw is enabled
+
+
+// reference (scalar) case index for a single cell; returns 0 for cells with no triangles
+unsigned voxel_manager::get_voxel_case(unsigned x, unsigned y, unsigned z, unsigned lod_level) const {
+
 	unsigned cix(0);
 	unsigned const step(1 << lod_level);
-	bool all_under_mesh(params.remove_under_mesh && (display_mode & 0x01)); // if mesh draw is enabled
+	bool all_under_mesh(check_under_mesh());
 	unsigned const x2(min(x+step, nx-1)), y2(min(y+step, ny-1)), z2(min(z+step, nz-1));
 	unsigned const xv[2] = {x, x2}, yv[2] = {y, y2}, zv[2] = {z, z2};
 	if (x2 <= x || y2 <= y || z2 <= z) {return 0;} // invalid (empty) range
@@ -514,8 +527,68 @@ unsigned voxel_manager::add_triangles_for_voxel(tri_data_t::value_type &tri_vert
 	}
 	assert(cix < 256);
 	if (all_under_mesh) return 0;
+	return ((voxel_detail::edge_table[cix] == 0) ? 0 : cix); // all inside or all outside => no polygons
+}
+
+
+// computes the case index of every cell in the z column at (x,y), storing 0 for empty/full/under mesh cells; returns the number of cells
+unsigned voxel_manager::calc_column_cases(unsigned x, unsigned y, unsigned lod_level, vector<unsigned char> &cases) const {
+
+	unsigned const step(1 << lod_level), ncells((nz + step - 1) >> lod_level);
+	unsigned const x2(min(x+step, nx-1)), y2(min(y+step, ny-1));
+	cases.resize(ncells + 8); // padded so that the caller can skip runs 8 cells at a time
+	fill(cases.begin(), cases.end(), 0);
+	if (x2 <= x || y2 <= y) {return ncells;} // invalid (empty) range
+	if (step > 1) { // strided z, use the scalar version
+		for (unsigned i = 0; i < ncells; ++i) {cases[i] = (unsigned char)get_voxel_case(x, y, (i << lod_level), lod_level);}
+		return ncells;
+	}
+	bool const check_um(check_under_mesh());
+	unsigned char const *const col[4] = {&outside[get_ix(x, y, 0)], &outside[get_ix(x2, y, 0)], &outside[get_ix(x2, y2, 0)], &outside[get_ix(x, y2, 0)]}; // corner bits 0-3
+	unsigned const nvalid(nz - 1); // the last z has no cell above it
+	unsigned z(0);
+#if USE_SSE_MC
+	__m128i const zero(_mm_setzero_si128()), ones(_mm_set1_epi8(-1)), lo_bits(_mm_set1_epi8(7)), um_bit(_mm_set1_epi8(UNDER_MESH_BIT));
+
+	for (; z + 16 <= nvalid; z += 16) { // 16 cells at a time; reads z+1 .. z+16 for the upper corners
+		__m128i cv(zero), under(ones);
+
+		for (unsigned c = 0; c < 4; ++c) {
+			__m128i const lo(_mm_loadu_si128((__m128i const *)(col[c] + z))), hi(_mm_loadu_si128((__m128i const *)(col[c] + z + 1)));
+			cv    = _mm_or_si128(cv, _mm_andnot_si128(_mm_cmpeq_epi8(_mm_and_si128(lo, lo_bits), zero), _mm_set1_epi8(char(1 << c))));
+			cv    = _mm_or_si128(cv, _mm_andnot_si128(_mm_cmpeq_epi8(_mm_and_si128(hi, lo_bits), zero), _mm_set1_epi8(char(1 << (c+4)))));
+			under = _mm_and_si128(under, lo);
+		}
+		__m128i skip(_mm_cmpeq_epi8(cv, ones)); // all outside
+		if (check_um) {skip = _mm_or_si128(skip, _mm_cmpeq_epi8(_mm_and_si128(under, um_bit), um_bit));} // all four lower corners under the mesh
+		_mm_storeu_si128((__m128i *)&cases[z], _mm_andnot_si128(skip, cv));
+	}
+#endif
+	for (; z < nvalid; ++z) {
+		unsigned cix(0);
+		bool all_under_mesh(check_um);
+
+		for (unsigned c = 0; c < 4; ++c) {
+			if (col[c][z]   & 7) {cix |= 1 << c;}
+			if (col[c][z+1] & 7) {cix |= 1 << (c+4);}
+			if (all_under_mesh) {all_under_mesh = ((col[c][z] & UNDER_MESH_BIT) != 0);}
+		}
+		cases[z] = (unsigned char)((all_under_mesh || voxel_detail::edge_table[cix] == 0) ? 0 : cix);
+	}
+	return ncells;
+}
+
+
+// yslice is the vix_cache y index for the {y, y+step} corners
+unsigned voxel_manager::add_triangles_for_voxel(tri_data_t::value_type &tri_verts, voxel_ix_cache &vix_cache, unsigned x, unsigned y, unsigned z, unsigned cix,
+	unsigned block_x0, unsigned const yslice[2], bool count_only, unsigned lod_level) const
+{
+	assert(cix < 256);
 	unsigned const edge_val(voxel_detail::edge_table[cix]);
 	if (edge_val == 0)  return 0; // no polygons
+	unsigned const step(1 << lod_level);
+	unsigned const x2(min(x+step, nx-1)), y2(min(y+step, ny-1)), z2(min(z+step, nz-1));
+	unsigned const xv[2] = {x, x2}, yv[2] = {y, y2}, zv[2] = {z, z2};
 	int const *const tris(voxel_detail::tri_table[cix]);
 	unsigned count(0);
 	for (unsigned i = 0; tris[i] >= 0; i += 3) {++count;}
@@ -540,7 +613,7 @@ unsigned voxel_manager::add_triangles_for_voxel(tri_data_t::value_type &tri_vert
 			pts[d].assign(cube.d[0][xhi], cube.d[1][yhi], cube.d[2][zhi]);
 		}
 		vlist[i] = interpolate_pt(params.isolevel, pts[0], pts[1], vals[0], vals[1]);
-		vixs [i] = &(vix_cache.get_ref(xv[xhv]-block_x0, yv[yhv]-block_y0, zv[zhv]).ix[edge_to_dim_map[i]]);
+		vixs [i] = &(vix_cache.get_ref(xv[xhv]-block_x0, yslice[yhv], zv[zhv]).ix[edge_to_dim_map[i]]);
 	}
 	for (unsigned i = 0; tris[i] >= 0; i += 3) {
 		triangle const tri(vlist[tris[i]], vlist[tris[i+1]], vlist[tris[i+2]]);
@@ -564,6 +637,25 @@ unsigned voxel_manager::add_triangles_for_voxel(tri_data_t::value_type &tri_vert
 }
 
 
+unsigned voxel_manager::add_triangles_for_column(tri_data_t::value_type &tri_verts, voxel_ix_cache &vix_cache, unsigned x, unsigned y,
+	unsigned block_x0, unsigned const yslice[2], bool count_only, unsigned lod_level, vector<unsigned char> &cases) const
+{
+	unsigned const ncells(calc_column_cases(x, y, lod_level, cases));
+	unsigned count(0);
+
+	for (unsigned i = 0; i < ncells; ++i) {
+		if ((i & 7) == 0) { // skip empty/full runs 8 cells at a time
+			uint64_t run;
+			memcpy(&run, &cases[i], sizeof(run));
+			if (run == 0) {i += 7; continue;}
+		}
+		if (cases[i] == 0) continue;
+		count += add_triangles_for_voxel(tri_verts, vix_cache, x, y, (i << lod_level), cases[i], block_x0, yslice, count_only, lod_level);
+	}
+	return count;
+}
+
+
  // Note: val == isolevel is treated as outside to avoid numerical issues
 bool val_is_outside(float val, voxel_params_t const &params) {
 	return ((val == params.isolevel) ? 1 : (((val < params.isolevel) ^ params.invert) ? 1 : 0));
@@ -955,7 +1047,7 @@ sphere_t voxel_model::get_bsphere() const {
 	sphere_t bsphere(center, 0.0);
 	
 	for (tri_data_t::const_iterator i = tri_data[0].begin(); i != tri_data[0].end(); ++i) {
-		for (vector<vertex_type_t>::const_iterator v = i->begin(); v != i->end(); ++v) {
+		for (auto v = i->begin(); v != i->end(); ++v) {
 			bsphere.radius = max(bsphere.radius, p2p_dist_sq(center, v->v));
 		}
 	}
@@ -1070,6 +1162,45 @@ bool voxel_model_ground::clear_block(unsigned block_ix) {
 }
 
 
+// returns the number of triangles extracted; ref_impl uses the original per-cell gather with a full block vertex cache (for benchmarking)
+unsigned voxel_model::extract_block(voxel_ix_cache &vix_cache, tri_data_t::value_type &tri_block, unsigned block_ix, bool count_only, unsigned lod_level, bool ref_impl) const {
+
+	unsigned const xbix(block_ix%params.num_blocks), ybix(block_ix/params.num_blocks), step(1 << lod_level);
+	unsigned const x0(xbix*xblocks), y0(ybix*yblocks);
+	unsigned count(0);
+
+	if (ref_impl) {
+		vix_cache.init(xblocks+1, yblocks+1, nz, vsz, zero_vector, vert_ix_cache_entry(), 1);
+
+		for (unsigned y = y0; y < y0+yblocks; y += step) {
+			unsigned const yslice[2] = {y-y0, min(y+step, ny-1)-y0};
+
+			for (unsigned x = x0; x < x0+xblocks; x += step) {
+				for (unsigned z = 0; z < nz; z += step) {
+					unsigned const cix(get_voxel_case(x, y, z, lod_level));
+					if (cix) {count += add_triangles_for_voxel(tri_block, vix_cache, x, y, z, cix, x0, yslice, count_only, lod_level);}
+				}
+			}
+		}
+		return count;
+	}
+	// sliding window of two y slices: the upper slice of one row becomes the lower slice of the next row
+	vix_cache.init(xblocks+1, 2, nz, vsz, zero_vector, vert_ix_cache_entry(), 1);
+	unsigned const slice_sz((xblocks+1)*nz);
+	vector<unsigned char> cases;
+
+	for (unsigned y = y0; y < y0+yblocks; y += step) {
+		unsigned const lo_slice(((y - y0) >> lod_level) & 1), yslice[2] = {lo_slice, 1-lo_slice};
+
+		for (unsigned x = x0; x < x0+xblocks; x += step) {
+			count += add_triangles_for_column(tri_block, vix_cache, x, y, x0, yslice, count_only, lod_level, cases);
+		}
+		fill(vix_cache.begin()+lo_slice*slice_sz, vix_cache.begin()+(lo_slice+1)*slice_sz, vert_ix_cache_entry()); // reuse as the next upper slice
+	}
+	return count;
+}
+
+
 // returns the number of triangles created
 unsigned voxel_model::create_block(voxel_ix_cache &vix_cache, unsigned block_ix, bool first_create, bool count_only, unsigned lod_level) {
 
@@ -1078,17 +1209,9 @@ unsigned voxel_model::create_block(voxel_ix_cache &vix_cache, unsigned block_ix,
 	assert(block_ix < td.size());
 	auto &tri_block(td[block_ix]);
 	assert(tri_block.empty());
-	vix_cache.init(xblocks+1, yblocks+1, nz, vsz, zero_vector, vert_ix_cache_entry(), 1);
-	unsigned const xbix(block_ix%params.num_blocks), ybix(block_ix/params.num_blocks), step(1 << lod_level);
-	unsigned count(0);
+	unsigned const xbix(block_ix%params.num_blocks), ybix(block_ix/params.num_blocks);
+	unsigned const count(extract_block(vix_cache, tri_block, block_ix, count_only, lod_level));
 
-	for (unsigned y = ybix*yblocks; y < (ybix+1)*yblocks; y += step) {
-		for (unsigned x = xbix*xblocks; x < (xbix+1)*xblocks; x += step) {
-			for (unsigned z = 0; z < nz; z += step) {
-				count += add_triangles_for_voxel(tri_block, vix_cache, x, y, z, xbix*xblocks, ybix*yblocks, count_only, lod_level);
-			}
-		}
-	}
 	if (!count_only) {
 		if (first_create) { // after the first creation pt_to_ix is out of order
 			assert(lod_level < pt_to_ix.size());
@@ -1119,6 +1242,37 @@ unsigned voxel_model::create_block_all_lods(unsigned block_ix, bool first_create
 }
 
 
+// times the reference vs. column/SIMD marching cubes extraction over all blocks and LODs and checks that the outputs are identical
+void voxel_model::run_mc_benchmark() const {
+
+	unsigned const tot_blocks(params.num_blocks*params.num_blocks), num_runs(tot_blocks*tri_data.size());
+	vector<tri_data_t::value_type> results[2];
+	unsigned num_tris[2] = {0, 0}, num_mismatch(0);
+	int times[2] = {0, 0};
+
+	for (unsigned impl = 0; impl < 2; ++impl) { // 0=column/SIMD, 1=reference
+		results[impl].resize(num_runs, tri_data_t::value_type(0));
+		voxel_ix_cache vix_cache;
+		int const start_time(GET_TIME_MS());
+
+		for (unsigned lod = 0; lod < tri_data.size(); ++lod) {
+			for (unsigned b = 0; b < tot_blocks; ++b) {
+				num_tris[impl] += extract_block(vix_cache, results[impl][lod*tot_blocks + b], b, 0, lod, (impl == 1));
+			}
+		}
+		times[impl] = GET_TIME_MS() - start_time;
+	}
+	for (unsigned i = 0; i < num_runs; ++i) {
+		tri_data_t::value_type const &a(results[0][i]), &b(results[1][i]);
+		bool same(a.size() == b.size() && a.num_verts() == b.num_verts() && equal(a.begin(), a.end(), b.begin()));
+		for (unsigned j = 0; j < a.num_verts() && same; ++j) {same = (a.get_ix(j) == b.get_ix(j));}
+		num_mismatch += !same;
+	}
+	cout << "Marching cubes " << nx << "x" << ny << "x" << nz << ", " << tri_data.size() << " LODs: reference " << times[1] << "ms, column" << (USE_SSE_MC ? "/SSE2 " : " ")
+		 << times[0] << "ms, triangles " << num_tris[0] << " / " << num_tris[1] << ", mismatched blocks: " << num_mismatch << endl;
+}
+
+
 void voxel_model_ground::create_block_hook(unsigned block_ix) { // lod_level == 0
 
 	if (!add_cobjs) return; // nothing to do
@@ -1549,6 +1703,7 @@ void voxel_model::build(bool verbose, bool do_ao_lighting) {
 		create_block_all_lods(block, 1, 0);
 	}
 	if (verbose) {PRINT_TIME("  Triangles to Model");}
+	if (verbose && voxel_mc_bench) {run_mc_benchmark();}
 
 	if (tot_blocks > 1) { // merge triangle vertices along block seams
 		for (unsigned block_ix = 0; block_ix < tot_blocks; ++block_ix) {
@@ -1673,14 +1828,15 @@ void voxel_model_space::setup_tex_gen_for_rendering(shader_t &s) {
 	voxel_model::setup_tex_gen_for_rendering(s);
 	
 	if (!ao_lighting.empty()) {
-		if (ao_tid == 0) {ao_tid = create_3d_texture(nx, ny, nz, 1, ao_lighting, GL_LINEAR, GL_CLAMP_TO_EDGE);}
+		if (ao_tid == 0) {assert(ao_lighting.size() == nx*ny*nz); ao_tid = create_3d_texture(nx, ny, nz, 1, &ao_lighting.front(), GL_LINEAR, GL_CLAMP_TO_EDGE);}
 		set_3d_texture_as_current(ao_tid, 9);
 	}
 	if (shadow_tid == 0) {
 		voxel_grid<unsigned char> shadow_data; // 0 == no light/in shadow, 255 = full light/no shadow
 		calc_shadows(shadow_data);
 		extract_shadow_edges(shadow_data);
-		shadow_tid = create_3d_texture(nx, ny, nz, 1, shadow_data, GL_LINEAR, GL_CLAMP_TO_EDGE);
+		assert(shadow_data.size() == nx*ny*nz);
+		shadow_tid = create_3d_texture(nx, ny, nz, 1, &shadow_data.front(), GL_LINEAR, GL_CLAMP_TO_EDGE);
 	}
 	set_3d_texture_as_current(shadow_tid, 10);
 }
@@ -115,22 +115,23 @@ public:
 
 
 // stored internally in yxz order
-template<typename V> class voxel_grid : public vector<V> {
+template<typename V> class voxel_grid : public tracked_vector<V, MEM_CAT_VOXELS> {
+	typedef tracked_vector<V, MEM_CAT_VOXELS> vect_t;
 	void init_grid(unsigned nx_, unsigned ny_, unsigned nz_, V default_val, unsigned num_blocks);
 public:
 	unsigned nx, ny, nz, xblocks, yblocks;
 	vector3d vsz; // size of a voxel in x,y,z
 	point center, lo_pos;
 
-	using vector<V>::clear;
-	using vector<V>::empty;
-	using vector<V>::size;
-	using vector<V>::at;
-	using vector<V>::operator[];
-	using vector<V>::resize;
-	using vector<V>::begin;
-	using vector<V>::end;
-	using vector<V>::front;
+	using vect_t::clear;
+	using vect_t::empty;
+	using vect_t::size;
+	using vect_t::at;
+	using vect_t::operator[];
+	using vect_t::resize;
+	using vect_t::begin;
+	using vect_t::end;
+	using vect_t::front;
 
 	voxel_grid() : nx(0), ny(0), nz(0), xblocks(0), yblocks(0), vsz(zero_vector) {}
 	void init(unsigned nx_, unsigned ny_, unsigned nz_, vector3d const &vsz_, point const &center_, V const &default_val, unsigned num_blocks=1);
@@ -198,8 +199,13 @@ protected:
 	void flood_fill_range(unsigned x1, unsigned y1, unsigned x2, unsigned y2, vector<unsigned> &work, unsigned char fill_val, unsigned char bit_mask);
 	void remove_unconnected_outside_range(bool keep_at_edge, unsigned x1, unsigned y1, unsigned x2, unsigned y2,
 		vector<unsigned> *xy_updated, vector<pt_ix_t> *updated_pts, bool mark_only=0);
-	unsigned add_triangles_for_voxel(tri_data_t::value_type &tri_verts, voxel_ix_cache &vix_cache,
-		unsigned x, unsigned y, unsigned z, unsigned block_x0, unsigned block_y0, bool count_only, unsigned lod_level) const;
+	bool check_under_mesh() const;
+	unsigned get_voxel_case(unsigned x, unsigned y, unsigned z, unsigned lod_level) const;
+	unsigned calc_column_cases(unsigned x, unsigned y, unsigned lod_level, vector<unsigned char> &cases) const;
+	unsigned add_triangles_for_voxel(tri_data_t::value_type &tri_verts, voxel_ix_cache &vix_cache, unsigned x, unsigned y, unsigned z, unsigned cix,
+		unsigned block_x0, unsigned const yslice[2], bool count_only, unsigned lod_level) const;
+	unsigned add_triangles_for_column(tri_data_t::value_type &tri_verts, voxel_ix_cache &vix_cache, unsigned x, unsigned y,
+		unsigned block_x0, unsigned const yslice[2], bool count_only, unsigned lod_level, vector<unsigned char> &cases) const;
 	void add_cobj_voxels(coll_obj &cobj, float filled_val);
 	void make_voxel_outside(unsigned ix);
 	void make_voxel_inside(unsigned ix);
@@ -284,8 +290,10 @@ protected:
 	void remove_unconnected_outside_modified_blocks(bool postproc_brushes_mode);
 	unsigned get_block_ix(unsigned voxel_ix) const;
 	virtual bool clear_block(unsigned block_ix);
+	unsigned extract_block(voxel_ix_cache &vix_cache, tri_data_t::value_type &tri_block, unsigned block_ix, bool count_only, unsigned lod_level, bool ref_impl=0) const;
 	unsigned create_block(voxel_ix_cache &vix_cache, unsigned block_ix, bool first_create, bool count_only, unsigned lod_level);
 	unsigned create_block_all_lods(unsigned block_ix, bool first_create, bool count_only);
+	void run_mc_benchmark() const;
 	void update_boundary_normals_for_block(unsigned block_ix, bool calc_average);
 	void finalize_boundary_vmap();
 	void calc_ao_dirs();
@@ -8,7 +8,8 @@
 #include "player_state.h"
 #include "draw_utils.h"
 #include "shaders.h"
-#include <queue>
+#include <list>
+#include <omp.h>
 
 
 int const WP_RESET_FRAMES      = 100; // Note: in frames, not ticks, fix?
@@ -19,6 +20,7 @@ float const STEP_SIZE_MULT2    = 0.50; // reachability tests (relative to smiley
 
 bool has_user_placed(0), has_item_placed(0), has_wpt_goal(0);
 int show_waypoints(0); // 0=none, 1=waypoints, 2=waypoints+edges
+unsigned waypoint_bench_agents(0); // if nonzero, run a path query benchmark with this many agents after creating waypoints
 waypoint_vector waypoints;
 
 extern bool use_waypoints;
@@ -74,7 +76,7 @@ bool waypt_used_set::is_valid(unsigned wp) { // called to determine whether or n
 
 waypoint_t::waypoint_t(point const &p, int cid, bool up, bool i, bool g, bool t)
 	: user_placed(up), placed_item(i), goal(g), temp(t), visited(0), disabled(0), next_valid(0),
-	came_from(-1), item_group(-1), item_ix(-1), coll_id(cid), connected_to(-1), g_score(0), h_score(0), f_score(0), pos(p)
+	item_group(-1), item_ix(-1), coll_id(cid), connected_to(-1), pos(p)
 {
 	clear();
 }
@@ -128,6 +130,7 @@ wpt_ix_t waypoint_vector::add(waypoint_t const &w) {
 		push_back(w);
 	}
 	operator[](ix).disabled = 0;
+	mark_changed();
 	return ix;
 }
 
@@ -135,6 +138,7 @@ wpt_ix_t waypoint_vector::add(waypoint_t const &w) {
 void waypoint_vector::remove(wpt_ix_t ix) {
 
 	assert(ix < size());
+	mark_changed();
 	
 	if (unsigned(ix+1) == size()) { // last element
 		pop_back();
@@ -405,6 +409,7 @@ public:
 		assert(waypoints.back().temp); // too strict?
 		disconnect_waypoint((unsigned)waypoints.size()-1, 1);
 		waypoints.pop_back();
+		waypoints.mark_changed();
 	}
 
 	void remove_cobj_waypoint(coll_obj const &c) {
@@ -430,6 +435,7 @@ public:
 		unsigned visible(0), cand_edges(0), num_edges(0), tot_steps(0);
 		float const fast_dmax(0.25*(X_SCENE_SIZE + Y_SCENE_SIZE));
 		for (int i = from_start; i < (int)from_end; ++i) {waypoints[i].next_valid = 0;}
+		waypoints.mark_changed();
 		vector<pair<float, unsigned> > cands;
 
 		#pragma omp parallel for schedule(dynamic,1) private(cands) // is this fully thread safe? it's not determinstic across threads
@@ -570,21 +576,101 @@ public:
 // ********** waypoint_search **********
 
 
-struct waypoint_cache {
+// caller-owned A* scratch state, so that multiple path queries can run in parallel against the read-only waypoint graph
+class waypoint_search_state {
 
-	vector<unsigned> open, closed; // tentative/already evaulated nodes
+	struct node_t {
+		float g_score, f_score; // cost from start along best known path, estimated total cost from start to goal through this node
+		int came_from;
+		unsigned call_ix, heap_pos; // node is only valid if call_ix matches
+		bool closed;
+		node_t() : g_score(0.0), f_score(0.0), came_from(-1), call_ix(0), heap_pos(0), closed(0) {}
+	};
+	vector<node_t> nodes;
+	vector<unsigned> heap; // binary min-heap of open node indices ordered by f_score
 	unsigned call_ix; // incremented each run_a_star() call
-	waypoint_cache() : call_ix(0) {}
+
+	bool heap_less(unsigned a, unsigned b) const {return (nodes[heap[a]].f_score < nodes[heap[b]].f_score);}
+
+	void heap_swap(unsigned a, unsigned b) {
+		swap(heap[a], heap[b]);
+		nodes[heap[a]].heap_pos = a;
+		nodes[heap[b]].heap_pos = b;
+	}
+	void sift_up(unsigned pos) {
+		while (pos > 0) {
+			unsigned const parent((pos - 1) >> 1);
+			if (!heap_less(pos, parent)) break;
+			heap_swap(pos, parent);
+			pos = parent;
+		}
+	}
+	void sift_down(unsigned pos) {
+		while (1) {
+			unsigned const c1(2*pos + 1), c2(c1 + 1);
+			if (c1 >= heap.size()) break;
+			unsigned const c((c2 < heap.size() && heap_less(c2, c1)) ? c2 : c1);
+			if (!heap_less(c, pos)) break;
+			heap_swap(pos, c);
+			pos = c;
+		}
+	}
+
+public:
+	waypoint_search_state() : call_ix(0) {}
+
+	void start_search(unsigned num_nodes) {
+		nodes.resize(num_nodes); // already resized after the first call
+		heap.clear();
+		
+		if (++call_ix == 0) { // wraparound - invalidate all nodes
+			for (auto i = nodes.begin(); i != nodes.end(); ++i) {i->call_ix = 0;}
+			call_ix = 1;
+		}
+	}
+	bool is_visited(unsigned ix) const {assert(ix < nodes.size()); return (nodes[ix].call_ix == call_ix);}
+	bool is_closed (unsigned ix) const {return (is_visited(ix) &&  nodes[ix].closed);}
+	bool is_open   (unsigned ix) const {return (is_visited(ix) && !nodes[ix].closed);}
+	float get_g_score(unsigned ix) const {assert(is_visited(ix)); return nodes[ix].g_score;}
+	float get_f_score(unsigned ix) const {assert(is_visited(ix)); return nodes[ix].f_score;}
+	int get_came_from(unsigned ix) const {assert(is_visited(ix)); return nodes[ix].came_from;}
+	bool open_empty() const {return heap.empty();}
+
+	// adds ix to the open set, or updates its scores and decreases its key if it's already open
+	void update_open(unsigned ix, float g_score, float f_score, int came_from) {
+		assert(!is_closed(ix));
+		node_t &n(nodes[ix]);
+		bool const was_open(is_open(ix));
+		n.g_score   = g_score;
+		n.f_score   = f_score;
+		n.came_from = came_from;
+
+		if (was_open) {sift_up(n.heap_pos); return;} // decrease key
+		n.call_ix  = call_ix;
+		n.closed   = 0;
+		n.heap_pos = (unsigned)heap.size();
+		heap.push_back(ix);
+		sift_up(n.heap_pos);
+	}
+	unsigned pop_and_close() { // removes the open node with min f_score and moves it to the closed set
+		assert(!heap.empty());
+		unsigned const ix(heap.front());
+		heap_swap(0, (unsigned)heap.size()-1);
+		heap.pop_back();
+		if (!heap.empty()) {sift_down(0);}
+		nodes[ix].closed = 1;
+		return ix;
+	}
 };
 
-waypoint_cache global_wpt_cache;
+waypoint_search_state global_wpt_search_state; // for serial queries from the main thread
 
 
 class waypoint_search {
 
 	wpt_goal goal;
 	waypoint_builder wb;
-	waypoint_cache &wc;
+	waypoint_search_state &wss;
 
 	float get_h_dist(unsigned cur) const {
 		return ((goal.mode >= 4) ? p2p_dist(waypoints[cur].pos, goal.pos) : 0.0);
@@ -608,99 +694,244 @@ class waypoint_search {
 		}
 		return 0;
 	}
-	void reconstruct_path(unsigned cur, vector<unsigned> &path) {
-		assert(cur >= 0 && cur < waypoints.size());
-		if (waypoints[cur].came_from >= 0) {reconstruct_path(waypoints[cur].came_from, path);}
-		path.push_back(cur);
+	void reconstruct_path(unsigned cur, vector<unsigned> &path) const {
+		unsigned const start_ix((unsigned)path.size());
+
+		for (int ix = (int)cur; ix >= 0; ix = wss.get_came_from(ix)) { // iterate from the goal back to the start
+			assert((unsigned)ix < waypoints.size());
+			path.push_back(ix);
+		}
+		reverse(path.begin()+start_ix, path.end());
 	}
 
 public:
-	waypoint_search(wpt_goal const &goal_, waypoint_cache &wc_) : goal(goal_), wc(wc_) {}
+	waypoint_search(wpt_goal const &goal_, waypoint_search_state &wss_) : goal(goal_), wss(wss_) {}
+
+	// converts goal modes 5 and 6 (closest waypoint) into mode 4 (specific waypoint); returns false if there is no such waypoint
+	static bool resolve_goal(wpt_goal &goal) {
+		if (goal.mode != 5 && goal.mode != 6) return 1; // nothing to do
+		int const wpt(waypoint_builder().find_closest_waypoint(goal.pos, (goal.mode == 6)));
+		if (wpt < 0) return 0; // no waypoint (maybe none visible)
+		goal.wpt  = wpt;
+		goal.mode = 4;
+		return 1;
+	}
 
 	// returns min distance to goal following connected waypoints along path
 	float run_a_star(vector<pair<unsigned, float> > const &start, vector<unsigned> &path, set<unsigned> const &wps_penalty) {
 		if (!goal.is_reachable()) return 0.0; // nothing to do
 		assert(path.empty());
 		bool const orig_has_wpt_goal(has_wpt_goal);
-		if (goal.mode == 4) {goal.pos = waypoints[goal.wpt].pos;} // specific waypoint
-		if (goal.mode == 5) {goal.wpt = wb.find_closest_waypoint(goal.pos, 0);}
-		if (goal.mode == 6) {goal.wpt = wb.find_closest_waypoint(goal.pos, 1);}
-		if (goal.mode == 7) {goal.wpt = wb.add_new_waypoint(goal.pos, -1, 1, 1, 1, 1);} // goal position - add temp waypoint
+		if (!resolve_goal(goal)) return 0.0; // no current waypoint (maybe none visible)
+		if (goal.mode == 7) {goal.wpt = wb.add_new_waypoint(goal.pos, -1, 1, 1, 1, 1);} // goal position - add temp waypoint (not thread safe)
 		if (goal.mode == 7) {has_wpt_goal = 1;}
+		if (goal.mode >= 4) {goal.pos = waypoints[goal.wpt].pos;} // specific waypoint
 		//cout << "start: " << start.size() << ", goal: mode: " << goal.mode << ", pos: " << goal.pos.str() << ", wpt: " << goal.wpt << endl;
-		if (goal.wpt < 0) return 0.0; // no current waypoint (maybe none visible)
-		std::priority_queue<pair<float, unsigned> > open_queue;
-		wc.open.resize(waypoints.size(), 0); // already resized after the first call
-		wc.closed.resize(waypoints.size(), 0);
-		++wc.call_ix;
+		float const min_dist(run_a_star_inner(start, path, wps_penalty));
+
+		if (goal.mode == 7) {
+			wb.remove_last_waypoint(); // goal position - remove temp waypoint
+			has_wpt_goal = orig_has_wpt_goal;
+		}
+		return min_dist;
+	}
+
+private:
+	float run_a_star_inner(vector<pair<unsigned, float> > const &start, vector<unsigned> &path, set<unsigned> const &wps_penalty) {
+		wss.start_search((unsigned)waypoints.size());
 
 		for (vector<pair<unsigned, float> >::const_iterator i = start.begin(); i != start.end(); ++i) {
 			unsigned const ix(i->first);
 			assert(ix < waypoints.size());
-			waypoint_t &w(waypoints[ix]);
-			w.g_score   = i->second; // cost from start along best known path
-			w.h_score   = get_h_dist(ix);
-			//if (wps_penalty.find(ix) != wps_penalty.end()) {w.h_score *= 10.0;} // distance penalty for this waypoint
-			w.f_score   = w.h_score; // estimated total cost from start to goal through current
-			w.came_from = -1;
+			float const h_score(get_h_dist(ix));
+			//if (wps_penalty.find(ix) != wps_penalty.end()) {h_score *= 10.0;} // distance penalty for this waypoint
 
 			if (is_goal(ix)) { // already at the goal
 				path.push_back(ix);
-				return w.f_score;
+				return h_score;
 			}
-			wc.open[ix] = wc.call_ix;
-			open_queue.push(make_pair(-w.f_score, ix));
+			if (!wss.is_open(ix) || i->second < wss.get_g_score(ix)) {wss.update_open(ix, i->second, h_score, -1);}
 		}
 		if (goal.mode >= 4 && waypoints[goal.wpt].unreachable()) return 0.0; // goal has no incoming edges - unreachable
-		float min_dist(0.0);
 
-		while (!open_queue.empty()) {
-			unsigned const cur(open_queue.top().second);
-			open_queue.pop();
-			if (wc.closed[cur] == wc.call_ix) continue; // already closed (duplicate)
+		while (!wss.open_empty()) {
+			unsigned const cur(wss.pop_and_close());
 			waypoint_t const &cw(waypoints[cur]);
 
 			if (is_goal(cur)) {
 				reconstruct_path(cur, path);
-				min_dist = cw.f_score;
-				break; // we're done
+				return wss.get_f_score(cur); // we're done
 			}
-			assert(wc.closed[cur] != wc.call_ix);
-			wc.closed[cur] = wc.call_ix;
-			wc.open[cur]   = 0;
+			float const cur_g_score(wss.get_g_score(cur));
 
 			for (waypt_adj_vect::const_iterator i = cw.next_wpts.begin(); i != cw.next_wpts.end(); ++i) {
-				if (wc.closed[*i] == wc.call_ix) continue; // already closed (duplicate)
+				if (wss.is_closed(*i)) continue; // already closed
 				assert(*i < waypoints.size());
-				waypoint_t &wn(waypoints[*i]);
+				waypoint_t const &wn(waypoints[*i]);
 				// if not connected by a teleporter, use distance between the waypoints; otherswise, use a small but nonzero value
-				float const new_g_score(cw.g_score + ((cw.connected_to == *i) ? CAMERA_RADIUS : p2p_dist(cw.pos, wn.pos)));
-				bool better(0);
-
-				if (wc.open[*i] != wc.call_ix) {
-					wc.open[*i] = wc.call_ix;
-					better = 1;
-				}
-				else if (new_g_score < wn.g_score) {
-					better = 1;
-				}
-				if (better) {
-					wn.came_from = cur;
-					wn.g_score   = new_g_score;
-					wn.h_score   = get_h_dist(*i);
-					wn.f_score   = wn.g_score + wn.h_score;
-					open_queue.push(make_pair(-wn.f_score, *i));
-				}
+				float const new_g_score(cur_g_score + ((cw.connected_to == *i) ? CAMERA_RADIUS : p2p_dist(cw.pos, wn.pos)));
+				if (wss.is_open(*i) && new_g_score >= wss.get_g_score(*i)) continue; // not better
+				wss.update_open(*i, new_g_score, (new_g_score + get_h_dist(*i)), cur);
 			} // for i
 		}
-		if (goal.mode == 7) {
-			wb.remove_last_waypoint(); // goal position - remove temp waypoint
-			has_wpt_goal = orig_has_wpt_goal;
+		return 0.0; // no path found
+	}
+};
+
+
+// LRU cache of recent path query results for goals that only depend on the waypoint graph
+class waypoint_path_cache {
+
+	struct key_t {
+		unsigned start, wpt;
+		int mode;
+		key_t(unsigned s, wpt_goal const &g) : start(s), wpt((g.mode == 4) ? g.wpt : 0), mode(g.mode) {}
+		bool operator<(key_t const &k) const {
+			if (start != k.start) return (start < k.start);
+			if (mode  != k.mode ) return (mode  < k.mode );
+			return (wpt < k.wpt);
 		}
-		return min_dist;
+	};
+	typedef std::list<pair<key_t, pair<int, float> > > lru_list_t; // {key, {next_wpt, dist}}, most recently used first
+	lru_list_t lru;
+	map<key_t, lru_list_t::iterator> lookup;
+	unsigned graph_version, max_entries;
+
+public:
+	waypoint_path_cache(unsigned max_entries_=256) : graph_version(0), max_entries(max_entries_) {}
+
+	static bool is_cacheable(wpt_goal const &goal) {return (goal.mode == 1 || goal.mode == 3 || goal.mode == 4);} // static goals only
+	
+	void clear() {
+		lru.clear();
+		lookup.clear();
+	}
+	void check_graph_version() {
+		if (waypoints.get_version() == graph_version) return;
+		clear();
+		graph_version = waypoints.get_version();
+	}
+	bool find(unsigned start, wpt_goal const &goal, int &next_wpt, float &dist) {
+		if (!is_cacheable(goal)) return 0;
+		auto it(lookup.find(key_t(start, goal)));
+		if (it == lookup.end()) return 0;
+		lru.splice(lru.begin(), lru, it->second); // move to front
+		next_wpt = it->second->second.first;
+		dist     = it->second->second.second;
+		return 1;
+	}
+	void insert(unsigned start, wpt_goal const &goal, int next_wpt, float dist) {
+		if (!is_cacheable(goal) || max_entries == 0) return;
+		key_t const key(start, goal);
+		if (lookup.find(key) != lookup.end()) return; // already cached
+		
+		if (lru.size() >= max_entries) { // evict least recently used
+			lookup.erase(lru.back().first);
+			lru.pop_back();
+		}
+		lru.push_front(make_pair(key, make_pair(next_wpt, dist)));
+		lookup[key] = lru.begin();
 	}
 };
 
+waypoint_path_cache wpt_path_cache;
+vector<waypoint_search_state> thread_wpt_search_states; // for parallel path queries
+
+
+int get_next_wpt_on_path(unsigned cur, vector<unsigned> const &path) {
+	if (path.empty())     return -1; // no path to goal
+	assert(path[0] == cur);
+	if (path.size() == 1) return cur; // already at goal
+	return path[1];
+}
+
+
+// batched version of find_optimal_next_waypoint(); serial cache lookups, with A* runs for cache misses done in parallel
+void find_optimal_next_waypoints(vector<wpt_path_query_t> &queries) {
+
+	if (queries.empty()) return;
+	wpt_path_cache.check_graph_version();
+	vector<unsigned> to_search;
+	unsigned const num_threads(max(1, omp_get_max_threads()));
+	if (thread_wpt_search_states.size() < num_threads) {thread_wpt_search_states.resize(num_threads);}
+
+#pragma omp parallel for schedule(dynamic,4)
+	for (int i = 0; i < (int)queries.size(); ++i) { // resolve closest waypoint goals first so that they can be cached
+		wpt_path_query_t &q(queries[i]);
+		q.next_wpt = -1;
+		q.dist     = 0.0;
+		if (!q.goal.is_reachable() || !waypoint_search::resolve_goal(q.goal)) {q.goal.mode = 0;} // mark as unreachable
+	}
+	for (unsigned i = 0; i < queries.size(); ++i) {
+		wpt_path_query_t &q(queries[i]);
+		assert(q.start < waypoints.size());
+		if (q.goal.mode == 0) continue; // unreachable
+		if (wpt_path_cache.find(q.start, q.goal, q.next_wpt, q.dist)) continue; // cached
+		
+		if (q.goal.mode == 7) { // adds a temp waypoint to the graph, so must be done serially
+			vector<unsigned> path;
+			q.dist     = waypoint_search(q.goal, global_wpt_search_state).run_a_star(vector<pair<unsigned, float> >(1, make_pair(q.start, 0.0f)), path, set<unsigned>());
+			q.next_wpt = get_next_wpt_on_path(q.start, path);
+			continue;
+		}
+		to_search.push_back(i);
+	}
+#pragma omp parallel for schedule(dynamic,1)
+	for (int i = 0; i < (int)to_search.size(); ++i) {
+		wpt_path_query_t &q(queries[to_search[i]]);
+		vector<unsigned> path;
+		waypoint_search ws(q.goal, thread_wpt_search_states[omp_get_thread_num()]);
+		q.dist     = ws.run_a_star(vector<pair<unsigned, float> >(1, make_pair(q.start, 0.0f)), path, set<unsigned>());
+		q.next_wpt = get_next_wpt_on_path(q.start, path);
+	}
+	for (auto i = to_search.begin(); i != to_search.end(); ++i) {
+		wpt_path_query_t const &q(queries[*i]);
+		wpt_path_cache.insert(q.start, q.goal, q.next_wpt, q.dist);
+	}
+}
+
+
+// times serial single path queries vs. batched path queries (with an empty and a full cache) for num_agents random {start, goal} pairs
+// on the current waypoint graph, and checks that all three produce the same next waypoints
+void run_waypoint_path_benchmark(unsigned num_agents) {
+
+	if (num_agents == 0 || waypoints.size() < 2) return;
+	rand_gen_t rgen;
+	vector<wpt_path_query_t> queries;
+
+	for (unsigned i = 0; i < num_agents; ++i) {
+		unsigned const start(rgen.rand()%waypoints.size()), goal(rgen.rand()%waypoints.size());
+		if (waypoints[start].disabled || waypoints[goal].disabled) continue;
+		queries.push_back(wpt_path_query_t(start, wpt_goal(4, goal, all_zeros)));
+	}
+	cout << "Waypoint path benchmark: " << queries.size() << " agents, " << waypoints.size() << " waypoints" << endl;
+	vector<int> serial_wpts(queries.size(), -1);
+	unsigned num_paths(0);
+	{
+		timer_t timer("  Serial Single Path Queries");
+		for (unsigned i = 0; i < queries.size(); ++i) {serial_wpts[i] = find_optimal_next_waypoint(queries[i].start, queries[i].goal, set<unsigned>());}
+	}
+	vector<wpt_path_query_t> queries2(queries);
+	wpt_path_cache.clear(); // time the batch without cached results
+	{
+		timer_t timer("  Batched Path Queries");
+		find_optimal_next_waypoints(queries);
+	}
+	{
+		timer_t timer("  Batched Path Queries (cached)");
+		find_optimal_next_waypoints(queries2);
+	}
+	unsigned num_mismatch(0), num_cache_mismatch(0);
+	
+	for (unsigned i = 0; i < queries.size(); ++i) {
+		num_paths          += (serial_wpts[i] >= 0);
+		num_mismatch       += (queries [i].next_wpt != serial_wpts[i]);
+		num_cache_mismatch += (queries2[i].next_wpt != serial_wpts[i]);
+	}
+	cout << "  Paths found: " << num_paths << ", batch vs. serial mismatches: " << num_mismatch << ", cached batch vs. serial mismatches: " << num_cache_mismatch << endl;
+	assert(num_mismatch == 0 && num_cache_mismatch == 0);
+}
+
 
 // ********** waypoint top level code **********
 
@@ -728,6 +959,7 @@ void create_waypoints(vector<user_waypt_t> const &user_waypoints) {
 	}
 	wb.connect_all_waypoints();
 	PRINT_TIME("  Waypoint Connectivity");
+	run_waypoint_path_benchmark(waypoint_bench_agents);
 }
 
 
@@ -737,15 +969,12 @@ int find_optimal_next_waypoint(unsigned cur, wpt_goal const &goal, set<unsigned>
 	if (!goal.is_reachable()) return -1; // nothing to do
 	//RESET_TIME;
 	vector<unsigned> path;
-	waypoint_search ws(goal, global_wpt_cache);
+	waypoint_search ws(goal, global_wpt_search_state);
 	vector<pair<unsigned, float> > start;
 	start.push_back(make_pair(cur, 0.0));
 	ws.run_a_star(start, path, wps_penalty);
 	//PRINT_TIME("A Star");
-	if (path.empty())     return -1; // no path to goal
-	assert(path[0] == cur);
-	if (path.size() == 1) return cur; // already at goal
-	return path[1];
+	return get_next_wpt_on_path(cur, path);
 }
 
 
@@ -778,7 +1007,7 @@ void find_optimal_waypoint(point const &pos, vector<od_data> &oddatav, wpt_goal
 			start.push_back(make_pair(id, dist));
 		}
 	}
-	waypoint_search ws(goal, global_wpt_cache);
+	waypoint_search ws(goal, global_wpt_search_state);
 	vector<unsigned> path;
 	ws.run_a_star(start, path, set<unsigned>());
 	//PRINT_TIME("Find Optimal Waypoint");